@@ -0,0 +1,329 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include "Comms/Comms.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FIQCPPBASE;
+
+namespace Microsoft {
+	namespace VisualStudio {
+		namespace CppUnitTestFramework {
+			template<>
+			std::wstring ToString<Comms::Result>(const enum Comms::Result& rc) { return std::to_wstring(static_cast<int>(rc)); }
+		}
+	}
+}
+
+namespace fiQCPPBaseTESTS
+{
+	// TestClient: Comms client recording each event it receives, so that test methods can wait for them
+	class TestClient : public CommsClient
+	{
+	public:
+		void IBConnect(unsigned int session) override {
+			{std::lock_guard<std::mutex> lock(eventlock);
+			connected.push_back(session);}
+			eventcv.notify_all();
+		}
+		void IBData(unsigned int session, _In_reads_(len) const char* buf, size_t len) override {
+			{std::lock_guard<std::mutex> lock(eventlock);
+			packets[session].emplace_back(buf, len);}
+			eventcv.notify_all();
+		}
+		void IBDisconnect(unsigned int session) override {
+			{std::lock_guard<std::mutex> lock(eventlock);
+			disconnected.push_back(session);}
+			eventcv.notify_all();
+		}
+		void IBDraining(unsigned int session) override {
+			{std::lock_guard<std::mutex> lock(eventlock);
+			draining.push_back(session);}
+			eventcv.notify_all();
+		}
+
+		// WaitFor: Wait up to Timeout milliseconds for recorded events to satisfy predicate (called under event lock)
+		template<typename P>
+		bool WaitFor(P predicate, int Timeout) {
+			std::unique_lock<std::mutex> lock(eventlock);
+			return eventcv.wait_for(lock, std::chrono::milliseconds(Timeout), predicate);
+		}
+		// WaitConnected: Wait for next session to connect, returning its ticket (zero if none connected)
+		unsigned int WaitConnected(int Timeout) {
+			return WaitFor([this]() {return (connected.size() > nextconnected);}, Timeout) ? connected[nextconnected++] : 0;
+		}
+		// WaitPackets: Wait for session to have received specified number of packets
+		bool WaitPackets(unsigned int session, size_t count, int Timeout) {
+			return WaitFor([this, session, count]() {return (packets[session].size() >= count);}, Timeout);
+		}
+		// WaitDisconnected: Wait for session to disconnect
+		bool WaitDisconnected(unsigned int session, int Timeout) {
+			return WaitFor([this, session]() {
+				return (std::find(disconnected.cbegin(), disconnected.cend(), session) != disconnected.cend());
+			}, Timeout);
+		}
+		// WaitDraining: Wait for session to start draining
+		bool WaitDraining(unsigned int session, int Timeout) {
+			return WaitFor([this, session]() {
+				return (std::find(draining.cbegin(), draining.cend(), session) != draining.cend());
+			}, Timeout);
+		}
+		// Packet: Retrieve copy of packet received on session
+		std::string Packet(unsigned int session, size_t index) {
+			std::lock_guard<std::mutex> lock(eventlock);
+			return (packets[session].size() > index ? packets[session][index] : std::string());
+		}
+
+		TestClient() : CommsClient(clientname) {}
+
+	private:
+		const std::string clientname = "TestClient";
+		std::mutex eventlock;
+		std::condition_variable eventcv;
+		std::vector<unsigned int> connected;
+		size_t nextconnected = 0;
+		std::vector<unsigned int> disconnected;
+		std::vector<unsigned int> draining;
+		std::map<unsigned int, std::vector<std::string>> packets;
+	};
+
+	// TcpRoundTrip: Connect to local listener on specified port, exchange packets in both directions (including one of
+	// maximum size) and disconnect, using whichever backend Comms was initialized with
+	void TcpRoundTrip(unsigned short port)
+	{
+		std::string errstring;
+		const auto server = std::make_shared<TestClient>(), client = std::make_shared<TestClient>();
+		const auto listen = std::make_shared<Connection>(), remote = std::make_shared<Connection>();
+		listen->SetLocal(port);
+		remote->SetRemote(std::string("127.0.0.1"), port);
+		const Comms::ListenerTicket listener = Comms::RegisterListener(server, listen, &errstring);
+		Assert::IsTrue(Comms::TicketValid(listener),
+			(L"RegisterListener: " + StringOps::ConvertToWideString(errstring)).c_str());
+
+		// Connect, and ensure both sides are notified:
+		const Comms::SessionTicket session = Comms::RequestConnect(client, remote, &errstring);
+		Assert::IsTrue(Comms::TicketValid(session),
+			(L"RequestConnect: " + StringOps::ConvertToWideString(errstring)).c_str());
+		Assert::AreEqual(session, client->WaitConnected(2000), L"Outbound session not connected");
+		const unsigned int accepted = server->WaitConnected(2000);
+		Assert::IsTrue(Comms::TicketValid(accepted), L"Session not accepted");
+
+		// Exchange packets in each direction:
+		const std::string large(Comms::PACKET_SIZE_MAX, 'X');
+		Assert::AreEqual(Comms::Result::OK, Comms::Send(session, "HELLO", 5), L"Send failed");
+		Assert::AreEqual(Comms::Result::OK, Comms::Send(session, large.data(), large.size()), L"Large send failed");
+		Assert::IsTrue(server->WaitPackets(accepted, 2, 2000), L"Packets not received");
+		Assert::AreEqual(std::string("HELLO"), server->Packet(accepted, 0), L"Invalid packet received");
+		Assert::IsTrue(server->Packet(accepted, 1) == large, L"Invalid large packet received");
+		Assert::AreEqual(Comms::Result::OK, Comms::Send(accepted, "WORLD", 5), L"Reply failed");
+		Assert::IsTrue(client->WaitPackets(session, 1, 2000), L"Reply not received");
+		Assert::AreEqual(std::string("WORLD"), client->Packet(session, 0), L"Invalid reply received");
+
+		// Disconnect, and ensure accepting side is notified:
+		Assert::AreEqual(Comms::Result::OK, Comms::Disconnect(session), L"Disconnect failed");
+		Assert::IsTrue(client->WaitDisconnected(session, 2000), L"Outbound session not disconnected");
+		Assert::IsTrue(server->WaitDisconnected(accepted, 2000), L"Accepted session not disconnected");
+		Comms::DeregisterListener(listener, 2000);
+	}
+
+	// InProcConnect: Register in-process listener with specified name and connect to it, returning tickets of outbound
+	// session and of session accepted for it
+	Comms::ListenerTicket InProcConnect(const std::string& name, const std::shared_ptr<TestClient>& server,
+		const std::shared_ptr<TestClient>& client, Comms::SessionTicket& session, unsigned int& accepted)
+	{
+		std::string errstring;
+		const auto listen = std::make_shared<Connection>(), remote = std::make_shared<Connection>();
+		listen->SetLocal("inproc://" + name);
+		remote->SetRemote("inproc://" + name);
+		const Comms::ListenerTicket listener = Comms::RegisterListener(server, listen, &errstring);
+		Assert::IsTrue(Comms::TicketValid(listener),
+			(L"RegisterListener: " + StringOps::ConvertToWideString(errstring)).c_str());
+		session = Comms::RequestConnect(client, remote, &errstring);
+		Assert::IsTrue(Comms::TicketValid(session),
+			(L"RequestConnect: " + StringOps::ConvertToWideString(errstring)).c_str());
+		Assert::AreEqual(session, client->WaitConnected(2000), L"Outbound session not connected");
+		accepted = server->WaitConnected(2000);
+		Assert::IsTrue(Comms::TicketValid(accepted), L"Session not accepted");
+		return listener;
+	}
+
+	TEST_CLASS(Comms_TEST)
+	{
+	public:
+
+		TEST_CLASS_INITIALIZE(Class_Init)
+		{
+			SocketOps::InitializeSockets(false);
+			Comms::Initialize(2);
+		}
+		TEST_CLASS_CLEANUP(Class_Cleanup)
+		{
+			Comms::Cleanup();
+			SocketOps::CleanupSockets();
+		}
+
+		TEST_METHOD(TcpSession)
+		{
+			TcpRoundTrip(11230);
+		}
+
+		TEST_METHOD(PooledNamedRemote)
+		{
+			std::string errstring;
+			const auto server = std::make_shared<TestClient>(), client = std::make_shared<TestClient>();
+			const auto listen = std::make_shared<Connection>(), pooled = std::make_shared<Connection>();
+			listen->SetLocal(11231);
+			pooled->SetRemote(std::string("localhost"), 11231).SetFlags(CommFlags::Pooled);
+			const Comms::ListenerTicket listener = Comms::RegisterListener(server, listen, &errstring);
+			Assert::IsTrue(Comms::TicketValid(listener),
+				(L"RegisterListener: " + StringOps::ConvertToWideString(errstring)).c_str());
+
+			// Pool should resolve remote name and warm a socket to one of its addresses (any address which does not accept
+			// a connection is retried after the next, so allow for at least one retry interval):
+			Assert::AreEqual(Comms::Result::OK, Comms::PreparePool(pooled), L"PreparePool failed");
+			ConnectionPool::PoolStats poolstats;
+			for(int i = 0; i < 100 && Comms::ResultOK(Comms::GetPoolStats(pooled, poolstats)) && poolstats.Idle == 0; ++i)
+				Sleep(50);
+			Assert::AreEqual(size_t{1}, poolstats.Idle, L"Pooled socket not connected to named remote");
+
+			// Session should lease the warm socket, counting it as a single connection attempt, and exchange data:
+			const Comms::SessionTicket session = Comms::RequestConnect(client, pooled, &errstring);
+			Assert::IsTrue(Comms::TicketValid(session),
+				(L"RequestConnect: " + StringOps::ConvertToWideString(errstring)).c_str());
+			Assert::AreEqual(session, client->WaitConnected(2000), L"Leased session not connected");
+			Assert::AreEqual(Comms::Result::OK, Comms::GetPoolStats(pooled, poolstats), L"GetPoolStats failed");
+			Assert::AreEqual(1ULL, poolstats.Leased, L"Socket not leased from pool");
+			Comms::SessionStats stats;
+			Assert::AreEqual(Comms::Result::OK, Comms::GetStats(session, stats), L"GetStats failed");
+			Assert::AreEqual(1U, stats.ConnectAttempts, L"Invalid connection attempt count");
+			const unsigned int accepted = server->WaitConnected(2000);
+			Assert::IsTrue(Comms::TicketValid(accepted), L"Pooled socket not accepted");
+			Assert::AreEqual(Comms::Result::OK, Comms::Send(session, "HELLO", 5), L"Send failed");
+			Assert::IsTrue(server->WaitPackets(accepted, 1, 2000), L"Packet not received");
+			Assert::AreEqual(std::string("HELLO"), server->Packet(accepted, 0), L"Invalid packet received");
+
+			Assert::AreEqual(Comms::Result::OK, Comms::Disconnect(session), L"Disconnect failed");
+			Assert::IsTrue(server->WaitDisconnected(accepted, 2000), L"Accepted session not disconnected");
+			Comms::DeregisterListener(listener, 2000);
+		}
+
+		TEST_METHOD(SendPieces)
+		{
+			using Piece = gsl::span<const char>;
+			using Pieces = gsl::span<const Piece>;
+			const auto server = std::make_shared<TestClient>(), client = std::make_shared<TestClient>();
+			Comms::SessionTicket session = 0;
+			unsigned int accepted = 0;
+			const Comms::ListenerTicket listener = InProcConnect("sendpieces", server, client, session, accepted);
+
+			// Pieces (including zero-length pieces, which are skipped) should arrive as one packet, in order:
+			const Piece pieces[] = {Piece("HEAD", 4), Piece(), Piece("BODY", 4), Piece("BODY", 0), Piece("TAIL", 4)};
+			Assert::AreEqual(Comms::Result::OK, Comms::Send(session, Pieces(pieces, 5)), L"Send of pieces failed");
+
+			// Up to SEND_PIECES_MAX pieces may be sent, totalling up to PACKET_SIZE_MAX bytes:
+			const std::string large(Comms::PACKET_SIZE_MAX, 'X');
+			std::vector<Piece> many(Comms::SEND_PIECES_MAX, Piece("B", 1));
+			many.back() = Piece(large.data(), large.size() - (many.size() - 1));
+			Assert::AreEqual(Comms::Result::OK, Comms::Send(session, Pieces(many.data(), many.size())),
+				L"Send of maximum pieces failed");
+			Assert::IsTrue(server->WaitPackets(accepted, 2, 2000), L"Packets not received");
+			Assert::AreEqual(std::string("HEADBODYTAIL"), server->Packet(accepted, 0), L"Invalid packet received");
+			Assert::IsTrue(server->Packet(accepted, 1)
+				== std::string(many.size() - 1, 'B') + large.substr(0, large.size() - (many.size() - 1)),
+				L"Invalid maximum packet received");
+
+			// More than SEND_PIECES_MAX pieces (even if some are empty), no data at all, or a total beyond
+			// PACKET_SIZE_MAX should be refused:
+			many.front() = Piece();
+			many.push_back(Piece("B", 1));
+			Assert::AreEqual(Comms::Result::InvalidArg, Comms::Send(session, Pieces(many.data(), many.size())),
+				L"Too many pieces accepted");
+			const Piece empty[] = {Piece(), Piece("BODY", 0)};
+			Assert::AreEqual(Comms::Result::InvalidArg, Comms::Send(session, Pieces(empty, 2)), L"Empty pieces accepted");
+			Assert::AreEqual(Comms::Result::InvalidArg, Comms::Send(session, Pieces()), L"Empty piece list accepted");
+			const Piece oversize[] = {Piece(large.data(), large.size()), Piece("TAIL", 4)};
+			Assert::AreEqual(Comms::Result::InvalidArg, Comms::Send(session, Pieces(oversize, 2)),
+				L"Oversize packet accepted");
+
+			// Refused sends should deliver nothing:
+			Assert::AreEqual(Comms::Result::OK, Comms::Send(session, "END", 3), L"Send failed");
+			Assert::IsTrue(server->WaitPackets(accepted, 3, 2000), L"Final packet not received");
+			Assert::AreEqual(std::string("END"), server->Packet(accepted, 2), L"Refused send delivered data");
+
+			Assert::AreEqual(Comms::Result::OK, Comms::Disconnect(session), L"Disconnect failed");
+			Assert::IsTrue(server->WaitDisconnected(accepted, 2000), L"Accepted session not disconnected");
+			Comms::DeregisterListener(listener, 2000);
+		}
+
+		TEST_METHOD(DrainOpenExchange)
+		{
+			const auto server = std::make_shared<TestClient>(), client = std::make_shared<TestClient>();
+			Comms::SessionTicket session = 0;
+			unsigned int accepted = 0;
+			const Comms::ListenerTicket listener = InProcConnect("drainexchange", server, client, session, accepted);
+
+			// Request arrives at server, which begins an exchange before session is drained:
+			Assert::AreEqual(Comms::Result::OK, Comms::Send(session, "REQUEST", 7), L"Send failed");
+			Assert::IsTrue(server->WaitPackets(accepted, 1, 2000), L"Request not received");
+			Assert::AreEqual(Comms::Result::OK, Comms::BeginExchange(accepted), L"BeginExchange failed");
+			Assert::AreEqual(Comms::Result::OK, Comms::DrainSession(accepted, 10000), L"DrainSession failed");
+			Assert::IsTrue(server->WaitDraining(accepted, 2000), L"Server not notified of drain");
+
+			// Session should stay open while exchange is in flight, and (being inbound) still accept the response:
+			Assert::IsFalse(server->WaitDisconnected(accepted, 500), L"Session closed with exchange in flight");
+			Assert::AreEqual(Comms::Result::OK, Comms::Send(accepted, "RESPONSE", 8), L"Response refused while draining");
+			Assert::IsTrue(client->WaitPackets(session, 1, 2000), L"Response not received");
+			Assert::AreEqual(std::string("RESPONSE"), client->Packet(session, 0), L"Invalid response received");
+
+			// Completing exchange should release session well before drain deadline:
+			Assert::AreEqual(Comms::Result::OK, Comms::EndExchange(accepted), L"EndExchange failed");
+			Assert::IsTrue(server->WaitDisconnected(accepted, 2000), L"Drained session not closed after exchange");
+			Assert::IsTrue(client->WaitDisconnected(session, 2000), L"Peer of drained session not disconnected");
+			Comms::DeregisterListener(listener, 2000);
+		}
+
+		TEST_METHOD(DrainDeadline)
+		{
+			const auto server = std::make_shared<TestClient>(), client = std::make_shared<TestClient>();
+			Comms::SessionTicket session = 0;
+			unsigned int accepted = 0;
+			const Comms::ListenerTicket listener = InProcConnect("draindeadline", server, client, session, accepted);
+
+			// Drain outbound session with an exchange never completed:
+			const auto started = std::chrono::steady_clock::now();
+			Assert::AreEqual(Comms::Result::OK, Comms::BeginExchange(session), L"BeginExchange failed");
+			Assert::AreEqual(Comms::Result::OK, Comms::DrainSession(session, 1000), L"DrainSession failed");
+			Assert::IsTrue(client->WaitDraining(session, 2000), L"Client not notified of drain");
+			Assert::AreEqual(Comms::Result::Draining, Comms::Send(session, "REQUEST", 7),
+				L"Send not refused while draining");
+
+			// Deadline should force session closed (not before it passes):
+			Assert::IsTrue(client->WaitDisconnected(session, 5000), L"Drained session not closed at deadline");
+			Assert::IsTrue(std::chrono::steady_clock::now() - started >= std::chrono::milliseconds(1000),
+				L"Drained session closed before deadline");
+			Assert::IsTrue(server->WaitDisconnected(accepted, 2000), L"Peer of drained session not disconnected");
+			Comms::DeregisterListener(listener, 2000);
+		}
+	};
+
+	// Comms_CompletionPort_TEST: Session tests repeated with comms threads using completion port backend
+	TEST_CLASS(Comms_CompletionPort_TEST)
+	{
+	public:
+
+		TEST_CLASS_INITIALIZE(Class_Init)
+		{
+			SocketOps::InitializeSockets(false);
+			Comms::Initialize(2, Comms::Backend::CompletionPort);
+		}
+		TEST_CLASS_CLEANUP(Class_Cleanup)
+		{
+			Comms::Cleanup();
+			SocketOps::CleanupSockets();
+		}
+
+		TEST_METHOD(TcpSession)
+		{
+			TcpRoundTrip(11232);
+		}
+	};
+}
@@ -0,0 +1,72 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include "Comms/DnsResolver.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FIQCPPBASE;
+
+namespace fiQCPPBaseTESTS
+{
+	TEST_CLASS(DnsResolver_TEST)
+	{
+	public:
+
+		TEST_CLASS_INITIALIZE(Class_Init)
+		{
+			SocketOps::InitializeSockets(false);
+		}
+		TEST_CLASS_CLEANUP(Class_Cleanup)
+		{
+			SocketOps::CleanupSockets();
+		}
+
+		TEST_METHOD(LiteralsAndCache)
+		{
+			DnsResolver resolver;
+			DnsResolver::ResolverStats stats;
+
+			// Address literals should complete immediately, without starting a lookup (even before resolver is started):
+			DnsResolver::LookupPtr v4 = resolver.Resolve("127.0.0.1"), v6 = resolver.Resolve("::1");
+			Assert::IsTrue(v4->Succeeded() && v6->Succeeded(), L"Address literal not resolved");
+			Assert::AreEqual(std::string("::1"), v6->GetAddresses().front(), L"Invalid IPv6 literal result");
+			Assert::IsFalse(resolver.Resolve("localhost")->Succeeded(), L"Name resolved before resolver started");
+
+			// Name should resolve to at least one address, and repeated requests should share (or reuse) its lookup:
+			Assert::IsTrue(resolver.Start(), L"Resolver failed to start");
+			DnsResolver::LookupPtr first = resolver.Resolve("localhost"), second = resolver.Resolve("localhost");
+			Assert::IsTrue(first.get() == second.get(), L"Lookups not merged");
+			Assert::IsTrue(first->Wait(5000), L"Lookup did not complete");
+			Assert::IsTrue(first->Succeeded(), L"Name not resolved");
+			for(const auto& address : first->GetAddresses()) {
+				sockaddr_storage addr = {0};
+				int addrlen = 0;
+				Assert::IsTrue(SocketOps::ParseAddress(address.c_str(), 80, addr, addrlen), L"Invalid address returned");
+			}
+			Assert::IsTrue(resolver.Resolve("localhost").get() == first.get(), L"Cached result not returned");
+			resolver.GetStats(stats);
+			Assert::AreEqual(1ULL, stats.Lookups, L"Invalid lookup count");
+			Assert::AreEqual(2ULL, stats.Merged + stats.CacheHits, L"Invalid merged/cached count");
+
+			// After purge, next request should start a new lookup:
+			resolver.Purge();
+			Assert::IsTrue(resolver.Resolve("localhost").get() != first.get(), L"Purged result returned");
+			resolver.Stop();
+		}
+
+		TEST_METHOD(FailedLookups)
+		{
+			// Failures should be cached only for negative TTL:
+			DnsResolver resolver(DnsResolver::TTL_DEFAULT, 0);
+			Assert::IsTrue(resolver.Start(1), L"Resolver failed to start");
+			DnsResolver::LookupPtr failed = resolver.Resolve("invalid.name.test");
+			Assert::IsTrue(failed->Wait(10000), L"Lookup did not complete");
+			Assert::IsFalse(failed->Succeeded(), L"Invalid name resolved");
+			Assert::IsFalse(failed->GetLastErrString().empty(), L"Error not set");
+			Assert::IsTrue(resolver.Resolve("invalid.name.test").get() != failed.get(), L"Expired failure returned");
+
+			// Requests made after resolver stops should fail immediately:
+			resolver.Stop();
+			Assert::IsFalse(resolver.Resolve("localhost")->Succeeded(), L"Name resolved after resolver stopped");
+		}
+	};
+}
@@ -0,0 +1,146 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include "Comms/HttpCodec.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FIQCPPBASE;
+
+namespace fiQCPPBaseTESTS
+{
+	// Feed: Copy data into parser's receive buffer, as a socket read would
+	static void Feed(HttpParser& parser, const std::string& data) {
+		size_t space = 0;
+		char* const tgt = parser.ReadTarget(space);
+		Assert::IsTrue(space >= data.size(), L"Insufficient read space");
+		memcpy(tgt, data.data(), data.size());
+		parser.Commit(data.size());
+	}
+
+	TEST_CLASS(HttpCodec_TEST)
+	{
+	public:
+
+		TEST_METHOD(PipelinedRequests)
+		{
+			HttpParser parser(HttpParser::Mode::Request);
+			HttpMessage msg;
+			const std::string stream =
+				"GET /first HTTP/1.1\r\nHost: test\r\n\r\n"
+				"POST /second HTTP/1.1\r\nContent-Length: 5\r\nX-Test:  value \r\n\r\nhello"
+				"GET /third HTTP/1.0\r\n\r\n"
+				"GET /ignored HTTP/1.1\r\n\r\n";
+
+			// Deliver one byte at a time, collecting messages as they complete:
+			std::vector<std::string> targets, bodies;
+			for(size_t c = 0; c < stream.size(); ++c) {
+				Feed(parser, stream.substr(c, 1));
+				for(HttpParser::Result rc = parser.Next(msg); rc != HttpParser::Result::Incomplete; rc = parser.Next(msg)) {
+					Assert::IsTrue(rc == HttpParser::Result::Complete, L"Invalid result returned");
+					targets.push_back(msg.Target.ToString());
+					bodies.push_back(msg.Body.ToString());
+					if(targets.size() == 2) {
+						Assert::IsTrue(msg.Method.Is("post"), L"Invalid method");
+						const HttpView* header = msg.FindHeader("x-test");
+						Assert::IsNotNull(header, L"Header not found");
+						Assert::AreEqual(std::string("value"), header->ToString(), L"Invalid header value");
+						Assert::IsTrue(msg.KeepAlive, L"HTTP/1.1 message not kept alive");
+					}
+					else if(targets.size() == 3) {
+						Assert::AreEqual(0U, msg.MinorVersion, L"Invalid minor version");
+						Assert::IsFalse(msg.KeepAlive, L"HTTP/1.0 message kept alive");
+					}
+				}
+			}
+			// Message following non-keepalive message should be discarded:
+			Assert::AreEqual(size_t{3}, targets.size(), L"Invalid message count");
+			Assert::AreEqual(std::string("/first"), targets[0], L"Invalid first target");
+			Assert::AreEqual(std::string("/second"), targets[1], L"Invalid second target");
+			Assert::AreEqual(std::string("/third"), targets[2], L"Invalid third target");
+			Assert::AreEqual(std::string("hello"), bodies[1], L"Invalid second body");
+
+			// After reset, parser should accept new messages:
+			parser.Reset();
+			Feed(parser, "GET /again HTTP/1.1\r\n\r\n");
+			Assert::IsTrue(parser.Next(msg) == HttpParser::Result::Complete, L"Message not parsed after reset");
+		}
+
+		TEST_METHOD(ChunkedBodies)
+		{
+			// Build chunked response and parse it in small pieces:
+			HttpBuilder builder;
+			builder.Response(200).Header("X-Test", "1").StartChunked("text/plain")
+				.Chunk("abc", 3).Chunk("0123456789abcdefg", 17).EndChunked();
+			const std::string response(builder.Data(), builder.Size());
+			Assert::AreNotEqual(std::string::npos, response.find("\r\n11\r\n0123456789abcdefg\r\n0\r\n\r\n"),
+				L"Invalid chunk encoding");
+			HttpParser parser(HttpParser::Mode::Response);
+			HttpMessage msg;
+			for(size_t c = 0; c < response.size(); c += 7) {
+				Feed(parser, response.substr(c, 7));
+				if(c + 7 < response.size()) {
+					Assert::IsTrue(parser.Next(msg) == HttpParser::Result::Incomplete, L"Incomplete response returned");
+				}
+			}
+			Assert::IsTrue(parser.Next(msg) == HttpParser::Result::Complete, L"Response not parsed");
+			Assert::AreEqual(200U, msg.Status, L"Invalid status");
+			Assert::AreEqual(std::string("OK"), msg.Reason.ToString(), L"Invalid reason");
+			Assert::IsTrue(msg.Chunked, L"Chunked flag not set");
+			Assert::AreEqual(std::string("abc0123456789abcdefg"), msg.Body.ToString(), L"Invalid decoded body");
+
+			// Trailers and extensions should be accepted (and discarded):
+			Feed(parser, "HTTP/1.1 201 Created\r\nTransfer-Encoding: chunked\r\n\r\n"
+				"4;ext=1\r\nabcd\r\n0\r\nTrailer: x\r\n\r\n");
+			Assert::IsTrue(parser.Next(msg) == HttpParser::Result::Complete, L"Response with trailer not parsed");
+			Assert::AreEqual(std::string("abcd"), msg.Body.ToString(), L"Invalid body with trailer");
+
+			// Bodyless responses should not wait for body:
+			builder.Response(204).End();
+			Feed(parser, std::string(builder.Data(), builder.Size()));
+			Assert::IsTrue(parser.Next(msg) == HttpParser::Result::Complete, L"No-content response not parsed");
+			Assert::IsTrue(msg.Body.Empty(), L"No-content response has body");
+		}
+
+		TEST_METHOD(LargeBodies)
+		{
+			// Two pipelined requests with bodies much larger than a single read:
+			HttpBuilder builder;
+			const std::string body(100000, 'z');
+			builder.Request("POST", "/large").Header("Host", "test").Body(body.data(), body.size(), "text/plain");
+			const std::string request(builder.Data(), builder.Size());
+			const std::string stream = request + request;
+			HttpParser parser(HttpParser::Mode::Request);
+			HttpMessage msg;
+			size_t count = 0;
+			for(size_t c = 0; c < stream.size(); c += 5000) {
+				Feed(parser, stream.substr(c, 5000));
+				while(parser.Next(msg) == HttpParser::Result::Complete) {
+					Assert::AreEqual(body.size(), msg.Body.len, L"Invalid body length");
+					Assert::IsTrue(memcmp(body.data(), msg.Body.data, body.size()) == 0, L"Invalid body content");
+					++count;
+				}
+			}
+			Assert::AreEqual(size_t{2}, count, L"Invalid message count");
+		}
+
+		TEST_METHOD(InvalidMessages)
+		{
+			HttpMessage msg;
+			{HttpParser parser(HttpParser::Mode::Request, 0x400);
+			Feed(parser, std::string(0x800, 'a'));
+			Assert::IsTrue(parser.Next(msg) == HttpParser::Result::Invalid, L"Oversized header accepted");}
+			{HttpParser parser(HttpParser::Mode::Request, HttpParser::HEADER_BYTES_MAX_DEFAULT, 10);
+			Feed(parser, "POST / HTTP/1.1\r\nContent-Length: 11\r\n\r\n");
+			Assert::IsTrue(parser.Next(msg) == HttpParser::Result::Invalid, L"Oversized body accepted");}
+			{HttpParser parser(HttpParser::Mode::Request);
+			Feed(parser, "POST / HTTP/1.1\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\n");
+			Assert::IsTrue(parser.Next(msg) == HttpParser::Result::Invalid, L"Conflicting lengths accepted");}
+			{HttpParser parser(HttpParser::Mode::Request);
+			Feed(parser, "GET / HTTP/2.0\r\n\r\n");
+			Assert::IsTrue(parser.Next(msg) == HttpParser::Result::Invalid, L"Invalid version accepted");}
+			{HttpParser parser(HttpParser::Mode::Response);
+			Feed(parser, "HTTP/1.1 200 OK\r\n\r\n");
+			Assert::IsTrue(parser.Next(msg) == HttpParser::Result::Invalid, L"Unframed response accepted");
+			Assert::IsFalse(parser.GetLastErrString().empty(), L"Error not set");}
+		}
+	};
+}
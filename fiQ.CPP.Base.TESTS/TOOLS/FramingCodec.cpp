@@ -0,0 +1,57 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include "Tools/FramingCodec.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FIQCPPBASE;
+
+namespace fiQCPPBaseTESTS
+{
+	TEST_CLASS(FramingCodec_TEST)
+	{
+	public:
+
+		TEST_METHOD(PrefixedCodecs)
+		{
+			// Encode headers, ensure they are measured back to the same lengths (and not before header is complete):
+			size_t len = 0;
+			const Framing::Framed<Framing::Length2BE> f2(0x1234);
+			Assert::AreEqual(0x12, static_cast<int>(f2.Header()[0]), L"Invalid two-byte header");
+			Assert::AreEqual(0x34, static_cast<int>(f2.Header()[1]), L"Invalid two-byte header");
+			Assert::AreEqual(size_t{0}, Framing::Length2BE::Measure(f2.Header(), 1, len), L"Partial header measured");
+			Assert::AreEqual(size_t{0x1236}, Framing::Length2BE::Measure(f2.Header(), 2, len), L"Invalid two-byte frame size");
+			Assert::AreEqual(size_t{0x1234}, len, L"Invalid two-byte payload length");
+
+			const Framing::Framed<Framing::Extended> fx(0xFFFF);
+			Assert::AreEqual(0, static_cast<int>(fx.Header()[2] | fx.Header()[3]), L"Control bytes not zeroed");
+			Assert::AreEqual(size_t{0}, Framing::Extended::Measure(fx.Header(), 3, len), L"Partial header measured");
+			Assert::AreEqual(size_t{0x10003}, Framing::Extended::Measure(fx.Header(), 4, len), L"Invalid extended frame size");
+			Assert::AreEqual(size_t{0xFFFF}, len, L"Invalid extended payload length");
+
+			const Framing::Framed<Framing::Length4BE> f4(0x01020304);
+			Assert::AreEqual(size_t{0x01020308}, Framing::Length4BE::Measure(f4.Header(), 4, len), L"Invalid four-byte frame size");
+			Assert::AreEqual(size_t{0x01020304}, len, L"Invalid four-byte payload length");
+			const char high[4] = {'\x80', 0, 0, 1};
+			Assert::AreEqual(size_t{0x80000005}, Framing::Length4BE::Measure(high, 4, len), L"High length byte sign-extended");
+		}
+
+		TEST_METHOD(ScannedCodecs)
+		{
+			// Ensure delimited frame is only measured once delimiter is present, and excludes delimiter from payload:
+			size_t len = 99;
+			const char data[] = "ABC\r\nDEF";
+			Assert::AreEqual(size_t{0}, Framing::Delimited<'\n'>::Measure(data, 4, len), L"Incomplete frame measured");
+			Assert::AreEqual(size_t{5}, Framing::Delimited<'\n'>::Measure(data, 8, len), L"Invalid delimited frame size");
+			Assert::AreEqual(size_t{4}, len, L"Invalid delimited payload length");
+			Assert::AreEqual(size_t{1}, Framing::Delimited<'A'>::Measure(data, 8, len), L"Invalid empty frame size");
+			Assert::AreEqual(size_t{0}, len, L"Invalid empty payload length");
+			const Framing::Framed<Framing::Delimited<'|'>> fd(3);
+			Assert::AreEqual('|', fd.Trailer()[0], L"Invalid delimiter trailer");
+
+			// Ensure raw codec treats everything available as a single frame:
+			Assert::AreEqual(size_t{0}, Framing::Raw::Measure(data, 0, len), L"Empty raw frame measured");
+			Assert::AreEqual(size_t{8}, Framing::Raw::Measure(data, 8, len), L"Invalid raw frame size");
+			Assert::AreEqual(size_t{8}, len, L"Invalid raw payload length");
+		}
+	};
+}
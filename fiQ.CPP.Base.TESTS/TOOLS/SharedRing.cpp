@@ -0,0 +1,74 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include "Tools/SharedRing.h"
+#include "Tools/ThreadOps.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FIQCPPBASE;
+
+namespace fiQCPPBaseTESTS
+{
+	TEST_CLASS(SharedRing_TEST)
+	{
+	public:
+
+		TEST_METHOD(ConnectAcceptExchange)
+		{
+			// Publish rendezvous, ensure name cannot be published twice, and connection to unknown name fails:
+			std::string errstring;
+			SharedRing::Listener listener, duplicate;
+			Assert::IsTrue(listener.Open("fiQ.TEST.ring"), L"Listener open failed");
+			Assert::IsFalse(duplicate.Open("fiQ.TEST.ring"), L"Duplicate listener opened");
+			Assert::IsTrue(SharedRing::Connect("fiQ.TEST.none", 0x10000, errstring).get() == nullptr,
+				L"Connected to unknown name");
+
+			// Connect (both ends are in this process, which is sufficient to exercise section and event handling), and
+			// ensure listener callback is invoked and link is accepted with connecting side's capacity:
+			ThreadOps::Event posted(false);
+			Assert::IsTrue(listener.Watch([](void* context) {static_cast<ThreadOps::Event*>(context)->Set();}, &posted),
+				L"Listener watch failed");
+			std::unique_ptr<SharedRing> client = SharedRing::Connect("fiQ.TEST.ring", 0x10000, errstring);
+			Assert::IsTrue(client.get() != nullptr, L"Connect failed");
+			Assert::IsTrue(posted.Wait(2000), L"Listener not notified");
+			std::unique_ptr<SharedRing> server = listener.Accept();
+			Assert::IsTrue(server.get() != nullptr, L"Accept failed");
+			Assert::IsTrue(listener.Accept().get() == nullptr, L"Link accepted twice");
+			Assert::AreEqual(size_t{0}, server->End(), L"Invalid accepted end");
+			Assert::AreEqual(size_t{1}, client->End(), L"Invalid connecting end");
+			Assert::AreEqual(client->Capacity(), server->Capacity(), L"Ring capacities differ");
+
+			// Write from each end into other's ring, signalling other end, and ensure data and wake are received:
+			ThreadOps::Event woken(false);
+			Assert::IsTrue(server->Watch([](void* context) {static_cast<ThreadOps::Event*>(context)->Set();}, &woken),
+				L"Link watch failed");
+			Assert::AreEqual(size_t{5}, client->Inbound(0).Write("HELLO", 5), L"Invalid client write count");
+			client->Signal(0);
+			Assert::IsTrue(woken.Wait(2000), L"Accepted end not woken");
+			char tgt[8] = {0};
+			Assert::AreEqual(size_t{5}, server->Inbound(0).Read(tgt, sizeof(tgt)), L"Invalid server read count");
+			Assert::IsTrue(memcmp(tgt, "HELLO", 5) == 0, L"Invalid data read by server");
+			Assert::AreEqual(size_t{3}, server->Inbound(1).Write("BYE", 3), L"Invalid server write count");
+			Assert::AreEqual(size_t{3}, client->Inbound(1).Read(tgt, sizeof(tgt)), L"Invalid client read count");
+			Assert::IsTrue(memcmp(tgt, "BYE", 3) == 0, L"Invalid data read by client");
+
+			// Flags are shared between ends:
+			client->GetFlags().closed = true;
+			Assert::IsTrue(server->GetFlags().closed, L"Closed flag not shared");
+		}
+
+		TEST_METHOD(ListenerClose)
+		{
+			// Ensure link posted but not accepted is flagged closed when listener closes, and later connections fail:
+			std::string errstring;
+			SharedRing::Listener listener;
+			Assert::IsTrue(listener.Open("fiQ.TEST.close"), L"Listener open failed");
+			std::unique_ptr<SharedRing> client = SharedRing::Connect("fiQ.TEST.close", 0x10000, errstring);
+			Assert::IsTrue(client.get() != nullptr, L"Connect failed");
+			Assert::IsFalse(client->GetFlags().closed, L"Link closed before listener");
+			listener.Close();
+			Assert::IsTrue(client->GetFlags().closed, L"Pending link not closed with listener");
+			Assert::IsTrue(SharedRing::Connect("fiQ.TEST.close", 0x10000, errstring).get() == nullptr,
+				L"Connected to closed listener");
+		}
+	};
+}
@@ -0,0 +1,130 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include "Tools/SlotTable.h"
+#include <thread>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FIQCPPBASE;
+
+namespace fiQCPPBaseTESTS
+{
+	// Test object which tracks count of instances destroyed:
+	struct Counted {
+		explicit Counted(int _value, std::atomic<int>& _destroyed) noexcept : value(_value), destroyed(_destroyed) {}
+		~Counted() {++destroyed;}
+		Counted(const Counted&) = delete;
+		Counted(Counted&&) = delete;
+		Counted& operator=(const Counted&) = delete;
+		Counted& operator=(Counted&&) = delete;
+		int value;
+		std::atomic<int>& destroyed;
+	};
+
+	TEST_CLASS(SlotTable_TEST)
+	{
+	public:
+
+		TEST_METHOD(InsertAcquireRetire)
+		{
+			std::atomic<int> destroyed{0};
+			SlotTable<Counted, 20, 12> table;
+
+			// Insert objects, validate keys and lookups:
+			const auto k1 = table.Insert(std::make_unique<Counted>(100, destroyed));
+			const auto k2 = table.Insert(std::make_unique<Counted>(200, destroyed));
+			Assert::AreNotEqual(0U, k1, L"Failed to insert first object");
+			Assert::AreNotEqual(0U, k2, L"Failed to insert second object");
+			Assert::AreNotEqual(k1, k2, L"Duplicate keys issued");
+			Assert::AreEqual(0U, table.Insert(nullptr), L"Inserted null object");
+			Assert::AreEqual(size_t{2}, table.Occupied(), L"Invalid occupied count");
+			{auto r = table.Acquire(k1);
+			Assert::IsTrue(static_cast<bool>(r), L"Failed to acquire first object");
+			Assert::AreEqual(100, r->value, L"Invalid value for first object");}
+			Assert::IsFalse(static_cast<bool>(table.Acquire(0)), L"Acquired object with zero key");
+
+			// Retire object while holding reference; ensure it remains valid until reference is released:
+			{auto r = table.Acquire(k1);
+			Assert::IsTrue(table.Retire(k1), L"Failed to retire first object");
+			Assert::IsFalse(table.Retire(k1), L"Retired first object twice");
+			Assert::IsFalse(static_cast<bool>(table.Acquire(k1)), L"Acquired retired object");
+			Assert::AreEqual(0, destroyed.load(), L"Object destroyed while reference held");
+			Assert::AreEqual(100, r->value, L"Invalid value for retired object");}
+			Assert::AreEqual(1, destroyed.load(), L"Object not destroyed after reference released");
+			Assert::AreEqual(size_t{1}, table.Occupied(), L"Invalid occupied count after reclaim");
+
+			// Iterate and clear table:
+			int total = 0;
+			table.ForEach([&total](unsigned int, Counted& c) {total += c.value;});
+			Assert::AreEqual(200, total, L"Invalid total from iteration");
+			table.Clear();
+			Assert::AreEqual(2, destroyed.load(), L"Invalid destroyed count after clear");
+			Assert::IsFalse(static_cast<bool>(table.Acquire(k2)), L"Acquired object after clear");
+		}
+		TEST_METHOD(TicketReuse)
+		{
+			std::atomic<int> destroyed{0};
+			SlotTable<Counted, 20, 12> table;
+
+			// Insert and immediately retire an object, then insert another; freed slot must not be reused right away:
+			const auto k1 = table.Insert(std::make_unique<Counted>(1, destroyed));
+			Assert::IsTrue(table.Retire(k1), L"Failed to retire object");
+			const auto k2 = table.Insert(std::make_unique<Counted>(2, destroyed));
+			Assert::AreNotEqual(table.KeyIndex(k1), table.KeyIndex(k2), L"Freed slot reused immediately");
+
+			// Cycle through enough insert/retire operations to bring allocation cursor back around to first slot, and
+			// ensure generation has advanced (so stale key does not resolve):
+			std::set<unsigned int> keys;
+			for(int i = 0; i < 10000; ++i) {
+				const auto k = table.Insert(std::make_unique<Counted>(i, destroyed));
+				Assert::AreNotEqual(0U, k, L"Failed to insert object");
+				Assert::IsTrue(keys.insert(k).second, L"Key reissued");
+				if(table.KeyIndex(k) == table.KeyIndex(k1))
+					Assert::AreNotEqual(table.KeyGeneration(k1), table.KeyGeneration(k), L"Generation not advanced");
+				Assert::IsTrue(table.Retire(k), L"Failed to retire object");
+			}
+			Assert::IsFalse(static_cast<bool>(table.Acquire(k1)), L"Stale key resolved to new occupant");
+			Assert::AreEqual(2, table.Acquire(k2)->value, L"Invalid value for live object");
+			Assert::AreEqual(size_t{1}, table.Occupied(), L"Invalid occupied count");
+		}
+		TEST_METHOD(ConcurrentInsertAcquire)
+		{
+			std::atomic<int> destroyed{0};
+			SlotTable<Counted, 20, 12> table;
+			std::atomic<unsigned int> current{0};
+			std::atomic_bool running{true};
+			std::atomic<int> bad{0};
+
+			// Start reader threads, acquiring whatever key is current and validating object contents:
+			std::vector<std::thread> readers;
+			for(int t = 0; t < 4; ++t) readers.emplace_back([&]() {
+				while(running) {
+					const unsigned int key = current.load();
+					if(auto r = table.Acquire(key)) {
+						if(r->value != static_cast<int>(key)) ++bad;
+					}
+				}
+			});
+
+			// Start writer threads, repeatedly inserting and retiring objects (storing own key in object once known):
+			std::vector<std::thread> writers;
+			for(int t = 0; t < 2; ++t) writers.emplace_back([&]() {
+				for(int i = 0; i < 20000; ++i) {
+					const auto key = table.Insert(std::make_unique<Counted>(0, destroyed));
+					if(key == 0) {++bad; continue;}
+					// Readers only see key once it has been stored in current, after value is set:
+					{auto r = table.Acquire(key);
+					if(r) r->value = static_cast<int>(key);}
+					current = key;
+					if(table.Retire(key) == false) ++bad;
+				}
+			});
+			for(auto& t : writers) t.join();
+			running = false;
+			for(auto& t : readers) t.join();
+			Assert::AreEqual(0, bad.load(), L"Invalid object observed or operation failed");
+			Assert::AreEqual(40000, destroyed.load(), L"Invalid destroyed count");
+			Assert::AreEqual(size_t{0}, table.Occupied(), L"Invalid occupied count");
+		}
+
+	};
+}
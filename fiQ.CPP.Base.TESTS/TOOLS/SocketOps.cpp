@@ -89,6 +89,243 @@ namespace fiQCPPBaseTESTS
 			Assert::AreEqual("HELLO", readbuf, L"Invalid message received");}
 		}
 
+		TEST_METHOD(TcpStatistics)
+		{
+			// Open up listening socket, connect and accept:
+			Server = SocketOps::ServerSocket::Create();
+			Assert::IsTrue(Server->Open(11223), (L"Open: " + StringOps::ConvertToWideString(Server->GetLastErrString())).c_str());
+			ClientSession = SocketOps::SessionSocket::StartConnect("127.0.0.1", 11223);
+			Assert::IsTrue(ClientSession->SocketValid(), (L"StartConnect: " + StringOps::ConvertToWideString(ClientSession->GetLastErrString())).c_str());
+			Assert::AreEqual(SocketOps::Result::OK, Server->WaitEvent(10), StringOps::ConvertToWideString(Server->GetLastErrString()).c_str());
+			ServerSession = Server->Accept();
+			Assert::IsTrue(ServerSession->SocketValid(), (L"Accept: " + StringOps::ConvertToWideString(ServerSession->GetLastErrString())).c_str());
+			Assert::AreEqual(SocketOps::Result::OK, ClientSession->PollConnect(), (L"PollConnect: " + StringOps::ConvertToWideString(ClientSession->GetLastErrString())).c_str());
+
+			// Exchange data, then sample statistics at client (supported from Windows 10 1703; skip checks otherwise):
+			char readbuf[8] = {0};
+			Assert::AreEqual(SocketOps::Result::OK, ClientSession->Send("HELLO", 5), (L"Send: " + StringOps::ConvertToWideString(ClientSession->GetLastErrString())).c_str());
+			Assert::AreEqual(SocketOps::Result::OK, ServerSession->ReadExact(readbuf, 5, 100), (L"Read: " + StringOps::ConvertToWideString(ServerSession->GetLastErrString())).c_str());
+			SocketOps::TcpInfo info;
+			if(ClientSession->GetTcpInfo(info)) {
+				Assert::IsTrue(info.Cwnd > 0, L"Invalid congestion window");
+				Assert::AreEqual(0ULL, info.BytesRetransmitted, L"Unexpected retransmission on loopback");
+			}
+			else Logger::WriteMessage("TCP statistics not available");
+
+			// Statistics are not available once socket is closed:
+			ClientSession->Close();
+			Assert::IsFalse(ClientSession->GetTcpInfo(info), L"Statistics returned for closed socket");
+		}
+
+		TEST_METHOD(NonBlockingAcceptBatch)
+		{
+			// Open up nonblocking listening socket with large backlog:
+			Server = SocketOps::ServerSocket::Create();
+			Assert::IsTrue(Server->Open(11223, nullptr, 500, true), (L"Open: " + StringOps::ConvertToWideString(Server->GetLastErrString())).c_str());
+
+			// Ensure accept does not block when no connection is pending:
+			std::string errstring;
+			Assert::AreEqual(SocketOps::Result::Timeout, Server->AcceptPending(ServerSession, &errstring), StringOps::ConvertToWideString(errstring).c_str());
+			Assert::IsTrue(ServerSession.get() == nullptr, L"Session returned with no connection pending");
+
+			// Start multiple client socket connections:
+			std::vector<SocketOps::SessionSocketPtr> clients;
+			for(int i = 0; i < 5; ++i) {
+				clients.emplace_back(SocketOps::SessionSocket::StartConnect("127.0.0.1", 11223));
+				Assert::IsTrue(clients.back()->SocketValid(), (L"StartConnect: " + StringOps::ConvertToWideString(clients.back()->GetLastErrString())).c_str());
+			}
+
+			// Wait for listener to become readable, then drain all pending connections in a single batch:
+			Assert::AreEqual(SocketOps::Result::OK, Server->WaitEvent(100), StringOps::ConvertToWideString(Server->GetLastErrString()).c_str());
+			std::vector<SocketOps::SessionSocketPtr> sessions;
+			for(int i = 0; i < 100 && sessions.size() < clients.size(); ++i) {
+				const SocketOps::Result rc = Server->AcceptPending(ServerSession, &errstring);
+				if(rc == SocketOps::Result::OK) sessions.emplace_back(std::move(ServerSession));
+				else if(rc == SocketOps::Result::Timeout) Sleep(5); // Connection may not yet have reached queue
+				else Assert::Fail((L"AcceptPending: " + StringOps::ConvertToWideString(errstring)).c_str());
+			}
+			Assert::AreEqual(clients.size(), sessions.size(), L"Invalid number of sessions accepted");
+			Assert::AreEqual(SocketOps::Result::Timeout, Server->AcceptPending(ServerSession, &errstring), L"Unexpected pending session");
+
+			// Complete connections, ensure accepted sessions are in blocking mode and can exchange data (sessions may not be
+			// accepted in the same order as clients connected, so send from every session before reading at every client):
+			for(auto& c : clients) Assert::AreEqual(SocketOps::Result::OK, c->PollConnect(), (L"PollConnect: " + StringOps::ConvertToWideString(c->GetLastErrString())).c_str());
+			for(auto& s : sessions) {
+				Assert::IsTrue(s->Valid(), L"Accepted session not valid");
+				Assert::AreEqual(SocketOps::Result::OK, s->Send("\x00\x05HELLO", 7), (L"Packet send: " + StringOps::ConvertToWideString(s->GetLastErrString())).c_str());
+			}
+			for(auto& c : clients) {
+				char readbuf[64] = {0}; size_t br = 0;
+				Assert::AreEqual(SocketOps::Result::OK, c->ReadPacket(readbuf, 50, br, 100), (L"Packet read: " + StringOps::ConvertToWideString(c->GetLastErrString())).c_str());
+				Assert::AreEqual("HELLO", readbuf, L"Invalid message received");
+			}
+		}
+
+		TEST_METHOD(GatherSendAndWake)
+		{
+			// Open up listening socket, connect client and accept session:
+			Server = SocketOps::ServerSocket::Create();
+			Assert::IsTrue(Server->Open(11223), (L"Open: " + StringOps::ConvertToWideString(Server->GetLastErrString())).c_str());
+			ClientSession = SocketOps::SessionSocket::StartConnect("127.0.0.1", 11223);
+			Assert::IsTrue(ClientSession->SocketValid(), (L"StartConnect: " + StringOps::ConvertToWideString(ClientSession->GetLastErrString())).c_str());
+			Assert::AreEqual(SocketOps::Result::OK, Server->WaitEvent(100), StringOps::ConvertToWideString(Server->GetLastErrString()).c_str());
+			ServerSession = Server->Accept();
+			Assert::IsTrue(ServerSession.get() ? ServerSession->Valid() : false, L"Accept failed");
+			Assert::AreEqual(SocketOps::Result::OK, ClientSession->PollConnect(), (L"PollConnect: " + StringOps::ConvertToWideString(ClientSession->GetLastErrString())).c_str());
+
+			// Send packet header and body from separate buffers in a single write, ensure packet is read intact:
+			char header[2] = {0, 5}, body[6] = "HELLO";
+			const WSABUF buffers[2] = {{2, header}, {5, body}};
+			Assert::AreEqual(SocketOps::Result::OK, ServerSession->Send(buffers, 2), (L"Gather send: " + StringOps::ConvertToWideString(ServerSession->GetLastErrString())).c_str());
+			char readbuf[64] = {0}; size_t br = 0;
+			Assert::AreEqual(SocketOps::Result::OK, ClientSession->ReadPacket(readbuf, 50, br, 100), (L"Packet read: " + StringOps::ConvertToWideString(ClientSession->GetLastErrString())).c_str());
+			Assert::AreEqual("HELLO", readbuf, L"Invalid message received");
+
+			// Ensure wake socket interrupts poll, and is not readable once drained:
+			SocketOps::WakeSocket wake;
+			Assert::IsTrue(wake.Open(), (L"Wake open: " + StringOps::ConvertToWideString(wake.GetLastErrString())).c_str());
+			std::vector<WSAPOLLFD> fds;
+			Assert::IsTrue(wake.AddToFD(fds), L"Failed to add wake socket to poll set");
+			Assert::AreEqual(0, WSAPoll(fds.data(), 1, 0), L"Wake socket readable before wake");
+			wake.Wake();
+			Assert::AreEqual(1, WSAPoll(fds.data(), 1, 100), L"Wake socket not readable after wake");
+			wake.Drain();
+			Assert::AreEqual(0, WSAPoll(fds.data(), 1, 0), L"Wake socket readable after drain");
+		}
+
+		TEST_METHOD(FramedReadSend)
+		{
+			// Open up listening socket, connect client and accept session:
+			Server = SocketOps::ServerSocket::Create();
+			Assert::IsTrue(Server->Open(11223), (L"Open: " + StringOps::ConvertToWideString(Server->GetLastErrString())).c_str());
+			ClientSession = SocketOps::SessionSocket::StartConnect("127.0.0.1", 11223);
+			Assert::IsTrue(ClientSession->SocketValid(), (L"StartConnect: " + StringOps::ConvertToWideString(ClientSession->GetLastErrString())).c_str());
+			Assert::AreEqual(SocketOps::Result::OK, Server->WaitEvent(100), StringOps::ConvertToWideString(Server->GetLastErrString()).c_str());
+			ServerSession = Server->Accept();
+			Assert::IsTrue(ServerSession.get() ? ServerSession->Valid() : false, L"Accept failed");
+			Assert::AreEqual(SocketOps::Result::OK, ClientSession->PollConnect(), (L"PollConnect: " + StringOps::ConvertToWideString(ClientSession->GetLastErrString())).c_str());
+
+			// Send four-byte length frame, ensure it is read intact:
+			char readbuf[64] = {0}; size_t br = 0;
+			Assert::AreEqual(SocketOps::Result::OK, ServerSession->SendFrame<Framing::Length4BE>("HELLO", 5), (L"Frame send: " + StringOps::ConvertToWideString(ServerSession->GetLastErrString())).c_str());
+			Assert::AreEqual(SocketOps::Result::OK, ClientSession->ReadFrame<Framing::Length4BE>(readbuf, 50, br, 100), (L"Frame read: " + StringOps::ConvertToWideString(ClientSession->GetLastErrString())).c_str());
+			Assert::AreEqual(size_t{5}, br, L"Invalid frame length");
+			Assert::AreEqual("HELLO", readbuf, L"Invalid frame received");
+
+			// Send two delimited frames in one write, followed by partial frame; ensure frames are read separately and that
+			// partial frame times out (shutting down session):
+			const char lines[] = "ONE\nTWO\nTHR";
+			Assert::AreEqual(SocketOps::Result::OK, ServerSession->Send(lines, sizeof(lines) - 1), (L"Send: " + StringOps::ConvertToWideString(ServerSession->GetLastErrString())).c_str());
+			memset(readbuf, 0, sizeof(readbuf));
+			Assert::AreEqual(SocketOps::Result::OK, ClientSession->ReadFrame<Framing::Delimited<'\n'>>(readbuf, 50, br, 100), (L"Delimited read: " + StringOps::ConvertToWideString(ClientSession->GetLastErrString())).c_str());
+			Assert::AreEqual(size_t{3}, br, L"Invalid delimited frame length");
+			Assert::IsTrue(memcmp(readbuf, "ONE", 3) == 0, L"Invalid first delimited frame");
+			Assert::AreEqual(SocketOps::Result::OK, ClientSession->ReadFrame<Framing::Delimited<'\n'>>(readbuf, 50, br, 100), (L"Delimited read: " + StringOps::ConvertToWideString(ClientSession->GetLastErrString())).c_str());
+			Assert::IsTrue(br == 3 && memcmp(readbuf, "TWO", 3) == 0, L"Invalid second delimited frame");
+			Assert::AreEqual(SocketOps::Result::Timeout, ClientSession->ReadFrame<Framing::Delimited<'\n'>>(readbuf, 50, br, 100), L"Partial frame read");
+			Assert::AreEqual(size_t{0}, br, L"Partial frame length returned");
+		}
+
+		TEST_METHOD(UnixDomainSessions)
+		{
+			// Open up listener on unix domain socket, ensure address is recognized and socket file created:
+			const char* const address = "unix:fiQSocketOpsTest.sock";
+			Assert::IsTrue(SocketOps::IsUnixAddress(address), L"Unix address not recognized");
+			Assert::IsFalse(SocketOps::IsUnixAddress("unix:"), L"Empty unix path recognized");
+			Server = SocketOps::ServerSocket::Create();
+			Assert::IsTrue(Server->Open(0, address), (L"Open: " + StringOps::ConvertToWideString(Server->GetLastErrString())).c_str());
+			Assert::AreNotEqual(INVALID_FILE_ATTRIBUTES, GetFileAttributesA(address + 5), L"Socket file not created");
+
+			// Connect client, accept session and exchange packet in each direction:
+			ClientSession = SocketOps::SessionSocket::StartConnect(address, 0);
+			Assert::IsTrue(ClientSession->SocketValid(), (L"StartConnect: " + StringOps::ConvertToWideString(ClientSession->GetLastErrString())).c_str());
+			Assert::AreEqual(SocketOps::Result::OK, Server->WaitEvent(100), StringOps::ConvertToWideString(Server->GetLastErrString()).c_str());
+			ServerSession = Server->Accept();
+			Assert::IsTrue(ServerSession.get() ? ServerSession->Valid() : false, L"Accept failed");
+			Assert::AreEqual(SocketOps::Result::OK, ClientSession->PollConnect(), (L"PollConnect: " + StringOps::ConvertToWideString(ClientSession->GetLastErrString())).c_str());
+			char readbuf[64] = {0}; size_t br = 0;
+			Assert::AreEqual(SocketOps::Result::OK, ClientSession->SendFrame<Framing::Length2BE>("HELLO", 5), (L"Client send: " + StringOps::ConvertToWideString(ClientSession->GetLastErrString())).c_str());
+			Assert::AreEqual(SocketOps::Result::OK, ServerSession->ReadPacket(readbuf, 50, br, 100), (L"Server read: " + StringOps::ConvertToWideString(ServerSession->GetLastErrString())).c_str());
+			Assert::AreEqual("HELLO", readbuf, L"Invalid message received by server");
+			memset(readbuf, 0, sizeof(readbuf));
+			Assert::AreEqual(SocketOps::Result::OK, ServerSession->SendFrame<Framing::Length2BE>("WORLD", 5), (L"Server send: " + StringOps::ConvertToWideString(ServerSession->GetLastErrString())).c_str());
+			Assert::AreEqual(SocketOps::Result::OK, ClientSession->ReadPacket(readbuf, 50, br, 100), (L"Client read: " + StringOps::ConvertToWideString(ClientSession->GetLastErrString())).c_str());
+			Assert::AreEqual("WORLD", readbuf, L"Invalid message received by client");
+
+			// Close listener, ensure socket file is removed:
+			Server->Close();
+			Assert::AreEqual(INVALID_FILE_ATTRIBUTES, GetFileAttributesA(address + 5), L"Socket file not removed");
+		}
+
+		TEST_METHOD(NonBlockingWriteBacklog)
+		{
+			// Open up listening socket, connect client and accept session; place server session in nonblocking mode:
+			Server = SocketOps::ServerSocket::Create();
+			Assert::IsTrue(Server->Open(11223), (L"Open: " + StringOps::ConvertToWideString(Server->GetLastErrString())).c_str());
+			ClientSession = SocketOps::SessionSocket::StartConnect("127.0.0.1", 11223);
+			Assert::IsTrue(ClientSession->SocketValid(), (L"StartConnect: " + StringOps::ConvertToWideString(ClientSession->GetLastErrString())).c_str());
+			Assert::AreEqual(SocketOps::Result::OK, Server->WaitEvent(100), StringOps::ConvertToWideString(Server->GetLastErrString()).c_str());
+			ServerSession = Server->Accept();
+			Assert::IsTrue(ServerSession.get() ? ServerSession->Valid() : false, L"Accept failed");
+			Assert::AreEqual(SocketOps::Result::OK, ClientSession->PollConnect(), (L"PollConnect: " + StringOps::ConvertToWideString(ClientSession->GetLastErrString())).c_str());
+			Assert::IsTrue(ServerSession->SetNonBlocking(true), (L"SetNonBlocking: " + StringOps::ConvertToWideString(ServerSession->GetLastErrString())).c_str());
+
+			// Write more data than socket buffers can hold while client is not reading; ensure write returns immediately,
+			// with unwritten remainder held in backlog:
+			const size_t total = 0x4000000;
+			std::vector<char> sendbuf(total);
+			for(size_t i = 0; i < total; ++i) sendbuf[i] = static_cast<char>(i % 251);
+			const WSABUF buffers[1] = {{gsl::narrow_cast<ULONG>(total), sendbuf.data()}};
+			SocketOps::SendBuffer backlog;
+			Assert::AreEqual(SocketOps::Result::OK, ServerSession->Write(buffers, 1, backlog), (L"Write: " + StringOps::ConvertToWideString(ServerSession->GetLastErrString())).c_str());
+			Assert::IsFalse(backlog.Empty(), L"Backlog empty after oversized write");
+
+			// Alternate client reads with backlog writes until all data is received; ensure it arrives intact, in order:
+			std::vector<char> readbuf(0x10000);
+			size_t received = 0;
+			for(int i = 0; i < 100000 && received < total; ++i) {
+				size_t br = 0;
+				if(SocketOps::ResultOK(ClientSession->WaitEvent(10))) {
+					Assert::AreEqual(SocketOps::Result::OK, ClientSession->ReadAvailable(readbuf.data(), readbuf.size(), br), (L"Read: " + StringOps::ConvertToWideString(ClientSession->GetLastErrString())).c_str());
+					Assert::IsTrue(br <= total - received && memcmp(readbuf.data(), sendbuf.data() + received, br) == 0, L"Invalid data received");
+					received += br;
+				}
+				Assert::AreEqual(SocketOps::Result::OK, ServerSession->WriteBacklog(backlog), (L"WriteBacklog: " + StringOps::ConvertToWideString(ServerSession->GetLastErrString())).c_str());
+			}
+			Assert::AreEqual(total, received, L"Not all data received");
+			Assert::IsTrue(backlog.Empty(), L"Backlog not empty after all data received");
+		}
+
+		TEST_METHOD(ConnectRaceFallback)
+		{
+			// Open up listening socket (IPv4 only):
+			Server = SocketOps::ServerSocket::Create();
+			Assert::IsTrue(Server->Open(11223), (L"Open: " + StringOps::ConvertToWideString(Server->GetLastErrString())).c_str());
+
+			// Race IPv6 and IPv4 loopback addresses (IPv6 attempt is started first, and refused), ensure IPv4 attempt wins:
+			SocketOps::ConnectRace race;
+			Assert::IsTrue(race.Start({"::1", "127.0.0.1"}, 11223, false, SocketOps::ConnectRace::ATTEMPT_DELAY_MIN), (L"Start: " + StringOps::ConvertToWideString(race.GetLastErrString())).c_str());
+			SocketOps::Result rc = SocketOps::Result::Timeout;
+			for(int i = 0; i < 500 && rc == SocketOps::Result::Timeout; ++i) {
+				if((rc = race.Poll(ClientSession)) == SocketOps::Result::Timeout) Sleep(5);
+			}
+			Assert::AreEqual(SocketOps::Result::OK, rc, (L"Poll: " + StringOps::ConvertToWideString(race.GetLastErrString())).c_str());
+			Assert::IsTrue(ClientSession->Valid(), L"Winning session not valid");
+			Assert::AreEqual(size_t{0}, race.AttemptsActive(), L"Losing attempts not abandoned");
+
+			// Ensure winning session is connected to server:
+			Assert::AreEqual(SocketOps::Result::OK, Server->WaitEvent(100), StringOps::ConvertToWideString(Server->GetLastErrString()).c_str());
+			ServerSession = Server->Accept();
+			Assert::IsTrue(ServerSession->SocketValid(), (L"Accept: " + StringOps::ConvertToWideString(ServerSession->GetLastErrString())).c_str());
+
+			// Race with no reachable address should fail once all attempts have failed (refusal may take some time):
+			SocketOps::ConnectRace failrace;
+			Assert::IsTrue(failrace.Start({"::1", "127.0.0.1"}, 11224, false, SocketOps::ConnectRace::ATTEMPT_DELAY_MIN), L"Start failed");
+			for(int i = 0; i < 2000 && (rc = failrace.Poll(ClientSession)) == SocketOps::Result::Timeout; ++i) Sleep(5);
+			Assert::AreEqual(SocketOps::Result::Failed, rc, L"Race to closed port did not fail");
+			Assert::AreEqual(size_t{2}, failrace.AttemptsStarted(), L"Not all addresses attempted");
+		}
+
 		TEST_METHOD(TLSConnections_Accept)
 		{
 			// Open up listening socket:
@@ -219,6 +456,204 @@ namespace fiQCPPBaseTESTS
 			Logger::WriteMessage(readbuf);}
 		}
 
+		TEST_METHOD(TLSSessionResumption)
+		{
+			// Open up listening socket; purge client cache so that first connection performs full handshake:
+			Server = SocketOps::ServerSocket::Create();
+			Assert::IsTrue(Server->Open(11223), (L"Open: " + StringOps::ConvertToWideString(Server->GetLastErrString())).c_str());
+			Assert::IsTrue(Server->InitCredentialsFromStore("localhost", "", false), (L"InitCredentials: " + StringOps::ConvertToWideString(Server->GetLastErrString())).c_str());
+			SocketOps::PurgeTLSSessionCache();
+			SocketOps::TLSResumptionStats before, after;
+			SocketOps::GetTLSResumptionStats(before);
+
+			// Connect three times to the same endpoint, rotating server ticket key before the third connection (which
+			// should still resume, as previous key is retained):
+			for(int c = 0; c < 3; ++c) {
+				if(c == 2) Assert::IsTrue(Server->RotateTicketKeys(), (L"RotateTicketKeys: " + StringOps::ConvertToWideString(Server->GetLastErrString())).c_str());
+				ClientSession = SocketOps::SessionSocket::StartConnect("127.0.0.1", 11223, true);
+				Assert::IsTrue(ClientSession->SocketValid(), (L"StartConnect: " + StringOps::ConvertToWideString(ClientSession->GetLastErrString())).c_str());
+				Assert::AreEqual(SocketOps::Result::OK, Server->WaitEvent(10), (L"Server wait: " + StringOps::ConvertToWideString(Server->GetLastErrString())).c_str());
+				ServerSession = Server->StartAccept();
+				Assert::IsTrue(ServerSession->SocketValid(), (L"Server StartAccept: " + StringOps::ConvertToWideString(ServerSession->GetLastErrString())).c_str());
+				{SocketOps::Result crc = SocketOps::Result::Timeout, src = SocketOps::Result::Timeout;
+				for(int i = 0; i < 10 && (SocketOps::ResultTimeout(crc) || SocketOps::ResultTimeout(src)); ++i) {
+					if(SocketOps::ResultTimeout(crc)) crc = ClientSession->PollConnect();
+					if(SocketOps::ResultTimeout(src)) src = Server->PollAccept(ServerSession);
+				}
+				Assert::AreEqual(SocketOps::Result::OK, crc, (L"PollConnect: " + StringOps::ConvertToWideString(ClientSession->GetLastErrString())).c_str());
+				Assert::AreEqual(SocketOps::Result::OK, src, (L"PollAccept: " + StringOps::ConvertToWideString(ServerSession->GetLastErrString())).c_str());}
+
+				// First connection should perform full handshake, all others should resume:
+				Assert::AreEqual(c > 0, ClientSession->TLSResumed(), L"Invalid client resumption state");
+				Assert::AreEqual(c > 0, ServerSession->TLSResumed(), L"Invalid server resumption state");
+				ClientSession.reset(nullptr);
+				ServerSession.reset(nullptr);
+			}
+			SocketOps::GetTLSResumptionStats(after);
+			Assert::AreEqual(1ULL, after.ClientFull - before.ClientFull, L"Invalid client full handshake count");
+			Assert::AreEqual(2ULL, after.ClientResumed - before.ClientResumed, L"Invalid client resumption count");
+			Assert::AreEqual(2ULL, after.ServerResumed - before.ServerResumed, L"Invalid server resumption count");
+		}
+
+		TEST_METHOD(TLSPackedSend)
+		{
+			// Open up listening socket, connect and negotiate without blocking:
+			Server = SocketOps::ServerSocket::Create();
+			Assert::IsTrue(Server->Open(11223), (L"Open: " + StringOps::ConvertToWideString(Server->GetLastErrString())).c_str());
+			Assert::IsTrue(Server->InitCredentialsFromStore("localhost", "", false), (L"InitCredentials: " + StringOps::ConvertToWideString(Server->GetLastErrString())).c_str());
+			ClientSession = SocketOps::SessionSocket::StartConnect("127.0.0.1", 11223, true);
+			Assert::IsTrue(ClientSession->SocketValid(), (L"StartConnect: " + StringOps::ConvertToWideString(ClientSession->GetLastErrString())).c_str());
+			Assert::AreEqual(SocketOps::Result::OK, Server->WaitEvent(10), (L"Server wait: " + StringOps::ConvertToWideString(Server->GetLastErrString())).c_str());
+			ServerSession = Server->StartAccept();
+			Assert::IsTrue(ServerSession->SocketValid(), (L"Server StartAccept: " + StringOps::ConvertToWideString(ServerSession->GetLastErrString())).c_str());
+			{SocketOps::Result crc = SocketOps::Result::Timeout, src = SocketOps::Result::Timeout;
+			for(int i = 0; i < 10 && (SocketOps::ResultTimeout(crc) || SocketOps::ResultTimeout(src)); ++i) {
+				if(SocketOps::ResultTimeout(crc)) crc = ClientSession->PollConnect();
+				if(SocketOps::ResultTimeout(src)) src = Server->PollAccept(ServerSession);
+			}
+			Assert::AreEqual(SocketOps::Result::OK, crc, (L"PollConnect: " + StringOps::ConvertToWideString(ClientSession->GetLastErrString())).c_str());
+			Assert::AreEqual(SocketOps::Result::OK, src, (L"PollAccept: " + StringOps::ConvertToWideString(ServerSession->GetLastErrString())).c_str());}
+
+			// Kernel TLS offload is not enabled, so both directions should be handled in user space:
+			Assert::IsTrue(SocketOps::TLSOffload::None == ServerSession->GetTLSOffload(), L"Unexpected kernel TLS offload");
+
+			// Send small buffers followed by a buffer spanning several TLS messages, in a single gather send (twice, so
+			// that second send reuses session's encryption buffer):
+			char header[2] = {0, 5}, body[6] = "HELLO";
+			std::vector<char> bulk(20000);
+			for(size_t i = 0; i < bulk.size(); ++i) bulk[i] = static_cast<char>('A' + (i % 26));
+			const WSABUF buffers[3] = {{2, header}, {5, body}, {gsl::narrow_cast<ULONG>(bulk.size()), bulk.data()}};
+			std::vector<char> expected;
+			for(int pass = 0; pass < 2; ++pass) {
+				Assert::AreEqual(SocketOps::Result::OK, ServerSession->Send(buffers, 3), (L"Gather send: " + StringOps::ConvertToWideString(ServerSession->GetLastErrString())).c_str());
+				for(const WSABUF& b : buffers) expected.insert(expected.end(), b.buf, b.buf + b.len);
+			}
+
+			// Read all data at client, and confirm it arrives intact and in order:
+			std::vector<char> received;
+			char readbuf[4096] = {0};
+			for(int i = 0; i < 100 && received.size() < expected.size(); ++i) {
+				size_t br = 0;
+				if(SocketOps::ResultOK(ClientSession->WaitEvent(100))) {
+					Assert::IsFalse(SocketOps::ResultFailed(ClientSession->ReadAvailable(readbuf, sizeof(readbuf), br)), (L"Read: " + StringOps::ConvertToWideString(ClientSession->GetLastErrString())).c_str());
+					received.insert(received.end(), readbuf, readbuf + br);
+				}
+			}
+			Assert::AreEqual(expected.size(), received.size(), L"Invalid number of bytes read");
+			Assert::IsTrue(expected == received, L"Invalid data received");
+		}
+
+		TEST_METHOD(TLSPacketView)
+		{
+			// Open up listening socket, connect and negotiate without blocking:
+			Server = SocketOps::ServerSocket::Create();
+			Assert::IsTrue(Server->Open(11223), (L"Open: " + StringOps::ConvertToWideString(Server->GetLastErrString())).c_str());
+			Assert::IsTrue(Server->InitCredentialsFromStore("localhost", "", false), (L"InitCredentials: " + StringOps::ConvertToWideString(Server->GetLastErrString())).c_str());
+			ClientSession = SocketOps::SessionSocket::StartConnect("127.0.0.1", 11223, true);
+			Assert::IsTrue(ClientSession->SocketValid(), (L"StartConnect: " + StringOps::ConvertToWideString(ClientSession->GetLastErrString())).c_str());
+			Assert::AreEqual(SocketOps::Result::OK, Server->WaitEvent(10), (L"Server wait: " + StringOps::ConvertToWideString(Server->GetLastErrString())).c_str());
+			ServerSession = Server->StartAccept();
+			Assert::IsTrue(ServerSession->SocketValid(), (L"Server StartAccept: " + StringOps::ConvertToWideString(ServerSession->GetLastErrString())).c_str());
+			{SocketOps::Result crc = SocketOps::Result::Timeout, src = SocketOps::Result::Timeout;
+			for(int i = 0; i < 10 && (SocketOps::ResultTimeout(crc) || SocketOps::ResultTimeout(src)); ++i) {
+				if(SocketOps::ResultTimeout(crc)) crc = ClientSession->PollConnect();
+				if(SocketOps::ResultTimeout(src)) src = Server->PollAccept(ServerSession);
+			}
+			Assert::AreEqual(SocketOps::Result::OK, crc, (L"PollConnect: " + StringOps::ConvertToWideString(ClientSession->GetLastErrString())).c_str());
+			Assert::AreEqual(SocketOps::Result::OK, src, (L"PollAccept: " + StringOps::ConvertToWideString(ServerSession->GetLastErrString())).c_str());}
+
+			// Send many packets (including a zero-length keepalive) in a single gather send, so that several packets
+			// arrive in each TLS message:
+			const char packet[] = "\x00\x05HELLO\x00\x00\x00\x05WORLD";
+			std::vector<WSABUF> buffers(200, WSABUF{sizeof(packet) - 1, const_cast<char*>(packet)});
+			Assert::AreEqual(SocketOps::Result::OK, ServerSession->Send(buffers.data(), buffers.size()), (L"Gather send: " + StringOps::ConvertToWideString(ServerSession->GetLastErrString())).c_str());
+
+			// Read packets at client as views into session buffer:
+			for(size_t p = 0; p < buffers.size() * 3; ++p) {
+				gsl::span<const char> view;
+				Assert::AreEqual(SocketOps::Result::OK, ClientSession->ReadPacketView(view, 1000), (L"Packet view read: " + StringOps::ConvertToWideString(ClientSession->GetLastErrString())).c_str());
+				const char* const expected = (p % 3 == 0) ? "HELLO" : (p % 3 == 1) ? "" : "WORLD";
+				Assert::AreEqual(std::string(expected), std::string(view.begin(), view.end()), L"Invalid packet received");
+			}
+
+			// Views are not available on non-TLS sessions:
+			{gsl::span<const char> view;
+			SocketOps::SessionSocketPtr plain = SocketOps::SessionSocket::StartConnect("127.0.0.1", 11223, false);
+			Assert::AreEqual(SocketOps::Result::InvalidArg, plain->ReadPacketView(view, 0), L"Packet view read on non-TLS session");}
+		}
+
+		TEST_METHOD(TLSBufferPool)
+		{
+			// Record pool usage before any sessions are opened:
+			SocketOps::TLSBufferStats baseline, stats;
+			SocketOps::GetTLSBufferStats(baseline);
+
+			// Open up listening socket, connect and negotiate without blocking:
+			Server = SocketOps::ServerSocket::Create();
+			Assert::IsTrue(Server->Open(11223), (L"Open: " + StringOps::ConvertToWideString(Server->GetLastErrString())).c_str());
+			Assert::IsTrue(Server->InitCredentialsFromStore("localhost", "", false), (L"InitCredentials: " + StringOps::ConvertToWideString(Server->GetLastErrString())).c_str());
+			ClientSession = SocketOps::SessionSocket::StartConnect("127.0.0.1", 11223, true);
+			Assert::IsTrue(ClientSession->SocketValid(), (L"StartConnect: " + StringOps::ConvertToWideString(ClientSession->GetLastErrString())).c_str());
+			Assert::AreEqual(SocketOps::Result::OK, Server->WaitEvent(10), (L"Server wait: " + StringOps::ConvertToWideString(Server->GetLastErrString())).c_str());
+			ServerSession = Server->StartAccept();
+			Assert::IsTrue(ServerSession->SocketValid(), (L"Server StartAccept: " + StringOps::ConvertToWideString(ServerSession->GetLastErrString())).c_str());
+			{SocketOps::Result crc = SocketOps::Result::Timeout, src = SocketOps::Result::Timeout;
+			for(int i = 0; i < 10 && (SocketOps::ResultTimeout(crc) || SocketOps::ResultTimeout(src)); ++i) {
+				if(SocketOps::ResultTimeout(crc)) crc = ClientSession->PollConnect();
+				if(SocketOps::ResultTimeout(src)) src = Server->PollAccept(ServerSession);
+			}
+			Assert::AreEqual(SocketOps::Result::OK, crc, (L"PollConnect: " + StringOps::ConvertToWideString(ClientSession->GetLastErrString())).c_str());
+			Assert::AreEqual(SocketOps::Result::OK, src, (L"PollAccept: " + StringOps::ConvertToWideString(ServerSession->GetLastErrString())).c_str());}
+
+			// Exchange data; each session should hold no more than its two buffers, drawn from the pool:
+			char readbuf[16] = {0};
+			Assert::AreEqual(SocketOps::Result::OK, ServerSession->Send("HELLO", 5), (L"Send: " + StringOps::ConvertToWideString(ServerSession->GetLastErrString())).c_str());
+			Assert::AreEqual(SocketOps::Result::OK, ClientSession->ReadExact(readbuf, 5, 1000), (L"Read: " + StringOps::ConvertToWideString(ClientSession->GetLastErrString())).c_str());
+			Assert::AreEqual(std::string("HELLO"), std::string(readbuf, 5), L"Invalid data received");
+			SocketOps::GetTLSBufferStats(stats);
+			Assert::IsTrue(stats.InUse <= baseline.InUse + 4, L"Sessions hold too many buffers");
+			Assert::IsTrue(stats.InUse <= stats.Allocated, L"Invalid pool usage");
+
+			// Once sessions are closed, all of their buffers should be returned to the pool (and remain allocated there):
+			ClientSession->Close();
+			ServerSession->Close();
+			SocketOps::GetTLSBufferStats(stats);
+			Assert::AreEqual(baseline.InUse, stats.InUse, L"Buffers not returned to pool");
+			Assert::IsTrue(stats.Allocated > 0, L"Pool holds no buffers");
+		}
+
+		TEST_METHOD(KernelTLSSetting)
+		{
+			// Offload can always be disabled; it can only be enabled where backend supports it (never with SChannel, nor
+			// with Windows builds of OpenSSL, which are built without kTLS):
+			Assert::IsTrue(SocketOps::SetKernelTLS(false), L"Failed to disable kernel TLS");
+			Assert::IsFalse(SocketOps::SetKernelTLS(true), L"Kernel TLS enabled on Windows");
+
+			// Request to enable should have no effect, so sessions negotiated afterwards should use user-space TLS:
+			Server = SocketOps::ServerSocket::Create();
+			Assert::IsTrue(Server->Open(11223), (L"Open: " + StringOps::ConvertToWideString(Server->GetLastErrString())).c_str());
+			Assert::IsTrue(Server->InitCredentialsFromStore("localhost", "", false), (L"InitCredentials: " + StringOps::ConvertToWideString(Server->GetLastErrString())).c_str());
+			ClientSession = SocketOps::SessionSocket::StartConnect("127.0.0.1", 11223, true);
+			Assert::IsTrue(ClientSession->SocketValid(), (L"StartConnect: " + StringOps::ConvertToWideString(ClientSession->GetLastErrString())).c_str());
+			Assert::AreEqual(SocketOps::Result::OK, Server->WaitEvent(10), (L"Server wait: " + StringOps::ConvertToWideString(Server->GetLastErrString())).c_str());
+			ServerSession = Server->StartAccept();
+			Assert::IsTrue(ServerSession->SocketValid(), (L"Server StartAccept: " + StringOps::ConvertToWideString(ServerSession->GetLastErrString())).c_str());
+			{SocketOps::Result crc = SocketOps::Result::Timeout, src = SocketOps::Result::Timeout;
+			for(int i = 0; i < 10 && (SocketOps::ResultTimeout(crc) || SocketOps::ResultTimeout(src)); ++i) {
+				if(SocketOps::ResultTimeout(crc)) crc = ClientSession->PollConnect();
+				if(SocketOps::ResultTimeout(src)) src = Server->PollAccept(ServerSession);
+			}
+			Assert::AreEqual(SocketOps::Result::OK, crc, (L"PollConnect: " + StringOps::ConvertToWideString(ClientSession->GetLastErrString())).c_str());
+			Assert::AreEqual(SocketOps::Result::OK, src, (L"PollAccept: " + StringOps::ConvertToWideString(ServerSession->GetLastErrString())).c_str());}
+			Assert::IsTrue(SocketOps::TLSOffload::None == ClientSession->GetTLSOffload(), L"Unexpected client kernel TLS offload");
+			Assert::IsTrue(SocketOps::TLSOffload::None == ServerSession->GetTLSOffload(), L"Unexpected server kernel TLS offload");
+			Assert::AreEqual(SocketOps::Result::OK, ServerSession->Send("\x00\x05HELLO", 7), (L"Send: " + StringOps::ConvertToWideString(ServerSession->GetLastErrString())).c_str());
+			{gsl::span<const char> view;
+			Assert::AreEqual(SocketOps::Result::OK, ClientSession->ReadPacketView(view, 1000), (L"Packet view read: " + StringOps::ConvertToWideString(ClientSession->GetLastErrString())).c_str());
+			Assert::AreEqual(std::string("HELLO"), std::string(view.begin(), view.end()), L"Invalid packet received");}
+			Assert::IsTrue(SocketOps::SetKernelTLS(false), L"Failed to disable kernel TLS");
+		}
+
 		TEST_METHOD_CLEANUP(Method_Cleanup) // Executes after each TEST_METHOD
 		{
 			ClientSession.reset(nullptr);
@@ -0,0 +1,96 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include "Tools/SpscRing.h"
+#include <thread>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FIQCPPBASE;
+
+namespace fiQCPPBaseTESTS
+{
+	TEST_CLASS(SpscRing_TEST)
+	{
+	public:
+
+		TEST_METHOD(WriteReadWrap)
+		{
+			SpscRing ring(100);
+			Assert::AreEqual(size_t{SpscRing::CAPACITY_MIN}, ring.Capacity(), L"Capacity not rounded up");
+			Assert::IsTrue(ring.Empty(), L"New ring not empty");
+
+			// Fill ring, ensure further writes are rejected:
+			std::vector<char> src(ring.Capacity() + 100), tgt(ring.Capacity() + 100);
+			for(size_t i = 0; i < src.size(); ++i) src[i] = static_cast<char>(i % 251);
+			Assert::AreEqual(ring.Capacity(), ring.Write(src.data(), src.size()), L"Ring not filled");
+			Assert::AreEqual(size_t{0}, ring.Write(src.data(), 1), L"Write accepted by full ring");
+			Assert::AreEqual(ring.Capacity(), ring.Available(), L"Invalid available count");
+
+			// Read part of data, then write across end of buffer and read back:
+			Assert::AreEqual(size_t{1000}, ring.Read(tgt.data(), 1000), L"Invalid read count");
+			Assert::IsTrue(memcmp(src.data(), tgt.data(), 1000) == 0, L"Invalid data read");
+			const size_t before = ring.WritePosition();
+			Assert::AreEqual(size_t{500}, ring.Write(src.data() + 100, 500), L"Invalid wrapped write count");
+			Assert::IsFalse(ring.Drained(before), L"Ring reported drained");
+			char header[4] = {0};
+			Assert::IsTrue(ring.Peek(header, 4), L"Peek failed");
+			Assert::AreEqual(src[1000], header[0], L"Invalid peeked data");
+			Assert::AreEqual(ring.Capacity() - 500, ring.Read(tgt.data(), ring.Capacity() - 500), L"Invalid read count");
+			Assert::IsTrue(memcmp(src.data() + 1000, tgt.data(), ring.Capacity() - 1000) == 0, L"Invalid data read");
+			Assert::IsTrue(memcmp(src.data() + 100, tgt.data() + ring.Capacity() - 1000, 500) == 0,
+				L"Invalid wrapped data read");
+			Assert::IsTrue(ring.Empty(), L"Ring not empty after reading all data");
+			Assert::IsTrue(ring.Drained(ring.WritePosition()), L"Ring not reported drained");
+			Assert::IsFalse(ring.Peek(header, 1), L"Peek succeeded on empty ring");
+			Assert::AreEqual(size_t{0}, ring.Read(tgt.data(), tgt.size()), L"Read succeeded on empty ring");
+		}
+
+		TEST_METHOD(ProducerConsumer)
+		{
+			// Stream known byte sequence through small ring in variable-sized pieces, from one thread to another:
+			constexpr size_t total = 0x4000000;
+			SpscRing ring(SpscRing::CAPACITY_MIN);
+			std::thread producer([&ring]() {
+				char chunk[777];
+				for(size_t sent = 0, n = 1; sent < total; n = (n % sizeof(chunk)) + 1) {
+					const size_t len = (std::min)(n, total - sent);
+					for(size_t i = 0; i < len; ++i) chunk[i] = static_cast<char>((sent + i) % 253);
+					for(size_t done = 0; done < len;) {
+						const size_t written = ring.Write(chunk + done, len - done);
+						if(written == 0) std::this_thread::yield();
+						done += written;
+					}
+					sent += len;
+				}
+			});
+			char buf[1000];
+			size_t received = 0, errors = 0;
+			while(received < total) {
+				const size_t br = ring.Read(buf, (received % sizeof(buf)) + 1);
+				if(br == 0) std::this_thread::yield();
+				for(size_t i = 0; i < br; ++i) if(buf[i] != static_cast<char>((received + i) % 253)) ++errors;
+				received += br;
+			}
+			producer.join();
+			Assert::AreEqual(size_t{0}, errors, L"Data corrupted in transit");
+			Assert::IsTrue(ring.Empty(), L"Ring not empty after transfer");
+		}
+
+		TEST_METHOD(SharedRegion)
+		{
+			// Attach producer and consumer rings to same caller-supplied region (as two processes would to a shared
+			// section), ensure data written by one is read by the other:
+			const size_t regionsize = SpscRing::RegionSize(100);
+			Assert::IsTrue(regionsize > SpscRing::CAPACITY_MIN, L"Region size excludes positions");
+			std::vector<size_t> region((regionsize + sizeof(size_t) - 1) / sizeof(size_t), ~size_t{0});
+			SpscRing producer(region.data(), 100, true);
+			SpscRing consumer(region.data(), 100, false);
+			Assert::IsTrue(consumer.Empty(), L"Region positions not initialized");
+			Assert::AreEqual(size_t{5}, producer.Write("ABCDE", 5), L"Invalid write count");
+			Assert::AreEqual(size_t{5}, consumer.Available(), L"Write not visible to consumer");
+			char tgt[8] = {0};
+			Assert::AreEqual(size_t{5}, consumer.Read(tgt, sizeof(tgt)), L"Invalid read count");
+			Assert::IsTrue(memcmp(tgt, "ABCDE", 5) == 0, L"Invalid data read");
+			Assert::IsTrue(producer.Drained(producer.WritePosition()), L"Read not visible to producer");
+		}
+	};
+}
@@ -7,7 +7,7 @@
 using namespace FIQCPPBASE;
 
 //==========================================================================================================================
-void Comms::Initialize(size_t CommThreads) {GetCommLink().Initialize(CommThreads);}
+void Comms::Initialize(size_t CommThreads, Backend backend) {GetCommLink().Initialize(CommThreads, backend);}
 void Comms::Cleanup() {GetCommLink().Cleanup();}
 
 //==========================================================================================================================
@@ -18,16 +18,48 @@ _Check_return_ Comms::CommLink& Comms::GetCommLink() noexcept {
 }
 
 //==========================================================================================================================
-void Comms::CommLink::Initialize(size_t CommThreads) {
-	UNREFERENCED_PARAMETER(CommThreads);
-	for(listenerticketmax = 0; listenerticketmax < 100;) listenertickets.push_back(++listenerticketmax);
-	for(sessionticketmax = 0; sessionticketmax < 100;) sessiontickets.push_back(++sessionticketmax);
+// CommLink::Initialize: Start up worker threads for listener and session management
+void Comms::CommLink::Initialize(size_t CommThreads, Backend backend) {
+	if(threads.empty() == false) return;
+	const size_t threadcount = ValueOps::Bounded(COMM_THREADS_MIN, CommThreads, COMM_THREADS_MAX);
+	threads.reserve(threadcount);
+	for(size_t i = 0; i < threadcount; ++i) {
+		threads.emplace_back(std::make_unique<CommThread>(*this, backend));
+		if(threads.back()->Start() == false) throw FORMAT_RUNTIME_ERROR("Error initializing thread");
+	}
+	if(resolver.Start() == false) throw FORMAT_RUNTIME_ERROR("Error initializing DNS resolver threads");
+	if(pool.Start() == false) throw FORMAT_RUNTIME_ERROR("Error initializing connection pool thread");
 }
+// CommLink::Cleanup: Stop worker threads (releasing their references to listeners and sessions), then clear tables
 void Comms::CommLink::Cleanup() {
-	listenertickets.clear();
-	sessiontickets.clear();
-	listeners.clear();
-	sessions.clear();
+	for(auto& t : threads) {
+		if(t->Stop(2500) == false) LogSink::StdErrLog("WARNING: Comms manager thread not stopped cleanly");
+	}
+	threads.clear();
+	pool.Stop();
+	resolver.Stop();
+	{std::lock_guard<std::mutex> lock(inproclock);
+	inproclisteners.clear();}
+	// Withdraw shared-memory rendezvous before clearing table, so that no accept callback is still running:
+	listeners.ForEach([](ListenerTicket, ListenerControlBlock& lcb) {
+		if(lcb.shmlistener.get()) lcb.shmlistener->Close();
+	});
+	listeners.Clear();
+	sessions.Clear();
+}
+// CommLink::~CommLink: Ensure object was shut down cleanly
+Comms::CommLink::~CommLink() noexcept(false) {
+	// In normal circumstances, all worker threads should be shut down by call to Cleanup; if main() failed to do so,
+	// just log warning (if this is being destructed, program is terminating anyway):
+	if(threads.empty() == false) LogSink::StdErrLog("WARNING: Comms manager destructing without shutdown");
+}
+// CommLink::AssignToThread: Queue listener or session to worker thread(s) for polling
+void Comms::CommLink::AssignToThread(Assignment::Type type, unsigned int ticket, bool allthreads) {
+	if(threads.empty()) return;
+	else if(allthreads) {
+		for(auto& t : threads) t->Assign(type, ticket);
+	}
+	else threads[nextthread.fetch_add(1) % threads.size()]->Assign(type, ticket);
 }
 
 //==========================================================================================================================
@@ -42,13 +74,68 @@ _Check_return_ Comms::ListenerTicket Comms::CommLink::RegisterListener(
 		if(LastErrString) *LastErrString = "Invalid listener configuration";
 		return 0;
 	}
+	else if(threads.empty()) {
+		if(LastErrString) *LastErrString = "Comms threads not initialized";
+		return 0;
+	}
 	else if(LastErrString) LastErrString->clear();
 
-	std::unique_ptr<ListenerControlBlock> lcb = std::make_unique<ListenerControlBlock>(client, connection);
+	// In-process listener has no socket; record it by address, for RequestConnect to pair sessions with directly:
+	if(connection->IsInProc()) {
+		const std::string& address = connection->GetRemoteAddress();
+		std::lock_guard<std::mutex> lock(inproclock);
+		if(inproclisteners.find(address) != inproclisteners.end()) {
+			if(LastErrString) *LastErrString = "In-process listener address already registered";
+			return 0;
+		}
+		const ListenerTicket ticket = listeners.Insert(
+			std::make_unique<ListenerControlBlock>(client, connection, ACCEPT_BATCH_DEFAULT));
+		if(ticket == 0) throw FORMAT_RUNTIME_ERROR("Failed to acquire ticket");
+		inproclisteners.emplace(address, ticket);
+		LOG_FROM_TEMPLATE(LogLevel::Debug, "Registered listener ticket {:X8} for {:S60} on {:S60}",
+			ticket, client->GetName().c_str(), address.c_str());
+		return ticket;
+	}
+
+	// Retrieve listen backlog and accept batch size from configuration (using defaults if not provided):
+	const std::string& backlog = connection->GetConfigParm("BACKLOG");
+	const std::string& acceptbatch = connection->GetConfigParm("ACCEPTBATCH");
+	const int ibacklog = backlog.empty() ? LISTEN_BACKLOG_DEFAULT
+		: ValueOps::Bounded(1, atoi(backlog.c_str()), LISTEN_BACKLOG_MAX);
+	const size_t iacceptbatch = acceptbatch.empty() ? ACCEPT_BATCH_DEFAULT
+		: ValueOps::Bounded(ACCEPT_BATCH_MIN, static_cast<size_t>(ValueOps::MinZero(atoi(acceptbatch.c_str()))),
+			ACCEPT_BATCH_MAX);
+
+	std::unique_ptr<ListenerControlBlock> lcb = std::make_unique<ListenerControlBlock>(client, connection, iacceptbatch);
+	if(connection->IsShm()) {
+		// Shared-memory listener has no socket either; it publishes a named rendezvous, and accepts links from that
+		// rendezvous' wait callback (see AcceptShared), so is not assigned to worker threads:
+		lcb->shmlistener = std::make_unique<SharedRing::Listener>();
+		if(lcb->shmlistener->Open(connection->GetShmName()) == false) {
+			if(LastErrString) LastErrString->assign(lcb->shmlistener->GetLastErrString());
+			return 0;
+		}
+		const ListenerTicket ticket = listeners.Insert(std::move(lcb));
+		if(ticket == 0) throw FORMAT_RUNTIME_ERROR("Failed to acquire ticket");
+		auto lcbref = listeners.Acquire(ticket);
+		if(lcbref->shmlistener->Watch(&SharedAccept,
+			reinterpret_cast<void*>(static_cast<uintptr_t>(ticket))) == false) {
+			if(LastErrString) LastErrString->assign(lcbref->shmlistener->GetLastErrString());
+			lcbref->shmlistener->Close();
+			listeners.Retire(ticket);
+			return 0;
+		}
+		LOG_FROM_TEMPLATE(LogLevel::Debug, "Registered listener ticket {:X8} for {:S60} on {:S60}",
+			ticket, client->GetName().c_str(), connection->GetRemoteAddress().c_str());
+		return ticket;
+	}
+	const bool sharded = lcb->sharded;
 	try {
-		// Create socket listener and attempt to initialize:
+		// Create socket listener and attempt to initialize (in nonblocking mode, as listener will be polled by worker
+		// thread(s) and drained with batched accepts); unix domain listeners bind to their path rather than a port:
 		lcb->serversocket = SocketOps::ServerSocket::Create();
-		if(lcb->serversocket->Open(connection->GetLocalPort()) == false) {
+		if(lcb->serversocket->Open(connection->GetLocalPort(),
+			connection->IsUnix() ? connection->GetRemoteAddress().c_str() : nullptr, ibacklog, true) == false) {
 			if(LastErrString) LastErrString->assign(std::move(lcb->serversocket->GetLastErrString()));
 			return 0;
 		}
@@ -68,69 +155,50 @@ _Check_return_ Comms::ListenerTicket Comms::CommLink::RegisterListener(
 	}
 	catch(const std::exception&) {std::throw_with_nested(FORMAT_RUNTIME_ERROR("Failed to initialize socket listener"));}
 
-	// Lock access to available ListenerTicket container and acquire ticket
-	ListenerTicket ticket = 0;
-	{auto lock = Locks::Acquire(listenerticketlock);
-	if(lock.IsLocked()) {
-		if(listenertickets.empty()) {
-			// No tickets available - add up to 100 new ticket values, stopping at max
-			for(short s = 0; s < 100 && listenerticketmax < LISTENER_TICKETS_MAX; ++s)
-				listenertickets.push_back(++listenerticketmax);
-		}
-		if(listenertickets.empty() == false) {
-			ticket = listenertickets.front();
-			listenertickets.pop_front();
-		}
-	}}
+	// Insert listener into table (allocating ticket), then assign to worker thread(s), which will now be responsible for
+	// accepting connections (sharded listeners are assigned to every thread):
+	const ListenerTicket ticket = listeners.Insert(std::move(lcb));
 	if(ticket == 0) throw FORMAT_RUNTIME_ERROR("Failed to acquire ticket");
-
-	try {
-		auto lock = Locks::Acquire(listenerlock);
-		lock.EnsureLocked();
-
-		// Ensure ticket does not already exist in map (should not be possible):
-		if(listeners.count(ticket)) throw FORMAT_RUNTIME_ERROR("Listener ticket already exists in map");
-
-		// Add listener to map; worker thread will now be responsible for listening for connections:
-		listeners.emplace(std::piecewise_construct,
-			std::forward_as_tuple(ticket),
-			std::forward_as_tuple(std::move(lcb))
-		);
-	}
-	catch(const std::exception&) {
-		// Return ticket to available collection prior to re-throwing exception:
-		auto lock = Locks::Acquire(listenerticketlock);
-		if(lock.IsLocked()) listenertickets.push_back(ticket);
-		std::throw_with_nested(FORMAT_RUNTIME_ERROR("Failed to register listener"));
-	}
+	AssignToThread(Assignment::Type::Listener, ticket, sharded);
 
 	// Log listener registration and return ticket:
-	LOG_FROM_TEMPLATE(LogLevel::Debug, "Registered listener ticket {:X8} for {:S60} on port {:D}",
-		ticket, client->GetName().c_str(), connection->GetLocalPort());
+	if(connection->IsUnix()) {
+		LOG_FROM_TEMPLATE(LogLevel::Debug, "Registered listener ticket {:X8} for {:S60} on {:S60} (backlog {:D}{:S10})",
+			ticket, client->GetName().c_str(), connection->GetRemoteAddress().c_str(), ibacklog, sharded ? ", sharded" : "");
+	}
+	else LOG_FROM_TEMPLATE(LogLevel::Debug, "Registered listener ticket {:X8} for {:S60} on port {:D} (backlog {:D}{:S10})",
+		ticket, client->GetName().c_str(), connection->GetLocalPort(), ibacklog, sharded ? ", sharded" : "");
 	return ticket;
 }
 Comms::Result Comms::CommLink::DeregisterListener(ListenerTicket listener, int timeout) {
 	Result rc = Result::InvalidTicket;
 	std::shared_ptr<CommsClient> client(nullptr);
 
-	// Lock access to listener map, then look up listener:
+	// Look up listener in table (holding reference until complete):
 	std::shared_ptr<ThreadOps::Event> shutdownevent(nullptr);
-	{auto lock = Locks::Acquire(listenerticketlock);
-	lock.EnsureLocked();
-	auto seek = listeners.find(listener);
-	if((seek == listeners.end() ? nullptr : seek->second.get()) != nullptr) {
-		if(seek->second->shutdownflag == false) {
-			// Initialize event object and share with listener, if waiting:
+	if(auto lcb = listeners.Acquire(listener)) {
+		// Flag that listener should be removed by worker thread (exactly one caller will succeed):
+		if(lcb->shutdownflag.exchange(true) == false) {
+			// Initialize event object and share with listener, if waiting; save client pointer:
 			if(timeout != 0) {
 				shutdownevent = std::make_shared<ThreadOps::Event>();
-				seek->second->shutdownevent = shutdownevent;
+				lcb->shutdownevent = shutdownevent;
 			}
-			// Save client pointer, flag that listener should be removed by worker thread:
-			client = seek->second->client.lock();
-			seek->second->shutdownflag = true;
+			client = lcb->client.lock();
 			rc = Result::OK;
+			// In-process or shared-memory listener is not polled by any worker thread, so remove from registry (or
+			// withdraw rendezvous, waiting for any accept in progress) and retire immediately (shutdown event is set
+			// once last reference is released):
+			if(lcb->serversocket.get() == nullptr) {
+				if(lcb->shmlistener.get()) lcb->shmlistener->Close();
+				else {
+					std::lock_guard<std::mutex> lock(inproclock);
+					inproclisteners.erase(lcb->connection->GetRemoteAddress());
+				}
+				listeners.Retire(listener);
+			}
 		}
-	}}
+	}
 
 	// Log result of operation and return:
 	if(ResultOK(rc)) {
@@ -143,7 +211,20 @@ Comms::Result Comms::CommLink::DeregisterListener(ListenerTicket listener, int t
 		}
 	}
 	else LOG_FROM_TEMPLATE(LogLevel::Warn, "Attempted to deregister invalid ticket {:X8}", listener);
-	return rc; 
+	return rc;
+}
+_Check_return_ Comms::Result Comms::CommLink::GetListenerStats(ListenerTicket listener, ListenerStats& stats) {
+	if(auto lcb = listeners.Acquire(listener)) {
+		// Traffic totals combine sessions already closed with those still registered:
+		stats = lcb->GetStats();
+		lcb->closedtraffic.AddTo(stats.Traffic);
+		sessions.ForEach([&stats, listener](SessionTicket, SessionControlBlock& scb) {
+			if(scb.listener == listener) scb.traffic.AddTo(stats.Traffic);
+		});
+		return Result::OK;
+	}
+	stats = ListenerStats{};
+	return Result::InvalidTicket;
 }
 
 //==========================================================================================================================
@@ -158,13 +239,19 @@ _Check_return_ Comms::SessionTicket Comms::CommLink::RequestConnect(
 		if(LastErrString) *LastErrString = "Invalid client configuration";
 		return 0;
 	}
-	else if(LastErrString) LastErrString->clear();
+	else if(connection->IsInProc()) return ConnectInProc(client, connection, LastErrString);
+	else if(connection->IsShm()) return ConnectShared(client, connection, LastErrString);
 
 	const bool syncconnect = connection->CheckFlag(CommFlags::SyncConnect),
 		syncdata = connection->CheckFlag(CommFlags::SyncData);
+	if(threads.empty() && syncdata == false) {
+		if(LastErrString) *LastErrString = "Comms threads not initialized";
+		return 0;
+	}
+	else if(LastErrString) LastErrString->clear();
 
-	SessionTicket ticket = 0;
 	std::unique_ptr<SessionControlBlock> scb = std::make_unique<SessionControlBlock>(client, connection);
+	bool leased = false;
 	try {
 
 		// Retrieve configuration parameters, parse connection timeout:
@@ -172,83 +259,341 @@ _Check_return_ Comms::SessionTicket Comms::CommLink::RequestConnect(
 			tlsmethod = connection->GetConfigParm("TLSMETHOD");
 		const int iconntimeout = conntimeout.empty() ? 0 : atoi(conntimeout.c_str());
 
-		LOG_FROM_TEMPLATE(LogLevel::Debug, "{:S20} connection for {:S60} to {:S20}:{:D}",
-			syncconnect ? "Attempting" : "Initiating", client->GetName().c_str(),
-			connection->GetRemoteAddress().c_str(), connection->GetRemotePort());
-
-		// Attempt outbound connection (either synchronous or not, based on config flags):
-		if(syncconnect) {
-			scb->sessionsocket = SocketOps::SessionSocket::Connect(connection->GetRemoteAddress().c_str(),
-				connection->GetRemotePort(), iconntimeout, (tlsmethod.empty() == false), tlsmethod);
-			// Flag that connection has already been established (skip ahead to open if sync data mode):
-			scb->state = syncdata ? SessionControlBlock::State::Open : SessionControlBlock::State::Connected;
+		// If connection is pooled, attempt to lease pre-connected socket (skipping ahead to connected state, or open if
+		// sync data mode):
+		if(connection->CheckFlag(CommFlags::Pooled)) {
+			if((scb->sessionsocket = pool.Lease(*connection)).get() != nullptr) {
+				leased = true;
+				++scb->connectattempts; // Pool resolved remote address and made the attempt on session's behalf
+				scb->state = syncdata ? SessionControlBlock::State::Open : SessionControlBlock::State::Connected;
+			}
 		}
-		else {
-			scb->sessionsocket = SocketOps::SessionSocket::StartConnect(connection->GetRemoteAddress().c_str(),
-				connection->GetRemotePort(), tlsmethod.empty() == false);
-			// Set connection timeout period (default to 30 seconds if not provided):
-			scb->conntimeoutat += std::chrono::milliseconds(iconntimeout > 0 ? iconntimeout : 30000);
+
+		// Otherwise, attempt outbound connection (either synchronous or not, based on config flags):
+		if(leased == false) {
+			LOG_FROM_TEMPLATE(LogLevel::Debug, "{:S20} connection for {:S60} to {:S20}:{:D}",
+				syncconnect ? "Attempting" : "Initiating", client->GetName().c_str(),
+				connection->GetRemoteAddress().c_str(), connection->GetRemotePort());
+			// Resolve remote address (address literals, and names with cached results, are resolved immediately);
+			// sessions with no owning thread must wait for lookup here, otherwise owning thread starts connection once
+			// name is resolved:
+			const int timeout = (iconntimeout > 0 ? iconntimeout : CONNECT_TIMEOUT_DEFAULT);
+			scb->lookup = resolver.Resolve(connection->GetRemoteAddress());
+			if((syncconnect || syncdata) && scb->lookup->Wait(timeout) == false) {
+				if(LastErrString) *LastErrString = "Timed out resolving remote address";
+				return 0;
+			}
+			if(syncconnect) {
+				// Connect to each address in turn, until one succeeds:
+				const DnsResolver::LookupPtr resolved = std::move(scb->lookup);
+				for(const auto& address : resolved->GetAddresses()) {
+					++scb->connectattempts;
+					scb->sessionsocket = SocketOps::SessionSocket::Connect(address.c_str(),
+						connection->GetRemotePort(), iconntimeout, (tlsmethod.empty() == false), tlsmethod);
+					if(scb->sessionsocket->SocketValid()) break;
+				}
+				if(scb->sessionsocket.get() == nullptr) {
+					if(LastErrString) *LastErrString = resolved->GetLastErrString();
+					return 0;
+				}
+				else if(connection->CheckFlag(CommFlags::ExtendedHeader) && scb->sessionsocket->SocketValid())
+					scb->sessionsocket->SetSessionFlags(SocketFlags::ExtendedHeader);
+				// Flag that connection has already been established (skip ahead to open if sync data mode):
+				scb->state = syncdata ? SessionControlBlock::State::Open : SessionControlBlock::State::Connected;
+			}
+			else {
+				if(scb->lookup->Complete() && scb->ConnectResolved(LastErrString) == false) return 0;
+				// Set connection timeout period, covering both lookup and connection:
+				scb->conntimeoutat += std::chrono::milliseconds(timeout);
+			}
 		}
 
-		// If socket not initialized, return now:
-		if((scb->sessionsocket.get() ? scb->sessionsocket->SocketValid() : false) == false) {
+		// If socket not initialized (and not awaiting lookup), return now:
+		if(scb->lookup.get() != nullptr || scb->race.get() != nullptr) {} // Connection continued by owning thread
+		else if((scb->sessionsocket.get() ? scb->sessionsocket->SocketValid() : false) == false) {
 			if(scb->sessionsocket.get() && LastErrString)
 				LastErrString->assign(std::move(scb->sessionsocket->GetLastErrString()));
 			return 0;
 		}
-
-		// Otherwise, connection has been initiated - retrieve ticket:
-		ticket = GetSessionTicket();
+		else if(leased && connection->CheckFlag(CommFlags::ExtendedHeader))
+			scb->sessionsocket->SetSessionFlags(SocketFlags::ExtendedHeader);
 	}
 	catch(const std::exception&) {std::throw_with_nested(FORMAT_RUNTIME_ERROR("Outbound connection failed"));}
 
+	// Insert session into table (allocating ticket); worker thread responsible for polling connection (if not
+	// syncconnect), calling back to client object with connection notification then monitoring session for events
+	// (sync data sessions are ignored by worker thread, client is responsible for managing, and are open already):
+	if(scb->state == SessionControlBlock::State::Open) {
+		scb->NoteOpened(SteadyClock());
+		sessionsopened.fetch_add(1, std::memory_order_relaxed);
+	}
+	const SessionTicket ticket = sessions.Insert(std::move(scb));
+	if(ticket == 0) throw FORMAT_RUNTIME_ERROR("Failed to acquire ticket");
+	else if(syncdata == false) AssignToThread(Assignment::Type::Session, ticket, false);
+
+	// Log session registration and return ticket:
+	LOG_FROM_TEMPLATE(LogLevel::Debug, "Registered session ticket {:X8} for {:S60} to {:S20}:{:D} ({:S10})",
+		ticket, client->GetName().c_str(), connection->GetRemoteAddress().c_str(), connection->GetRemotePort(),
+		leased ? "leased" : (syncconnect ? "connected" : "pending"));
+	return ticket;
+}
+// CommLink::ConnectInProc: Pair new outbound session with a new session accepted on named in-process listener; both
+// start connected, and are assigned to worker threads (which notify their clients, then open them for data exchange)
+_Check_return_ Comms::SessionTicket Comms::CommLink::ConnectInProc(
+	const std::shared_ptr<CommsClient>& client, const std::shared_ptr<Connection>& connection,
+	_Inout_opt_ std::string* LastErrString) {
+	if(threads.empty()) {
+		if(LastErrString) *LastErrString = "Comms threads not initialized";
+		return 0;
+	}
+	else if(connection->CheckFlag(CommFlags::SyncData)) {
+		if(LastErrString) *LastErrString = "Synchronous data not supported for in-process connections";
+		return 0;
+	}
+	else if(LastErrString) LastErrString->clear();
+
+	// Locate listener by address (listener flagged for shutdown is treated as absent):
+	ListenerTable::Ref lcb;
+	{std::lock_guard<std::mutex> lock(inproclock);
+	const auto seek = inproclisteners.find(connection->GetRemoteAddress());
+	if(seek != inproclisteners.end()) lcb = listeners.Acquire(seek->second);}
+	const std::shared_ptr<CommsClient> listenclient = (lcb && lcb->shutdownflag == false) ? lcb->client.lock() : nullptr;
+	if(listenclient.get() == nullptr) {
+		if(LastErrString) *LastErrString = "No in-process listener at " + connection->GetRemoteAddress();
+		return 0;
+	}
+
+	// Create link and control blocks for both ends, and insert into table (accepted end first, so that it is in place
+	// before outbound end can be used):
+	SessionTicket accepted = 0, ticket = 0;
 	try {
-		if(syncdata) {
-			// Add sync data flag to ticket, so it can be identified in subsequent calls as a sync session
-			ticket |= SESSION_TICKET_SYNCDATA;
-			// Ensure ticket does not already exist in sync map (should not be possible), then add session;
-			// worker thread will ignore connections in sync map (client responsible for managing):
-			std::unique_lock<std::timed_mutex> lock(syncsessionslock);
-			if(lock.owns_lock() == false) throw FORMAT_RUNTIME_ERROR("Unable to lock access to session map");
-			else if(syncsessions.count(ticket)) throw FORMAT_RUNTIME_ERROR("Session ticket already exists in map");
-			syncsessions.emplace(std::piecewise_construct,
-				std::forward_as_tuple(ticket),
-				std::forward_as_tuple(std::move(scb))
-			);
-		}
-		else {
-			// Ensure ticket does not already exist in map (should not be possible), then add session; worker
-			// thread responsible for polling connection (if not syncconnect), calling back to client object
-			// with connection notification then monitoring session for events
-			std::unique_lock<std::timed_mutex> lock(sessionslock);
-			if(lock.owns_lock() == false) throw FORMAT_RUNTIME_ERROR("Unable to lock access to session map");
-			else if(sessions.count(ticket)) throw FORMAT_RUNTIME_ERROR("Session ticket already exists in map");
-			sessions.emplace(std::piecewise_construct,
-				std::forward_as_tuple(ticket),
-				std::forward_as_tuple(std::move(scb))
-			);
-		}
+		const std::string& ringsize = connection->GetConfigParm("INPROCRING");
+		const std::shared_ptr<LoopbackLink> link = std::make_shared<LoopbackLink>(ringsize.empty() ? INPROC_RING_DEFAULT
+			: ValueOps::Bounded(INPROC_RING_MIN, static_cast<size_t>(ValueOps::MinZero(atoi(ringsize.c_str()))),
+				INPROC_RING_MAX));
+		std::unique_ptr<SessionControlBlock> scb =
+			std::make_unique<SessionControlBlock>(listenclient, lcb->connection, lcb.GetKey());
+		scb->loopback = link;
+		scb->loopend = 0;
+		scb->state = SessionControlBlock::State::Connected;
+		if((accepted = sessions.Insert(std::move(scb))) == 0) throw FORMAT_RUNTIME_ERROR("Failed to acquire ticket");
+		scb = std::make_unique<SessionControlBlock>(client, connection);
+		scb->loopback = link;
+		scb->loopend = 1;
+		scb->state = SessionControlBlock::State::Connected;
+		if((ticket = sessions.Insert(std::move(scb))) == 0) throw FORMAT_RUNTIME_ERROR("Failed to acquire ticket");
 	}
 	catch(const std::exception&) {
-		// Return ticket to collection prior to re-throwing exception:
-		auto lock = Locks::Acquire(listenerticketlock);
-		if(lock.IsLocked()) listenertickets.push_back(ticket & SESSION_TICKET_REMFLAGS);
-		std::throw_with_nested(FORMAT_RUNTIME_ERROR("Failed to register listener"));
+		if(accepted != 0) sessions.Retire(accepted);
+		std::throw_with_nested(FORMAT_RUNTIME_ERROR("In-process connection failed"));
 	}
+	lcb->CountAccepted();
+	AssignToThread(Assignment::Type::Session, accepted, false);
+	AssignToThread(Assignment::Type::Session, ticket, false);
 
 	// Log session registration and return ticket:
-	LOG_FROM_TEMPLATE(LogLevel::Debug, "Registered session ticket {:X8} for {:S60} to {:S20}:{:D} ({:S10})",
-		ticket, client->GetName().c_str(), connection->GetRemoteAddress().c_str(), connection->GetRemotePort(),
-		syncconnect ? "connected" : "pending");
+	LOG_FROM_TEMPLATE(LogLevel::Debug, "Registered session ticket {:X8} for {:S60} to {:S60} (accepted as {:X8})",
+		ticket, client->GetName().c_str(), connection->GetRemoteAddress().c_str(), accepted);
 	return ticket;
 }
+// CommLink::ConnectShared: Create shared-memory link to listener in another process, and assign outbound session on it
+// to a worker thread; session starts connected, as link is usable (data is buffered in ring) before listener accepts it
+_Check_return_ Comms::SessionTicket Comms::CommLink::ConnectShared(
+	const std::shared_ptr<CommsClient>& client, const std::shared_ptr<Connection>& connection,
+	_Inout_opt_ std::string* LastErrString) {
+	if(threads.empty()) {
+		if(LastErrString) *LastErrString = "Comms threads not initialized";
+		return 0;
+	}
+	else if(connection->CheckFlag(CommFlags::SyncData)) {
+		if(LastErrString) *LastErrString = "Synchronous data not supported for shared-memory connections";
+		return 0;
+	}
+	else if(LastErrString) LastErrString->clear();
+
+	SessionTicket ticket = 0;
+	try {
+		const std::string& ringsize = connection->GetConfigParm("SHMRING");
+		std::string errstring;
+		std::unique_ptr<SharedRing> shared = SharedRing::Connect(connection->GetShmName(),
+			ringsize.empty() ? INPROC_RING_DEFAULT : ValueOps::Bounded(INPROC_RING_MIN,
+				static_cast<size_t>(ValueOps::MinZero(atoi(ringsize.c_str()))), INPROC_RING_MAX), errstring);
+		if(shared.get() == nullptr) {
+			if(LastErrString) LastErrString->assign(std::move(errstring));
+			return 0;
+		}
+		std::unique_ptr<SessionControlBlock> scb = std::make_unique<SessionControlBlock>(client, connection);
+		scb->loopback = std::make_shared<LoopbackLink>(std::move(shared), connection->GetConfigParm("SHMWAIT") == "SPIN");
+		scb->loopend = 1;
+		scb->state = SessionControlBlock::State::Connected;
+		if((ticket = sessions.Insert(std::move(scb))) == 0) throw FORMAT_RUNTIME_ERROR("Failed to acquire ticket");
+	}
+	catch(const std::exception&) {std::throw_with_nested(FORMAT_RUNTIME_ERROR("Shared-memory connection failed"));}
+	AssignToThread(Assignment::Type::Session, ticket, false);
+
+	// Log session registration and return ticket:
+	LOG_FROM_TEMPLATE(LogLevel::Debug, "Registered session ticket {:X8} for {:S60} to {:S60}",
+		ticket, client->GetName().c_str(), connection->GetRemoteAddress().c_str());
+	return ticket;
+}
+// CommLink::SharedAccept: Shared-memory listener callback (on system thread pool), carrying listener ticket as context
+void Comms::CommLink::SharedAccept(void* Context) {
+	GetCommLink().AcceptShared(static_cast<ListenerTicket>(reinterpret_cast<uintptr_t>(Context)));
+}
+// CommLink::AcceptShared: Accept every link posted to shared-memory listener, creating a session for each and assigning
+// it to a worker thread (all pending links are taken, as listener is only signalled again by the next post)
+void Comms::CommLink::AcceptShared(ListenerTicket ticket) {
+	try {
+		ListenerTable::Ref lcb = listeners.Acquire(ticket);
+		if(!lcb || lcb->shutdownflag) return;
+		const std::shared_ptr<CommsClient> client = lcb->client.lock();
+		if(client.get() == nullptr) return; // Listener is orphaned, leave links pending until it is closed
+		const bool spin = (lcb->connection->GetConfigParm("SHMWAIT") == "SPIN");
+		while(std::unique_ptr<SharedRing> shared = lcb->shmlistener->Accept()) {
+			std::unique_ptr<SessionControlBlock> scb =
+				std::make_unique<SessionControlBlock>(client, lcb->connection, ticket);
+			scb->loopback = std::make_shared<LoopbackLink>(std::move(shared), spin);
+			scb->loopend = 0;
+			scb->state = SessionControlBlock::State::Connected;
+			const SessionTicket session = sessions.Insert(std::move(scb));
+			if(session == 0) {
+				++lcb->acceptfailed;
+				LOG_FROM_TEMPLATE(LogLevel::Error, "Failed to acquire session ticket on listener ticket {:X8}", ticket);
+				continue;
+			}
+			lcb->CountAccepted();
+			AssignToThread(Assignment::Type::Session, session, false);
+			if(lcb->connection->CheckFlag(CommFlags::TraceOn))
+				LOG_FROM_TEMPLATE(LogLevel::Debug, "Accepted session ticket {:X8} on listener ticket {:X8}", session, ticket);
+		}
+	}
+	catch(const std::exception& e) {
+		const auto exceptioncontext = Exceptions::UnrollException(e);
+		LOG_FROM_TEMPLATE_CONTEXT(LogLevel::Error, &exceptioncontext, "Exception accepting shared-memory link");
+	}
+}
+Comms::Result Comms::CommLink::PreparePool(const std::shared_ptr<Connection>& connection) {
+	if((connection.get() ? connection->IsValidClient() : false) == false) return Result::InvalidArg;
+	else if(connection->IsInProc() || connection->IsShm()) return Result::InvalidArg; // Nothing to pre-connect
+	pool.Prepare(*connection);
+	return Result::OK;
+}
+_Check_return_ Comms::Result Comms::CommLink::GetPoolStats(
+	const std::shared_ptr<Connection>& connection, ConnectionPool::PoolStats& stats) {
+	if(connection.get() == nullptr) return Result::InvalidArg;
+	return pool.GetStats(*connection, stats) ? Result::OK : Result::InvalidArg;
+}
 
 //==========================================================================================================================
 _Check_return_ Comms::Result Comms::CommLink::Send(SessionTicket session, _In_reads_(len) const char* buf, size_t len) {
-	UNREFERENCED_PARAMETER(session);
-	UNREFERENCED_PARAMETER(buf);
-	UNREFERENCED_PARAMETER(len);
-	return Result::InvalidArg;
+	if(buf == nullptr || len == 0) return Result::InvalidArg;
+	const gsl::span<const char> piece(buf, len);
+	return Send(session, gsl::span<const gsl::span<const char>>(&piece, 1));
+}
+_Check_return_ Comms::Result Comms::CommLink::Send(SessionTicket session, gsl::span<const gsl::span<const char>> pieces) {
+	if(ValueOps::Is(pieces.size()).InRange(1, SEND_PIECES_MAX) == false) return Result::InvalidArg;
+	// Gather non-empty pieces into write buffers, following slot reserved for packet header:
+	WSABUF buffers[SEND_PIECES_MAX + 1] = {};
+	size_t count = 1, len = 0;
+	for(const gsl::span<const char>& piece : pieces) {
+		if(piece.empty()) continue;
+		else if(piece.data() == nullptr || piece.size() > ULONG_MAX) return Result::InvalidArg;
+		buffers[count].buf = const_cast<char*>(piece.data());
+		buffers[count++].len = gsl::narrow_cast<ULONG>(piece.size());
+		len += piece.size();
+	}
+	if(len == 0) return Result::InvalidArg;
+	try {
+		// Locate session ticket in table, ensure session is open (checking state first, as socket of session connecting
+		// to a host name is assigned by owning thread before it opens session):
+		auto scb = sessions.Acquire(session);
+		if(scb ? (scb->state != SessionControlBlock::State::Open) : true) return Result::InvalidTicket;
+		else if(scb->HasTransport() == false) return Result::InvalidTicket;
+		else if(scb->listener == 0 && scb->Draining()) return Result::Draining; // Would start new exchange
+
+		// Build packet header (2 length bytes, plus 2 zero control bytes if extended header enabled), unless raw (HTTP
+		// sessions send messages as-is, so are treated as raw):
+		const bool raw = (scb->CheckFlag(CommFlags::Raw) || scb->protocol == Protocol::HTTP);
+		if(raw == false && len > PACKET_SIZE_MAX) return Result::InvalidArg;
+		const Framing::Framed<Framing::Extended> header(len); // Leading two bytes also form non-extended header
+		buffers[0].buf = const_cast<char*>(header.Header());
+		buffers[0].len = scb->CheckFlag(CommFlags::ExtendedHeader) ? 4UL : 2UL;
+		const WSABUF* const out = raw ? buffers + 1 : buffers;
+		const size_t outcount = raw ? count - 1 : count;
+
+		SocketOps::Result rc = SocketOps::Result::OK;
+		{std::lock_guard<std::mutex> sendlock(scb->sendlock);
+		CommThread* const owner = scb->owner;
+		if(owner == nullptr) {
+			// Sync data session (blocking socket, not owned by a comms thread) - write header and data together:
+			rc = scb->sessionsocket->Send(out, outcount);
+			scb->sent = true;
+		}
+		else if(scb->blocked) return Result::QueueFull; // Held output has not yet drained to low watermark
+		else {
+			const bool waspending = scb->writepending;
+			if(scb->CheckFlag(CommFlags::Coalesce)) {
+				// Append packet to queued output; if queue has reached its limit write immediately, otherwise ensure
+				// that owning thread will write it once due:
+				if(scb->outbuf.empty())
+					scb->flushdue = std::chrono::steady_clock::now() + scb->coalescedelay;
+				for(size_t b = 0; b < outcount; ++b)
+					scb->outbuf.insert(scb->outbuf.end(), out[b].buf, out[b].buf + out[b].len);
+				if(scb->outbuf.size() >= scb->coalescemax) rc = scb->FlushOutput();
+				else if(scb->flushqueued == false) {
+					scb->flushqueued = true;
+					owner->RequestFlush(session);
+				}
+				scb->UpdateOutputState();
+			}
+			else {
+				// Write header and data together, as far as socket will accept (remainder held for owning thread):
+				rc = scb->WriteOutput(out, outcount);
+				scb->sent = true;
+			}
+			// If output is now held awaiting socket writability or session has become blocked, owning thread must
+			// update its poll set and/or notify client:
+			if((scb->writepending && waspending == false) || scb->blocked) owner->Wake();
+		}
+		if(SocketOps::ResultOK(rc)) {
+			scb->NoteSend(len);
+			// HTTP exchanges are marked automatically (request sent begins one, response sent completes one):
+			if(scb->protocol == Protocol::HTTP) scb->MarkExchange(scb->listener == 0);
+		}}
+
+		// If write failed, socket has been shut down - flag session for disconnect by owning thread:
+		if(SocketOps::ResultFailed(rc) || SocketOps::ResultTimeout(rc)) {
+			LOG_FROM_TEMPLATE(LogLevel::Warn, "Write failed on session ticket {:X8}: {:S60}",
+				session, scb->GetLastErrString().c_str());
+			SessionControlBlock::State state = SessionControlBlock::State::Open;
+			scb->state.compare_exchange_strong(state, SessionControlBlock::State::Disconnecting);
+			return Result::Failed;
+		}
+		return Result::OK;
+	}
+	catch(const std::exception&) {std::throw_with_nested(FORMAT_RUNTIME_ERROR("Send operation failed"));}
+}
+_Check_return_ Comms::Result Comms::CommLink::Flush(SessionTicket session) {
+	try {
+		auto scb = sessions.Acquire(session);
+		if(scb ? (scb->state != SessionControlBlock::State::Open) : true) return Result::InvalidTicket;
+		else if(scb->HasTransport() == false) return Result::InvalidTicket;
+		SocketOps::Result rc = SocketOps::Result::OK;
+		{std::lock_guard<std::mutex> sendlock(scb->sendlock);
+		const bool waspending = scb->writepending;
+		rc = scb->FlushOutput(); // Session is left on owning thread's flush list, and removed once found empty
+		CommThread* const owner = scb->owner;
+		if(owner != nullptr && scb->writepending && waspending == false) owner->Wake();}
+		if(SocketOps::ResultFailed(rc) || SocketOps::ResultTimeout(rc)) {
+			LOG_FROM_TEMPLATE(LogLevel::Warn, "Write failed on session ticket {:X8}: {:S60}",
+				session, scb->GetLastErrString().c_str());
+			SessionControlBlock::State state = SessionControlBlock::State::Open;
+			scb->state.compare_exchange_strong(state, SessionControlBlock::State::Disconnecting);
+			return Result::Failed;
+		}
+		return Result::OK;
+	}
+	catch(const std::exception&) {std::throw_with_nested(FORMAT_RUNTIME_ERROR("Flush operation failed"));}
 }
 _Check_return_ Comms::Result Comms::CommLink::SendAndReceive(SessionTicket session,
 	_In_reads_(len) const char* buf, size_t len, // Outbound data to be delivered
@@ -256,23 +601,21 @@ _Check_return_ Comms::Result Comms::CommLink::SendAndReceive(SessionTicket sessi
 	int Timeout) {
 	BytesRead = 0;
 	if(buf == nullptr || len == 0 || Tgt == nullptr || MaxBytes == 0) return Result::InvalidArg;
-	else if((session & SESSION_TICKET_SYNCDATA) == 0) return Result::InvalidTicket;
 
 	const SteadyClock EndTime(std::chrono::milliseconds{Timeout});
 	try {
-		// Locate session ticket in map, ensure entry is found and has a non-null SessionSocketPtr:
-		std::unique_lock<std::timed_mutex> maplock(syncsessionslock, EndTime.GetTimePoint());
-		if(maplock.owns_lock() == false) throw FORMAT_RUNTIME_ERROR("Unable to lock access to session map");
-		auto seek = syncsessions.find(session);
-		if((seek == syncsessions.end() ? nullptr : seek->second.get()) == nullptr) return Result::InvalidTicket;
-		else if(seek->second->sessionsocket.get() == nullptr) return Result::InvalidTicket;
+		// Locate session ticket in table, ensure entry is found, has a non-null SessionSocketPtr and is configured for
+		// synchronous data exchange:
+		auto scb = sessions.Acquire(session);
+		if(scb ? (scb->sessionsocket.get() == nullptr) : true) return Result::InvalidTicket;
+		else if(scb->CheckFlag(CommFlags::SyncData) == false) return Result::InvalidTicket;
 		// If session socket is not valid or control block is not currently in "open" state, reject request:
-		else if(seek->second->sessionsocket->Valid() == false || seek->second->state != SessionControlBlock::State::Open)
+		else if(scb->sessionsocket->Valid() == false || scb->state != SessionControlBlock::State::Open)
 			return Result::InvalidTicket;
 
-		// Acquire lock for session object (so we will hold both locks temporarily):
-		//std::unique_lock<std::timed_mutex> sesslock(seek->second->synclock, EndTime.GetTimePoint());
-		// shit this is no good
+		// Acquire lock for session object (table reference keeps control block alive without holding a table lock):
+		std::unique_lock<std::timed_mutex> sesslock(scb->synclock, EndTime.GetTimePoint());
+		if(sesslock.owns_lock() == false) return Result::Timeout;
 
 		Tgt[0] = 0;
 		UNREFERENCED_PARAMETER(Timeout);
@@ -286,29 +629,16 @@ Comms::Result Comms::CommLink::Disconnect(SessionTicket session) {
 	Result rc = Result::InvalidTicket;
 	std::shared_ptr<CommsClient> client(nullptr);
 
-	if(session & SESSION_TICKET_SYNCDATA) {
-		// Look up session in sync map, and (if found) flag that it should be disconnected:
-		std::unique_lock<std::timed_mutex> lock(syncsessionslock);
-		if(lock.owns_lock() == false) throw FORMAT_RUNTIME_ERROR("Unable to lock access to session map");
-		auto seek = syncsessions.find(session);
-		if((seek == syncsessions.end() ? nullptr : seek->second.get()) != nullptr) {
-			if(seek->second->state < SessionControlBlock::State::Disconnecting) {
-				client = seek->second->client.lock();
-				seek->second->state = SessionControlBlock::State::Disconnecting;
-				rc = Result::OK;
-			}
-		}
-	}
-	else if(session > 0) {
-		// Look up session in map, and (if found) flag that it should be disconnected by worker thread:
-		std::unique_lock<std::timed_mutex> lock(sessionslock);
-		if(lock.owns_lock() == false) throw FORMAT_RUNTIME_ERROR("Unable to lock access to session map");
-		auto seek = sessions.find(session);
-		if((seek == sessions.end() ? nullptr : seek->second.get()) != nullptr) {
-			if(seek->second->state < SessionControlBlock::State::Disconnecting) {
-				client = seek->second->client.lock();
-				seek->second->state = SessionControlBlock::State::Disconnecting;
+	// Look up session in table, and (if found) flag that it should be disconnected by worker thread; sync data sessions
+	// are not owned by a worker thread, so retire immediately (socket closes once last reference is released):
+	if(auto scb = sessions.Acquire(session)) {
+		SessionControlBlock::State state = scb->state.load();
+		while(state < SessionControlBlock::State::Disconnecting) {
+			if(scb->state.compare_exchange_weak(state, SessionControlBlock::State::Disconnecting)) {
+				client = scb->client.lock();
 				rc = Result::OK;
+				if(scb->CheckFlag(CommFlags::SyncData)) RetireSession(session, *scb);
+				break;
 			}
 		}
 	}
@@ -320,3 +650,1114 @@ Comms::Result Comms::CommLink::Disconnect(SessionTicket session) {
 	else LOG_FROM_TEMPLATE(LogLevel::Warn, "Attempted to disconnect invalid session {:X8}", session);
 	return rc; 
 }
+// CommLink::DrainListener: Deregister listener, then flag its sessions for drain and wait for them to close (sessions
+// are flagged again on each check, in case a worker thread accepted one as listener was deregistered)
+Comms::Result Comms::CommLink::DrainListener(ListenerTicket listener, int deadline, size_t batch) {
+	const Result rc = DeregisterListener(listener, 0);
+	if(ResultOK(rc) == false) return rc;
+	const SteadyClock waituntil(std::chrono::milliseconds{ValueOps::MinZero(deadline) + DRAIN_CLOSE_GRACE});
+	for(size_t pass = 0;; ++pass) {
+		size_t remaining = 0;
+		sessions.ForEach([&remaining, listener, deadline, batch](SessionTicket, SessionControlBlock& scb) {
+			if(scb.listener != listener) return;
+			++remaining;
+			if(scb.StartDrain(deadline, batch)) {
+				if(CommThread* const owner = scb.owner) owner->Wake();
+			}
+		});
+		if(pass == 0) {
+			LOG_FROM_TEMPLATE(LogLevel::Debug, "Draining {:D} sessions of listener ticket {:X8}", remaining, listener);
+		}
+		if(remaining == 0) return Result::OK;
+		else if(waituntil.IsPast()) {
+			LOG_FROM_TEMPLATE(LogLevel::Warn, "Timeout draining listener ticket {:X8} ({:D} sessions remain)",
+				listener, remaining);
+			return Result::Timeout;
+		}
+		Sleep(10);
+	}
+}
+Comms::Result Comms::CommLink::DrainSession(SessionTicket session, int deadline) {
+	auto scb = sessions.Acquire(session);
+	if(scb ? (scb->state >= SessionControlBlock::State::Disconnecting) : true) return Result::InvalidTicket;
+	else if(scb->CheckFlag(CommFlags::SyncData)) return Disconnect(session); // No owning thread; nothing in flight
+	else if(scb->StartDrain(deadline, DRAIN_BATCH_DEFAULT)) {
+		if(CommThread* const owner = scb->owner) owner->Wake();
+	}
+	return Result::OK;
+}
+// CommLink::MarkExchange: Count exchange begun or completed on session; on completion, wake owning thread if session is
+// draining, so that it can close without waiting for its next wakeup
+Comms::Result Comms::CommLink::MarkExchange(SessionTicket session, bool begin) {
+	auto scb = sessions.Acquire(session);
+	if(scb ? (scb->state >= SessionControlBlock::State::Disconnecting) : true) return Result::InvalidTicket;
+	scb->MarkExchange(begin);
+	if(begin == false && scb->Draining() && scb->ExchangeInFlight() == false) {
+		if(CommThread* const owner = scb->owner) owner->Wake();
+	}
+	return Result::OK;
+}
+// CommLink::RetireSession: Remove session from table, then add its counters to closed totals (removing first, so that an
+// aggregate snapshot taken meanwhile may briefly omit session's counters, but never counts them twice)
+void Comms::CommLink::RetireSession(SessionTicket ticket, SessionControlBlock& scb) {
+	sessions.Retire(ticket);
+	closedtraffic.Accumulate(scb.traffic);
+	if(scb.lastreadms.load(std::memory_order_relaxed) != 0) sessionsclosed.fetch_add(1, std::memory_order_relaxed);
+	if(scb.listener != 0) {
+		if(auto lcb = listeners.Acquire(scb.listener)) lcb->closedtraffic.Accumulate(scb.traffic);
+	}
+}
+
+//==========================================================================================================================
+_Check_return_ Comms::Result Comms::CommLink::GetStats(SessionTicket session, SessionStats& stats) {
+	stats = SessionStats{};
+	if(auto scb = sessions.Acquire(session)) {
+		scb->GetStats(stats);
+		return Result::OK;
+	}
+	return Result::InvalidTicket;
+}
+void Comms::CommLink::GetAggregateStats(AggregateStats& stats) {
+	stats = AggregateStats{};
+	closedtraffic.AddTo(stats.Traffic);
+	stats.SessionsOpened = sessionsopened.load(std::memory_order_relaxed);
+	stats.SessionsClosed = sessionsclosed.load(std::memory_order_relaxed);
+	sessions.ForEach([&stats](SessionTicket, SessionControlBlock& scb) {
+		scb.traffic.AddTo(stats.Traffic);
+		stats.QueuedBytes += scb.held.load(std::memory_order_relaxed);
+		++stats.SessionsActive;
+	});
+}
+
+//==========================================================================================================================
+#pragma region TrafficCounters
+// TrafficCounters::Accumulate: Add counters of closed session to totals (from any thread)
+void Comms::CommLink::TrafficCounters::Accumulate(const TrafficCounters& t) noexcept {
+	bytesin.fetch_add(t.bytesin.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	bytesout.fetch_add(t.bytesout.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	packetsin.fetch_add(t.packetsin.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	packetsout.fetch_add(t.packetsout.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+// TrafficCounters::AddTo: Add current counter values to snapshot
+void Comms::CommLink::TrafficCounters::AddTo(TrafficStats& stats) const noexcept {
+	stats.BytesIn += bytesin.load(std::memory_order_relaxed);
+	stats.BytesOut += bytesout.load(std::memory_order_relaxed);
+	stats.PacketsIn += packetsin.load(std::memory_order_relaxed);
+	stats.PacketsOut += packetsout.load(std::memory_order_relaxed);
+}
+#pragma endregion TrafficCounters
+
+//==========================================================================================================================
+#pragma region ListenerControlBlock
+// ListenerControlBlock::CurrentSecond: Return steady clock time in whole seconds, for accept rate tracking
+_Check_return_ long long Comms::CommLink::ListenerControlBlock::CurrentSecond() noexcept {
+	return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+// ListenerControlBlock::CountAccepted: Update accept counters (rate is approximate, as counts from threads racing the
+// rollover to a new second may be attributed to either interval)
+void Comms::CommLink::ListenerControlBlock::CountAccepted() noexcept {
+	++accepted;
+	const long long now = CurrentSecond();
+	long long current = ratesecond.load();
+	if(current != now && ratesecond.compare_exchange_strong(current, now)) {
+		// This thread has rolled interval forward; prior count becomes last rate only if it was immediately previous:
+		const unsigned int prior = ratecount.exchange(0);
+		lastrate = (current == now - 1) ? prior : 0;
+	}
+	++ratecount;
+}
+// ListenerControlBlock::GetStats: Build snapshot of current accept counters
+_Check_return_ Comms::ListenerStats Comms::CommLink::ListenerControlBlock::GetStats() const noexcept {
+	ListenerStats stats;
+	stats.Accepted = accepted.load();
+	stats.AcceptFailed = acceptfailed.load();
+	stats.QueueOverflows = queueoverflows.load();
+	// Rate is count for last complete second (which is still held in ratecount if no accepts have yet occurred in the
+	// current second):
+	const long long now = CurrentSecond(), current = ratesecond.load();
+	stats.AcceptRate = (current == now) ? lastrate.load() : ((current == now - 1) ? ratecount.load() : 0);
+	return stats;
+}
+#pragma endregion ListenerControlBlock
+
+//==========================================================================================================================
+#pragma region SessionControlBlock
+// SessionControlBlock::SessionProtocol: Determine protocol of data exchanged on session from connection flags
+_Check_return_ Comms::Protocol Comms::CommLink::SessionControlBlock::SessionProtocol(
+	const std::shared_ptr<Connection>& connection) noexcept {
+	return (connection.get() ? connection->CheckFlag(CommFlags::Http) : false) ? Protocol::HTTP : Protocol::TCP;
+}
+// SessionControlBlock::KeepAliveInterval: Read keepalive interval, if connection uses application keepalives (packets
+// are required, so raw and HTTP sessions never send keepalives; nor do in-process sessions, which cannot go stale, or
+// shared-memory sessions, which close when peer process exits)
+_Check_return_ int Comms::CommLink::SessionControlBlock::KeepAliveInterval(const std::shared_ptr<Connection>& connection) {
+	if((connection.get() ? connection->CheckFlag(CommFlags::AppKeepAlive) : false) == false) return 0;
+	else if(connection->CheckFlag(CommFlags::Raw) || connection->CheckFlag(CommFlags::Http)) return 0;
+	else if(connection->IsInProc() || connection->IsShm()) return 0;
+	const std::string& keepalive = connection->GetConfigParm("KEEPALIVE");
+	return keepalive.empty() ? KEEPALIVE_INTERVAL_DEFAULT
+		: ValueOps::Bounded(KEEPALIVE_INTERVAL_MIN, atoi(keepalive.c_str()), INT_MAX);
+}
+// SessionControlBlock::IdleTimeout: Read idle read timeout, if configured for connection
+_Check_return_ int Comms::CommLink::SessionControlBlock::IdleTimeout(const std::shared_ptr<Connection>& connection) {
+	if(connection.get() == nullptr) return 0;
+	const std::string& idletimeout = connection->GetConfigParm("IDLETIMEOUT");
+	return idletimeout.empty() ? 0 : ValueOps::MinZero(atoi(idletimeout.c_str()));
+}
+// SessionControlBlock::CoalesceDelay: Read maximum time queued output may wait for owning thread to write it
+_Check_return_ std::chrono::microseconds Comms::CommLink::SessionControlBlock::CoalesceDelay(
+	const std::shared_ptr<Connection>& connection) {
+	if(connection.get() == nullptr) return std::chrono::microseconds(COALESCE_DELAY_DEFAULT);
+	const std::string& delay = connection->GetConfigParm("COALESCEDELAY");
+	return std::chrono::microseconds(delay.empty() ? COALESCE_DELAY_DEFAULT
+		: ValueOps::Bounded(0, atoi(delay.c_str()), COALESCE_DELAY_MAX));
+}
+// SessionControlBlock::CoalesceBytes: Read size of queued output at which sending thread writes immediately
+_Check_return_ size_t Comms::CommLink::SessionControlBlock::CoalesceBytes(const std::shared_ptr<Connection>& connection) {
+	if(connection.get() == nullptr) return COALESCE_BYTES_DEFAULT;
+	const std::string& bytes = connection->GetConfigParm("COALESCEMAX");
+	return bytes.empty() ? COALESCE_BYTES_DEFAULT
+		: static_cast<size_t>(ValueOps::Bounded(1, atoi(bytes.c_str()), static_cast<int>(COALESCE_BYTES_MAX)));
+}
+// SessionControlBlock::SendHighWater: Read size of held output at which session is blocked for further sends
+_Check_return_ size_t Comms::CommLink::SessionControlBlock::SendHighWater(const std::shared_ptr<Connection>& connection) {
+	if(connection.get() == nullptr) return SEND_HIGH_WATER_DEFAULT;
+	const std::string& bytes = connection->GetConfigParm("SENDHIGH");
+	return bytes.empty() ? SEND_HIGH_WATER_DEFAULT
+		: ValueOps::Bounded(SEND_HIGH_WATER_MIN, static_cast<size_t>(ValueOps::MinZero(atoi(bytes.c_str()))),
+			SEND_HIGH_WATER_MAX);
+}
+// SessionControlBlock::SendLowWater: Read size of held output at which blocked session is released (below high water)
+_Check_return_ size_t Comms::CommLink::SessionControlBlock::SendLowWater(
+	const std::shared_ptr<Connection>& connection, size_t highwater) {
+	const std::string& bytes = connection.get() ? connection->GetConfigParm("SENDLOW") : std::string();
+	return bytes.empty() ? (highwater / 2)
+		: (std::min)(static_cast<size_t>(ValueOps::MinZero(atoi(bytes.c_str()))), highwater - 1);
+}
+// SessionControlBlock::WriteOutput: Write buffers to (nonblocking) session socket, holding any part not accepted in
+// backlog for owning thread (caller must hold sendlock)
+_Check_return_ SocketOps::Result Comms::CommLink::SessionControlBlock::WriteOutput(
+	_In_reads_(Count) const WSABUF* Buffers, size_t Count) {
+	const SocketOps::Result rc = loopback.get() ? WriteLoopback(Buffers, Count)
+		: sessionsocket->Write(Buffers, Count, backlog);
+	UpdateOutputState();
+	return rc;
+}
+// SessionControlBlock::FlushOutput: Write all queued output in a single send (caller must hold sendlock)
+_Check_return_ SocketOps::Result Comms::CommLink::SessionControlBlock::FlushOutput() {
+	if(outbuf.empty()) return SocketOps::Result::OK;
+	const WSABUF wsabuf = {gsl::narrow_cast<ULONG>(outbuf.size()), outbuf.data()};
+	const SocketOps::Result rc = loopback.get() ? WriteLoopback(&wsabuf, 1) : sessionsocket->Write(&wsabuf, 1, backlog);
+	outbuf.clear();
+	sent = true;
+	UpdateOutputState();
+	return rc;
+}
+// SessionControlBlock::WriteBacklog: Continue writing held output (caller must hold sendlock)
+_Check_return_ SocketOps::Result Comms::CommLink::SessionControlBlock::WriteBacklog() {
+	const SocketOps::Result rc = loopback.get() ? WriteLoopback(nullptr, 0) : sessionsocket->WriteBacklog(backlog);
+	UpdateOutputState();
+	return rc;
+}
+// SessionControlBlock::UpdateOutputState: Update writability flags from current held output (caller must hold sendlock)
+void Comms::CommLink::SessionControlBlock::UpdateOutputState() noexcept {
+	writepending = (backlog.Empty() == false);
+	const size_t heldbytes = backlog.Size() + outbuf.size();
+	held.store(heldbytes, std::memory_order_relaxed);
+	if(heldbytes >= highwater) blocked = true;
+	else if(heldbytes <= lowwater) blocked = false;
+}
+// SessionControlBlock::GetLastErrString: Retrieve description of last transport error
+_Check_return_ const std::string& Comms::CommLink::SessionControlBlock::GetLastErrString() const noexcept {
+	static const std::string peerclosed("In-process or shared-memory peer session closed");
+	return sessionsocket.get() ? sessionsocket->GetLastErrString() : peerclosed;
+}
+// SessionControlBlock::GetStats: Build snapshot of session counters (from any thread), sampling TCP statistics if open
+// (session socket is not replaced once session has opened)
+void Comms::CommLink::SessionControlBlock::GetStats(SessionStats& stats) const {
+	traffic.AddTo(stats.Traffic);
+	stats.QueuedBytes = held.load(std::memory_order_relaxed);
+	stats.Blocked = blocked;
+	const long long now = StampOf(SteadyClock()), lastread = lastreadms.load(std::memory_order_relaxed),
+		lastsend = lastsendms.load(std::memory_order_relaxed);
+	if(lastread != 0) stats.MSecSinceRead = ValueOps::MinZero(now - lastread);
+	if(lastsend != 0) stats.MSecSinceSend = ValueOps::MinZero(now - lastsend);
+	stats.ConnectAttempts = connectattempts.load(std::memory_order_relaxed);
+	if(state == State::Open && sessionsocket.get()) stats.TcpInfoValid = sessionsocket->GetTcpInfo(stats.Tcp);
+}
+// SessionControlBlock::ConnectResolved: Start nonblocking connection to first address of completed lookup which accepts
+// a connection attempt (or, if racing connections, start race across all addresses), releasing lookup (returns false
+// with error if lookup failed, or no attempt could be started)
+_Check_return_ bool Comms::CommLink::SessionControlBlock::ConnectResolved(_Inout_opt_ std::string* ErrString) {
+	const DnsResolver::LookupPtr resolved = std::move(lookup);
+	const bool tls = (connection->GetConfigParm("TLSMETHOD").empty() == false);
+	if(CheckFlag(CommFlags::RaceConnect) && resolved->GetAddresses().size() > 1) {
+		const std::string& delay = connection->GetConfigParm("RACEDELAY");
+		race = std::make_unique<SocketOps::ConnectRace>();
+		if(race->Start(resolved->GetAddresses(), connection->GetRemotePort(), tls,
+			delay.empty() ? RACE_DELAY_DEFAULT : atoi(delay.c_str()))) return true;
+		if(ErrString) *ErrString = race->GetLastErrString();
+		race.reset();
+		return false;
+	}
+	for(const auto& address : resolved->GetAddresses()) {
+		++connectattempts;
+		sessionsocket = SocketOps::SessionSocket::StartConnect(address.c_str(), connection->GetRemotePort(), tls);
+		if(sessionsocket->SocketValid()) {
+			if(CheckFlag(CommFlags::ExtendedHeader)) sessionsocket->SetSessionFlags(SocketFlags::ExtendedHeader);
+			return true;
+		}
+	}
+	if(ErrString) *ErrString = sessionsocket.get() ? sessionsocket->GetLastErrString() : resolved->GetLastErrString();
+	return false;
+}
+// SessionControlBlock::WriteLoopback: Write held output and then buffers into peer's ring, holding any part the ring
+// cannot accept in backlog (caller must hold sendlock); peer's owning thread is woken if it had drained the ring, as
+// it may be waiting, and if output is held this session is flagged as stalled, so that peer will wake this session's
+// owning thread once it has read from the ring
+_Check_return_ SocketOps::Result Comms::CommLink::SessionControlBlock::WriteLoopback(
+	_In_reads_(Count) const WSABUF* Buffers, size_t Count) {
+	LoopbackLink& link = *loopback;
+	if(link.flags.closed) return SocketOps::Result::Failed;
+	SpscRing& ring = link.Inbound(1 - loopend);
+	const size_t position = ring.WritePosition();
+	if(backlog.Empty() == false) backlog.Consume(ring.Write(backlog.data.data() + backlog.offset, backlog.Size()));
+	for(size_t b = 0; b < Count; ++b) {
+		const size_t written = backlog.Empty() ? ring.Write(Buffers[b].buf, Buffers[b].len) : 0;
+		if(written < Buffers[b].len)
+			backlog.data.insert(backlog.data.end(), Buffers[b].buf + written, Buffers[b].buf + Buffers[b].len);
+	}
+	if(backlog.Empty() == false) {
+		// Flag stall before retrying, so that peer either sees flag or has made space visible to retry:
+		link.flags.stalled[loopend] = true;
+		backlog.Consume(ring.Write(backlog.data.data() + backlog.offset, backlog.Size()));
+	}
+	if(backlog.Empty()) link.flags.stalled[loopend] = false;
+	if(ring.WritePosition() != position && ring.Drained(position)) link.WakePeer(loopend);
+	return SocketOps::Result::OK;
+}
+// SessionControlBlock::ReadLoopback: Read from this session's ring, waking peer's owning thread if peer has output held
+// awaiting space (called from owning thread only)
+_Check_return_ size_t Comms::CommLink::SessionControlBlock::ReadLoopback(
+	_Out_writes_(MaxBytes) char* Tgt, size_t MaxBytes) {
+	LoopbackLink& link = *loopback;
+	const size_t br = link.Inbound(loopend).Read(Tgt, MaxBytes);
+	if(br > 0 && link.flags.stalled[1 - loopend]) link.WakePeer(loopend);
+	return br;
+}
+// SessionControlBlock::LoopbackReady: Check whether session has inbound data, or peer has closed (called from owning
+// thread only)
+_Check_return_ bool Comms::CommLink::SessionControlBlock::LoopbackReady() noexcept {
+	return (loopback->flags.closed || loopback->Inbound(loopend).Available() > 0);
+}
+#pragma endregion SessionControlBlock
+
+//==========================================================================================================================
+#pragma region LoopbackLink
+// LoopbackLink::LoopbackLink: Create in-process link, with rings allocated here
+Comms::CommLink::LoopbackLink::LoopbackLink(size_t capacity) noexcept(false) : shared(nullptr), flags(localflags) {
+	for(size_t end = 0; end < 2; ++end) {
+		rings[end] = (ownedrings[end] = std::make_unique<SpscRing>(capacity)).get();
+		owners[end] = nullptr;
+	}
+}
+// LoopbackLink::LoopbackLink (shared): Take over end of shared-memory link, recording whether this end is spinning (so
+// need not be signalled) and registering for its wakes
+Comms::CommLink::LoopbackLink::LoopbackLink(std::unique_ptr<SharedRing>&& _shared, bool spin) noexcept(false)
+	: shared(std::move(_shared)), flags(shared->GetFlags()) {
+	for(size_t end = 0; end < 2; ++end) {
+		rings[end] = &(shared->Inbound(end));
+		owners[end] = nullptr;
+	}
+	flags.spinning[shared->End()] = spin;
+	if(shared->Watch(&SharedWake, this) == false)
+		throw FORMAT_RUNTIME_ERROR("Failed to register shared-memory link wait");
+}
+// LoopbackLink::~LoopbackLink: Release shared-memory link first, withdrawing its callback before members it uses are
+// destroyed
+Comms::CommLink::LoopbackLink::~LoopbackLink() noexcept(false) {shared.reset();}
+// LoopbackLink::WakePeer: Wake owning thread of other end, if in this process, or signal other end's process (unless
+// it is spinning)
+void Comms::CommLink::LoopbackLink::WakePeer(size_t end) noexcept {
+	if(CommThread* const peerowner = owners[1 - end]) peerowner->Wake();
+	else if(shared.get() && flags.spinning[1 - end] == false) shared->Signal(1 - end);
+}
+// LoopbackLink::SharedWake: Shared-memory link callback (on system wait thread), waking owning thread of this end
+void Comms::CommLink::LoopbackLink::SharedWake(void* Context) {
+	const LoopbackLink& link = *static_cast<LoopbackLink*>(Context);
+	if(CommThread* const owner = link.owners[link.shared->End()]) owner->Wake();
+}
+#pragma endregion LoopbackLink
+
+//==========================================================================================================================
+#pragma region CommThread
+thread_local Comms::CommLink::CommThread* Comms::CommLink::CommThread::current = nullptr;
+constexpr char Comms::CommLink::CommThread::KEEPALIVE_PACKET[4]; // Definition required for pointer use (pre-C++17)
+// CommThread::Start: Create completion port and its readiness event (or wake socket, if using poll backend) and start
+// thread; if readiness event cannot be registered, listeners and held output are polled at LISTENER_POLL_INTERVAL
+_Check_return_ bool Comms::CommLink::CommThread::Start() {
+	if(backend == Backend::CompletionPort) {
+		if((completionport = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1)) == nullptr) {
+			LOG_FROM_TEMPLATE(LogLevel::Error, "Failed to create completion port, using poll backend: {:S60}",
+				Exceptions::ConvertCOMError(GetLastError()).c_str());
+		}
+		else if((ioevent = CreateEventA(nullptr, FALSE, FALSE, nullptr)) == nullptr
+			|| RegisterWaitForSingleObject(&iowait, ioevent, &IoSignalled, this, INFINITE,
+				WT_EXECUTEINWAITTHREAD) == FALSE) {
+			LOG_FROM_TEMPLATE(LogLevel::Warn, "Failed to register comms thread readiness event: {:S60}",
+				Exceptions::ConvertCOMError(GetLastError()).c_str());
+			if(ioevent) CloseHandle(ioevent);
+			ioevent = nullptr;
+			iowait = nullptr;
+		}
+	}
+	if(completionport == nullptr && wakesocket.Open() == false) {
+		LOG_FROM_TEMPLATE(LogLevel::Warn, "Failed to open comms thread wake socket: {:S60}",
+			wakesocket.GetLastErrString().c_str());
+	}
+	return ThreadStart(THREAD_PRIORITY_ABOVE_NORMAL);
+}
+// CommThread::Stop: Stop thread, then release readiness event and completion port, or wake socket
+_Check_return_ bool Comms::CommLink::CommThread::Stop(int Timeout) {
+	const bool stopped = ThreadWaitStop(Timeout);
+	if(stopped) {
+		if(iowait) UnregisterWaitEx(iowait, INVALID_HANDLE_VALUE);
+		iowait = nullptr;
+		if(ioevent) CloseHandle(ioevent);
+		ioevent = nullptr;
+		if(completionport) CloseHandle(completionport);
+		completionport = nullptr;
+		wakesocket.Close();
+	}
+	return stopped;
+}
+// CommThread::RequestFlush: Add session to flush list, waking thread if called from elsewhere
+void Comms::CommLink::CommThread::RequestFlush(SessionTicket ticket) {
+	if(current == this) flushlist.push_back(ticket);
+	else Assign(Assignment::Type::Flush, ticket);
+}
+// CommThread::Wake: Interrupt thread's wait for socket activity
+void Comms::CommLink::CommThread::Wake() noexcept {
+	if(current == this) return; // Thread is not waiting
+	else if(completionport) PostQueuedCompletionStatus(completionport, 0, 0, nullptr);
+	else wakesocket.Wake();
+}
+// CommThread::ThreadExecute: Poll assigned listeners and sessions, dispatching connection and data events to clients
+unsigned int Comms::CommLink::CommThread::ThreadExecute() {
+	LOG_FROM_TEMPLATE(LogLevel::Debug, "Comms thread started");
+	current = this;
+	readbuf = std::make_unique<char[]>(READ_BUFFER_SIZE);
+	std::vector<WSAPOLLFD> fds;
+	std::vector<SessionEntry*> fdsessions; // Entry for each session in fds (sessions follow wake socket and listeners)
+	std::vector<SessionEntry*> fdwriters; // Entry for each session polled for writability only (completion port mode)
+	std::vector<SessionEntry*> fdloopbacks; // Entry for each open in-process session (serviced after each wait)
+	while(ThreadShouldRun()) {
+		try {
+			// Pick up any new listener/session assignments:
+			ThreadWorkUnit work;
+			while(ThreadDequeueWork(work)) Adopt(*work);
+
+			// Drop any listeners flagged for shutdown (first thread to see flag retires ticket; control block is
+			// destroyed, closing socket, once the last thread polling it releases its reference):
+			for(auto seek = mylisteners.begin(); seek != mylisteners.end();) {
+				if((*seek)->shutdownflag) {
+					link.listeners.Retire(seek->GetKey());
+					seek = mylisteners.erase(seek);
+				}
+				else ++seek;
+			}
+
+			// Fire any due session timers (sending keepalives, and flagging idle sessions for disconnect), then write
+			// queued output which is due (including all output queued by callbacks during previous iteration):
+			RunTimers();
+			const int flushwait = FlushPending();
+
+			// Process pending session state changes (removing any completed sessions), and build poll set, including
+			// writability for sessions with held output (in completion port mode, only listeners and sessions with held
+			// output are polled; sessions instead have a read notification queued to the port, and fdsessions holds only
+			// those sessions which already have data buffered):
+			fds.clear();
+			fdsessions.clear();
+			fdwriters.clear();
+			fdloopbacks.clear();
+			const size_t firstlistener = (completionport == nullptr && wakesocket.AddToFD(fds)) ? 1 : 0;
+			for(const auto& l : mylisteners) l->serversocket->AddToFD(fds);
+			int polltimeout = (flushwait >= 0) ? (std::min)(flushwait, POLL_INTERVAL) : POLL_INTERVAL;
+			size_t drainclosed = 0; // Drained sessions closed on this iteration (see DrainComplete)
+			for(auto seek = mysessions.begin(); seek != mysessions.end();) {
+				bool keep = PollSession(seek->second, false);
+				if(keep && seek->second.scb->Draining()) keep = (DrainComplete(seek->second, drainclosed) == false);
+				SessionControlBlock& scb = *(seek->second.scb);
+				const SessionControlBlock::State state = scb.state;
+				if(keep && scb.loopback.get()) {
+					// In-process and shared-memory sessions have no socket to poll; wake is signalled by peer (see
+					// WriteLoopback), unless session is spinning, in which case thread does not wait at all:
+					if(state == SessionControlBlock::State::Open) {
+						ReportBackpressure(seek->second);
+						if(scb.LoopbackReady() || scb.loopback->Spinning(scb.loopend)) polltimeout = 0;
+						fdloopbacks.push_back(&(seek->second));
+					}
+				}
+				else if(keep && (state == SessionControlBlock::State::Open
+					|| (state == SessionControlBlock::State::Connecting && scb.listener != 0))) {
+					const bool writepending = scb.writepending;
+					if(state == SessionControlBlock::State::Open) ReportBackpressure(seek->second);
+					if(scb.sessionsocket->DataBuffered()) {
+						polltimeout = 0; // Do not wait, data already available
+						if(completionport) fdsessions.push_back(&(seek->second));
+					}
+					if(completionport) {
+						keep = ArmReadNotify(seek->second);
+						if(keep && writepending && ioevent && seek->second.writeselected == false) {
+							seek->second.writeselected = true; // Selected once, remains in effect while session is open
+							if(scb.sessionsocket->SelectWriteEvent(ioevent) == false) {
+								LOG_FROM_TEMPLATE(LogLevel::Warn,
+									"Failed to select write event for session ticket {:X8}: {:S60}", seek->first,
+									scb.sessionsocket->GetLastErrString().c_str());
+								iopolled = true;
+							}
+						}
+						if(keep && writepending && scb.sessionsocket->AddToFD(fds, POLLWRNORM))
+							fdwriters.push_back(&(seek->second));
+					}
+					else if(scb.sessionsocket->AddToFD(fds, writepending ? (POLLRDNORM | POLLWRNORM) : POLLRDNORM))
+						fdsessions.push_back(&(seek->second));
+				}
+				if(keep == false) {
+					CloseSession(seek->second);
+					seek = mysessions.erase(seek);
+				}
+				else ++seek;
+			}
+			// Do not wait beyond due time of next session timer:
+			if(polltimeout > 0 && timers.empty() == false)
+				polltimeout = ValueOps::Bounded(0, SteadyClock().MSecTill(timers.top().due), polltimeout);
+
+			// In completion port mode, hand off to completion processing (which also checks listeners):
+			if(completionport) {
+				WaitCompletions(fds, fdwriters, fdsessions, polltimeout);
+				ServiceLoopbacks(fdloopbacks);
+				continue;
+			}
+
+			// Wait for socket events (or just for new work, if there are no sockets to poll):
+			if(fds.empty()) {
+				ThreadWaitEvent(fdloopbacks.empty() ? POLL_INTERVAL : polltimeout);
+				ServiceLoopbacks(fdloopbacks);
+				continue;
+			}
+			else if(WSAPoll(fds.data(), gsl::narrow_cast<ULONG>(fds.size()), polltimeout) == SOCKET_ERROR) {
+				LOG_FROM_TEMPLATE(LogLevel::Error, "Comms thread poll failed: {:S60}",
+					Exceptions::ConvertCOMError(WSAGetLastError()).c_str());
+				ThreadWaitEvent(POLL_INTERVAL);
+				continue;
+			}
+
+			// Accept pending connections on readable listeners, then write held output to writable sessions and read data
+			// from readable sessions (sessions accepted here are added to mysessions, and will not be polled until next
+			// iteration):
+			const size_t listenercount = fds.size() - fdsessions.size();
+			if(firstlistener > 0 && fds[0].revents != 0) wakesocket.Drain();
+			for(size_t l = firstlistener; l < listenercount && (l - firstlistener) < mylisteners.size(); ++l) {
+				if(fds[l].revents != 0) AcceptBatch(mylisteners[l - firstlistener].GetKey(), *(mylisteners[l - firstlistener]));
+			}
+			for(size_t f = 0; f < fdsessions.size(); ++f) {
+				SessionEntry& entry = *(fdsessions[f]);
+				const short revents = fds[listenercount + f].revents;
+				bool keep = ((revents & POLLWRNORM) ? WriteSession(entry) : true);
+				if(keep && ((revents & ~POLLWRNORM) != 0 || entry.scb->sessionsocket->DataBuffered()))
+					keep = PollSession(entry, true);
+				if(keep == false) entry.scb->state = SessionControlBlock::State::Disconnecting; // Removed on next iteration
+			}
+			ServiceLoopbacks(fdloopbacks);
+		}
+		catch(const std::exception& e) {
+			const auto exceptioncontext = Exceptions::UnrollException(e);
+			LOG_FROM_TEMPLATE_CONTEXT(LogLevel::Error, &exceptioncontext, "Exception in comms thread");
+		}
+	}
+
+	// Close all sessions still owned by this thread (notifying clients), then release listener references (cancelling
+	// their accept event selection, as ioevent is closed once thread stops):
+	for(auto& entry : mysessions) CloseSession(entry.second);
+	mysessions.clear();
+	timers = decltype(timers)();
+	if(ioevent) for(const auto& l : mylisteners) static_cast<void>(l->serversocket->SelectAcceptEvent(nullptr));
+	mylisteners.clear();
+
+	// If using completion port, wait for aborted read notifications to complete before releasing their overlapped
+	// structures (any which do not complete in time are deliberately leaked, as system may still write to them):
+	if(completionport) {
+		const SteadyClock drainuntil(std::chrono::milliseconds{READ_TIMEOUT});
+		fds.clear();
+		fdsessions.clear();
+		fdwriters.clear();
+		while(orphans.empty() == false && drainuntil.IsPast() == false)
+			WaitCompletions(fds, fdwriters, fdsessions, SteadyClock().MSecTill(drainuntil));
+		if(orphans.empty() == false) {
+			LOG_FROM_TEMPLATE(LogLevel::Warn, "Abandoning {:D} incomplete read notifications", orphans.size());
+			for(auto& o : orphans) static_cast<void>(o.release());
+			orphans.clear();
+		}
+	}
+	LOG_FROM_TEMPLATE(LogLevel::Debug, "Comms thread stopped");
+	return 0;
+}
+// CommThread::Adopt: Acquire reference to newly-assigned listener or session
+void Comms::CommLink::CommThread::Adopt(const Assignment& work) {
+	if(work.type == Assignment::Type::Listener) {
+		if(auto lcb = link.listeners.Acquire(work.ticket)) {
+			std::string errstring;
+			if(ioevent && lcb->serversocket->SelectAcceptEvent(ioevent, &errstring) == false) {
+				LOG_FROM_TEMPLATE(LogLevel::Warn, "Failed to select accept event for listener ticket {:X8}: {:S60}",
+					work.ticket, errstring.c_str());
+				iopolled = true;
+			}
+			mylisteners.emplace_back(std::move(lcb));
+		}
+	}
+	else if(work.type == Assignment::Type::Flush) flushlist.push_back(work.ticket);
+	else if(auto scb = link.sessions.Acquire(work.ticket)) {
+		scb->owner = this;
+		if(scb->loopback.get()) scb->loopback->owners[scb->loopend] = this;
+		mysessions.emplace(work.ticket, SessionEntry{std::move(scb), false});
+	}
+}
+// CommThread::AcceptBatch: Accept all pending connections on listener, up to its batch limit
+void Comms::CommLink::CommThread::AcceptBatch(ListenerTicket ticket, ListenerControlBlock& lcb) {
+	// Retrieve client (if client is gone, listener is orphaned - do nothing) and connection parameters:
+	const std::shared_ptr<CommsClient> client = lcb.client.lock();
+	if(client.get() == nullptr) return;
+	const std::string& conntimeout = lcb.connection->GetConfigParm("CONNTIMEOUT");
+	const int iconntimeout = conntimeout.empty() ? 0 : atoi(conntimeout.c_str());
+	const bool extheader = lcb.connection->CheckFlag(CommFlags::ExtendedHeader);
+
+	size_t count = 0;
+	for(std::string errstring; count < lcb.acceptbatch; ++count) {
+		SocketOps::SessionSocketPtr sp(nullptr);
+		const SocketOps::Result rc = lcb.serversocket->AcceptPending(sp, &errstring);
+		if(SocketOps::ResultTimeout(rc)) break; // No further connections pending
+		else if(SocketOps::ResultFailed(rc) || sp.get() == nullptr) {
+			++lcb.acceptfailed;
+			LOG_FROM_TEMPLATE(LogLevel::Warn, "Accept failed on listener ticket {:X8}: {:S60}",
+				ticket, errstring.c_str());
+			continue;
+		}
+		lcb.CountAccepted();
+		if(extheader) sp->SetSessionFlags(SocketFlags::ExtendedHeader);
+
+		// Create control block for new session (if TLS negotiation is already complete or not required, session is
+		// connected; otherwise this thread will continue negotiation until connection timeout):
+		std::unique_ptr<SessionControlBlock> scb = std::make_unique<SessionControlBlock>(client, lcb.connection, ticket);
+		scb->owner = this;
+		if(sp->Valid()) scb->state = SessionControlBlock::State::Connected;
+		else scb->conntimeoutat += std::chrono::milliseconds(iconntimeout > 0 ? iconntimeout : CONNECT_TIMEOUT_DEFAULT);
+		scb->sessionsocket = std::move(sp);
+
+		// Insert session into table (allocating ticket), and take ownership in this thread:
+		const SessionTicket session = link.sessions.Insert(std::move(scb));
+		if(session == 0) {
+			++lcb.acceptfailed;
+			LOG_FROM_TEMPLATE(LogLevel::Error, "Failed to acquire session ticket on listener ticket {:X8}", ticket);
+		}
+		else if(auto scbref = link.sessions.Acquire(session)) {
+			mysessions.emplace(session, SessionEntry{std::move(scbref), false});
+			if(lcb.connection->CheckFlag(CommFlags::TraceOn))
+				LOG_FROM_TEMPLATE(LogLevel::Debug, "Accepted session ticket {:X8} on listener ticket {:X8}", session, ticket);
+		}
+	}
+	// If batch limit was reached, further connections are likely still queued (count as overflow, so that batch size
+	// and backlog can be tuned):
+	if(count >= lcb.acceptbatch) ++lcb.queueoverflows;
+}
+// CommThread::PollSession: Advance session state, reading data if socket is readable (returns false if session should
+// be closed and removed from this thread)
+_Check_return_ bool Comms::CommLink::CommThread::PollSession(SessionEntry& entry, bool readable) {
+	using State = SessionControlBlock::State;
+	SessionControlBlock& scb = *(entry.scb);
+	const SocketOps::SessionSocketPtr& ss = scb.sessionsocket;
+	if(scb.HasTransport() == false) return false;
+	State state = scb.state.load();
+
+	// Start outbound connection once remote name has been resolved:
+	if(state == State::Connecting && scb.lookup.get() != nullptr) {
+		std::string errstring;
+		if(scb.lookup->Complete() == false) {
+			if(scb.conntimeoutat.IsPast() == false) return true; // Lookup still pending
+			errstring = "Timed out resolving remote address";
+		}
+		else if(scb.ConnectResolved(&errstring)) return true; // Connection pending (polled from next iteration)
+		LOG_FROM_TEMPLATE(LogLevel::Warn, "Connection failed for session ticket {:X8}: {:S60}",
+			entry.scb.GetKey(), errstring.c_str());
+		return false;
+	}
+
+	// Continue connection race, handing over winning socket to session (remaining attempts are closed with race):
+	if(state == State::Connecting && scb.race.get() != nullptr) {
+		SocketOps::SessionSocketPtr winner(nullptr);
+		const SocketOps::Result rc = scb.race->Poll(winner, scb.connection->GetConfigParm("TLSMETHOD"));
+		if(SocketOps::ResultOK(rc)) {
+			if(scb.CheckFlag(CommFlags::ExtendedHeader)) winner->SetSessionFlags(SocketFlags::ExtendedHeader);
+			scb.sessionsocket = std::move(winner);
+			scb.connectattempts += gsl::narrow_cast<unsigned int>(scb.race->AttemptsStarted());
+			scb.race.reset();
+			if(scb.state.compare_exchange_strong(state, State::Connected)) state = State::Connected;
+		}
+		else if(SocketOps::ResultFailed(rc) || scb.conntimeoutat.IsPast()) {
+			LOG_FROM_TEMPLATE(LogLevel::Warn, "Connection failed for session ticket {:X8}: {:S60}",
+				entry.scb.GetKey(), SocketOps::ResultFailed(rc) ? scb.race->GetLastErrString().c_str() : "Timed out");
+			return false;
+		}
+		else return true; // Connection still pending
+	}
+
+	// Continue outbound connection, or inbound TLS negotiation, if still in progress:
+	if(state == State::Connecting) {
+		SocketOps::Result rc = SocketOps::Result::Timeout;
+		if(scb.listener == 0) rc = ss->PollConnect(0, scb.connection->GetConfigParm("TLSMETHOD"));
+		else if(readable) {
+			// Listener holds server credentials required to continue negotiation:
+			if(auto lcb = link.listeners.Acquire(scb.listener)) rc = lcb->serversocket->PollAccept(ss);
+			else rc = SocketOps::Result::Failed;
+		}
+		if(SocketOps::ResultOK(rc) && ss->Valid()) {
+			if(scb.state.compare_exchange_strong(state, State::Connected)) state = State::Connected;
+		}
+		else if(SocketOps::ResultFailed(rc) || scb.conntimeoutat.IsPast()) {
+			LOG_FROM_TEMPLATE(LogLevel::Warn, "Connection failed for session ticket {:X8}: {:S60}",
+				entry.scb.GetKey(), SocketOps::ResultFailed(rc) ? ss->GetLastErrString().c_str() : "Timed out");
+			return false;
+		}
+		else return true; // Connection still pending
+	}
+
+	// Notify client of new connection, and open session for data exchange:
+	if(state == State::Connected) {
+		if(auto client = scb.client.lock()) {
+			entry.notified = true;
+			try {client->IBConnect(entry.scb.GetKey());}
+			catch(const std::exception& e) {
+				const auto exceptioncontext = Exceptions::UnrollException(e);
+				LOG_FROM_TEMPLATE_CONTEXT(LogLevel::Error, &exceptioncontext, "Exception caught from connect callback");
+			}
+		}
+		else return false; // Client is gone, nothing to deliver data to
+		// Sends to open session are written without blocking (see Send), so switch socket mode before opening:
+		if(ss.get() && ss->SetNonBlocking(true) == false) {
+			LOG_FROM_TEMPLATE(LogLevel::Warn, "Failed to set nonblocking mode for session ticket {:X8}: {:S60}",
+				entry.scb.GetKey(), ss->GetLastErrString().c_str());
+			return false;
+		}
+		if(scb.state.compare_exchange_strong(state, State::Open)) {
+			state = State::Open;
+			entry.lastread = entry.lastsend = SteadyClock();
+			scb.NoteOpened(entry.lastread);
+			link.sessionsopened.fetch_add(1, std::memory_order_relaxed);
+			ScheduleTimer(entry);
+		}
+		readable = false; // Socket has not been polled in this state
+	}
+
+	// If session is open and readable, read available data (packet, raw or HTTP) and deliver to client:
+	if(state == State::Open) {
+		if(readable == false) return true;
+		else if(scb.protocol == Protocol::HTTP) return ReadHttp(entry);
+		else if(scb.loopback.get()) return ReadLoopback(entry);
+		size_t br = 0;
+		const SocketOps::Result rc = scb.CheckFlag(CommFlags::Raw)
+			? ss->ReadAvailable(readbuf.get(), SocketOps::TLS_BUFFER_SIZE_DEFAULT, br)
+			: ss->ReadPacket(readbuf.get(), READ_BUFFER_SIZE, br, READ_TIMEOUT);
+		if(SocketOps::ResultFailed(rc)) return false;
+		else if(SocketOps::ResultOK(rc)) scb.NoteRead(entry.lastread = SteadyClock(), br, (br > 0) ? 1 : 0);
+		if(SocketOps::ResultOK(rc) && br > 0) { // Zero-length packets are keepalives, not delivered
+			if(auto client = scb.client.lock()) {
+				try {client->IBData(entry.scb.GetKey(), readbuf.get(), br);}
+				catch(const std::exception& e) {
+					const auto exceptioncontext = Exceptions::UnrollException(e);
+					LOG_FROM_TEMPLATE_CONTEXT(LogLevel::Error, &exceptioncontext, "Exception caught from data callback");
+				}
+			}
+			else return false;
+		}
+		return true;
+	}
+
+	// Otherwise, session is disconnecting (or disconnected):
+	return false;
+}
+// CommThread::ReadHttp: Read available data from open HTTP session into its parser, and deliver each complete message
+// to client (returns false if session should be closed)
+_Check_return_ bool Comms::CommLink::CommThread::ReadHttp(SessionEntry& entry) {
+	SessionControlBlock& scb = *(entry.scb);
+	if(entry.http.get() == nullptr) {
+		// Inbound sessions receive requests, outbound sessions receive responses:
+		const std::string& headermax = scb.connection->GetConfigParm("HTTPMAXHEADER");
+		const std::string& bodymax = scb.connection->GetConfigParm("HTTPMAXBODY");
+		entry.http = std::make_unique<HttpParser>(
+			(scb.listener != 0) ? HttpParser::Mode::Request : HttpParser::Mode::Response,
+			headermax.empty() ? HttpParser::HEADER_BYTES_MAX_DEFAULT : ValueOps::Bounded(HTTP_HEADER_BYTES_MIN,
+				static_cast<size_t>(ValueOps::MinZero(atoi(headermax.c_str()))), HTTP_HEADER_BYTES_MAX),
+			bodymax.empty() ? HttpParser::BODY_BYTES_MAX_DEFAULT
+				: (std::min)(static_cast<size_t>(ValueOps::MinZero(atoi(bodymax.c_str()))), HTTP_BODY_BYTES_MAX));
+	}
+
+	// Read directly into parser's buffer (in-process peer's close is checked first, so that data it wrote before closing
+	// is delivered):
+	size_t space = 0, br = 0;
+	char* const tgt = entry.http->ReadTarget(space);
+	if(scb.loopback.get()) {
+		const bool peerclosed = scb.loopback->flags.closed;
+		if((br = scb.ReadLoopback(tgt, space)) == 0) return (peerclosed == false);
+	}
+	else {
+		const SocketOps::Result rc = scb.sessionsocket->ReadAvailable(tgt, space, br);
+		if(SocketOps::ResultFailed(rc)) return false;
+		else if(SocketOps::ResultOK(rc) == false || br == 0) return true;
+	}
+	scb.NoteRead(entry.lastread = SteadyClock(), br, 0);
+	entry.http->Commit(br);
+
+	// Deliver each complete message now buffered (more than one, if client is pipelining requests):
+	auto client = scb.client.lock();
+	if(client.get() == nullptr) return false;
+	for(;;) {
+		const HttpParser::Result hr = entry.http->Next(httpmsg);
+		if(hr == HttpParser::Result::Incomplete) return true;
+		else if(hr == HttpParser::Result::Invalid) {
+			LOG_FROM_TEMPLATE(LogLevel::Warn, "Invalid HTTP message on session ticket {:X8}: {:S60}",
+				entry.scb.GetKey(), entry.http->GetLastErrString().c_str());
+			return false;
+		}
+		TrafficCounters::Bump(scb.traffic.packetsin, 1);
+		scb.MarkExchange(scb.listener != 0); // Request received begins exchange, response received completes one
+		try {client->IBHttp(entry.scb.GetKey(), httpmsg);}
+		catch(const std::exception& e) {
+			const auto exceptioncontext = Exceptions::UnrollException(e);
+			LOG_FROM_TEMPLATE_CONTEXT(LogLevel::Error, &exceptioncontext, "Exception caught from HTTP callback");
+		}
+	}
+}
+// CommThread::MeasureLoopback: Measure frame at head of in-process or shared-memory ring using specified codec (returns
+// zero if frame header is not yet available in ring)
+template<typename Codec>
+_Check_return_ size_t Comms::CommLink::CommThread::MeasureLoopback(SpscRing& ring, size_t& len) noexcept {
+	char header[Codec::HeaderSize] = {0};
+	if(ring.Peek(header, Codec::HeaderSize) == false) return 0;
+	return Codec::Measure(header, Codec::HeaderSize, len);
+}
+// CommThread::ReadLoopback: Read data available in open in-process session's ring, delivering each packet (or each read,
+// if raw) to client; returns false if session should be closed (peer has closed, and all data it wrote has been read)
+// - Reading is limited to one ring's worth of data per call, so that a fast peer cannot monopolize this thread
+_Check_return_ bool Comms::CommLink::CommThread::ReadLoopback(SessionEntry& entry) {
+	SessionControlBlock& scb = *(entry.scb);
+	const bool peerclosed = scb.loopback->flags.closed; // Checked before reading, as peer writes before flagging close
+	SpscRing& ring = scb.loopback->Inbound(scb.loopend);
+	const bool raw = scb.CheckFlag(CommFlags::Raw);
+	const bool extended = scb.CheckFlag(CommFlags::ExtendedHeader);
+	auto client = scb.client.lock();
+	if(client.get() == nullptr) return false;
+	size_t consumed = 0;
+	while(consumed < ring.Capacity()) {
+		size_t br = 0;
+		if(raw) br = scb.ReadLoopback(readbuf.get(), READ_BUFFER_SIZE);
+		else {
+			// Only read packet once it is complete (peer writes packets whole, but ring may split them across writes):
+			size_t len = 0;
+			const size_t framelen = extended ? MeasureLoopback<Framing::Extended>(ring, len)
+				: MeasureLoopback<Framing::Length2BE>(ring, len);
+			if(framelen == 0 || ring.Available() < framelen) break;
+			char header[Framing::Extended::HeaderSize] = {0};
+			consumed += scb.ReadLoopback(header, framelen - len);
+			if(len > 0) br = scb.ReadLoopback(readbuf.get(), len);
+			else { // Zero-length packets are keepalives, not delivered
+				scb.NoteRead(entry.lastread = SteadyClock(), 0, 0);
+				continue;
+			}
+		}
+		if(br == 0) break;
+		consumed += br;
+		scb.NoteRead(entry.lastread = SteadyClock(), br, 1);
+		try {client->IBData(entry.scb.GetKey(), readbuf.get(), br);}
+		catch(const std::exception& e) {
+			const auto exceptioncontext = Exceptions::UnrollException(e);
+			LOG_FROM_TEMPLATE_CONTEXT(LogLevel::Error, &exceptioncontext, "Exception caught from data callback");
+		}
+	}
+	return (peerclosed == false || consumed >= ring.Capacity()); // Continue reading on next call, if limit was reached
+}
+// CommThread::WriteSession: Continue writing session's held output, once socket is writable (returns false if session
+// should be closed)
+_Check_return_ bool Comms::CommLink::CommThread::WriteSession(SessionEntry& entry) {
+	SessionControlBlock& scb = *(entry.scb);
+	std::lock_guard<std::mutex> sendlock(scb.sendlock);
+	const SocketOps::Result rc = scb.WriteBacklog();
+	if(SocketOps::ResultFailed(rc)) {
+		LOG_FROM_TEMPLATE(LogLevel::Warn, "Write failed on session ticket {:X8}: {:S60}",
+			entry.scb.GetKey(), scb.GetLastErrString().c_str());
+		return false;
+	}
+	return true;
+}
+// CommThread::ServiceLoopbacks: Write held output for, and read available data from, open in-process sessions
+void Comms::CommLink::CommThread::ServiceLoopbacks(std::vector<SessionEntry*>& loopbacks) {
+	for(SessionEntry* const entry : loopbacks) {
+		bool keep = (entry->scb->writepending ? WriteSession(*entry) : true);
+		if(keep && entry->scb->LoopbackReady()) keep = PollSession(*entry, true);
+		if(keep == false) entry->scb->state = SessionControlBlock::State::Disconnecting; // Removed on next iteration
+	}
+}
+// CommThread::ReportBackpressure: Notify client if session has become blocked, or been released, since last reported
+void Comms::CommLink::CommThread::ReportBackpressure(SessionEntry& entry) {
+	const bool blocked = entry.scb->blocked;
+	if(blocked == entry.blocknotified) return;
+	entry.blocknotified = blocked;
+	if(auto client = entry.scb->client.lock()) {
+		try {
+			if(blocked) client->OBWriteBlocked(entry.scb.GetKey());
+			else client->OBWritable(entry.scb.GetKey());
+		}
+		catch(const std::exception& e) {
+			const auto exceptioncontext = Exceptions::UnrollException(e);
+			LOG_FROM_TEMPLATE_CONTEXT(LogLevel::Error, &exceptioncontext, "Exception caught from backpressure callback");
+		}
+	}
+}
+// CommThread::DrainComplete: Notify client once session starts draining, then check whether session should now be
+// closed (no exchange in flight, no output held and no inbound data waiting, or deadline passed); at most the session's
+// drain batch of drained sessions are closed on each iteration (counted by drainclosed), others wait for next iteration
+_Check_return_ bool Comms::CommLink::CommThread::DrainComplete(SessionEntry& entry, size_t& drainclosed) {
+	using State = SessionControlBlock::State;
+	SessionControlBlock& scb = *(entry.scb);
+	const State state = scb.state;
+	if(state == State::Open && entry.drainnotified == false) {
+		entry.drainnotified = true;
+		if(auto client = scb.client.lock()) {
+			try {client->IBDraining(entry.scb.GetKey());}
+			catch(const std::exception& e) {
+				const auto exceptioncontext = Exceptions::UnrollException(e);
+				LOG_FROM_TEMPLATE_CONTEXT(LogLevel::Error, &exceptioncontext, "Exception caught from drain callback");
+			}
+		}
+	}
+	if(drainclosed >= scb.drainbatch) return false;
+	else if(state == State::Open && SessionControlBlock::StampOf(SteadyClock()) < scb.draindue) {
+		if(scb.ExchangeInFlight() || scb.held.load(std::memory_order_relaxed) > 0) return false;
+		else if(scb.loopback.get() ? scb.LoopbackReady()
+			: SocketOps::ResultOK(scb.sessionsocket->WaitEvent(0))) return false; // Read data before closing
+	}
+	++drainclosed;
+	if(scb.CheckFlag(CommFlags::TraceOn))
+		LOG_FROM_TEMPLATE(LogLevel::Debug, "Closing drained session ticket {:X8}", entry.scb.GetKey());
+	return true;
+}
+// CommThread::CloseSession: Close session socket, notify client (if connection was reported) and retire ticket
+void Comms::CommLink::CommThread::CloseSession(SessionEntry& entry) {
+	SessionControlBlock& scb = *(entry.scb);
+	scb.state = SessionControlBlock::State::Disconnected;
+	if(scb.sessionsocket.get()) {
+		// Make best effort to deliver any queued output before closing (without waiting; any output the socket does not
+		// accept immediately is discarded):
+		{std::lock_guard<std::mutex> sendlock(scb.sendlock);
+		if(scb.outbuf.empty() == false && scb.sessionsocket->Valid()) static_cast<void>(scb.FlushOutput());
+		if(scb.backlog.Empty() == false && scb.sessionsocket->Valid())
+			static_cast<void>(scb.sessionsocket->WriteBacklog(scb.backlog));}
+		scb.sessionsocket->Close();
+	}
+	else if(scb.loopback.get()) {
+		// Deliver any queued output to peer's ring as above, then flag link closed and wake peer, so that it closes
+		// once it has read all data written to it:
+		{std::lock_guard<std::mutex> sendlock(scb.sendlock);
+		if(scb.outbuf.empty() == false) static_cast<void>(scb.FlushOutput());
+		if(scb.backlog.Empty() == false) static_cast<void>(scb.WriteBacklog());}
+		LoopbackLink& loopback = *(scb.loopback);
+		loopback.flags.closed = true;
+		loopback.owners[scb.loopend] = nullptr;
+		loopback.WakePeer(scb.loopend);
+	}
+	if(entry.notified) {
+		entry.notified = false;
+		if(auto client = scb.client.lock()) {
+			try {client->IBDisconnect(entry.scb.GetKey());}
+			catch(const std::exception& e) {
+				const auto exceptioncontext = Exceptions::UnrollException(e);
+				LOG_FROM_TEMPLATE_CONTEXT(LogLevel::Error, &exceptioncontext, "Exception caught from disconnect callback");
+			}
+		}
+	}
+	// If read notification is still queued, closing socket will complete it; keep its overlapped structure alive until
+	// completion is dequeued:
+	if(entry.notifypending) {
+		entry.notifypending = false;
+		orphans.emplace_back(std::move(entry.readnotify));
+	}
+	link.RetireSession(entry.scb.GetKey(), scb);
+}
+// CommThread::FlushPending: Write queued output for sessions on flush list whose flush is due; returns time in
+// milliseconds until next flush is due (or -1 if flush list is empty)
+_Check_return_ int Comms::CommLink::CommThread::FlushPending() {
+	int wait = -1;
+	if(flushlist.empty()) return wait;
+	const auto now = std::chrono::steady_clock::now();
+	for(auto seek = flushlist.begin(); seek != flushlist.end();) {
+		const auto entry = mysessions.find(*seek);
+		if(entry == mysessions.end()) { // Session already closed
+			seek = flushlist.erase(seek);
+			continue;
+		}
+		SessionControlBlock& scb = *(entry->second.scb);
+		std::unique_lock<std::mutex> sendlock(scb.sendlock);
+		if(scb.outbuf.empty() == false && scb.flushdue > now) { // Not yet due; wait no longer than due time (rounded up)
+			const auto due = (std::chrono::duration_cast<std::chrono::microseconds>(scb.flushdue - now).count() + 999) / 1000;
+			wait = (wait < 0) ? gsl::narrow_cast<int>(due) : (std::min)(wait, gsl::narrow_cast<int>(due));
+			++seek;
+			continue;
+		}
+		else if(scb.outbuf.empty() == false && SocketOps::ResultFailed(scb.FlushOutput())) {
+			LOG_FROM_TEMPLATE(LogLevel::Warn, "Write failed on session ticket {:X8}: {:S60}",
+				entry->first, scb.GetLastErrString().c_str());
+			scb.state = SessionControlBlock::State::Disconnecting; // Removed on next session pass
+		}
+		scb.flushqueued = false;
+		seek = flushlist.erase(seek);
+	}
+	return wait;
+}
+// CommThread::ArmReadNotify: Ensure session socket has read notification queued to completion port (associating socket
+// with port on first call; returns false if session should be closed)
+_Check_return_ bool Comms::CommLink::CommThread::ArmReadNotify(SessionEntry& entry) {
+	if(entry.notifypending) return true;
+	const SocketOps::SessionSocketPtr& ss = entry.scb->sessionsocket;
+	if(ss->DataBuffered()) return true; // Will be read without waiting (notification queued once buffer is drained)
+	else if(entry.readnotify.get() == nullptr) {
+		if(ss->AssociateCompletionPort(completionport, entry.scb.GetKey()) == false) {
+			LOG_FROM_TEMPLATE(LogLevel::Error, "Failed to associate session ticket {:X8} with completion port: {:S60}",
+				entry.scb.GetKey(), ss->GetLastErrString().c_str());
+			return false;
+		}
+		entry.readnotify = std::make_unique<OVERLAPPED>();
+	}
+	if(SocketOps::ResultFailed(ss->PostReadNotify(entry.readnotify.get()))) {
+		LOG_FROM_TEMPLATE(LogLevel::Warn, "Read notification failed on session ticket {:X8}: {:S60}",
+			entry.scb.GetKey(), ss->GetLastErrString().c_str());
+		return false;
+	}
+	entry.notifypending = true;
+	return true;
+}
+// CommThread::WaitCompletions: Accept connections on any readable listeners and write held output to any writable
+// sessions in writers (which follow listeners in fds), then dequeue batch of read notifications from completion port,
+// and read from notified sessions (and those in ready, which already have data buffered)
+// - Listeners cannot be attached to the completion port (sharded listeners are shared by all threads), and zero-byte
+//   reads cannot signal writability, so both are polled without waiting; each also signals ioevent once ready (see
+//   IoSignalled), so completion port wait is only limited to LISTENER_POLL_INTERVAL if ioevent is unavailable (or a
+//   socket could not select it)
+void Comms::CommLink::CommThread::WaitCompletions(std::vector<WSAPOLLFD>& fds, std::vector<SessionEntry*>& writers,
+	std::vector<SessionEntry*>& ready, int timeout) {
+	if(fds.empty() == false) {
+		if(WSAPoll(fds.data(), gsl::narrow_cast<ULONG>(fds.size()), 0) > 0) {
+			const size_t listenercount = fds.size() - writers.size();
+			for(size_t l = 0; l < listenercount && l < mylisteners.size(); ++l) {
+				if(fds[l].revents != 0) AcceptBatch(mylisteners[l].GetKey(), *(mylisteners[l]));
+			}
+			for(size_t w = 0; w < writers.size(); ++w) {
+				if(fds[listenercount + w].revents != 0 && WriteSession(*(writers[w])) == false)
+					writers[w]->scb->state = SessionControlBlock::State::Disconnecting; // Removed on next iteration
+			}
+		}
+		if(ioevent == nullptr || iopolled) timeout = (std::min)(timeout, LISTENER_POLL_INTERVAL);
+	}
+
+	// Dequeue available completions (waiting up to timeout for the first); match each to its session by key, and
+	// release overlapped structures of sessions already closed:
+	OVERLAPPED_ENTRY completions[COMPLETION_BATCH];
+	ULONG count = 0;
+	if(GetQueuedCompletionStatusEx(completionport, completions, COMPLETION_BATCH, &count,
+		gsl::narrow_cast<DWORD>(ValueOps::MinZero(timeout)), FALSE) == FALSE) {
+		const DWORD err = GetLastError();
+		if(err != WAIT_TIMEOUT) {
+			LOG_FROM_TEMPLATE(LogLevel::Error, "Comms thread completion wait failed: {:S60}",
+				Exceptions::ConvertCOMError(err).c_str());
+		}
+		count = 0;
+	}
+	for(ULONG c = 0; c < count; ++c) {
+		if(completions[c].lpOverlapped == nullptr) continue; // Wake signal (see Wake)
+		const auto seek = mysessions.find(gsl::narrow_cast<SessionTicket>(completions[c].lpCompletionKey));
+		if(seek != mysessions.end() ? (seek->second.readnotify.get() == completions[c].lpOverlapped) : false) {
+			seek->second.notifypending = false;
+			ready.push_back(&(seek->second));
+		}
+		else {
+			const auto orphan = std::find_if(orphans.begin(), orphans.end(),
+				[&](const std::unique_ptr<OVERLAPPED>& o) {return (o.get() == completions[c].lpOverlapped);});
+			if(orphan != orphans.end()) orphans.erase(orphan);
+		}
+	}
+
+	// Read from all ready sessions (failures flagged for disconnect, removed on next iteration):
+	for(SessionEntry* entry : ready) {
+		if(PollSession(*entry, true) == false) entry->scb->state = SessionControlBlock::State::Disconnecting;
+	}
+}
+// CommThread::IoSignalled: Wait callback on ioevent, waking thread to poll its listeners and held-output sessions
+// (event is auto-reset, so a readiness signal raised while thread polls is never lost)
+void CALLBACK Comms::CommLink::CommThread::IoSignalled(PVOID Context, BOOLEAN) {
+	static_cast<CommThread*>(Context)->Wake();
+}
+// CommThread::RunTimers: Pop and process all due session timers, rescheduling each live session's next timer
+void Comms::CommLink::CommThread::RunTimers() {
+	const SteadyClock now;
+	while(timers.empty() == false && timers.top().due <= now) {
+		const SessionTimer timer = timers.top();
+		timers.pop();
+		// Discard entry if session has closed, or entry has been superseded:
+		const auto seek = mysessions.find(timer.ticket);
+		if(seek == mysessions.end() || (seek->second.timerdue == timer.due) == false) continue;
+		else if(SessionTimerDue(seek->second, now)) ScheduleTimer(seek->second);
+		else seek->second.scb->state = SessionControlBlock::State::Disconnecting; // Removed on next session pass
+	}
+}
+// CommThread::ScheduleTimer: Add timer queue entry for session at earliest of keepalive and idle timeout due times
+void Comms::CommLink::CommThread::ScheduleTimer(SessionEntry& entry) {
+	const SessionControlBlock& scb = *(entry.scb);
+	if(scb.keepalive > 0 && scb.idletimeout > 0) {
+		entry.timerdue = (std::min)(entry.lastsend + std::chrono::milliseconds(scb.keepalive),
+			entry.lastread + std::chrono::milliseconds(scb.idletimeout));
+	}
+	else if(scb.keepalive > 0) entry.timerdue = entry.lastsend + std::chrono::milliseconds(scb.keepalive);
+	else if(scb.idletimeout > 0) entry.timerdue = entry.lastread + std::chrono::milliseconds(scb.idletimeout);
+	else return; // No timers configured for session
+	timers.push(SessionTimer{entry.timerdue, entry.scb.GetKey()});
+}
+// CommThread::SessionTimerDue: Check idle timeout and send keepalive if link has been idle for full interval (returns
+// false if session should be closed)
+// - Sends by other threads are detected via session's sent flag, so last send time is only known to the resolution of
+//   the timer; the gap between outbound packets can therefore reach (but not exceed) twice the keepalive interval
+_Check_return_ bool Comms::CommLink::CommThread::SessionTimerDue(SessionEntry& entry, const SteadyClock& now) {
+	SessionControlBlock& scb = *(entry.scb);
+	if(scb.state != SessionControlBlock::State::Open) return true; // Session is being closed; do not reschedule
+	else if(scb.idletimeout > 0 && now.MSecSince(entry.lastread) >= scb.idletimeout) {
+		LOG_FROM_TEMPLATE(LogLevel::Warn, "Idle timeout on session ticket {:X8} after {:D}ms",
+			entry.scb.GetKey(), scb.idletimeout);
+		return false;
+	}
+	else if(scb.keepalive > 0) {
+		if(scb.sent.exchange(false)) entry.lastsend = now; // Link not idle
+		else if(now.MSecSince(entry.lastsend) >= scb.keepalive) {
+			// Write header-only packet from static buffer (if another thread is mid-send, link is not idle):
+			std::unique_lock<std::mutex> sendlock(scb.sendlock, std::try_to_lock);
+			if(sendlock.owns_lock()) {
+				const WSABUF keepalive = {scb.CheckFlag(CommFlags::ExtendedHeader) ? 4UL : 2UL,
+					const_cast<char*>(KEEPALIVE_PACKET)};
+				if(SocketOps::ResultFailed(scb.WriteOutput(&keepalive, 1))) {
+					LOG_FROM_TEMPLATE(LogLevel::Warn, "Keepalive failed on session ticket {:X8}: {:S60}",
+						entry.scb.GetKey(), scb.sessionsocket->GetLastErrString().c_str());
+					return false;
+				}
+			}
+			entry.lastsend = now;
+		}
+	}
+	return true;
+}
+#pragma endregion CommThread
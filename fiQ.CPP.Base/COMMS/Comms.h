@@ -3,9 +3,16 @@
 // Comms.h : Central class for managing underlying communications layer and event management
 //==========================================================================================================================
 
+#include <queue>
+#include <unordered_map>
 #include "Comms/CommsClient.h"
 #include "Comms/Connection.h"
+#include "Comms/ConnectionPool.h"
+#include "Comms/DnsResolver.h"
+#include "Tools/SharedRing.h"
+#include "Tools/SlotTable.h"
 #include "Tools/SocketOps.h"
+#include "Tools/SpscRing.h"
 #include "Tools/ThreadOps.h"
 
 namespace FIQCPPBASE {
@@ -23,20 +30,147 @@ public:
 	template<typename T, std::enable_if_t<std::is_same_v<T, unsigned int>, int> = 0>
 	_Check_return_ static bool TicketValid(T ticket) noexcept {return (ticket > 0);}
 	enum class Protocol : int { TCP = 0, HTTP = 1 };
-	enum class Result { OK = 0, Timeout = 10, InvalidTicket = 20, Failed = 21, InvalidArg = 22 };
+	enum class Result {
+		OK = 0, Timeout = 10, QueueFull = 11, Draining = 12, InvalidTicket = 20, Failed = 21, InvalidArg = 22 };
 	_Check_return_ static constexpr bool ResultOK(Result r) noexcept {return (r == Result::OK);}
 	_Check_return_ static constexpr bool ResultTimeout(Result r) noexcept {return (r == Result::Timeout);}
+	_Check_return_ static constexpr bool ResultQueueFull(Result r) noexcept {return (r == Result::QueueFull);}
+	_Check_return_ static constexpr bool ResultDraining(Result r) noexcept {return (r == Result::Draining);}
 	_Check_return_ static constexpr bool ResultFailed(Result r) noexcept {return (r >= Result::InvalidTicket);}
 	//======================================================================================================================
 	// Public definitions - Worker thread pool size
 	static constexpr size_t COMM_THREADS_MIN		= 1;
 	static constexpr size_t COMM_THREADS_DEFAULT	= 10;
 	static constexpr size_t COMM_THREADS_MAX		= 100;
+	// Backend: Mechanism used by worker threads to wait for session activity
+	// - Poll: Each wakeup polls all of thread's sockets (WSAPoll)
+	// - CompletionPort: Each session has a zero-byte read queued to its thread's I/O completion port, and each wakeup
+	//   dequeues a batch of completions; avoids rebuilding and scanning the full poll set each iteration (listeners and
+	//   sessions with held output are still polled on each wakeup, but signal an event which wakes the thread when they
+	//   become ready, so this favours threads with many mostly-idle sessions; a sharded listener signals only the last
+	//   thread to adopt it, others accepting from it whenever they next wake, within the poll interval)
+	enum class Backend : int { Poll = 0, CompletionPort = 1 };
+	//======================================================================================================================
+	// Public definitions - Listener accept batching (maximum connections accepted per listener on each thread wakeup,
+	// overridden by "ACCEPTBATCH" config parameter) and listen backlog (overridden by "BACKLOG" config parameter)
+	static constexpr size_t ACCEPT_BATCH_MIN		= 1;
+	static constexpr size_t ACCEPT_BATCH_DEFAULT	= 64;
+	static constexpr size_t ACCEPT_BATCH_MAX		= 1024;
+	static constexpr int LISTEN_BACKLOG_DEFAULT		= SocketOps::LISTEN_BACKLOG_DEFAULT;
+	static constexpr int LISTEN_BACKLOG_MAX			= 0xFFFF;
+	//======================================================================================================================
+	// Public definitions - Session timers: keepalive interval for sessions with AppKeepAlive flag (overridden by
+	// "KEEPALIVE" config parameter), and idle read timeout for any session (set by "IDLETIMEOUT" config parameter,
+	// disabled by default); both are driven by the owning comms thread and apply to asynchronous sessions only
+	static constexpr int KEEPALIVE_INTERVAL_MIN		= 100;
+	static constexpr int KEEPALIVE_INTERVAL_DEFAULT	= 30000;
+	//======================================================================================================================
+	// Public definitions - Packet size limit (two-byte length header), and write coalescing for connections with Coalesce
+	// flag: packets are queued and written together by the owning comms thread once the oldest has waited for the
+	// "COALESCEDELAY" config parameter (microseconds; default zero, i.e. at the end of the thread's current iteration),
+	// or by the sending thread as soon as "COALESCEMAX" bytes are queued; a packet may be sent from up to SEND_PIECES_MAX
+	// separate buffers (see Send), so that a packet and its header fit one gather write (and one TLS message, if small)
+	static constexpr size_t PACKET_SIZE_MAX			= 0xFFFF;
+	static constexpr size_t SEND_PIECES_MAX			= 15;
+	static constexpr int COALESCE_DELAY_DEFAULT		= 0;
+	static constexpr int COALESCE_DELAY_MAX			= 1000000;
+	static constexpr size_t COALESCE_BYTES_DEFAULT	= 0x4000;
+	static constexpr size_t COALESCE_BYTES_MAX		= 0x100000;
+	//======================================================================================================================
+	// Public definitions - Outbound backpressure: asynchronous sessions write without blocking, and output the socket
+	// cannot yet accept is held for the owning comms thread to write once the socket is writable; when held (plus any
+	// coalesced) output reaches the "SENDHIGH" config parameter (bytes), client receives OBWriteBlocked and Send returns
+	// QueueFull until it has drained to "SENDLOW" (default half of high watermark), when client receives OBWritable
+	static constexpr size_t SEND_HIGH_WATER_MIN		= 0x400;
+	static constexpr size_t SEND_HIGH_WATER_DEFAULT	= 0x400000;
+	static constexpr size_t SEND_HIGH_WATER_MAX		= 0x40000000;
+	//======================================================================================================================
+	// Public definitions - HTTP protocol: sessions on connections with Http flag exchange HTTP/1.1 messages rather than
+	// packets; each complete inbound request (inbound sessions) or response (outbound sessions) is raised via IBHttp,
+	// with keep-alive, pipelining and chunked bodies handled by HttpParser; header and body sizes are limited by the
+	// "HTTPMAXHEADER" and "HTTPMAXBODY" config parameters (bytes), and sessions close after an invalid message
+	static constexpr size_t HTTP_HEADER_BYTES_MIN	= 0x400;
+	static constexpr size_t HTTP_HEADER_BYTES_MAX	= 0x100000;
+	static constexpr size_t HTTP_BODY_BYTES_MAX		= 0x40000000;
+	//======================================================================================================================
+	// Public definitions - In-process loopback: connections with an "inproc://NAME" address need no sockets; listener is
+	// registered by name, and RequestConnect pairs the outbound session directly with a session accepted on it, with
+	// data passed through a lock-free ring in each direction (capacity set by connecting side's "INPROCRING" config
+	// parameter, in bytes); all other behaviour, including client callbacks and backpressure, is as for TCP sessions
+	static constexpr size_t INPROC_RING_MIN			= 0x20000;	// Must hold largest packet
+	static constexpr size_t INPROC_RING_DEFAULT		= 0x100000;
+	static constexpr size_t INPROC_RING_MAX			= 0x10000000;
+	//======================================================================================================================
+	// Public definitions - Shared-memory links: connections with a "shm://NAME" address exchange data with another
+	// process on this host through a named shared-memory section holding a ring in each direction (see SharedRing), with
+	// capacity set by connecting side's "SHMRING" config parameter (default and limits as for in-process rings); each
+	// end's owning thread is woken through a named event, signalled by writer only when reader had drained its ring,
+	// unless that end's "SHMWAIT" config parameter is "SPIN", in which case its owning thread busy-polls the ring (never
+	// waiting while session is open); all other behaviour is as for in-process sessions, and sessions also close if the
+	// peer process exits
+	//======================================================================================================================
+	// Public definitions - Outbound connection setup: remote host names are resolved off the calling thread (see
+	// DnsResolver), and asynchronous connections to a name not yet resolved are started by the owning comms thread once
+	// it resolves, within the "CONNTIMEOUT" config parameter (milliseconds); connections with RaceConnect flag race
+	// attempts across all resolved addresses (see SocketOps::ConnectRace), each started after "RACEDELAY" milliseconds
+	static constexpr int CONNECT_TIMEOUT_DEFAULT	= ConnectionPool::CONNECT_TIMEOUT_DEFAULT;
+	static constexpr int RACE_DELAY_DEFAULT			= SocketOps::ConnectRace::ATTEMPT_DELAY_DEFAULT;
+	//======================================================================================================================
+	// Public definitions - Graceful drain: a draining session's client receives IBDraining, after which Send is refused
+	// (Draining) on outbound sessions, as any send would start a new exchange, while inbound sessions may still send
+	// responses; owning thread closes session once no exchange is in flight, no output is held and no inbound data is
+	// waiting, or once drain deadline passes, closing at most "batch" drained sessions on each wakeup
+	// - Exchanges in flight are those marked by client (see BeginExchange), as only the client knows how its protocol
+	//   pairs requests with responses (one-way notifications, multi-packet responses, server push); HTTP sessions are
+	//   marked automatically, taking each message sent or delivered as a complete request or response
+	// - A session with no exchange marked is closed as soon as its output is written and its inbound data read
+	static constexpr size_t DRAIN_BATCH_DEFAULT		= 64;
+	static constexpr int DRAIN_CLOSE_GRACE			= 2000;	// Time allowed beyond deadline for final batches to close
+	//======================================================================================================================
+	// Transfer statistics - Counters are maintained by each session with relaxed atomics (inbound by owning comms
+	// thread, outbound by sending thread under session's send lock), so each value read is current but a snapshot is not
+	// consistent across values; data bytes exclude packet headers, and keepalive packets are not counted
+	struct TrafficStats {
+		unsigned long long BytesIn = 0;		// Data bytes delivered to client
+		unsigned long long BytesOut = 0;	// Data bytes accepted by Send
+		unsigned long long PacketsIn = 0;	// Packets (or raw reads, or HTTP messages) delivered to client
+		unsigned long long PacketsOut = 0;	// Packets (or raw buffers, or HTTP messages) accepted by Send
+	};
+	// ListenerStats: Snapshot of accept counters for a registered listener (see GetListenerStats)
+	struct ListenerStats {
+		unsigned long long Accepted = 0;		// Sessions accepted since listener was registered
+		unsigned long long AcceptFailed = 0;	// Accept calls (or TLS negotiation starts) which failed
+		unsigned long long QueueOverflows = 0;	// Wakeups on which accept batch limit was reached with requests pending
+		unsigned int AcceptRate = 0;			// Sessions accepted during most recent complete one-second interval
+		TrafficStats Traffic;					// Totals for sessions accepted by listener (open and closed)
+	};
+	// SessionStats: Snapshot of counters and transport state for a session (see GetStats)
+	// - TCP statistics are sampled from socket when snapshot is taken (open TCP sessions only, see SocketOps::TcpInfo)
+	struct SessionStats {
+		TrafficStats Traffic;
+		size_t QueuedBytes = 0;			// Output held awaiting socket writability, plus coalesced output not yet written
+		bool Blocked = false;			// Held output has reached high watermark (Send returns QueueFull)
+		long long MSecSinceRead = -1;	// Time since last inbound data, or session opening (-1 if not yet open)
+		long long MSecSinceSend = -1;	// Time since last Send accepted, or session opening (-1 if not yet open)
+		unsigned int ConnectAttempts = 0;	// Connection attempts started for outbound session (one per address tried, or
+											// one if session leased a pooled socket)
+		bool TcpInfoValid = false;		// Flag indicating Tcp member was sampled
+		SocketOps::TcpInfo Tcp;
+	};
+	// AggregateStats: Snapshot of counters across all sessions (see GetAggregateStats)
+	struct AggregateStats {
+		TrafficStats Traffic;					// Totals for all sessions (open and closed)
+		unsigned long long SessionsOpened = 0;	// Sessions opened for data exchange
+		unsigned long long SessionsClosed = 0;	// Sessions closed after opening
+		size_t SessionsActive = 0;				// Sessions currently registered (including those still connecting)
+		size_t QueuedBytes = 0;					// Output held across all sessions (see SessionStats)
+	};
 
 	//======================================================================================================================
-	// Static library initialization functions: Each should be called exactly once in program lifetime
+	// Static library initialization functions: Initialize should be called once before any other function, and Cleanup
+	// once comms are no longer required (Initialize may then be called again, e.g. to select a different backend)
 	// - Note these functions are NOT thread-safe - call them from main() only
-	static void Initialize(size_t CommThreads = COMM_THREADS_DEFAULT);
+	static void Initialize(size_t CommThreads = COMM_THREADS_DEFAULT, Backend backend = Backend::Poll);
 	static void Cleanup();
 
 	//======================================================================================================================
@@ -45,12 +179,28 @@ public:
 		const std::shared_ptr<CommsClient>& client, const std::shared_ptr<Connection>& connection,
 		_Inout_opt_ std::string* LastErrString = nullptr);
 	static Result DeregisterListener(ListenerTicket listener, int timeout);
+	// GetListenerStats: Retrieve accept counters for specified listener
+	_Check_return_ static Result GetListenerStats(ListenerTicket listener, ListenerStats& stats);
 	// RequestConnect: Attempt connection out to remote; returns SessionTicket
+	// - If connection has Pooled flag set, a pre-connected socket is leased from the connection pool if available (new
+	//   connection is attempted otherwise, and pool is warmed for subsequent requests)
 	_Check_return_ static SessionTicket RequestConnect(
 		const std::shared_ptr<CommsClient>& client, const std::shared_ptr<Connection>& connection,
 		_Inout_opt_ std::string* LastErrString = nullptr);
-	// Send: Deliver data to specified session
+	// PreparePool: Start pre-connecting pooled sockets for connection's remote endpoint, ahead of first RequestConnect
+	static Result PreparePool(const std::shared_ptr<Connection>& connection);
+	// GetPoolStats: Retrieve connection pool state for connection's remote endpoint
+	_Check_return_ static Result GetPoolStats(const std::shared_ptr<Connection>& connection, ConnectionPool::PoolStats& stats);
+	// Send: Deliver data to specified session (preceded by packet header, unless connection has Raw or Http flag)
+	// - If connection has Coalesce flag, data is queued for a combined write (see above) rather than written immediately
+	// - Returns QueueFull (data not sent) while session's outbound backpressure is above its watermark (see above)
+	// - Returns Draining (data not sent) on outbound session being drained (see above)
 	_Check_return_ static Result Send(SessionTicket session, _In_reads_(len) const char* buf, size_t len);
+	// Send: As above, with data gathered from up to SEND_PIECES_MAX buffers (e.g. header, body and trailer) and sent as a
+	// single packet, without first being copied together
+	_Check_return_ static Result Send(SessionTicket session, gsl::span<const gsl::span<const char>> pieces);
+	// Flush: Write any data queued for specified session immediately
+	_Check_return_ static Result Flush(SessionTicket session);
 	// SendAndReceive: Deliver data to specified session and wait for response synchronously
 	_Check_return_ static Result SendAndReceive(SessionTicket session,
 		_In_reads_(len) const char* buf, size_t len, // Outbound data to be delivered
@@ -58,15 +208,27 @@ public:
 		int Timeout);
 	// Disconnect: Drop specified session
 	static Result Disconnect(SessionTicket session);
+	// DrainListener: Stop accepting on listener (which is deregistered), then drain every session it accepted (see
+	// above); waits until all have closed (returns OK), or until deadline plus DRAIN_CLOSE_GRACE passes (Timeout)
+	static Result DrainListener(ListenerTicket listener, int deadline, size_t batch = DRAIN_BATCH_DEFAULT);
+	// DrainSession: Start draining specified session (without waiting; client receives IBDisconnect once closed)
+	static Result DrainSession(SessionTicket session, int deadline);
+	// BeginExchange, EndExchange: Mark start and completion of an exchange on specified session (e.g. request received
+	// and final response sent, on inbound session), so that a drain waits for it (see above); each call to EndExchange
+	// completes one exchange begun earlier (calls beyond those are ignored)
+	static Result BeginExchange(SessionTicket session);
+	static Result EndExchange(SessionTicket session);
+	// GetStats: Retrieve counters and transport state for specified session
+	_Check_return_ static Result GetStats(SessionTicket session, SessionStats& stats);
+	// GetAggregateStats: Retrieve counters across all sessions (visits every registered session, so not for hot paths)
+	static void GetAggregateStats(AggregateStats& stats);
 
 private:
 
 	//======================================================================================================================
-	// Private value definitions
-	static constexpr ListenerTicket LISTENER_TICKETS_MAX = 0x00FFFFFF;
-	static constexpr SessionTicket SESSION_TICKET_MAX = 0x00FFFFFF;
-	static constexpr SessionTicket SESSION_TICKET_REMFLAGS = ~0xFF000000;
-	static constexpr SessionTicket SESSION_TICKET_SYNCDATA = 0x10000000;
+	// Private value definitions - Ticket layout is [slot generation:12][slot index:20] (see SlotTable)
+	static constexpr unsigned int TICKET_INDEX_BITS = 20;
+	static constexpr unsigned int TICKET_GENERATION_BITS = 12;
 
 	//======================================================================================================================
 	// CommLink: Singleton communications management class, driving all communications functionality
@@ -74,7 +236,7 @@ private:
 	public:
 		//==================================================================================================================
 		// Initialization functions (forwarded from Comms static functions)
-		void Initialize(size_t CommThreads);
+		void Initialize(size_t CommThreads, Backend backend);
 		void Cleanup();
 
 		//==================================================================================================================
@@ -83,35 +245,70 @@ private:
 			const std::shared_ptr<CommsClient>& client, const std::shared_ptr<Connection>& connection,
 			_Inout_opt_ std::string* LastErrString);
 		Result DeregisterListener(ListenerTicket listener, int timeout);
+		_Check_return_ Result GetListenerStats(ListenerTicket listener, ListenerStats& stats);
 		_Check_return_ SessionTicket RequestConnect(
 			const std::shared_ptr<CommsClient>& client, const std::shared_ptr<Connection>& connection,
 			_Inout_opt_ std::string* LastErrString);
+		Result PreparePool(const std::shared_ptr<Connection>& connection);
+		_Check_return_ Result GetPoolStats(const std::shared_ptr<Connection>& connection, ConnectionPool::PoolStats& stats);
 		_Check_return_ Result Send(SessionTicket session, _In_reads_(len) const char* buf, size_t len);
+		_Check_return_ Result Send(SessionTicket session, gsl::span<const gsl::span<const char>> pieces);
+		_Check_return_ Result Flush(SessionTicket session);
 		_Check_return_ Result SendAndReceive(SessionTicket session,
 			_In_reads_(len) const char* buf, size_t len, // Outbound data to be delivered
 			_Out_writes_(MaxBytes) char* Tgt, size_t MaxBytes, size_t& BytesRead, // Destination for inbound response
 			int Timeout);
 		Result Disconnect(SessionTicket session);
+		Result DrainListener(ListenerTicket listener, int deadline, size_t batch);
+		Result DrainSession(SessionTicket session, int deadline);
+		Result MarkExchange(SessionTicket session, bool begin);
+		_Check_return_ Result GetStats(SessionTicket session, SessionStats& stats);
+		void GetAggregateStats(AggregateStats& stats);
 
-		CommLink() noexcept : listenerticketmax(0), listenerticketlock(true), listenerlock(true),
-			sessionticketmax(0), sessionticketlock(true) {}
+		// Default constructor, destructor
+		CommLink() = default;
+		~CommLink() noexcept(false);
+
+		// Deleted copy/move constructors and assignment operators (should never be called, as this class will only be
+		// created once and only destructed at program exit)
+		CommLink(const CommLink&) = delete;
+		CommLink(CommLink&&) = delete;
+		CommLink& operator=(const CommLink&) = delete;
+		CommLink& operator=(CommLink&&) = delete;
 
 	private:
 
 		//==================================================================================================================
-		// Listener management
-		ListenerTicket listenerticketmax;			// Current max listener ticket value
-		std::deque<ListenerTicket> listenertickets;	// Collection of available listener tickets
-		Locks::SpinLock listenerticketlock;			// Lock for access to listener ticket collection
+		// Transfer counters (see TrafficStats): session counters each have a single writer, so are updated by relaxed load
+		// and store (no interlocked operation); totals of closed sessions are accumulated by interlocked addition
+		struct TrafficCounters {
+			static void Bump(std::atomic<unsigned long long>& counter, unsigned long long n) noexcept {
+				counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+			}
+			void Accumulate(const TrafficCounters& t) noexcept;
+			void AddTo(TrafficStats& stats) const noexcept;
+			std::atomic<unsigned long long> bytesin{0};
+			std::atomic<unsigned long long> bytesout{0};
+			std::atomic<unsigned long long> packetsin{0};
+			std::atomic<unsigned long long> packetsout{0};
+		};
 
+		//==================================================================================================================
+		// Listener management
 		struct ListenerControlBlock {
 
-			// Default constructor/destructor
+			// Default constructor/destructor (destructor closes socket, then signals shutdown event if set)
 			ListenerControlBlock(
-				const std::shared_ptr<CommsClient> _client, const std::shared_ptr<Connection>& _connection)
-				: client(_client), connection(_connection), serversocket(nullptr),
-				shutdownflag(false), shutdownevent(nullptr) {}
-			~ListenerControlBlock() = default;
+				const std::shared_ptr<CommsClient> _client, const std::shared_ptr<Connection>& _connection,
+				size_t _acceptbatch) noexcept(false)
+				: client(_client), connection(_connection), acceptbatch(_acceptbatch),
+				sharded(_connection.get() ? _connection->CheckFlag(CommFlags::ShardedListen) : false),
+				serversocket(nullptr), shutdownflag(false), shutdownevent(nullptr) {}
+			~ListenerControlBlock() noexcept(false) {
+				serversocket.reset();
+				shmlistener.reset();
+				if(shutdownevent.get()) shutdownevent->Set();
+			}
 
 			// Deleted copy/move constructors/assignment operators
 			ListenerControlBlock(const ListenerControlBlock&) = delete;
@@ -119,25 +316,64 @@ private:
 			ListenerControlBlock& operator=(const ListenerControlBlock&) = delete;
 			ListenerControlBlock& operator=(ListenerControlBlock&&) = delete;
 
+			// Accept statistics functions (called from worker threads, lock-free)
+			_Check_return_ static long long CurrentSecond() noexcept;
+			void CountAccepted() noexcept;
+			_Check_return_ ListenerStats GetStats() const noexcept;
+
 			// Const members, set at construction
 			const std::weak_ptr<CommsClient> client;		// Callback handle to registered client
 			const std::shared_ptr<Connection> connection;	// Configuration information for this connection
+			const size_t acceptbatch;						// Maximum connections to accept per thread wakeup
+			const bool sharded;								// Listener is polled by all threads (not just one)
 
 			// Processing members
-			SocketOps::ServerSocketPtr serversocket;		// Handle to listener socket
-			bool shutdownflag;								// Flag to indicate when this listener should close
+			SocketOps::ServerSocketPtr serversocket;		// Handle to listener socket (nonblocking)
+			std::unique_ptr<SharedRing::Listener> shmlistener;	// Rendezvous (shared-memory listeners only)
+			std::atomic_bool shutdownflag;					// Flag to indicate when this listener should close
 			std::shared_ptr<ThreadOps::Event> shutdownevent;	// Event to flag when shutdown is complete, if required
+
+			// Accept statistics members
+			std::atomic<unsigned long long> accepted{0};
+			std::atomic<unsigned long long> acceptfailed{0};
+			std::atomic<unsigned long long> queueoverflows{0};
+			std::atomic<long long> ratesecond{0};			// Steady clock second in which ratecount is accumulating
+			std::atomic<unsigned int> ratecount{0};		// Accepts counted in ratesecond
+			std::atomic<unsigned int> lastrate{0};			// Accepts counted in second prior to ratesecond
+			TrafficCounters closedtraffic;					// Totals of accepted sessions which have closed
 		};
-		std::map<ListenerTicket, std::unique_ptr<ListenerControlBlock>> listeners;
-		Locks::SpinLock listenerlock;
+		using ListenerTable = SlotTable<ListenerControlBlock, TICKET_INDEX_BITS, TICKET_GENERATION_BITS>;
+		ListenerTable listeners; // Table of active listeners, indexed by ticket (lock-free allocation and lookup)
 
 		//==================================================================================================================
 		// Session management
-		SessionTicket sessionticketmax = 0;			// Current max session ticket value
-		std::deque<SessionTicket> sessiontickets;	// Collection of available session tickets
-		Locks::SpinLock sessionticketlock;			// Lock for access to session ticket collection
-		_Check_return_ SessionTicket GetSessionTicket(); // Utility function to retrieve next free session ticket
-
+		class CommThread;
+		// LoopbackLink: Shared by the two sessions of an in-process link (end 0 is the accepted session, end 1 outbound),
+		// or held by one session of a shared-memory link (other end being held by a session in another process)
+		// - Each end writes into the other's ring (under its own sendlock, so each ring has a single producer) and reads
+		//   its own ring from its owning thread; writer wakes reader's owner when it writes into a drained ring, and a
+		//   writer whose output is held (ring full) flags itself stalled, so that reader wakes writer's owner on reading
+		// - Other end of a shared-memory link is woken by signalling its event (unless it is spinning), which its process
+		//   forwards to its owning thread (see SharedWake); rings and flags are then held in shared section
+		struct LoopbackLink {
+			explicit LoopbackLink(size_t capacity) noexcept(false);
+			LoopbackLink(std::unique_ptr<SharedRing>&& _shared, bool spin) noexcept(false);
+			~LoopbackLink() noexcept(false);
+			LoopbackLink(const LoopbackLink&) = delete;
+			LoopbackLink(LoopbackLink&&) = delete;
+			LoopbackLink& operator=(const LoopbackLink&) = delete;
+			LoopbackLink& operator=(LoopbackLink&&) = delete;
+			_Check_return_ SpscRing& Inbound(size_t end) noexcept {return *rings[end];}
+			_Check_return_ bool Spinning(size_t end) const noexcept {return flags.spinning[end];}
+			void WakePeer(size_t end) noexcept;			// Wake owner of other end, from specified end
+			static void SharedWake(void* Context);		// Forward shared-memory link's event to owner of this end
+			std::unique_ptr<SpscRing> ownedrings[2];	// Inbound data for each end (in-process links only)
+			std::unique_ptr<SharedRing> shared;			// Shared-memory link (null for in-process links)
+			SharedRing::Flags localflags{};				// Link flags (in-process links only)
+			SharedRing::Flags& flags;					// Stalled flag for each end, and closed flag for link
+			SpscRing* rings[2];							// Inbound data for each end
+			std::atomic<CommThread*> owners[2];	// Thread owning each end (null until adopted, once closed, or if remote)
+		};
 		struct SessionControlBlock {
 
 			// Type/value definitions
@@ -153,13 +389,61 @@ private:
 			_Check_return_ bool CheckFlag(CommFlags f) const noexcept {
 				return (connection.get() ? connection->CheckFlag(f) : false);
 			}
+			_Check_return_ bool HasTransport() const noexcept {
+				return (sessionsocket.get() != nullptr || loopback.get() != nullptr || lookup.get() != nullptr
+					|| race.get() != nullptr);
+			}
+			_Check_return_ const std::string& GetLastErrString() const noexcept;
+			_Check_return_ bool ConnectResolved(_Inout_opt_ std::string* ErrString);
+
+			// Statistics functions: NoteRead is called from owning thread only, NoteSend with sendlock held
+			_Check_return_ static long long StampOf(const SteadyClock& t) noexcept {
+				return t.GetTimePoint().time_since_epoch().count();
+			}
+			void NoteOpened(const SteadyClock& now) noexcept {
+				lastreadms.store(StampOf(now), std::memory_order_relaxed);
+				lastsendms.store(StampOf(now), std::memory_order_relaxed);
+			}
+			void NoteRead(const SteadyClock& now, size_t bytes, size_t packets) noexcept {
+				lastreadms.store(StampOf(now), std::memory_order_relaxed);
+				TrafficCounters::Bump(traffic.bytesin, bytes);
+				TrafficCounters::Bump(traffic.packetsin, packets);
+			}
+			void NoteSend(size_t bytes) noexcept {
+				lastsendms.store(StampOf(SteadyClock()), std::memory_order_relaxed);
+				TrafficCounters::Bump(traffic.bytesout, bytes);
+				TrafficCounters::Bump(traffic.packetsout, 1);
+			}
+			void GetStats(SessionStats& stats) const;
+
+			// Drain functions: StartDrain flags session for drain (returns false if already draining, leaving batch of
+			// drain in progress unchanged); MarkExchange counts exchanges begun and completed (never below zero)
+			_Check_return_ bool Draining() const noexcept {return (draindue.load() != 0);}
+			_Check_return_ bool StartDrain(int deadline, size_t batch) noexcept {
+				const long long due = StampOf(SteadyClock() + std::chrono::milliseconds(ValueOps::MinZero(deadline)));
+				long long expected = 0;
+				if(draindue.compare_exchange_strong(expected, due) == false) return false;
+				drainbatch = (std::max)(batch, static_cast<size_t>(1));
+				return true;
+			}
+			void MarkExchange(bool begin) noexcept {
+				if(begin) ++exchanges;
+				else {
+					int expected = exchanges.load();
+					while(expected > 0 && exchanges.compare_exchange_weak(expected, expected - 1) == false) {}
+				}
+			}
+			_Check_return_ bool ExchangeInFlight() const noexcept {return (exchanges.load() > 0);}
 
 			// Default constructor and destructor
 			SessionControlBlock(
 				const std::shared_ptr<CommsClient> _client,
 				const std::shared_ptr<Connection>& _connection,
 				ListenerTicket _listener = 0) noexcept(false)
-				: client(_client), connection(_connection), listener(_listener),
+				: client(_client), connection(_connection), listener(_listener), protocol(SessionProtocol(_connection)),
+				keepalive(KeepAliveInterval(_connection)), idletimeout(IdleTimeout(_connection)),
+				coalescedelay(CoalesceDelay(_connection)), coalescemax(CoalesceBytes(_connection)),
+				highwater(SendHighWater(_connection)), lowwater(SendLowWater(_connection, highwater)),
 				sessionsocket(nullptr), state(State::Connecting) {}
 			~SessionControlBlock() = default;
 
@@ -169,21 +453,209 @@ private:
 			SessionControlBlock& operator=(const SessionControlBlock&) = delete;
 			SessionControlBlock& operator=(SessionControlBlock&&) = delete;
 
+			// Configuration parsing functions (zero return values indicate timer is disabled)
+			_Check_return_ static Protocol SessionProtocol(const std::shared_ptr<Connection>& connection) noexcept;
+			_Check_return_ static int KeepAliveInterval(const std::shared_ptr<Connection>& connection);
+			_Check_return_ static int IdleTimeout(const std::shared_ptr<Connection>& connection);
+			_Check_return_ static std::chrono::microseconds CoalesceDelay(const std::shared_ptr<Connection>& connection);
+			_Check_return_ static size_t CoalesceBytes(const std::shared_ptr<Connection>& connection);
+			_Check_return_ static size_t SendHighWater(const std::shared_ptr<Connection>& connection);
+			_Check_return_ static size_t SendLowWater(const std::shared_ptr<Connection>& connection, size_t highwater);
+
+			// Output functions for asynchronous sessions (sendlock must be held by caller)
+			_Check_return_ SocketOps::Result WriteOutput(_In_reads_(Count) const WSABUF* Buffers, size_t Count);
+			_Check_return_ SocketOps::Result FlushOutput();
+			_Check_return_ SocketOps::Result WriteBacklog();
+			void UpdateOutputState() noexcept;
+
+			// In-process link functions: WriteLoopback writes held output then buffers (sendlock must be held by caller),
+			// ReadLoopback and LoopbackReady are called from owning thread only
+			_Check_return_ SocketOps::Result WriteLoopback(_In_reads_(Count) const WSABUF* Buffers, size_t Count);
+			_Check_return_ size_t ReadLoopback(_Out_writes_(MaxBytes) char* Tgt, size_t MaxBytes);
+			_Check_return_ bool LoopbackReady() noexcept;
+
 			// Const members, set at construction
 			const std::weak_ptr<CommsClient> client;
 			const std::shared_ptr<Connection> connection;
 			const ListenerTicket listener; // Ticket of listener accepting this connection, if inbound
+			const Protocol protocol;	// Protocol of data exchanged on session (packets, unless connection has Http flag)
+			const int keepalive;	// Time after last send at which keepalive packet is sent (zero if disabled)
+			const int idletimeout;	// Time after last receive at which session is closed (zero if disabled)
+			const std::chrono::microseconds coalescedelay;	// Maximum time queued output waits for owning thread
+			const size_t coalescemax;						// Queued output size at which sender writes immediately
+			const size_t highwater;	// Held output size at which session is blocked for further sends
+			const size_t lowwater;	// Held output size at which blocked session is released
 
 			// Processing members
-			SocketOps::SessionSocketPtr sessionsocket;	// Handler for session socket
+			SocketOps::SessionSocketPtr sessionsocket;	// Handler for session socket (null for in-process sessions)
+			std::shared_ptr<LoopbackLink> loopback;		// Link to peer session (in-process and shared-memory sessions)
+			size_t loopend = 0;							// End of link held by this session (as above)
+			DnsResolver::LookupPtr lookup;	// Remote name lookup, until connection started (see ConnectResolved)
+			std::unique_ptr<SocketOps::ConnectRace> race;	// Attempts to resolved addresses, until one connects
 			SteadyClock conntimeoutat;	// Time at which connection polling should abort, if async connect
-			State state;				// Current state of session
+			std::atomic<State> state;	// Current state of session (updated without table lock - see SlotTable)
 			std::timed_mutex synclock;	// Lock for sychronous send/receive operations
+			std::mutex sendlock;		// Lock for writes to asynchronous session socket (and output members below)
+			std::atomic_bool sent{false};	// Data written to session since comms thread last checked keepalive timer
+			std::atomic<CommThread*> owner{nullptr};	// Comms thread which owns session (null for sync data sessions)
+			std::atomic_bool writepending{false};	// Backlog holds output awaiting socket writability
+			std::atomic_bool blocked{false};		// Held output has reached high watermark (not yet back to low)
+			std::atomic<size_t> held{0};			// Held plus queued output size (as of last update, for statistics)
+
+			// Statistics members (see GetStats)
+			TrafficCounters traffic;
+			std::atomic<long long> lastreadms{0};	// Steady clock timestamp of last inbound data (zero until opened)
+			std::atomic<long long> lastsendms{0};	// Steady clock timestamp of last outbound data (zero until opened)
+			std::atomic<unsigned int> connectattempts{0};	// Connection attempts started (outbound sessions only)
+
+			// Drain members (see StartDrain)
+			std::atomic<long long> draindue{0};		// Steady clock timestamp at which session closes (zero if not draining)
+			std::atomic<size_t> drainbatch{0};		// Maximum drained sessions closed per wakeup (zero defers until set)
+			std::atomic<int> exchanges{0};			// Exchanges in flight (see MarkExchange)
+
+			// Output members (accessed under sendlock; outbuf for Coalesce flag only)
+			SocketOps::SendBuffer backlog;	// Output not yet accepted by (nonblocking) socket
+			std::vector<char> outbuf;	// Queued packets, including headers
+			std::chrono::steady_clock::time_point flushdue;	// Time by which owning thread should write queued packets
+			bool flushqueued = false;	// Session is on owning thread's flush list
+		};
+		// Table of active sessions, indexed by ticket (lock-free allocation and lookup; sync data sessions are stored in
+		// same table, and identified by SyncData flag on their connection)
+		using SessionTable = SlotTable<SessionControlBlock, TICKET_INDEX_BITS, TICKET_GENERATION_BITS>;
+		SessionTable sessions;
+		// In-process listeners, by address (these are not assigned to worker threads, as there is no socket to poll)
+		std::mutex inproclock;
+		std::unordered_map<std::string, ListenerTicket> inproclisteners;
+		_Check_return_ SessionTicket ConnectInProc(
+			const std::shared_ptr<CommsClient>& client, const std::shared_ptr<Connection>& connection,
+			_Inout_opt_ std::string* LastErrString);
+		// Shared-memory links: listeners are not assigned to worker threads either, as links are accepted from their
+		// rendezvous' wait callback (see AcceptShared)
+		_Check_return_ SessionTicket ConnectShared(
+			const std::shared_ptr<CommsClient>& client, const std::shared_ptr<Connection>& connection,
+			_Inout_opt_ std::string* LastErrString);
+		static void SharedAccept(void* Context);
+		void AcceptShared(ListenerTicket ticket);
+		// Session totals: RetireSession removes session from table, then adds its counters to closed totals (of link, and
+		// of accepting listener)
+		TrafficCounters closedtraffic;						// Totals of sessions which have closed
+		std::atomic<unsigned long long> sessionsopened{0};	// Sessions opened for data exchange
+		std::atomic<unsigned long long> sessionsclosed{0};	// Sessions closed after opening
+		void RetireSession(SessionTicket ticket, SessionControlBlock& scb);
+
+		//==================================================================================================================
+		// Worker thread management
+		// - Each CommThread polls the listeners and sessions assigned to it; sharded listeners are assigned to every
+		//   thread (all threads poll the same nonblocking socket and drain pending connections in batches), other
+		//   listeners to a single thread; sessions are owned by the thread which accepted (or was assigned) them
+		struct Assignment {
+			enum class Type : int { Listener = 0, Session = 1, Flush = 2 };
+			Assignment(Type _type, unsigned int _ticket) noexcept : type(_type), ticket(_ticket) {}
+			const Type type;
+			const unsigned int ticket;
+		};
+		class CommThread : private ThreadOperator<Assignment> {
+		public:
+			// Thread management functions
+			_Check_return_ bool Start();
+			_Check_return_ bool Stop(int Timeout);
+			void Assign(Assignment::Type type, unsigned int ticket) {
+				ThreadQueueWork(type, ticket);
+				Wake();
+			}
+			// RequestFlush: Add session to this thread's flush list (directly if called from this thread, otherwise via
+			// work queue); Wake: Interrupt thread's socket wait, from any thread
+			void RequestFlush(SessionTicket ticket);
+			void Wake() noexcept;
+
+			// Public constructor/destructor
+			CommThread(CommLink& _link, Backend _backend) noexcept(false) : link(_link), backend(_backend) {}
+			~CommThread() noexcept(false) = default;
+
+			// Deleted copy/move constructors and assignment operators
+			CommThread(const CommThread&) = delete;
+			CommThread(CommThread&&) = delete;
+			CommThread& operator=(const CommThread&) = delete;
+			CommThread& operator=(CommThread&&) = delete;
+
+		private:
+			// Private definitions
+			static constexpr int POLL_INTERVAL = 50;		// Maximum time to wait on sockets before checking queue
+			static constexpr int READ_TIMEOUT = 1000;		// Maximum time to wait for remainder of packet once started
+			static constexpr size_t READ_BUFFER_SIZE = 0x10000;	// Large enough for maximum packet (two-byte length)
+			static constexpr char KEEPALIVE_PACKET[4] = {0, 0, 0, 0};	// Zero-length packet header (2 or 4 bytes sent)
+			static constexpr ULONG COMPLETION_BATCH = 64;		// Maximum completions dequeued per wakeup
+			static constexpr int LISTENER_POLL_INTERVAL = 10;	// Maximum completion wait while polling without ioevent
+			struct SessionEntry {
+				SessionTable::Ref scb;
+				bool notified = false;	// Client has been notified of connection (so must receive disconnect)
+				SteadyClock lastread;	// Time of last inbound data (or of session opening)
+				SteadyClock lastsend;	// Time of last outbound data known to this thread (or of session opening)
+				SteadyClock timerdue;	// Due time of session's live entry in timer queue (older entries are stale)
+				std::unique_ptr<OVERLAPPED> readnotify = nullptr;	// Read notification (completion port backend only)
+				bool notifypending = false;	// Read notification is queued and has not yet completed
+				bool blocknotified = false;	// Client has been notified that session is blocked (so must receive writable)
+				bool drainnotified = false;	// Client has been notified that session is draining
+				bool writeselected = false;	// Socket has selected ioevent for writability (completion port backend only)
+				std::unique_ptr<HttpParser> http = nullptr;	// Inbound message parser (HTTP sessions, created on open)
+			};
+			// SessionTimer: Timer queue entry; each open session with a keepalive or idle timeout has one live entry,
+			// rescheduled when it fires (entries for closed sessions, or superseded entries, are discarded when popped)
+			struct SessionTimer {
+				SteadyClock due;
+				SessionTicket ticket;
+				_Check_return_ bool operator>(const SessionTimer& t) const noexcept {return (due > t.due);}
+			};
+
+			// Thread execution functions
+			unsigned int ThreadExecute() override;
+			void Adopt(const Assignment& work);
+			void AcceptBatch(ListenerTicket ticket, ListenerControlBlock& lcb);
+			_Check_return_ bool PollSession(SessionEntry& entry, bool readable);
+			_Check_return_ bool ReadHttp(SessionEntry& entry);
+			_Check_return_ bool ReadLoopback(SessionEntry& entry);
+			template<typename Codec>
+			_Check_return_ static size_t MeasureLoopback(SpscRing& ring, size_t& len) noexcept;
+			void ServiceLoopbacks(std::vector<SessionEntry*>& loopbacks);
+			_Check_return_ bool WriteSession(SessionEntry& entry);
+			void ReportBackpressure(SessionEntry& entry);
+			_Check_return_ bool DrainComplete(SessionEntry& entry, size_t& drainclosed);
+			void CloseSession(SessionEntry& entry);
+			_Check_return_ int FlushPending();
+			_Check_return_ bool ArmReadNotify(SessionEntry& entry);
+			static void CALLBACK IoSignalled(PVOID Context, BOOLEAN);
+			void WaitCompletions(std::vector<WSAPOLLFD>& fds, std::vector<SessionEntry*>& writers,
+				std::vector<SessionEntry*>& ready, int timeout);
+			void RunTimers();
+			void ScheduleTimer(SessionEntry& entry);
+			_Check_return_ bool SessionTimerDue(SessionEntry& entry, const SteadyClock& now);
+
+			// Private members
+			static thread_local CommThread* current;			// Comms thread running on calling thread, if any
+			CommLink& link;
+			const Backend backend;
+			HANDLE completionport = nullptr;					// Completion port (if backend is CompletionPort)
+			HANDLE ioevent = nullptr;							// Signalled by ready listeners and held-output sockets
+			HANDLE iowait = nullptr;							// Registered wait on ioevent, waking thread
+			bool iopolled = false;								// A socket failed to select ioevent (so is polled)
+			SocketOps::WakeSocket wakesocket;					// Interrupts WSAPoll wait (if backend is Poll)
+			std::vector<SessionTicket> flushlist;				// Sessions with queued output awaiting flush
+			std::vector<std::unique_ptr<OVERLAPPED>> orphans;	// Read notifications of closed sessions, until completed
+			std::vector<ListenerTable::Ref> mylisteners;		// Listeners polled by this thread
+			std::unordered_map<SessionTicket, SessionEntry> mysessions;	// Sessions owned by this thread, by ticket
+			std::priority_queue<SessionTimer, std::vector<SessionTimer>, std::greater<SessionTimer>> timers; // By due
+			std::unique_ptr<char[]> readbuf = nullptr;		// Inbound data buffer (allocated on thread start)
+			HttpMessage httpmsg;							// Inbound HTTP message (reused for each delivery)
 		};
-		std::map<SessionTicket, std::unique_ptr<SessionControlBlock>> sessions;
-		std::timed_mutex sessionslock;
-		std::map<SessionTicket, std::unique_ptr<SessionControlBlock>> syncsessions;
-		std::timed_mutex syncsessionslock;
+		std::vector<std::unique_ptr<CommThread>> threads;	// Worker threads (populated by Initialize)
+		std::atomic<size_t> nextthread{0};					// Round-robin counter for unsharded assignments
+		void AssignToThread(Assignment::Type type, unsigned int ticket, bool allthreads);
+
+		//==================================================================================================================
+		// Outbound connection pool (pre-connected sockets for connections with Pooled flag, see ConnectionPool), and
+		// resolver for remote host names (so that outbound connections never wait on name server, see DnsResolver)
+		DnsResolver resolver;
+		ConnectionPool pool{resolver};
 	};
 
 	// Static CommLink accessor function (creates precisely one CommLink during process lifetime)
@@ -199,14 +671,30 @@ inline _Check_return_ Comms::ListenerTicket Comms::RegisterListener(
 inline Comms::Result Comms::DeregisterListener(ListenerTicket listener, int timeout) {
 	return GetCommLink().DeregisterListener(listener, timeout);
 }
+inline _Check_return_ Comms::Result Comms::GetListenerStats(ListenerTicket listener, ListenerStats& stats) {
+	return GetCommLink().GetListenerStats(listener, stats);
+}
 inline _Check_return_ Comms::SessionTicket Comms::RequestConnect(
 	const std::shared_ptr<CommsClient>& client, const std::shared_ptr<Connection>& connection,
 	_Inout_opt_ std::string* LastErrString) {
 	return GetCommLink().RequestConnect(client, connection, LastErrString);
 }
+inline Comms::Result Comms::PreparePool(const std::shared_ptr<Connection>& connection) {
+	return GetCommLink().PreparePool(connection);
+}
+inline _Check_return_ Comms::Result Comms::GetPoolStats(
+	const std::shared_ptr<Connection>& connection, ConnectionPool::PoolStats& stats) {
+	return GetCommLink().GetPoolStats(connection, stats);
+}
 inline _Check_return_ Comms::Result Comms::Send(SessionTicket session, _In_reads_(len) const char* buf, size_t len) {
 	return GetCommLink().Send(session, buf, len);
 }
+inline _Check_return_ Comms::Result Comms::Send(SessionTicket session, gsl::span<const gsl::span<const char>> pieces) {
+	return GetCommLink().Send(session, pieces);
+}
+inline _Check_return_ Comms::Result Comms::Flush(SessionTicket session) {
+	return GetCommLink().Flush(session);
+}
 inline _Check_return_ Comms::Result Comms::SendAndReceive(SessionTicket session,
 	_In_reads_(len) const char* buf, size_t len, // Outbound data to be delivered
 	_Out_writes_(MaxBytes) char* Tgt, size_t MaxBytes, size_t& BytesRead, // Destination for inbound response
@@ -216,23 +704,23 @@ inline _Check_return_ Comms::Result Comms::SendAndReceive(SessionTicket session,
 inline Comms::Result Comms::Disconnect(SessionTicket session) {
 	return GetCommLink().Disconnect(session);
 }
-
-inline _Check_return_ Comms::SessionTicket Comms::CommLink::GetSessionTicket() {
-	// Lock access to available SessionTicket container and acquire ticket:
-	auto lock = Locks::Acquire(sessionticketlock);
-	if(lock.IsLocked()) {
-		if(sessiontickets.empty()) {
-			// No tickets available - add up to 1000 new ticket values, stopping at max
-			for(short s = 0; s < 1000 && sessionticketmax < SESSION_TICKET_MAX; ++s)
-				sessiontickets.push_back(++sessionticketmax);
-		}
-		if(sessiontickets.empty() == false) {
-			const SessionTicket ticket = sessiontickets.front();
-			sessiontickets.pop_front();
-			return ticket;
-		}
-	}
-	throw FORMAT_RUNTIME_ERROR("Failed to acquire ticket");
+inline Comms::Result Comms::DrainListener(ListenerTicket listener, int deadline, size_t batch) {
+	return GetCommLink().DrainListener(listener, deadline, batch);
+}
+inline Comms::Result Comms::DrainSession(SessionTicket session, int deadline) {
+	return GetCommLink().DrainSession(session, deadline);
+}
+inline Comms::Result Comms::BeginExchange(SessionTicket session) {
+	return GetCommLink().MarkExchange(session, true);
+}
+inline Comms::Result Comms::EndExchange(SessionTicket session) {
+	return GetCommLink().MarkExchange(session, false);
+}
+inline _Check_return_ Comms::Result Comms::GetStats(SessionTicket session, SessionStats& stats) {
+	return GetCommLink().GetStats(session, stats);
+}
+inline void Comms::GetAggregateStats(AggregateStats& stats) {
+	GetCommLink().GetAggregateStats(stats);
 }
 
 }; // (end namespace FIQCPPBASE)
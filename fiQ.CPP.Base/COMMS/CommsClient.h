@@ -3,6 +3,8 @@
 // CommsClient.h : Defines interface for an object wishing to register itself with comms library
 //==========================================================================================================================
 
+#include "Comms/HttpCodec.h"
+
 namespace FIQCPPBASE {
 
 //==========================================================================================================================
@@ -12,10 +14,35 @@ class CommsClient : public std::enable_shared_from_this<CommsClient>
 public:
 
 	//======================================================================================================================
-	// Pure virtual function definitions - comms event handlers
-	virtual void IBConnect() noexcept(false) = 0;
-	virtual void IBData() noexcept(false) = 0;
-	virtual void IBDisconnect() noexcept(false) = 0;
+	// Pure virtual function definitions - comms event handlers (called from comms worker threads)
+	// - Session value is the ticket of the session raising the event (inbound sessions are assigned a ticket on accept)
+	// - IBData buffer is valid only for the duration of the call
+	virtual void IBConnect(unsigned int session) noexcept(false) = 0;
+	virtual void IBData(unsigned int session, _In_reads_(len) const char* buf, size_t len) noexcept(false) = 0;
+	virtual void IBDisconnect(unsigned int session) noexcept(false) = 0;
+
+	//======================================================================================================================
+	// Virtual function definitions - inbound HTTP message handler (called from comms worker threads)
+	// - Raised for each complete request (inbound sessions) or response (outbound sessions) on connections with Http
+	//   flag; message fields are valid only for the duration of the call
+	// - Default implementation delivers message body (if any) to IBData
+	virtual void IBHttp(unsigned int session, const HttpMessage& message) noexcept(false) {
+		if(message.Body.Empty() == false) IBData(session, message.Body.data, message.Body.len);
+	}
+
+	//======================================================================================================================
+	// Virtual function definitions - outbound backpressure handlers (called from comms worker threads; default ignores)
+	// - OBWriteBlocked is raised when session's held output reaches its high watermark (further sends are rejected with
+	//   QueueFull), and OBWritable once it has drained to its low watermark (see Comms::Send)
+	virtual void OBWriteBlocked(unsigned int) noexcept(false) {}
+	virtual void OBWritable(unsigned int) noexcept(false) {}
+
+	//======================================================================================================================
+	// Virtual function definitions - drain handler (called from comms worker threads; default ignores)
+	// - IBDraining is raised once when session starts draining (see Comms::DrainListener): client should complete any
+	//   exchange in progress without starting new ones, as session is closed once no exchange is in flight (as marked
+	//   by Comms::BeginExchange and EndExchange)
+	virtual void IBDraining(unsigned int) noexcept(false) {}
 
 	//======================================================================================================================
 	// Public accessors
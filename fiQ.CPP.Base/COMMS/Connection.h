@@ -11,12 +11,17 @@ namespace FIQCPPBASE {
 // Public definitions - Behaviour flags with overloaded operators for binary flag operations
 enum class CommFlags : unsigned short {
 	None			= 0x0000,	// Default/empty flag value
-	AppKeepAlive	= 0x0001,	// Send zero-length (header only) packet periodically to ensure session is live
+	AppKeepAlive	= 0x0001,	// Send zero-length (header only) packet when session is idle, to ensure it is live
 	ExtendedHeader	= 0x0002,	// Packets using extended 4-byte header (2 length bytes, 2 control bytes)
 	Raw				= 0x0004,	// Do not use packet headers (allow caller to directly read/write raw data)
+	ShardedListen	= 0x0008,	// Listener is polled and drained by all comms threads (rather than a single thread)
 	TraceOn			= 0x0010,	// Enable tracing on this connection
+	Pooled			= 0x0020,	// Outbound connections leased from (and pre-connected by) connection pool
+	Coalesce		= 0x0040,	// Queue outbound packets and deliver in combined writes (see Comms::Send)
+	Http			= 0x0080,	// Sessions exchange HTTP/1.1 messages rather than packets (see Comms::Protocol)
 	SyncConnect		= 0x0100,	// Outbound connection requests should be performed synchronously
-	SyncData		= 0x0200	// Data read/write will be performed as a synchronous operation
+	SyncData		= 0x0200,	// Data read/write will be performed as a synchronous operation
+	RaceConnect		= 0x0400	// Async outbound connections race all resolved addresses (see SocketOps::ConnectRace)
 };
 inline constexpr CommFlags operator|(CommFlags a, CommFlags b) noexcept {
 	using CommFlagsType = std::underlying_type_t<CommFlags>;
@@ -42,8 +47,28 @@ public:
 
 	//======================================================================================================================
 	// External accessor functions
-	_Check_return_ bool IsValidClient() const noexcept {return (!address.empty() && ValueOps::Is(port).InRange(1, 0x7FFF));}
-	_Check_return_ bool IsValidServer() const noexcept {return (address.empty() && ValueOps::Is(port).InRange(1, 0x7FFF));}
+	_Check_return_ bool IsValidClient() const noexcept {
+		return (IsInProc() || IsShm() || IsUnix() || (!address.empty() && ValueOps::Is(port).InRange(1, 0x7FFF)));
+	}
+	_Check_return_ bool IsValidServer() const noexcept {
+		return (IsInProc() || IsShm() || IsUnix() || (address.empty() && ValueOps::Is(port).InRange(1, 0x7FFF)));
+	}
+	// IsInProc: Connection refers to an in-process listener ("inproc://NAME" address, used by listener and connector)
+	_Check_return_ bool IsInProc() const noexcept {
+		return (address.size() > INPROC_PREFIX_LEN && address.compare(0, INPROC_PREFIX_LEN, INPROC_PREFIX) == 0);
+	}
+	// IsShm: Connection refers to a shared-memory listener in another process on this host ("shm://NAME" address, used
+	// by listener and connector; see SharedRing)
+	_Check_return_ bool IsShm() const noexcept {
+		return (address.size() > SHM_PREFIX_LEN && address.compare(0, SHM_PREFIX_LEN, SHM_PREFIX) == 0);
+	}
+	// GetShmName: Shared-memory link name, following "shm://" prefix (valid only if IsShm)
+	_Check_return_ const char* GetShmName() const noexcept {return address.c_str() + SHM_PREFIX_LEN;}
+	// IsUnix: Connection refers to a unix domain socket on this host ("unix:PATH" address, used by listener and connector;
+	// see SocketOps::IsUnixAddress)
+	_Check_return_ bool IsUnix() const noexcept {
+		return (address.size() > UNIX_PREFIX_LEN && address.compare(0, UNIX_PREFIX_LEN, UNIX_PREFIX) == 0);
+	}
 	_Check_return_ const std::string& GetRemoteAddress() const noexcept {return address;}
 	_Check_return_ unsigned short GetRemotePort() const noexcept {return (address.empty() ? 0 : port);}
 	_Check_return_ unsigned short GetLocalPort() const noexcept {return (address.empty() ? port : 0);}
@@ -60,6 +85,7 @@ public:
 	Connection& SetRemote(S&& _address, I _port); // Specify remote address and port
 	Connection& SetRemote(const std::string& _address); // Specify remote address and port in "ADDR:PORT" format
 	Connection& SetLocal(unsigned short _port) noexcept; // Specify local listening port number
+	Connection& SetLocal(const std::string& _address); // Specify local listener address ("inproc:", "shm:" or "unix:")
 	Connection& SetFlags(CommFlags _cflags) noexcept; // Set all flags
 	Connection& SetFlagOn(CommFlags _cflags) noexcept; // Enable specific flag(s)
 	template<typename T, std::enable_if_t<std::is_same_v<std::decay_t<T>, ConfigParms>, int> = 0>
@@ -83,6 +109,14 @@ private:
 	// Static accessor to produce persistent invalid field value:
 	_Check_return_ static const std::string& EMPTYSTR() noexcept;
 
+	// Address prefixes identifying in-process, shared-memory and unix domain links:
+	static constexpr char INPROC_PREFIX[] = "inproc://";
+	static constexpr size_t INPROC_PREFIX_LEN = sizeof(INPROC_PREFIX) - 1;
+	static constexpr char SHM_PREFIX[] = "shm://";
+	static constexpr size_t SHM_PREFIX_LEN = sizeof(SHM_PREFIX) - 1;
+	static constexpr char UNIX_PREFIX[] = "unix:";
+	static constexpr size_t UNIX_PREFIX_LEN = sizeof(UNIX_PREFIX) - 1;
+
 	// Private configuration variables
 	std::string address;		// Remote address if connecting outbound, blank if listening
 	unsigned short port = 0;	// Remote port if connecting out, local if listening
@@ -124,10 +158,14 @@ inline Connection& Connection::SetRemote(S&& _address, I _port) {
 	}
 	return *this;
 }
-// Connection::SetRemote (string only): For outgoing connections, specify remote address and port (in "ADDR:PORT" format)
+// Connection::SetRemote (string only): For outgoing connections, specify remote address and port (in "ADDR:PORT" format),
+// or address of in-process, shared-memory or unix domain listener (in "inproc://NAME", "shm://NAME" or "unix:PATH" format)
 inline Connection& Connection::SetRemote(const std::string& _address) {
 	address.clear();
 	port = 0;
+	if(_address.compare(0, INPROC_PREFIX_LEN, INPROC_PREFIX) == 0 || _address.compare(0, SHM_PREFIX_LEN, SHM_PREFIX) == 0
+		|| _address.compare(0, UNIX_PREFIX_LEN, UNIX_PREFIX) == 0)
+		return SetLocal(_address); // Same address on both sides of link
 	const std::string::size_type st = _address.find(':');
 	if((st == std::string::npos) ? false : ValueOps::Is(st).InRange(1, _address.size() - 1)) {
 		const int iport = atoi(_address.c_str() + st + 1);
@@ -144,6 +182,19 @@ inline Connection& Connection::SetLocal(unsigned short _port) noexcept {
 	port = _port;
 	return *this;
 }
+// Connection::SetLocal (string): For in-process, shared-memory or unix domain listeners, specify address (in
+// "inproc://NAME", "shm://NAME" or "unix:PATH" format)
+inline Connection& Connection::SetLocal(const std::string& _address) {
+	address.clear();
+	port = 0;
+	if(_address.size() > INPROC_PREFIX_LEN && _address.compare(0, INPROC_PREFIX_LEN, INPROC_PREFIX) == 0)
+		address = _address;
+	else if(_address.size() > SHM_PREFIX_LEN && _address.compare(0, SHM_PREFIX_LEN, SHM_PREFIX) == 0)
+		address = _address;
+	else if(_address.size() > UNIX_PREFIX_LEN && _address.compare(0, UNIX_PREFIX_LEN, UNIX_PREFIX) == 0)
+		address = _address;
+	return *this;
+}
 inline Connection& Connection::SetFlags(CommFlags _cflags) noexcept {
 	cflags = _cflags;
 	return *this;
@@ -202,9 +253,14 @@ inline Connection& Connection::ReadConfig(const Tokenizer& toks) {
 			else if(_stricmp(toks.Value(s), "APPKEEPALIVE") == 0) cflags |= CommFlags::AppKeepAlive;
 			else if(_stricmp(toks.Value(s), "EXTHEADER") == 0) cflags |= CommFlags::ExtendedHeader;
 			else if(_stricmp(toks.Value(s), "RAW") == 0) cflags |= CommFlags::Raw;
+			else if(_stricmp(toks.Value(s), "SHARDED") == 0) cflags |= CommFlags::ShardedListen;
 			else if(_stricmp(toks.Value(s), "TRACEON") == 0) cflags |= CommFlags::TraceOn;
+			else if(_stricmp(toks.Value(s), "POOLED") == 0) cflags |= CommFlags::Pooled;
+			else if(_stricmp(toks.Value(s), "COALESCE") == 0) cflags |= CommFlags::Coalesce;
+			else if(_stricmp(toks.Value(s), "HTTP") == 0) cflags |= CommFlags::Http;
 			else if(_stricmp(toks.Value(s), "SYNCCONN") == 0) cflags |= CommFlags::SyncConnect;
 			else if(_stricmp(toks.Value(s), "SYNCDATA") == 0) cflags |= CommFlags::SyncData;
+			else if(_stricmp(toks.Value(s), "RACE") == 0) cflags |= CommFlags::RaceConnect;
 			// ...ignore any other (unrecognized) flag values
 		}
 	}
@@ -0,0 +1,235 @@
+//==========================================================================================================================
+// ConnectionPool.cpp : Pool of pre-connected outbound sockets, maintained per remote endpoint
+//==========================================================================================================================
+#include "pch.h"
+#include "ConnectionPool.h"
+using namespace FIQCPPBASE;
+
+//==========================================================================================================================
+// ConnectionPool::Stop: Stop worker thread and close all pooled sockets
+void ConnectionPool::Stop() {
+	if(ThreadWaitStop(2500) == false) LogSink::StdErrLog("WARNING: Connection pool thread not stopped cleanly");
+	auto lock = Locks::Acquire(endpointslock);
+	if(lock.IsLocked()) endpoints.clear();
+}
+// ConnectionPool::Prepare: Create endpoint for connection (if not already present), so that worker thread will begin
+// pre-connecting sockets before first lease
+void ConnectionPool::Prepare(const Connection& connection) {
+	if(FindEndpoint(connection, true).get() != nullptr) ThreadFlagEvent();
+}
+// ConnectionPool::Lease: Hand over most recently idled socket for connection's endpoint, if any (null if none available)
+_Check_return_ SocketOps::SessionSocketPtr ConnectionPool::Lease(const Connection& connection) {
+	SocketOps::SessionSocketPtr ss(nullptr);
+	const std::shared_ptr<Endpoint> ep = FindEndpoint(connection, true);
+	if(ep.get() == nullptr) return ss;
+
+	// Take sockets from back of idle queue (warmest first); discard any socket which has become readable while idle, as
+	// this indicates remote has closed session (or sent unsolicited data, which would corrupt leaseholder's stream) -
+	// each socket is checked after releasing lock, so that other threads are not held up by the poll:
+	for(;;) {
+		{auto lock = Locks::Acquire(ep->idlelock);
+		if(lock.IsLocked() == false || ep->idle.empty()) break;
+		ss = std::move(ep->idle.back().ss);
+		ep->idle.pop_back();
+		--ep->idlecount;}
+		if(SocketOps::ResultTimeout(ss->WaitEvent(0))) break;
+		ss.reset();
+		++ep->evicted;
+	}
+
+	// Update statistics; on miss, record demand and wake worker thread to start replacement connections:
+	if(ss.get()) ++ep->leased;
+	else {
+		++ep->missed;
+		++ep->demand;
+		ThreadFlagEvent();
+	}
+	return ss;
+}
+// ConnectionPool::GetStats: Retrieve snapshot of pool state for connection's endpoint (false if no endpoint exists)
+_Check_return_ bool ConnectionPool::GetStats(const Connection& connection, PoolStats& stats) {
+	stats = PoolStats{};
+	const std::shared_ptr<Endpoint> ep = FindEndpoint(connection, false);
+	if(ep.get() == nullptr) return false;
+	stats.Idle = ep->idlecount.load();
+	stats.Connecting = ep->connectingcount.load();
+	stats.Leased = ep->leased.load();
+	stats.Missed = ep->missed.load();
+	stats.Failed = ep->failed.load();
+	stats.Evicted = ep->evicted.load();
+	return true;
+}
+
+//==========================================================================================================================
+// ConnectionPool::Endpoint::Endpoint: Read endpoint identity and pool sizing from connection configuration
+ConnectionPool::Endpoint::Endpoint(const Connection& connection) noexcept(false)
+	: address(connection.GetRemoteAddress()), port(connection.GetRemotePort()),
+	tlsmethod(connection.GetConfigParm("TLSMETHOD")),
+	minidle(connection.GetConfigParm("POOLMIN").empty() ? POOL_MIN_DEFAULT
+		: static_cast<size_t>(ValueOps::Bounded(0, atoi(connection.GetConfigParm("POOLMIN").c_str()),
+			static_cast<int>(POOL_MAX_LIMIT)))),
+	maxidle((std::max)(minidle, connection.GetConfigParm("POOLMAX").empty() ? POOL_MAX_DEFAULT
+		: static_cast<size_t>(ValueOps::Bounded(1, atoi(connection.GetConfigParm("POOLMAX").c_str()),
+			static_cast<int>(POOL_MAX_LIMIT))))),
+	idletimeout(connection.GetConfigParm("POOLIDLE").empty() ? POOL_IDLE_DEFAULT
+		: ValueOps::MinZero(atoi(connection.GetConfigParm("POOLIDLE").c_str()))),
+	conntimeout(connection.GetConfigParm("CONNTIMEOUT").empty() ? CONNECT_TIMEOUT_DEFAULT
+		: ValueOps::MinZero(atoi(connection.GetConfigParm("CONNTIMEOUT").c_str()))),
+	idlelock(true) {}
+
+//==========================================================================================================================
+// ConnectionPool::ThreadExecute: Periodically (or when woken by lease miss) maintain all endpoints
+unsigned int ConnectionPool::ThreadExecute() {
+	LOG_FROM_TEMPLATE(LogLevel::Debug, "Connection pool thread started");
+	std::vector<std::shared_ptr<Endpoint>> eps;
+	while(ThreadShouldRun()) {
+		ThreadWaitEvent(MAINTENANCE_INTERVAL);
+		ThreadClearEventFlag();
+
+		// Take snapshot of current endpoints (endpoints are never removed, so this only needs to be done under lock to
+		// guard against concurrent insertion):
+		eps.clear();
+		{auto lock = Locks::Acquire(endpointslock);
+		if(lock.IsLocked()) for(const auto& ep : endpoints) eps.push_back(ep.second);}
+
+		for(const auto& ep : eps) {
+			if(ThreadShouldRun() == false) break;
+			try {Maintain(*ep);}
+			catch(const std::exception& e) {
+				const auto exceptioncontext = Exceptions::UnrollException(e);
+				LOG_FROM_TEMPLATE_CONTEXT(LogLevel::Error, &exceptioncontext, "Exception maintaining pool for {:S20}:{:D}",
+					ep->address.c_str(), ep->port);
+			}
+		}
+	}
+	eps.clear();
+	LOG_FROM_TEMPLATE(LogLevel::Debug, "Connection pool thread stopped");
+	return 0;
+}
+// ConnectionPool::Maintain: Complete pending connections, health-check and evict idle sockets, start new connections
+void ConnectionPool::Maintain(Endpoint& ep) {
+	const SteadyClock now;
+
+	// Poll pending connections; move completed connections to idle queue (unless already at maximum), discard failures:
+	for(auto seek = ep.connecting.begin(); seek != ep.connecting.end();) {
+		const SocketOps::Result rc = seek->ss->PollConnect(0, ep.tlsmethod);
+		if(SocketOps::ResultOK(rc) && seek->ss->Valid()) {
+			auto lock = Locks::Acquire(ep.idlelock);
+			if(lock.IsLocked() && ep.idle.size() < ep.maxidle) {
+				ep.idle.push_back(Endpoint::IdleSocket{
+					std::move(seek->ss), now, now + std::chrono::milliseconds(HEALTH_CHECK_INTERVAL)});
+				++ep.idlecount;
+			}
+		}
+		else if(SocketOps::ResultFailed(rc) || seek->timeoutat <= now) {
+			++ep.failed;
+			ep.retryat = now + std::chrono::milliseconds(RETRY_INTERVAL);
+			LOG_FROM_TEMPLATE(LogLevel::Warn, "Pooled connection to {:S20}:{:D} failed: {:S60}", ep.address.c_str(),
+				ep.port, SocketOps::ResultFailed(rc) ? seek->ss->GetLastErrString().c_str() : "Timed out");
+		}
+		else { // Still in progress
+			++seek;
+			continue;
+		}
+		seek = ep.connecting.erase(seek);
+		--ep.connectingcount;
+	}
+
+	// Check idle sockets, oldest first: take out sockets beyond minimum count which have exceeded idle timeout, and any
+	// socket due for health check (evicted sockets are closed, and checked sockets polled, below, after releasing lock,
+	// so that leasing threads are not held up):
+	checks.clear();
+	evictions.clear();
+	{auto lock = Locks::Acquire(ep.idlelock);
+	if(lock.IsLocked()) {
+		for(auto seek = ep.idle.begin(); seek != ep.idle.end();) {
+			if(ep.idle.size() + checks.size() > ep.minidle && now.MSecSince(seek->idlesince) > ep.idletimeout) {
+				evictions.push_back(std::move(*seek));
+				++ep.evicted;
+			}
+			else if(seek->checkat <= now) checks.push_back(std::move(*seek));
+			else {
+				++seek;
+				continue;
+			}
+			seek = ep.idle.erase(seek);
+			--ep.idlecount;
+		}
+	}}
+	evictions.clear();
+
+	// Evict checked sockets which have become readable (remote has closed session) or failed, and return the rest to
+	// idle queue in their original order (by time of becoming idle):
+	for(auto& check : checks) {
+		if(SocketOps::ResultTimeout(check.ss->WaitEvent(0))) {
+			check.checkat = now + std::chrono::milliseconds(HEALTH_CHECK_INTERVAL);
+		}
+		else {
+			check.ss.reset();
+			++ep.evicted;
+		}
+	}
+	{auto lock = Locks::Acquire(ep.idlelock);
+	if(lock.IsLocked()) {
+		for(auto& check : checks) {
+			if(check.ss.get() == nullptr) continue;
+			const auto pos = std::upper_bound(ep.idle.begin(), ep.idle.end(), check,
+				[](const Endpoint::IdleSocket& a, const Endpoint::IdleSocket& b) {return (a.idlesince < b.idlesince);});
+			ep.idle.insert(pos, std::move(check));
+			++ep.idlecount;
+		}
+	}}
+	checks.clear();
+
+	// Start new connections to bring pool up to target size (minimum idle count, raised by any recent lease misses up to
+	// maximum), unless waiting to retry after a failure:
+	const size_t target = (std::min)(ep.maxidle, ep.minidle + ep.demand.exchange(0));
+	if(ep.retryat > now || ep.idlecount + ep.connecting.size() >= target) return;
+
+	// Resolve remote address (address literals, and names with cached results, are resolved immediately), leaving any
+	// lookup still in progress to be checked on next pass; lookup is released once used, so that the next connections
+	// started take a fresh result once the cached one expires:
+	if(ep.lookup.get() == nullptr) ep.lookup = resolver.Resolve(ep.address);
+	if(ep.lookup->Complete() == false) return;
+	const DnsResolver::LookupPtr resolved = std::move(ep.lookup);
+	const std::vector<std::string>& addresses = resolved->GetAddresses();
+	if(addresses.empty()) {
+		++ep.failed;
+		ep.retryat = now + std::chrono::milliseconds(RETRY_INTERVAL);
+		LOG_FROM_TEMPLATE(LogLevel::Warn, "Pooled connection to {:S20}:{:D} failed: {:S60}", ep.address.c_str(),
+			ep.port, resolved->GetLastErrString().c_str());
+		return;
+	}
+	while(ep.idlecount + ep.connecting.size() < target) {
+		const std::string& address = addresses[ep.nextaddress++ % addresses.size()];
+		SocketOps::SessionSocketPtr ss = SocketOps::SessionSocket::StartConnect(
+			address.c_str(), ep.port, ep.tlsmethod.empty() == false);
+		if((ss.get() ? ss->SocketValid() : false) == false) {
+			++ep.failed;
+			ep.retryat = now + std::chrono::milliseconds(RETRY_INTERVAL);
+			break;
+		}
+		ep.connecting.push_back(Endpoint::PendingSocket{std::move(ss), now + std::chrono::milliseconds(ep.conntimeout)});
+		++ep.connectingcount;
+	}
+}
+
+//==========================================================================================================================
+// ConnectionPool::FindEndpoint: Look up endpoint for connection, optionally creating if not found
+_Check_return_ std::shared_ptr<ConnectionPool::Endpoint> ConnectionPool::FindEndpoint(
+	const Connection& connection, bool create) {
+	if(connection.IsValidClient() == false) return nullptr;
+	const std::string key = EndpointKey(connection);
+	auto lock = Locks::Acquire(endpointslock);
+	if(lock.IsLocked() == false) return nullptr;
+	const auto seek = endpoints.find(key);
+	if(seek != endpoints.cend()) return seek->second;
+	else if(create == false) return nullptr;
+	LOG_FROM_TEMPLATE(LogLevel::Debug, "Creating connection pool for {:S60}", key.c_str());
+	return endpoints.emplace(key, std::make_shared<Endpoint>(connection)).first->second;
+}
+// ConnectionPool::EndpointKey: Build endpoint identifier from connection remote address, port and TLS method
+_Check_return_ std::string ConnectionPool::EndpointKey(const Connection& connection) {
+	return connection.GetRemoteAddress() + ':' + std::to_string(connection.GetRemotePort())
+		+ '|' + connection.GetConfigParm("TLSMETHOD");
+}
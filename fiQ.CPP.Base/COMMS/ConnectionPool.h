@@ -0,0 +1,130 @@
+#pragma once
+//==========================================================================================================================
+// ConnectionPool.h : Pool of pre-connected outbound sockets, maintained per remote endpoint
+//==========================================================================================================================
+
+#include <map>
+#include "Comms/Connection.h"
+#include "Comms/DnsResolver.h"
+#include "Tools/SocketOps.h"
+#include "Tools/ThreadOps.h"
+
+namespace FIQCPPBASE {
+
+//==========================================================================================================================
+// ConnectionPool: Maintains warm (connected and, if required, TLS-negotiated) outbound sockets for each remote endpoint
+// - An endpoint is identified by the remote address, port and TLS method of a Connection, and is created on the first
+//   Prepare or Lease call for that Connection (taking pool sizing from its "POOLMIN", "POOLMAX" and "POOLIDLE" parameters)
+// - Remote host names are resolved through the owner's DnsResolver before connecting, with new connections spread across
+//   the resolved addresses in turn
+// - Worker thread pre-connects sockets in the background up to the minimum idle count (or further, up to the maximum,
+//   while leases are missing), health-checks idle sockets and evicts those idle beyond the idle timeout (down to minimum)
+// - Lease hands over an idle socket without performing any blocking network operation; caller takes ownership
+class ConnectionPool : private ThreadOperator<int> {
+public:
+	//======================================================================================================================
+	// Public definitions - Pool sizing defaults and limits
+	static constexpr size_t POOL_MIN_DEFAULT	= 1;
+	static constexpr size_t POOL_MAX_DEFAULT	= 8;
+	static constexpr size_t POOL_MAX_LIMIT		= 256;
+	static constexpr int POOL_IDLE_DEFAULT		= 60000;
+	static constexpr int CONNECT_TIMEOUT_DEFAULT	= 30000;	// Default "CONNTIMEOUT", shared with Comms connections
+	// PoolStats: Snapshot of pool state and counters for an endpoint
+	struct PoolStats {
+		size_t Idle = 0;					// Sockets currently ready for lease
+		size_t Connecting = 0;				// Sockets currently being connected in background
+		unsigned long long Leased = 0;		// Leases satisfied from pool
+		unsigned long long Missed = 0;		// Leases requested with no idle socket available
+		unsigned long long Failed = 0;		// Background connection attempts which failed
+		unsigned long long Evicted = 0;		// Idle sockets closed (idle timeout or failed health check)
+	};
+
+	//======================================================================================================================
+	// Pool management functions
+	_Check_return_ bool Start() {return ThreadStart();}
+	void Stop();
+	void Prepare(const Connection& connection);
+	_Check_return_ SocketOps::SessionSocketPtr Lease(const Connection& connection);
+	_Check_return_ bool GetStats(const Connection& connection, PoolStats& stats);
+
+	//======================================================================================================================
+	// Public constructor (resolver must outlive pool) and destructor
+	explicit ConnectionPool(DnsResolver& _resolver) noexcept(false) : resolver(_resolver), endpointslock(true) {}
+	~ConnectionPool() noexcept(false) = default;
+
+	// Deleted copy/move constructors and assignment operators
+	ConnectionPool(const ConnectionPool&) = delete;
+	ConnectionPool(ConnectionPool&&) = delete;
+	ConnectionPool& operator=(const ConnectionPool&) = delete;
+	ConnectionPool& operator=(ConnectionPool&&) = delete;
+
+private:
+
+	//======================================================================================================================
+	// Private definitions
+	static constexpr int MAINTENANCE_INTERVAL = 100;	// Maximum time between maintenance passes
+	static constexpr int HEALTH_CHECK_INTERVAL = 1000;	// Time between health checks of each idle socket
+	static constexpr int RETRY_INTERVAL = 1000;			// Time to wait before reconnecting after failure
+
+	//======================================================================================================================
+	// Endpoint: Pool of sockets for a single remote address, port and TLS method
+	struct Endpoint {
+		struct IdleSocket {
+			SocketOps::SessionSocketPtr ss;
+			SteadyClock idlesince;	// Time socket became idle (for idle timeout)
+			SteadyClock checkat;	// Time of next health check
+		};
+		struct PendingSocket {
+			SocketOps::SessionSocketPtr ss;
+			SteadyClock timeoutat;	// Time at which connection attempt should be abandoned
+		};
+
+		// Public constructor (read configuration from connection)
+		explicit Endpoint(const Connection& connection) noexcept(false);
+
+		// Const members, set at construction
+		const std::string address;
+		const unsigned short port;
+		const std::string tlsmethod;
+		const size_t minidle;
+		const size_t maxidle;
+		const int idletimeout;
+		const int conntimeout;
+
+		// Idle sockets (accessed by worker thread and leasing threads, under lock; most recently idle at back)
+		Locks::SpinLock idlelock;
+		std::deque<IdleSocket> idle;
+
+		// Sockets being connected, and resolution of remote address (accessed by worker thread only)
+		std::vector<PendingSocket> connecting;
+		SteadyClock retryat;
+		DnsResolver::LookupPtr lookup;	// Lookup awaiting completion before connections can be started
+		size_t nextaddress = 0;			// Index of resolved address for next connection (cycling through all)
+
+		// Statistics members (idle and connecting counts are maintained separately for lock-free reads)
+		std::atomic<size_t> idlecount{0};
+		std::atomic<size_t> connectingcount{0};
+		std::atomic<size_t> demand{0};		// Leases missed since last maintenance pass
+		std::atomic<unsigned long long> leased{0};
+		std::atomic<unsigned long long> missed{0};
+		std::atomic<unsigned long long> failed{0};
+		std::atomic<unsigned long long> evicted{0};
+	};
+
+	//======================================================================================================================
+	// Private functions
+	unsigned int ThreadExecute() override;
+	void Maintain(Endpoint& ep);
+	_Check_return_ std::shared_ptr<Endpoint> FindEndpoint(const Connection& connection, bool create);
+	_Check_return_ static std::string EndpointKey(const Connection& connection);
+
+	//======================================================================================================================
+	// Private members
+	DnsResolver& resolver;
+	Locks::SpinLock endpointslock;
+	std::map<std::string, std::shared_ptr<Endpoint>> endpoints; // Endpoints, indexed by EndpointKey (never removed)
+	std::vector<Endpoint::IdleSocket> checks; // Idle sockets being health-checked (worker thread only, see Maintain)
+	std::vector<Endpoint::IdleSocket> evictions; // Idle sockets being evicted (worker thread only, see Maintain)
+};
+
+}; // (end namespace FIQCPPBASE)
@@ -0,0 +1,177 @@
+//==========================================================================================================================
+// DnsResolver.cpp : Asynchronous host name resolution, with cache of recent results
+//==========================================================================================================================
+#include "pch.h"
+#include "DnsResolver.h"
+using namespace FIQCPPBASE;
+
+//==========================================================================================================================
+// DnsResolver::Start: Start worker threads (returns false if any failed to start, in which case none are left running)
+_Check_return_ bool DnsResolver::Start(size_t Workers) {
+	if(running) return true;
+	if(Workers < 1) Workers = 1;
+	else if(Workers > WORKERS_MAX) Workers = WORKERS_MAX;
+	for(size_t w = 0; w < Workers; ++w) {
+		workers.push_back(std::make_unique<Worker>(*this));
+		if(workers.back()->Start() == false) {
+			Stop();
+			return false;
+		}
+	}
+	running = true;
+	return true;
+}
+// DnsResolver::Stop: Stop worker threads, failing any lookups still awaiting a worker (so that no caller waits forever),
+// and discard cache
+void DnsResolver::Stop() {
+	// Clear running flag and take workers under lock, so that no Resolve call can wake a worker once they are stopping:
+	std::vector<std::unique_ptr<Worker>> stopping;
+	{auto lock = Locks::Acquire(cachelock);
+	running = false;
+	if(lock.IsLocked()) stopping.swap(workers);}
+	for(const auto& w : stopping) {
+		if(w->Stop(2500) == false) LogSink::StdErrLog("WARNING: DNS resolver thread not stopped cleanly");
+	}
+	stopping.clear();
+	std::deque<std::shared_ptr<Lookup>> abandoned;
+	{auto lock = Locks::Acquire(cachelock);
+	if(lock.IsLocked()) {
+		abandoned.swap(pending);
+		cache.clear();
+	}}
+	for(const auto& lookup : abandoned) Complete(*lookup, std::vector<std::string>(), "Resolver stopped");
+}
+// DnsResolver::Resolve: Return cached or in-progress lookup for name if available, otherwise start a new lookup
+_Check_return_ DnsResolver::LookupPtr DnsResolver::Resolve(const std::string& Name) {
+	std::shared_ptr<Lookup> lookup = std::make_shared<Lookup>(Name);
+
+	// Address literals, and requests which cannot be serviced, are completed immediately (and not cached):
+	sockaddr_storage addr = {0};
+	int addrlen = 0;
+	if(SocketOps::ParseAddress(Name.c_str(), 0, addr, addrlen)) {
+		Complete(*lookup, std::vector<std::string>{Name}, "");
+		return lookup;
+	}
+	else if(Name.empty()) {
+		Complete(*lookup, std::vector<std::string>(), "Invalid name");
+		return lookup;
+	}
+
+	// Check cache for an unexpired result or a lookup in progress; otherwise replace entry with new lookup and queue it
+	// for next available worker (purging expired entries first, if cache has grown large); running flag is checked under
+	// lock, so that no lookup can be queued after Stop has drained queue:
+	{auto lock = Locks::Acquire(cachelock);
+	if(lock.IsLocked() == false || running == false) {
+		Complete(*lookup, std::vector<std::string>(), "Resolver not started");
+		return lookup;
+	}
+	const auto seek = cache.find(Name);
+	if(seek != cache.end()) {
+		if(seek->second->Complete() == false) {
+			++merged;
+			return seek->second;
+		}
+		else if(seek->second->expiry.IsPast() == false) {
+			++cachehits;
+			return seek->second;
+		}
+		seek->second = lookup;
+	}
+	else {
+		if(cache.size() >= CACHE_SIZE_MAX) {
+			for(auto purge = cache.begin(); purge != cache.end();) {
+				if(purge->second->Complete() && purge->second->expiry.IsPast()) purge = cache.erase(purge);
+				else ++purge;
+			}
+		}
+		cache.emplace(Name, lookup);
+	}
+	pending.push_back(lookup);
+	for(const auto& w : workers) w->Wake();} // Under lock, as Stop takes workers under lock
+	++lookups;
+	return lookup;
+}
+// DnsResolver::Purge: Discard all completed lookups from cache
+void DnsResolver::Purge() {
+	auto lock = Locks::Acquire(cachelock);
+	if(lock.IsLocked() == false) return;
+	for(auto seek = cache.begin(); seek != cache.end();) {
+		if(seek->second->Complete()) seek = cache.erase(seek);
+		else ++seek;
+	}
+}
+// DnsResolver::GetStats: Retrieve snapshot of resolver counters
+void DnsResolver::GetStats(ResolverStats& stats) {
+	stats = ResolverStats{};
+	{auto lock = Locks::Acquire(cachelock);
+	if(lock.IsLocked()) stats.Cached = cache.size();}
+	stats.Lookups = lookups.load();
+	stats.CacheHits = cachehits.load();
+	stats.Merged = merged.load();
+	stats.Failed = failed.load();
+}
+
+//==========================================================================================================================
+// DnsResolver::NextPending: Remove and return next lookup awaiting a worker (null if none)
+_Check_return_ std::shared_ptr<DnsResolver::Lookup> DnsResolver::NextPending() {
+	std::shared_ptr<Lookup> lookup(nullptr);
+	auto lock = Locks::Acquire(cachelock);
+	if(lock.IsLocked() && pending.empty() == false) {
+		lookup = std::move(pending.front());
+		pending.pop_front();
+	}
+	return lookup;
+}
+// DnsResolver::Complete: Publish result of lookup, setting expiry of cached result based on outcome
+void DnsResolver::Complete(Lookup& lookup, std::vector<std::string>&& addresses, const std::string& errstring) {
+	const bool found = (addresses.empty() == false);
+	if(found == false) ++failed;
+	lookup.Finish(std::move(addresses), errstring, found ? ttl : negativettl);
+}
+// DnsResolver::Lookup::Finish: Store result and expiry, then flag completion and release any waiting callers
+void DnsResolver::Lookup::Finish(std::vector<std::string>&& _addresses, const std::string& _errstring, int ttl) {
+	addresses = std::move(_addresses);
+	if(addresses.empty()) errstring = _errstring.empty() ? std::string("No addresses found") : _errstring;
+	expiry = SteadyClock(std::chrono::milliseconds{ttl});
+	{std::lock_guard<std::mutex> lock(waitlock);
+	complete.store(true, std::memory_order_release);}
+	waitcv.notify_all();
+}
+// DnsResolver::Lookup::Wait: Wait up to Timeout milliseconds for lookup to complete (returns true if complete)
+_Check_return_ bool DnsResolver::Lookup::Wait(int Timeout) const {
+	if(Complete()) return true;
+	std::unique_lock<std::mutex> lock(waitlock);
+	return waitcv.wait_for(lock, std::chrono::milliseconds(Timeout > 0 ? Timeout : 0), [this]() {return Complete();});
+}
+
+//==========================================================================================================================
+// DnsResolver::Worker::ThreadExecute: Perform lookups from resolver's pending queue until stopped
+unsigned int DnsResolver::Worker::ThreadExecute() {
+	LOG_FROM_TEMPLATE(LogLevel::Debug, "DNS resolver thread started");
+	while(ThreadShouldRun()) {
+		ThreadWaitEvent(1000);
+		ThreadClearEventFlag();
+		// Once stop is flagged, finish current lookup only (resolver fails those still pending, see Stop):
+		for(std::shared_ptr<Lookup> lookup = resolver.NextPending(); lookup.get() != nullptr;
+			lookup = ThreadShouldRun() ? resolver.NextPending() : nullptr) {
+			std::vector<std::string> addresses;
+			std::string errstring;
+			try {
+				if(SocketOps::DNSLookup(lookup->GetName().c_str(), addresses, &errstring) == false) {
+					LOG_FROM_TEMPLATE(LogLevel::Warn, "DNS lookup failed for {:S60}: {:S60}",
+						lookup->GetName().c_str(), errstring.c_str());
+				}
+			}
+			catch(const std::exception& e) {
+				const auto exceptioncontext = Exceptions::UnrollException(e);
+				LOG_FROM_TEMPLATE_CONTEXT(LogLevel::Error, &exceptioncontext, "Exception resolving {:S60}",
+					lookup->GetName().c_str());
+				addresses.clear();
+				errstring = "Lookup failed";
+			}
+			resolver.Complete(*lookup, std::move(addresses), errstring);
+		}
+	}
+	LOG_FROM_TEMPLATE(LogLevel::Debug, "DNS resolver thread stopped");
+	return 0;
+}
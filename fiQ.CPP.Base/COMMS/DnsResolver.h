@@ -0,0 +1,132 @@
+#pragma once
+//==========================================================================================================================
+// DnsResolver.h : Asynchronous host name resolution, with cache of recent results
+//==========================================================================================================================
+
+#include <condition_variable>
+#include <unordered_map>
+#include "Tools/SocketOps.h"
+#include "Tools/ThreadOps.h"
+
+namespace FIQCPPBASE {
+
+//==========================================================================================================================
+// DnsResolver: Resolves host names to all of their IPv4 and IPv6 addresses on worker threads, so that callers never block
+// on a slow name server
+// - Resolve returns a Lookup immediately; caller polls it (Complete) or waits for it (Wait); address literals complete
+//   immediately without a lookup
+// - Completed lookups are cached for a fixed time-to-live (shorter for failures), as the system resolver does not expose
+//   record TTLs; a request for a name whose lookup is still in progress shares that lookup rather than starting another
+// - Lookups are taken from a single queue by all workers, so that a name server which is slow to answer one name only
+//   delays lookups queued behind it once every worker is waiting
+class DnsResolver {
+public:
+	//======================================================================================================================
+	// Public definitions
+	static constexpr size_t WORKERS_DEFAULT		= 2;
+	static constexpr size_t WORKERS_MAX			= 16;
+	static constexpr int TTL_DEFAULT			= 60000;	// Cache lifetime of successful lookup (milliseconds)
+	static constexpr int NEGATIVE_TTL_DEFAULT	= 5000;		// Cache lifetime of failed lookup (milliseconds)
+	static constexpr size_t CACHE_SIZE_MAX		= 4096;		// Cache size above which expired entries are purged
+	// Lookup: Resolution of a single name, shared by all callers requesting that name while in progress or cached
+	// - Addresses and error string may only be read once Complete returns true (they are not modified thereafter)
+	class Lookup {
+	public:
+		_Check_return_ bool Complete() const noexcept {return complete.load(std::memory_order_acquire);}
+		_Check_return_ bool Wait(int Timeout) const;
+		_Check_return_ bool Succeeded() const noexcept {return (Complete() && addresses.empty() == false);}
+		_Check_return_ const std::string& GetName() const noexcept {return name;}
+		_Check_return_ const std::vector<std::string>& GetAddresses() const noexcept {return addresses;}
+		_Check_return_ const std::string& GetLastErrString() const noexcept {return errstring;}
+
+		// Public constructor, destructor
+		explicit Lookup(const std::string& _name) noexcept(false) : name(_name) {}
+		~Lookup() noexcept(false) = default;
+		// Deleted copy/move constructors and assignment operators
+		Lookup(const Lookup&) = delete;
+		Lookup(Lookup&&) = delete;
+		Lookup& operator=(const Lookup&) = delete;
+		Lookup& operator=(Lookup&&) = delete;
+
+	private:
+		friend class DnsResolver;
+		void Finish(std::vector<std::string>&& _addresses, const std::string& _errstring, int ttl);
+
+		const std::string name;
+		std::atomic_bool complete{false};
+		std::vector<std::string> addresses;		// All addresses for name, in order of preference
+		std::string errstring;					// Reason for failure (if no addresses found)
+		SteadyClock expiry;						// Time at which cached result should no longer be used
+		mutable std::mutex waitlock;
+		mutable std::condition_variable waitcv;
+	};
+	using LookupPtr = std::shared_ptr<const Lookup>;
+	// ResolverStats: Snapshot of resolver counters
+	struct ResolverStats {
+		size_t Cached = 0;					// Names currently held in cache (including lookups in progress)
+		unsigned long long Lookups = 0;		// Lookups started (i.e. passed to system resolver)
+		unsigned long long CacheHits = 0;	// Requests satisfied from cache
+		unsigned long long Merged = 0;		// Requests which joined a lookup already in progress
+		unsigned long long Failed = 0;		// Lookups which returned no addresses
+	};
+
+	//======================================================================================================================
+	// Resolver management functions
+	_Check_return_ bool Start(size_t Workers = WORKERS_DEFAULT);
+	void Stop();
+	_Check_return_ LookupPtr Resolve(const std::string& Name);
+	void Purge(); // Discard all cached results (lookups in progress are unaffected)
+	void GetStats(ResolverStats& stats);
+
+	//======================================================================================================================
+	// Public constructor, destructor
+	explicit DnsResolver(int _ttl = TTL_DEFAULT, int _negativettl = NEGATIVE_TTL_DEFAULT) noexcept(false)
+		: ttl(_ttl), negativettl(_negativettl), cachelock(true) {}
+	~DnsResolver() noexcept(false) = default;
+	// Deleted copy/move constructors and assignment operators
+	DnsResolver(const DnsResolver&) = delete;
+	DnsResolver(DnsResolver&&) = delete;
+	DnsResolver& operator=(const DnsResolver&) = delete;
+	DnsResolver& operator=(DnsResolver&&) = delete;
+
+private:
+
+	//======================================================================================================================
+	// Worker: Thread performing blocking lookups, taken from resolver's pending queue
+	class Worker : private ThreadOperator<int> {
+	public:
+		_Check_return_ bool Start() {return ThreadStart();}
+		_Check_return_ bool Stop(int Timeout) {return ThreadWaitStop(Timeout);}
+		void Wake() {ThreadFlagEvent();}
+		explicit Worker(DnsResolver& _resolver) noexcept(false) : resolver(_resolver) {}
+		~Worker() noexcept(false) = default;
+		Worker(const Worker&) = delete;
+		Worker(Worker&&) = delete;
+		Worker& operator=(const Worker&) = delete;
+		Worker& operator=(Worker&&) = delete;
+	private:
+		unsigned int ThreadExecute() override;
+		DnsResolver& resolver;
+	};
+
+	//======================================================================================================================
+	// Private functions
+	_Check_return_ std::shared_ptr<Lookup> NextPending();
+	void Complete(Lookup& lookup, std::vector<std::string>&& addresses, const std::string& errstring);
+
+	//======================================================================================================================
+	// Private members
+	const int ttl;
+	const int negativettl;
+	std::vector<std::unique_ptr<Worker>> workers;	// Worker threads (populated by Start, taken by Stop under lock)
+	std::atomic_bool running{false};
+	Locks::SpinLock cachelock;						// Protects cache and pending, and workers once running
+	std::unordered_map<std::string, std::shared_ptr<Lookup>> cache;	// Lookups by name (completed or in progress)
+	std::deque<std::shared_ptr<Lookup>> pending;	// Lookups awaiting a worker
+	std::atomic<unsigned long long> lookups{0};
+	std::atomic<unsigned long long> cachehits{0};
+	std::atomic<unsigned long long> merged{0};
+	std::atomic<unsigned long long> failed{0};
+};
+
+}; // (end namespace FIQCPPBASE)
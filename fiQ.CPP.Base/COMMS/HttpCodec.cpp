@@ -0,0 +1,378 @@
+//==========================================================================================================================
+// HttpCodec.cpp : Incremental HTTP/1.1 message parser and preallocated message builder for comms sessions
+//==========================================================================================================================
+#include "pch.h"
+#include "HttpCodec.h"
+using namespace FIQCPPBASE;
+
+namespace {
+	// FindLineEnd: Return offset of CRLF terminating line beginning at "line" (within "len" bytes), or len if not found
+	_Check_return_ size_t FindLineEnd(_In_reads_(len) const char* line, size_t len) noexcept {
+		for(size_t i = 1; i < len; ++i) if(line[i] == '\n' && line[i - 1] == '\r') return i - 1;
+		return len;
+	}
+	// Trim: Remove leading and trailing whitespace (SP/HT) from view
+	_Check_return_ HttpView Trim(const char* s, const char* e) noexcept {
+		while(s < e && (*s == ' ' || *s == '\t')) ++s;
+		while(e > s && (*(e - 1) == ' ' || *(e - 1) == '\t')) --e;
+		return HttpView{s, static_cast<size_t>(e - s)};
+	}
+	// HexValue: Return value of hexadecimal digit, or -1 if invalid
+	_Check_return_ int HexValue(char c) noexcept {
+		if(c >= '0' && c <= '9') return c - '0';
+		if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+		if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+		return -1;
+	}
+	constexpr size_t LENGTH_DIGITS_MAX = 15; // Limit on decimal/hex digits in length fields (avoids overflow)
+}
+
+//==========================================================================================================================
+#pragma region HttpParser
+_Check_return_ char* HttpParser::ReadTarget(size_t& space) {
+	if(closed || start >= end) {
+		// Either nothing is buffered, or connection is closing and remaining data is to be discarded; restart at
+		// beginning of buffer (no partial message can be in progress, as it would occupy buffered data)
+		start = end = 0;
+	}
+	else if(start > 0 && buf.size() - end < READ_SIZE_MIN) {
+		// Move partial message to start of buffer to reclaim space from messages already returned:
+		memmove(buf.data(), buf.data() + start, end - start);
+		end -= start;
+		start = 0;
+	}
+	if(buf.size() - end < READ_SIZE_MIN) buf.resize(end + READ_SIZE_MIN);
+	space = buf.size() - end;
+	return buf.data() + end;
+}
+void HttpParser::Commit(size_t bytes) noexcept {
+	end = (std::min)(end + bytes, buf.size());
+}
+_Check_return_ HttpParser::Result HttpParser::Next(HttpMessage& msg) {
+	if(closed) return Result::Incomplete;
+	if(headlen == 0) {
+		// Skip any empty lines between messages, then locate end of header (continuing from end of last search):
+		if(scan == 0) while(start < end && (buf[start] == '\r' || buf[start] == '\n')) ++start;
+		const char* const head = buf.data() + start;
+		const size_t avail = end - start;
+		size_t i = (std::max)(scan, static_cast<size_t>(3));
+		for(; i < avail; ++i) {
+			if(head[i] == '\n' && head[i - 1] == '\r' && head[i - 2] == '\n' && head[i - 3] == '\r') break;
+		}
+		if(i >= avail) {
+			scan = avail;
+			return (avail > headermax) ? Fail("Header size exceeds maximum") : Result::Incomplete;
+		}
+		else if(i >= headermax) return Fail("Header size exceeds maximum");
+		headlen = i + 1;
+	}
+
+	// Parse header on every attempt, as buffer may have been compacted since last call (views must be refreshed):
+	char* const msgstart = buf.data() + start;
+	const size_t avail = end - start;
+	Result rc = ParseHead(msg, msgstart, headlen);
+	if(rc != Result::Complete) return rc;
+
+	// Locate body and determine total message length:
+	size_t msglen = headlen;
+	if(msg.Chunked) {
+		rc = DecodeChunks(msgstart, avail);
+		if(rc != Result::Complete) return rc;
+		msg.Body = HttpView{msgstart + headlen, chunkout};
+		msglen = chunkin;
+	}
+	else {
+		if(bodylen > bodymax) return Fail("Body size exceeds maximum");
+		else if(avail - headlen < bodylen) return Result::Incomplete;
+		msg.Body = HttpView{msgstart + headlen, bodylen};
+		msglen += bodylen;
+	}
+
+	// Message is complete; advance past it and reset per-message state:
+	start += msglen;
+	scan = headlen = bodylen = 0;
+	chunkstate = ChunkState::Size;
+	chunkin = chunkout = chunkleft = 0;
+	if(msg.KeepAlive == false) closed = true;
+	return Result::Complete;
+}
+void HttpParser::Reset() noexcept {
+	start = end = scan = headlen = bodylen = 0;
+	chunkstate = ChunkState::Size;
+	chunkin = chunkout = chunkleft = 0;
+	closed = false;
+	LastErrString.clear();
+}
+
+//==========================================================================================================================
+// HttpParser::ParseHead: Parse start line and headers (head includes terminating blank line)
+_Check_return_ HttpParser::Result HttpParser::ParseHead(HttpMessage& msg, const char* head, size_t len) {
+	msg.Method = msg.Target = msg.Reason = msg.Body = HttpView{};
+	msg.Status = 0;
+	msg.MinorVersion = 1;
+	msg.HeaderCount = 0;
+	msg.Chunked = false;
+	msg.KeepAlive = true;
+	bodylen = 0;
+	const char* const headend = head + len - 2; // Final CRLF (end of blank line)
+
+	// Parse start line, which has three space-delimited fields (reason phrase of response is optional, and may
+	// itself contain spaces):
+	const char* p = head;
+	const char* eol = p + FindLineEnd(p, headend - p + 2);
+	const char* const sp1 = static_cast<const char*>(memchr(p, ' ', eol - p));
+	if(sp1 == nullptr) return Fail("Malformed start line");
+	const char* sp2 = static_cast<const char*>(memchr(sp1 + 1, ' ', eol - sp1 - 1));
+	HttpView version;
+	if(mode == Mode::Request) {
+		if(sp2 == nullptr || sp1 == p || sp2 == sp1 + 1) return Fail("Malformed request line");
+		msg.Method = HttpView{p, static_cast<size_t>(sp1 - p)};
+		msg.Target = HttpView{sp1 + 1, static_cast<size_t>(sp2 - sp1 - 1)};
+		version = HttpView{sp2 + 1, static_cast<size_t>(eol - sp2 - 1)};
+	}
+	else {
+		if(sp2 == nullptr) sp2 = eol;
+		version = HttpView{p, static_cast<size_t>(sp1 - p)};
+		if(sp2 - sp1 - 1 != 3) return Fail("Malformed status line");
+		for(const char* d = sp1 + 1; d < sp2; ++d) {
+			if(*d < '0' || *d > '9') return Fail("Malformed status code");
+			msg.Status = msg.Status * 10 + (*d - '0');
+		}
+		if(sp2 < eol) msg.Reason = HttpView{sp2 + 1, static_cast<size_t>(eol - sp2 - 1)};
+	}
+	if(version.len != 8 || _strnicmp(version.data, "HTTP/1.", 7) != 0
+		|| version.data[7] < '0' || version.data[7] > '9') return Fail("Unsupported HTTP version");
+	msg.MinorVersion = static_cast<unsigned int>(version.data[7] - '0');
+
+	// Parse header lines, recording values of headers relevant to message framing:
+	bool haslength = false, closetoken = false, keepalivetoken = false;
+	for(p = eol + 2; p < headend; p = eol + 2) {
+		eol = p + FindLineEnd(p, headend - p + 2);
+		if(*p == ' ' || *p == '\t') return Fail("Obsolete header line folding");
+		const char* const colon = static_cast<const char*>(memchr(p, ':', eol - p));
+		if(colon == nullptr || colon == p) return Fail("Malformed header line");
+		else if(memchr(p, ' ', colon - p) || memchr(p, '\t', colon - p)) return Fail("Whitespace in header name");
+		else if(msg.HeaderCount >= HttpMessage::HEADERS_MAX) return Fail("Header count exceeds maximum");
+		HttpHeader& header = msg.Headers[msg.HeaderCount++];
+		header.Name = HttpView{p, static_cast<size_t>(colon - p)};
+		header.Value = Trim(colon + 1, eol);
+		if(header.Name.Is("Content-Length")) {
+			size_t value = 0;
+			if(header.Value.Empty() || header.Value.len > LENGTH_DIGITS_MAX) return Fail("Invalid content length");
+			for(size_t d = 0; d < header.Value.len; ++d) {
+				const char c = header.Value.data[d];
+				if(c < '0' || c > '9') return Fail("Invalid content length");
+				value = value * 10 + (c - '0');
+			}
+			if(haslength && value != bodylen) return Fail("Conflicting content lengths");
+			haslength = true;
+			bodylen = value;
+		}
+		else if(header.Name.Is("Transfer-Encoding")) {
+			if(header.Value.Is("chunked") == false) return Fail("Unsupported transfer encoding");
+			msg.Chunked = true;
+		}
+		else if(header.Name.Is("Connection")) {
+			// Value is a comma-separated list of options; check for "close" and "keep-alive" tokens only:
+			const char* t = header.Value.data;
+			const char* const vend = header.Value.data + header.Value.len;
+			while(t < vend) {
+				const char* comma = static_cast<const char*>(memchr(t, ',', vend - t));
+				if(comma == nullptr) comma = vend;
+				const HttpView token = Trim(t, comma);
+				if(token.Is("close")) closetoken = true;
+				else if(token.Is("keep-alive")) keepalivetoken = true;
+				t = comma + 1;
+			}
+		}
+	}
+
+	// Determine connection persistence (HTTP/1.0 closes unless keep-alive requested) and body framing:
+	msg.KeepAlive = (closetoken == false && (msg.MinorVersion >= 1 || keepalivetoken));
+	if(msg.Chunked) {
+		// Content length is ignored if chunked encoding is present, but such a message may be an attempt at request
+		// smuggling; it is accepted, but the connection is not reused (RFC 7230 section 3.3.3)
+		if(haslength) msg.KeepAlive = false;
+		bodylen = 0;
+	}
+	if(mode == Mode::Response) {
+		if(msg.Status < 200 || msg.Status == 204 || msg.Status == 304) {
+			msg.Chunked = false; // These responses never carry a body, regardless of headers
+			bodylen = 0;
+		}
+		else if(msg.Chunked == false && haslength == false) return Fail("Response body length not specified");
+	}
+	return Result::Complete;
+}
+
+//==========================================================================================================================
+// HttpParser::DecodeChunks: Continue decoding chunked body of current message, moving chunk data down in place so that
+// the decoded body is contiguous from end of header
+_Check_return_ HttpParser::Result HttpParser::DecodeChunks(char* msgstart, size_t avail) {
+	if(chunkin == 0) {
+		chunkin = headlen;
+		chunkout = 0;
+		chunkstate = ChunkState::Size;
+	}
+	char* const body = msgstart + headlen;
+	for(;;) {
+		// Limit total size of chunk framing and trailers, to prevent unbounded buffering:
+		if(chunkin - headlen - chunkout > bodymax + headermax) return Fail("Chunk framing exceeds maximum");
+		switch(chunkstate) {
+		case ChunkState::Size:
+		case ChunkState::Trailer:
+		{
+			const char* const line = msgstart + chunkin;
+			const size_t linelen = FindLineEnd(line, avail - chunkin);
+			if(linelen >= avail - chunkin) {
+				return (avail - chunkin > CHUNK_LINE_MAX) ? Fail("Chunk line exceeds maximum") : Result::Incomplete;
+			}
+			else if(linelen > CHUNK_LINE_MAX) return Fail("Chunk line exceeds maximum");
+			chunkin += linelen + 2;
+			if(chunkstate == ChunkState::Trailer) {
+				if(linelen == 0) chunkstate = ChunkState::Done; // Trailer fields (if any) are discarded
+				break;
+			}
+			// Parse hexadecimal chunk size, ignoring any chunk extensions:
+			size_t size = 0, digits = 0;
+			for(; digits < linelen; ++digits) {
+				const int value = HexValue(line[digits]);
+				if(value < 0) break;
+				else if(digits >= LENGTH_DIGITS_MAX) return Fail("Invalid chunk size");
+				size = size * 16 + value;
+			}
+			if(digits == 0 || (digits < linelen && line[digits] != ';' && line[digits] != ' ' && line[digits] != '\t')) {
+				return Fail("Invalid chunk size");
+			}
+			else if(size == 0) chunkstate = ChunkState::Trailer;
+			else if(chunkout + size > bodymax) return Fail("Body size exceeds maximum");
+			else {
+				chunkleft = size;
+				chunkstate = ChunkState::Data;
+			}
+			break;
+		}
+		case ChunkState::Data:
+		{
+			const size_t bytes = (std::min)(chunkleft, avail - chunkin);
+			if(bytes == 0) return Result::Incomplete;
+			if(headlen + chunkout != chunkin) memmove(body + chunkout, msgstart + chunkin, bytes);
+			chunkout += bytes;
+			chunkin += bytes;
+			chunkleft -= bytes;
+			if(chunkleft == 0) chunkstate = ChunkState::DataEnd;
+			break;
+		}
+		case ChunkState::DataEnd:
+			if(avail - chunkin < 2) return Result::Incomplete;
+			else if(msgstart[chunkin] != '\r' || msgstart[chunkin + 1] != '\n') return Fail("Malformed chunk terminator");
+			chunkin += 2;
+			chunkstate = ChunkState::Size;
+			break;
+		case ChunkState::Done:
+			return Result::Complete;
+		}
+	}
+}
+_Check_return_ HttpParser::Result HttpParser::Fail(_In_z_ const char* error) {
+	LastErrString = error;
+	return Result::Invalid;
+}
+#pragma endregion HttpParser
+
+//==========================================================================================================================
+#pragma region HttpBuilder
+HttpBuilder& HttpBuilder::Request(_In_z_ const char* method, _In_z_ const char* target) {
+	buf.clear();
+	Append(method);
+	Append(" ", 1);
+	Append(target);
+	Append(" HTTP/1.1\r\n", 11);
+	return *this;
+}
+HttpBuilder& HttpBuilder::Response(unsigned int status, _In_opt_z_ const char* reason) {
+	buf.clear();
+	Append("HTTP/1.1 ", 9);
+	AppendNumber(status);
+	Append(" ", 1);
+	Append(reason ? reason : ReasonPhrase(status));
+	Append("\r\n", 2);
+	return *this;
+}
+HttpBuilder& HttpBuilder::Header(_In_z_ const char* name, _In_z_ const char* value) {
+	Append(name);
+	Append(": ", 2);
+	Append(value);
+	Append("\r\n", 2);
+	return *this;
+}
+HttpBuilder& HttpBuilder::Header(_In_z_ const char* name, size_t value) {
+	Append(name);
+	Append(": ", 2);
+	AppendNumber(value);
+	Append("\r\n", 2);
+	return *this;
+}
+HttpBuilder& HttpBuilder::Body(_In_reads_(len) const char* data, size_t len, _In_opt_z_ const char* contenttype) {
+	if(contenttype) Header("Content-Type", contenttype);
+	Header("Content-Length", len);
+	Append("\r\n", 2);
+	if(data) Append(data, len);
+	return *this;
+}
+HttpBuilder& HttpBuilder::StartChunked(_In_opt_z_ const char* contenttype) {
+	if(contenttype) Header("Content-Type", contenttype);
+	Append("Transfer-Encoding: chunked\r\n\r\n", 30);
+	return *this;
+}
+HttpBuilder& HttpBuilder::Chunk(_In_reads_(len) const char* data, size_t len) {
+	if(len > 0) { // Zero-length chunk would terminate body, see EndChunked
+		AppendNumber(len, true);
+		Append("\r\n", 2);
+		Append(data, len);
+		Append("\r\n", 2);
+	}
+	return *this;
+}
+HttpBuilder& HttpBuilder::EndChunked() {
+	Append("0\r\n\r\n", 5);
+	return *this;
+}
+_Check_return_ const char* HttpBuilder::ReasonPhrase(unsigned int status) noexcept {
+	switch(status) {
+	case 100: return "Continue";
+	case 101: return "Switching Protocols";
+	case 200: return "OK";
+	case 201: return "Created";
+	case 202: return "Accepted";
+	case 204: return "No Content";
+	case 301: return "Moved Permanently";
+	case 302: return "Found";
+	case 304: return "Not Modified";
+	case 400: return "Bad Request";
+	case 401: return "Unauthorized";
+	case 403: return "Forbidden";
+	case 404: return "Not Found";
+	case 405: return "Method Not Allowed";
+	case 408: return "Request Timeout";
+	case 413: return "Payload Too Large";
+	case 429: return "Too Many Requests";
+	case 500: return "Internal Server Error";
+	case 501: return "Not Implemented";
+	case 502: return "Bad Gateway";
+	case 503: return "Service Unavailable";
+	case 504: return "Gateway Timeout";
+	default: return "Unknown";
+	}
+}
+void HttpBuilder::AppendNumber(size_t value, bool hex) {
+	char digits[24];
+	char* const digitsend = digits + sizeof(digits);
+	char* d = digitsend;
+	do {
+		*(--d) = "0123456789ABCDEF"[value % (hex ? 16 : 10)];
+		value /= (hex ? 16 : 10);
+	} while(value > 0);
+	Append(d, digitsend - d);
+}
+#pragma endregion HttpBuilder
@@ -0,0 +1,164 @@
+#pragma once
+//==========================================================================================================================
+// HttpCodec.h : Incremental HTTP/1.1 message parser and preallocated message builder for comms sessions
+//==========================================================================================================================
+
+namespace FIQCPPBASE {
+
+//==========================================================================================================================
+// HttpView: Reference to a run of characters within a parser's receive buffer (not null-terminated)
+// - Valid only until the parser's buffer is next written (see HttpParser::ReadTarget)
+struct HttpView {
+	const char* data = nullptr;
+	size_t len = 0;
+	_Check_return_ bool Empty() const noexcept {return (len == 0);}
+	_Check_return_ bool Is(_In_z_ const char* s) const noexcept { // Case-insensitive comparison
+		return (s != nullptr && strlen(s) == len && (len == 0 || _strnicmp(data, s, len) == 0));
+	}
+	_Check_return_ std::string ToString() const {return (data ? std::string(data, len) : std::string());}
+};
+struct HttpHeader {
+	HttpView Name;
+	HttpView Value;
+};
+
+//==========================================================================================================================
+// HttpMessage: Parsed HTTP/1.x request or response, with all fields referencing the parser's receive buffer
+struct HttpMessage {
+	static constexpr size_t HEADERS_MAX = 64;
+	HttpView Method;				// Request method (requests only)
+	HttpView Target;				// Request target (requests only)
+	unsigned int Status = 0;		// Status code (responses only)
+	HttpView Reason;				// Reason phrase (responses only)
+	unsigned int MinorVersion = 1;	// Minor version of HTTP/1.x
+	HttpHeader Headers[HEADERS_MAX];
+	size_t HeaderCount = 0;
+	HttpView Body;					// Message body (chunked bodies are decoded in place, trailers are discarded)
+	bool Chunked = false;			// Body was delivered with chunked transfer encoding
+	bool KeepAlive = true;			// Connection remains open for further messages after this one
+	// FindHeader: Retrieve value of first header with specified name (case-insensitive), null if not present
+	_Check_return_ const HttpView* FindHeader(_In_z_ const char* name) const noexcept {
+		for(size_t h = 0; h < HeaderCount; ++h) if(Headers[h].Name.Is(name)) return &(Headers[h].Value);
+		return nullptr;
+	}
+};
+
+//==========================================================================================================================
+// HttpParser: Incremental parser for a stream of HTTP/1.x requests (server) or responses (client)
+// - Caller reads socket data directly into parser's buffer (ReadTarget/Commit), then calls Next until it no longer
+//   returns Complete; each pipelined message is returned in turn, without copying (chunked bodies are compacted in place)
+// - After a message which does not keep the connection alive, any further data is discarded
+// - Response bodies must be delimited by length or chunked encoding (except for 1xx, 204 and 304 responses); caller
+//   must not issue HEAD requests, as the parser cannot tell that their responses carry no body
+// - Note this class is NOT internally thread-safe; use object within single thread only
+class HttpParser {
+public:
+	//======================================================================================================================
+	// Public definitions
+	enum class Mode : int { Request = 0, Response = 1 };
+	enum class Result : int { Complete = 0, Incomplete = 1, Invalid = 2 };
+	static constexpr size_t HEADER_BYTES_MAX_DEFAULT	= 0x4000;
+	static constexpr size_t BODY_BYTES_MAX_DEFAULT		= 0x1000000;
+	static constexpr size_t READ_SIZE_MIN				= 0x4000;	// Minimum space offered by ReadTarget
+
+	//======================================================================================================================
+	// Receive buffer functions
+	// - ReadTarget: Return pointer to free space (at least READ_SIZE_MIN bytes, size returned in "space"), compacting
+	//   buffer first if required; invalidates views of any previously returned message
+	// - Commit: Record number of bytes written to space returned by ReadTarget
+	_Check_return_ char* ReadTarget(size_t& space);
+	void Commit(size_t bytes) noexcept;
+	// Next: Parse next message from buffered data; on Complete, message fields are valid until next ReadTarget call
+	// - Returns Invalid (with error text in GetLastErrString) if stream is malformed or exceeds size limits; the stream
+	//   cannot be recovered, so session should be closed
+	_Check_return_ Result Next(HttpMessage& msg);
+	_Check_return_ const std::string& GetLastErrString() const noexcept {return LastErrString;}
+	void Reset() noexcept;
+
+	//======================================================================================================================
+	// Public constructor, destructor
+	explicit HttpParser(Mode _mode, size_t _headermax = HEADER_BYTES_MAX_DEFAULT,
+		size_t _bodymax = BODY_BYTES_MAX_DEFAULT) noexcept(false)
+		: mode(_mode), headermax(_headermax), bodymax(_bodymax) {buf.resize(READ_SIZE_MIN);}
+	~HttpParser() noexcept(false) = default;
+	// Deleted copy/move constructors and assignment operators
+	HttpParser(const HttpParser&) = delete;
+	HttpParser(HttpParser&&) = delete;
+	HttpParser& operator=(const HttpParser&) = delete;
+	HttpParser& operator=(HttpParser&&) = delete;
+
+private:
+
+	// Private definitions
+	enum class ChunkState : int { Size = 0, Data = 1, DataEnd = 2, Trailer = 3, Done = 4 };
+	static constexpr size_t CHUNK_LINE_MAX = 1024;	// Maximum length of chunk size or trailer line
+
+	// Private utility functions
+	_Check_return_ Result ParseHead(HttpMessage& msg, const char* head, size_t len);
+	_Check_return_ Result DecodeChunks(char* msgstart, size_t avail);
+	_Check_return_ Result Fail(_In_z_ const char* error);
+
+	// Private members (offsets below are relative to start, so that buffer can be compacted without adjusting them)
+	const Mode mode;
+	const size_t headermax;
+	const size_t bodymax;
+	std::vector<char> buf;				// Receive buffer
+	size_t start = 0;					// Offset in buf of first byte of current (unreturned) message
+	size_t end = 0;						// Offset in buf of end of received data
+	size_t scan = 0;					// Position from which to continue search for end of header
+	size_t headlen = 0;					// Length of header including terminating blank line (zero if not yet found)
+	size_t bodylen = 0;					// Content length of current message (if not chunked)
+	ChunkState chunkstate = ChunkState::Size;
+	size_t chunkin = 0;					// Position of next undecoded chunked body byte
+	size_t chunkout = 0;				// Length of decoded chunked body (stored from headlen onwards)
+	size_t chunkleft = 0;				// Bytes remaining in current chunk
+	bool closed = false;				// Message without keep-alive has been returned, discard further data
+	std::string LastErrString;
+};
+
+//==========================================================================================================================
+// HttpBuilder: Builds HTTP/1.1 request or response in a buffer which is retained between messages
+// - Start each message with Request or Response, add headers, then finish with Body (or End, for an empty body), or
+//   StartChunked followed by any number of Chunk calls and EndChunked; Data/Size give the message for Comms::Send
+// - Buffer capacity is reserved at construction and retained by Reset, so steady-state building does not allocate
+class HttpBuilder {
+public:
+	static constexpr size_t RESERVE_DEFAULT = 0x1000;
+
+	//======================================================================================================================
+	// Message building functions
+	HttpBuilder& Request(_In_z_ const char* method, _In_z_ const char* target);
+	HttpBuilder& Response(unsigned int status, _In_opt_z_ const char* reason = nullptr);
+	HttpBuilder& Header(_In_z_ const char* name, _In_z_ const char* value);
+	HttpBuilder& Header(_In_z_ const char* name, size_t value);
+	HttpBuilder& Body(_In_reads_(len) const char* data, size_t len, _In_opt_z_ const char* contenttype = nullptr);
+	HttpBuilder& End() {return Body(nullptr, 0);}
+	HttpBuilder& StartChunked(_In_opt_z_ const char* contenttype = nullptr);
+	HttpBuilder& Chunk(_In_reads_(len) const char* data, size_t len);
+	HttpBuilder& EndChunked();
+	void Reset() noexcept {buf.clear();}
+
+	//======================================================================================================================
+	// External accessors
+	_Check_return_ const char* Data() const noexcept {return buf.data();}
+	_Check_return_ size_t Size() const noexcept {return buf.size();}
+	_Check_return_ static const char* ReasonPhrase(unsigned int status) noexcept;
+
+	//======================================================================================================================
+	// Public constructor, destructor
+	explicit HttpBuilder(size_t reserve = RESERVE_DEFAULT) noexcept(false) {buf.reserve(reserve);}
+	~HttpBuilder() noexcept(false) = default;
+	// Deleted copy/move constructors and assignment operators
+	HttpBuilder(const HttpBuilder&) = delete;
+	HttpBuilder(HttpBuilder&&) = delete;
+	HttpBuilder& operator=(const HttpBuilder&) = delete;
+	HttpBuilder& operator=(HttpBuilder&&) = delete;
+
+private:
+	void Append(_In_reads_(len) const char* s, size_t len) {if(len > 0) buf.insert(buf.end(), s, s + len);}
+	void Append(_In_z_ const char* s) {Append(s, strlen(s));}
+	void AppendNumber(size_t value, bool hex = false);
+	std::vector<char> buf;
+};
+
+}; // (end namespace FIQCPPBASE)
@@ -0,0 +1,141 @@
+#pragma once
+//==========================================================================================================================
+// FramingCodec.h : Compile-time codecs describing how messages are framed on a byte stream
+//==========================================================================================================================
+
+#include <string.h>
+#include <limits.h>
+
+namespace FIQCPPBASE {
+
+//==========================================================================================================================
+// Framing: Codec policies, passed as template arguments to framed read and send functions (see SocketOps), so that the
+// encode and decode logic for a session's framing is resolved and inlined at compile time
+// - Each codec is a stateless struct providing the following (see existing codecs for examples):
+//   - Strategy: Prefixed (frame length known from fixed-size header) or Scanned (frame end found by examining data)
+//   - HeaderSize, TrailerSize: Number of framing bytes preceding and following payload
+//   - MaxPayload: Largest payload which codec can frame
+//   - EncodeHeader, EncodeTrailer: Write framing bytes for payload of specified length
+//   - Measure: Given data at start of frame, return total size of frame (framing plus payload) and set Length to size of
+//     payload, or return zero if frame size cannot yet be determined from available data (note Prefixed codecs return
+//     frame size as soon as header is available, Scanned codecs only once whole frame is available)
+// - Zero-length payloads are valid for Prefixed codecs (e.g. keepalive packets)
+namespace Framing {
+
+	//======================================================================================================================
+	// Strategy tags
+	struct Prefixed {};
+	struct Scanned {};
+
+	//======================================================================================================================
+	// Length2BE: Two-byte big-endian length header
+	struct Length2BE {
+		using Strategy = Prefixed;
+		static constexpr size_t HeaderSize = 2;
+		static constexpr size_t TrailerSize = 0;
+		static constexpr size_t MaxPayload = 0xFFFF;
+		static void EncodeHeader(_Out_writes_(HeaderSize) char* Header, size_t Length) noexcept {
+			Header[0] = static_cast<char>((Length >> 8) & 0xFF);
+			Header[1] = static_cast<char>(Length & 0xFF);
+		}
+		static void EncodeTrailer(char*) noexcept {}
+		_Check_return_ static size_t Measure(_In_reads_(Available) const char* Data, size_t Available, size_t& Length) noexcept {
+			if(Available < HeaderSize) return 0;
+			Length = (static_cast<size_t>(static_cast<unsigned char>(Data[0])) << 8) | static_cast<unsigned char>(Data[1]);
+			return HeaderSize + Length;
+		}
+	};
+
+	//======================================================================================================================
+	// Extended: Four-byte header made up of two-byte big-endian length and two control bytes (zero on output, ignored on
+	// input)
+	struct Extended {
+		using Strategy = Prefixed;
+		static constexpr size_t HeaderSize = 4;
+		static constexpr size_t TrailerSize = 0;
+		static constexpr size_t MaxPayload = Length2BE::MaxPayload;
+		static void EncodeHeader(_Out_writes_(HeaderSize) char* Header, size_t Length) noexcept {
+			Length2BE::EncodeHeader(Header, Length);
+			Header[2] = Header[3] = 0;
+		}
+		static void EncodeTrailer(char*) noexcept {}
+		_Check_return_ static size_t Measure(_In_reads_(Available) const char* Data, size_t Available, size_t& Length) noexcept {
+			if(Available < HeaderSize) return 0;
+			(void)Length2BE::Measure(Data, Available, Length);
+			return HeaderSize + Length;
+		}
+	};
+
+	//======================================================================================================================
+	// Length4BE: Four-byte big-endian length header (limited to positive int range, as reads are bounded by INT_MAX)
+	struct Length4BE {
+		using Strategy = Prefixed;
+		static constexpr size_t HeaderSize = 4;
+		static constexpr size_t TrailerSize = 0;
+		static constexpr size_t MaxPayload = INT_MAX - HeaderSize;
+		static void EncodeHeader(_Out_writes_(HeaderSize) char* Header, size_t Length) noexcept {
+			Header[0] = static_cast<char>((Length >> 24) & 0xFF);
+			Header[1] = static_cast<char>((Length >> 16) & 0xFF);
+			Header[2] = static_cast<char>((Length >> 8) & 0xFF);
+			Header[3] = static_cast<char>(Length & 0xFF);
+		}
+		static void EncodeTrailer(char*) noexcept {}
+		_Check_return_ static size_t Measure(_In_reads_(Available) const char* Data, size_t Available, size_t& Length) noexcept {
+			if(Available < HeaderSize) return 0;
+			Length = (static_cast<size_t>(static_cast<unsigned char>(Data[0])) << 24)
+				| (static_cast<size_t>(static_cast<unsigned char>(Data[1])) << 16)
+				| (static_cast<size_t>(static_cast<unsigned char>(Data[2])) << 8)
+				| static_cast<unsigned char>(Data[3]);
+			return HeaderSize + Length;
+		}
+	};
+
+	//======================================================================================================================
+	// Raw: No framing; each read delivers whatever data is available as one frame
+	struct Raw {
+		using Strategy = Scanned;
+		static constexpr size_t HeaderSize = 0;
+		static constexpr size_t TrailerSize = 0;
+		static constexpr size_t MaxPayload = INT_MAX;
+		static void EncodeHeader(char*, size_t) noexcept {}
+		static void EncodeTrailer(char*) noexcept {}
+		_Check_return_ static size_t Measure(const char*, size_t Available, size_t& Length) noexcept {
+			return (Length = Available);
+		}
+	};
+
+	//======================================================================================================================
+	// Delimited: Payload followed by single delimiter character (caller is responsible for ensuring payload does not
+	// itself contain delimiter)
+	template<char Delimiter = '\n'>
+	struct Delimited {
+		using Strategy = Scanned;
+		static constexpr size_t HeaderSize = 0;
+		static constexpr size_t TrailerSize = 1;
+		static constexpr size_t MaxPayload = INT_MAX - TrailerSize;
+		static void EncodeHeader(char*, size_t) noexcept {}
+		static void EncodeTrailer(_Out_writes_(TrailerSize) char* Trailer) noexcept {Trailer[0] = Delimiter;}
+		_Check_return_ static size_t Measure(_In_reads_(Available) const char* Data, size_t Available, size_t& Length) noexcept {
+			const char* const Found = static_cast<const char*>(memchr(Data, Delimiter, Available));
+			if(Found == nullptr) return 0;
+			Length = static_cast<size_t>(Found - Data);
+			return Length + TrailerSize;
+		}
+	};
+
+	//======================================================================================================================
+	// Framed: Framing bytes for a single outbound payload, encoded on construction (header and trailer are held together,
+	// with trailer immediately following header)
+	template<typename Codec>
+	struct Framed {
+		explicit Framed(size_t Length) noexcept {
+			Codec::EncodeHeader(Bytes, Length);
+			Codec::EncodeTrailer(Bytes + Codec::HeaderSize);
+		}
+		_Check_return_ const char* Header() const noexcept {return Bytes;}
+		_Check_return_ const char* Trailer() const noexcept {return Bytes + Codec::HeaderSize;}
+		char Bytes[Codec::HeaderSize + Codec::TrailerSize + 1]; // Extra byte avoids zero-length array for Raw codec
+	};
+}
+
+}; // (end namespace FIQCPPBASE)
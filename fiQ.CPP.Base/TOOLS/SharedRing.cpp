@@ -0,0 +1,234 @@
+//==========================================================================================================================
+// SharedRing.cpp : Pair of lock-free byte rings in a named shared-memory section, linking two processes on this host
+//==========================================================================================================================
+#include "pch.h"
+#include "SharedRing.h"
+using namespace FIQCPPBASE;
+
+//==========================================================================================================================
+#pragma region Section
+// Section::Create: Create new named section of specified size, and map it (fails if name is already in use)
+_Check_return_ bool SharedRing::Section::Create(const std::string& ObjName, size_t Size, std::string& ErrString) {
+	const unsigned long long size = Size;
+	Handle = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+		static_cast<DWORD>(size >> 32), static_cast<DWORD>(size & 0xFFFFFFFF), ObjName.c_str());
+	const DWORD err = GetLastError();
+	if(Handle == nullptr) {
+		ErrString = Exceptions::ConvertCOMError(err);
+		return false;
+	}
+	else if(err == ERROR_ALREADY_EXISTS) {
+		ErrString = "Shared-memory name already in use";
+		Close();
+		return false;
+	}
+	return MapAll(ErrString);
+}
+// Section::Open: Open existing named section, and map it
+_Check_return_ bool SharedRing::Section::Open(const std::string& ObjName, std::string& ErrString) {
+	if((Handle = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, ObjName.c_str())) == nullptr) {
+		ErrString = Exceptions::ConvertCOMError(GetLastError());
+		return false;
+	}
+	return MapAll(ErrString);
+}
+// Section::MapAll: Map entire section into this process, recording size of view
+_Check_return_ bool SharedRing::Section::MapAll(std::string& ErrString) {
+	MEMORY_BASIC_INFORMATION mbi = {};
+	if((MapView = MapViewOfFile(Handle, FILE_MAP_ALL_ACCESS, 0, 0, 0)) == nullptr
+		|| VirtualQuery(MapView, &mbi, sizeof(mbi)) == 0) {
+		ErrString = Exceptions::ConvertCOMError(GetLastError());
+		Close();
+		return false;
+	}
+	MapSize = mbi.RegionSize;
+	return true;
+}
+// Section::Close: Unmap and close section (system releases it once all processes have closed it)
+void SharedRing::Section::Close() noexcept {
+	if(MapView) UnmapViewOfFile(MapView);
+	if(Handle) CloseHandle(Handle);
+	MapView = nullptr;
+	Handle = nullptr;
+	MapSize = 0;
+}
+#pragma endregion Section
+
+//==========================================================================================================================
+#pragma region Listener
+// Listener::Open: Create rendezvous section and accept event, then publish rendezvous (magic is set last, so that
+// connecting processes only post to a complete rendezvous)
+_Check_return_ bool SharedRing::Listener::Open(_In_z_ const char* Name) {
+	Close();
+	BaseName = ObjectName(Name);
+	if(RendezvousSection.Create(BaseName, sizeof(SharedRing::Rendezvous), LastErrString) == false) return false;
+	else if((AcceptEvent = CreateEventA(nullptr, FALSE, FALSE, (BaseName + ".accept").c_str())) == nullptr) {
+		LastErrString = Exceptions::ConvertCOMError(GetLastError());
+		RendezvousSection.Close();
+		return false;
+	}
+	SharedRing::Rendezvous& rv = *new(RendezvousSection.View()) SharedRing::Rendezvous();
+	rv.pid = GetCurrentProcessId();
+	rv.magic = MAGIC;
+	return true;
+}
+// Listener::Watch: Register wait on accept event (callback runs on thread pool, as accepting attaches to sections)
+_Check_return_ bool SharedRing::Listener::Watch(Callback _Notify, void* Context) {
+	Notify = _Notify;
+	NotifyContext = Context;
+	if(RegisterWaitForSingleObject(&WaitHandle, AcceptEvent, &Posted, this, INFINITE, WT_EXECUTEDEFAULT) == FALSE) {
+		LastErrString = Exceptions::ConvertCOMError(GetLastError());
+		WaitHandle = nullptr;
+		return false;
+	}
+	return true;
+}
+// Listener::Posted: Wait callback, forwarding accept event to registered callback
+void CALLBACK SharedRing::Listener::Posted(PVOID Context, BOOLEAN) {
+	const Listener& listener = *static_cast<Listener*>(Context);
+	listener.Notify(listener.NotifyContext);
+}
+// Listener::Accept: Take each posted sequence number in turn, until a link section is successfully attached
+_Check_return_ std::unique_ptr<SharedRing> SharedRing::Listener::Accept() {
+	if(RendezvousSection.View() == nullptr) return nullptr;
+	SharedRing::Rendezvous& rv = *static_cast<SharedRing::Rendezvous*>(RendezvousSection.View());
+	for(auto& slot : rv.pending) {
+		const unsigned int seq = slot.exchange(0);
+		if(seq == 0) continue;
+		std::unique_ptr<SharedRing> link = std::make_unique<SharedRing>(pass_key{}, 0);
+		if(link->Attach(BaseName + "." + std::to_string(seq), 0, 0, LastErrString)) return link;
+	}
+	return nullptr;
+}
+// Listener::Close: Withdraw rendezvous, so that processes posting from now on reclaim their slot (see Connect), then
+// close any link posted before withdrawal, waking its connecting end
+void SharedRing::Listener::Close() {
+	if(WaitHandle) UnregisterWaitEx(WaitHandle, INVALID_HANDLE_VALUE);
+	WaitHandle = nullptr;
+	if(RendezvousSection.View()) {
+		static_cast<SharedRing::Rendezvous*>(RendezvousSection.View())->magic = 0;
+		while(std::unique_ptr<SharedRing> link = Accept()) {
+			link->GetFlags().closed = true;
+			link->Signal(1);
+		}
+	}
+	if(AcceptEvent) CloseHandle(AcceptEvent);
+	AcceptEvent = nullptr;
+	RendezvousSection.Close();
+}
+#pragma endregion Listener
+
+//==========================================================================================================================
+#pragma region SharedRing
+// SharedRing::Connect: Allocate sequence number from listener's rendezvous, create link section for it, then post it to
+// a free pending slot and signal listener
+_Check_return_ std::unique_ptr<SharedRing> SharedRing::Connect(
+	_In_z_ const char* Name, size_t Capacity, std::string& ErrString) {
+	const std::string basename = ObjectName(Name);
+	Section rendezvous;
+	if(rendezvous.Open(basename, ErrString) == false || rendezvous.Size() < sizeof(Rendezvous)
+		|| static_cast<Rendezvous*>(rendezvous.View())->magic != MAGIC) {
+		ErrString = "No shared-memory listener at " + std::string(Name);
+		return nullptr;
+	}
+	Rendezvous& rv = *static_cast<Rendezvous*>(rendezvous.View());
+	unsigned int seq = 0;
+	while(seq == 0) seq = ++rv.nextseq; // Zero marks a free slot, so is never allocated
+	std::unique_ptr<SharedRing> link = std::make_unique<SharedRing>(pass_key{}, 1);
+	if(link->Attach(basename + "." + std::to_string(seq), Capacity, rv.pid, ErrString) == false) return nullptr;
+
+	// Post link, then check listener has not withdrawn rendezvous meanwhile (if it has, and has not taken link while
+	// closing, reclaim slot):
+	for(auto& slot : rv.pending) {
+		unsigned int expected = 0;
+		if(slot.compare_exchange_strong(expected, seq) == false) continue;
+		expected = seq;
+		if(rv.magic != MAGIC && slot.compare_exchange_strong(expected, 0)) break;
+		if(const HANDLE acceptevent = OpenEventA(EVENT_MODIFY_STATE, FALSE, (basename + ".accept").c_str())) {
+			SetEvent(acceptevent);
+			CloseHandle(acceptevent);
+		}
+		return link;
+	}
+	ErrString = (rv.magic != MAGIC) ? "No shared-memory listener at " + std::string(Name)
+		: std::string("Shared-memory listener backlog full");
+	return nullptr;
+}
+// SharedRing::Attach: Create (connecting end) or open (accepting end) link section, attach rings and events, and open
+// process holding other end (if that process has already exited, link is flagged closed)
+_Check_return_ bool SharedRing::Attach(
+	const std::string& ObjName, size_t _Capacity, DWORD PeerId, std::string& ErrString) {
+	const bool initialize = (ThisEnd == 1);
+	if(initialize) {
+		if(Link.Create(ObjName, HEADER_SIZE + 2 * SpscRing::RegionSize(_Capacity), ErrString) == false) return false;
+		View = new(Link.View()) Header();
+		View->capacity = _Capacity;
+		View->pids[0] = PeerId;
+		View->pids[1] = GetCurrentProcessId();
+	}
+	else {
+		if(Link.Open(ObjName, ErrString) == false) return false;
+		View = static_cast<Header*>(Link.View());
+		// Validate layout written by connecting process (capacity is checked against view before being rounded, so that
+		// rounding cannot overflow):
+		if(Link.Size() < HEADER_SIZE || View->magic != MAGIC || View->capacity > Link.Size()
+			|| HEADER_SIZE + 2 * SpscRing::RegionSize(View->capacity) > Link.Size()) {
+			ErrString = "Invalid shared-memory link section";
+			return false;
+		}
+	}
+	const size_t regionsize = SpscRing::RegionSize(View->capacity);
+	for(size_t end = 0; end < 2; ++end) {
+		Rings[end] = std::make_unique<SpscRing>(static_cast<char*>(Link.View()) + HEADER_SIZE + end * regionsize,
+			View->capacity, initialize);
+		if((Events[end] = CreateEventA(nullptr, FALSE, FALSE, (ObjName + "." + std::to_string(end)).c_str())) == nullptr) {
+			ErrString = Exceptions::ConvertCOMError(GetLastError());
+			return false;
+		}
+	}
+	if(initialize) View->magic = MAGIC;
+	if((PeerProcess = OpenProcess(SYNCHRONIZE, FALSE, View->pids[1 - ThisEnd])) == nullptr) View->flags.closed = true;
+	return true;
+}
+// SharedRing::Watch: Register waits on this end's event, and on exit of process holding other end (callbacks are quick,
+// so run on wait thread itself)
+_Check_return_ bool SharedRing::Watch(Callback _Notify, void* Context) {
+	Notify = _Notify;
+	NotifyContext = Context;
+	if(RegisterWaitForSingleObject(&Waits[0], Events[ThisEnd], &EventSignalled, this, INFINITE,
+		WT_EXECUTEINWAITTHREAD) == FALSE) {
+		Waits[0] = nullptr;
+		return false;
+	}
+	else if(PeerProcess && RegisterWaitForSingleObject(&Waits[1], PeerProcess, &PeerExited, this, INFINITE,
+		WT_EXECUTEINWAITTHREAD | WT_EXECUTEONLYONCE) == FALSE) {
+		Waits[1] = nullptr;
+		return false;
+	}
+	return true;
+}
+// SharedRing::EventSignalled, PeerExited: Wait callbacks, forwarding to registered callback (flagging link closed first,
+// if other end's process has exited)
+void CALLBACK SharedRing::EventSignalled(PVOID Context, BOOLEAN) {
+	const SharedRing& link = *static_cast<SharedRing*>(Context);
+	link.Notify(link.NotifyContext);
+}
+void CALLBACK SharedRing::PeerExited(PVOID Context, BOOLEAN) {
+	const SharedRing& link = *static_cast<SharedRing*>(Context);
+	link.View->flags.closed = true;
+	link.Notify(link.NotifyContext);
+}
+// SharedRing::~SharedRing: Withdraw waits (waiting for running callbacks), then close handles; section is unmapped last
+SharedRing::~SharedRing() noexcept(false) {
+	for(HANDLE& wait : Waits) {
+		if(wait) UnregisterWaitEx(wait, INVALID_HANDLE_VALUE);
+		wait = nullptr;
+	}
+	for(HANDLE& event : Events) {
+		if(event) CloseHandle(event);
+		event = nullptr;
+	}
+	if(PeerProcess) CloseHandle(PeerProcess);
+	PeerProcess = nullptr;
+}
+#pragma endregion SharedRing
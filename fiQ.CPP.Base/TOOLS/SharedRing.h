@@ -0,0 +1,163 @@
+#pragma once
+//==========================================================================================================================
+// SharedRing.h : Pair of lock-free byte rings in a named shared-memory section, linking two processes on this host
+//==========================================================================================================================
+
+#include <memory>
+#include <string>
+#include "Tools/Exceptions.h"
+#include "Tools/SpscRing.h"
+
+namespace FIQCPPBASE {
+
+//==========================================================================================================================
+// SharedRing: One end of a link between two processes, made up of a named shared-memory section holding an SpscRing in
+// each direction (each end reads its own ring, and writes the other end's) plus flags shared by both ends, and a named
+// auto-reset event for each end, signalled by the other end to wake it
+// - Links are established through a named rendezvous published by a Listener: connecting process creates link section
+//   (as end 1, see Connect), posts its sequence number to one of the rendezvous' pending slots and signals listener,
+//   which attaches to section (as end 0, see Listener::Accept); system releases section and events once both processes
+//   have closed their handles
+// - Each end may register a callback (see Watch), invoked on a system wait thread whenever its event is signalled, and
+//   once if the process holding the other end exits (after flagging link closed)
+// - Kernel objects are named "Local\fiQ.shm.NAME" (link objects add ".SEQ", and events ".END"), so are visible only
+//   within the caller's logon session
+class SharedRing {
+private: struct pass_key {}; // Private function pass-key definition
+	// Private definitions - Section: Named shared-memory section, mapped in full (unmapped and closed on destruction)
+	class Section {
+	public:
+		_Check_return_ bool Create(const std::string& ObjName, size_t Size, std::string& ErrString);
+		_Check_return_ bool Open(const std::string& ObjName, std::string& ErrString);
+		_Check_return_ void* View() const noexcept {return MapView;}
+		_Check_return_ size_t Size() const noexcept {return MapSize;}
+		void Close() noexcept;
+		Section() noexcept = default;
+		~Section() noexcept {Close();}
+		Section(const Section&) = delete;
+		Section(Section&&) = delete;
+		Section& operator=(const Section&) = delete;
+		Section& operator=(Section&&) = delete;
+	private:
+		_Check_return_ bool MapAll(std::string& ErrString);
+		HANDLE Handle = nullptr;
+		void* MapView = nullptr;
+		size_t MapSize = 0;	// Size of mapped view (rounded up to page size by system)
+	};
+	static constexpr unsigned int MAGIC = 0x6D687366; // Set once section is initialized (cleared on rendezvous withdrawal)
+
+public:
+	//======================================================================================================================
+	// Public definitions
+	static constexpr size_t PENDING_MAX = 16;	// Links awaiting acceptance by listener, beyond which Connect fails
+	using Callback = void(*)(void* Context);
+	// Flags: Link state shared by both ends (elements indexed by end are written by that end only)
+	struct Flags {
+		std::atomic_bool stalled[2];	// End has output held, awaiting space in other end's ring
+		std::atomic_bool spinning[2];	// End busy-polls its ring, so need not be signalled
+		std::atomic_bool closed;		// Either end has closed (or its process has exited)
+	};
+
+	//======================================================================================================================
+	// Listener: Named rendezvous, accepting links from other processes
+	class Listener {
+	public:
+		_Check_return_ const std::string& GetLastErrString() const noexcept {return LastErrString;}
+		// Open: Publish rendezvous under specified name (fails if name is already in use on this host)
+		_Check_return_ bool Open(_In_z_ const char* Name);
+		// Watch: Register callback, invoked on a system thread pool thread whenever links are posted (see Accept)
+		_Check_return_ bool Watch(Callback _Notify, void* Context);
+		// Accept: Attach to next posted link, returning null if none is pending (links whose connecting process has
+		// already exited are skipped); called from callback, or a single thread at a time
+		_Check_return_ std::unique_ptr<SharedRing> Accept();
+		// Close: Withdraw rendezvous, waiting for any running callback, then close links posted but not yet accepted
+		// (must not be called from callback)
+		void Close();
+
+		// Public constructor, destructor
+		Listener() noexcept = default;
+		~Listener() noexcept(false) {Close();}
+		// Deleted copy/move constructors and assignment operators
+		Listener(const Listener&) = delete;
+		Listener(Listener&&) = delete;
+		Listener& operator=(const Listener&) = delete;
+		Listener& operator=(Listener&&) = delete;
+
+	private:
+		static void CALLBACK Posted(PVOID Context, BOOLEAN);
+		std::string BaseName;				// Kernel object name of rendezvous section
+		Section RendezvousSection;
+		HANDLE AcceptEvent = nullptr;		// Signalled by connecting process once link is posted
+		HANDLE WaitHandle = nullptr;		// Registered wait on AcceptEvent (see Watch)
+		Callback Notify = nullptr;
+		void* NotifyContext = nullptr;
+		std::string LastErrString;			// Storage for last error on open or accept
+	};
+
+	//======================================================================================================================
+	// Connect: Create link to listener published under specified name, with rings of (at least) specified capacity;
+	// returns null on failure, with description in ErrString
+	_Check_return_ static std::unique_ptr<SharedRing> Connect(
+		_In_z_ const char* Name, size_t Capacity, std::string& ErrString);
+
+	//======================================================================================================================
+	// Link functions
+	// - Inbound: Ring holding inbound data for specified end
+	// - Signal: Wake specified end (via its event)
+	// - Watch: Register callback for this end (see above), at most once
+	_Check_return_ size_t End() const noexcept {return ThisEnd;}
+	_Check_return_ size_t Capacity() const noexcept {return Rings[0]->Capacity();}
+	_Check_return_ SpscRing& Inbound(size_t end) noexcept {return *Rings[end];}
+	_Check_return_ Flags& GetFlags() noexcept {return View->flags;}
+	void Signal(size_t end) const noexcept {SetEvent(Events[end]);}
+	_Check_return_ bool Watch(Callback _Notify, void* Context);
+
+	//======================================================================================================================
+	// Public constructor (for use by Connect and Listener::Accept only), destructor (withdraws callbacks, waiting for any
+	// running callback to complete, so must not be called from callback)
+	SharedRing(pass_key, size_t _end) noexcept : ThisEnd(_end) {}
+	~SharedRing() noexcept(false);
+	// Deleted copy/move constructors and assignment operators
+	SharedRing(const SharedRing&) = delete;
+	SharedRing(SharedRing&&) = delete;
+	SharedRing& operator=(const SharedRing&) = delete;
+	SharedRing& operator=(SharedRing&&) = delete;
+
+private:
+	//======================================================================================================================
+	// Private definitions - Layout of rendezvous section, and of link section (header followed by ring for each end)
+	struct Rendezvous {
+		std::atomic<unsigned int> magic;
+		DWORD pid;								// Listening process
+		std::atomic<unsigned int> nextseq;		// Last sequence number allocated to a link
+		std::atomic<unsigned int> pending[PENDING_MAX];	// Sequence numbers of posted links (zero if slot is free)
+	};
+	struct Header {
+		std::atomic<unsigned int> magic;
+		size_t capacity;						// Requested capacity of each ring
+		DWORD pids[2];							// Process holding each end
+		Flags flags;
+	};
+	static constexpr size_t HEADER_SIZE = ((sizeof(Header) + 63) / 64) * 64;
+	_Check_return_ static std::string ObjectName(_In_z_ const char* Name) {return std::string("Local\\fiQ.shm.") + Name;}
+
+	//======================================================================================================================
+	// Private utility functions
+	_Check_return_ bool Attach(const std::string& ObjName, size_t _Capacity, DWORD PeerId, std::string& ErrString);
+	static void CALLBACK EventSignalled(PVOID Context, BOOLEAN);
+	static void CALLBACK PeerExited(PVOID Context, BOOLEAN);
+
+	//======================================================================================================================
+	// Private members
+	const size_t ThisEnd;
+	Section Link;
+	Header* View = nullptr;
+	std::unique_ptr<SpscRing> Rings[2];
+	HANDLE Events[2] = {nullptr, nullptr};
+	HANDLE PeerProcess = nullptr;			// Process holding other end (waited on, see Watch)
+	HANDLE Waits[2] = {nullptr, nullptr};	// Registered waits on this end's event, and on PeerProcess
+	Callback Notify = nullptr;
+	void* NotifyContext = nullptr;
+};
+
+}; // (end namespace FIQCPPBASE)
@@ -0,0 +1,277 @@
+#pragma once
+//==========================================================================================================================
+// SlotTable.h : Class providing lock-free, index-addressed storage for objects referenced by integer tickets
+//==========================================================================================================================
+
+#include <atomic>
+#include "Tools/ValueOps.h"
+
+namespace FIQCPPBASE {
+
+//==========================================================================================================================
+// SlotTable: Paged table of object slots, addressed by a key made up of slot index and slot generation
+// - Keys are unsigned int values: low IndexBits hold slot index (index zero is never used, so a valid key is never zero),
+//   next GenerationBits hold low bits of slot generation; any higher bits are ignored (available to caller for flags)
+// - Each slot carries an atomic control word containing its full generation, a reference count and an occupancy state;
+//   lookups (Acquire) add a reference by compare-exchange on this word, so no lock is held by readers or writers
+// - Insert allocates a slot without locking: a shared cursor advances round-robin through the active index range and the
+//   first free slot found is claimed by compare-exchange, so a freed slot is not reused until the cursor has passed
+//   every other slot in range (range is grown by one page whenever table is more than three-quarters occupied)
+// - Retire flags an object for removal; it is destroyed when its last reference is released, at which point the slot
+//   generation is advanced (so keys issued for previous occupant no longer resolve) and slot becomes free
+// - Pages of slots are allocated on first use and retained until table is destructed
+template<typename T, unsigned int IndexBits, unsigned int GenerationBits>
+class SlotTable {
+	static_assert(IndexBits >= 12 && IndexBits + GenerationBits <= 32, "Invalid slot table key layout");
+	struct pass_key {}; // Private function pass-key definition
+	struct Slot; // Forward declaration
+public:
+
+	//======================================================================================================================
+	// Public definitions - Key layout and helper functions
+	using Key = unsigned int;
+	static constexpr Key INDEX_MASK = ((1U << IndexBits) - 1);
+	static constexpr Key GENERATION_MASK = ((GenerationBits >= 32) ? ~0U : ((1U << GenerationBits) - 1));
+	static constexpr Key KEY_MASK = (IndexBits + GenerationBits >= 32) ? ~0U : ((1U << (IndexBits + GenerationBits)) - 1);
+	static constexpr size_t SLOTS_MAX = INDEX_MASK; // Maximum index value (index zero is reserved)
+	_Check_return_ static constexpr size_t KeyIndex(Key key) noexcept {return (key & INDEX_MASK);}
+	_Check_return_ static constexpr Key KeyGeneration(Key key) noexcept {return ((key >> IndexBits) & GENERATION_MASK);}
+	_Check_return_ static constexpr Key MakeKey(size_t index, unsigned int generation) noexcept {
+		return (gsl::narrow_cast<Key>(index) & INDEX_MASK) | ((generation & GENERATION_MASK) << IndexBits);
+	}
+
+	//======================================================================================================================
+	// Ref: Scoped reference to an object in table; object is guaranteed to remain valid for lifetime of this object
+	class Ref {
+	public:
+		_Check_return_ T* get() const noexcept {return Object;}
+		_Check_return_ T* operator->() const noexcept {return Object;}
+		_Check_return_ T& operator*() const noexcept {return *Object;}
+		_Check_return_ explicit operator bool() const noexcept {return (Object != nullptr);}
+		_Check_return_ Key GetKey() const noexcept {return RefKey;}
+		void Release() {if(Table) Table->ReleaseRef(*SlotPtr); Table = nullptr, SlotPtr = nullptr, Object = nullptr;}
+
+		// Public constructors (locked by private pass key), destructor
+		Ref() noexcept = default;
+		Ref(pass_key, SlotTable* _Table, Slot* _SlotPtr, T* _Object, Key _RefKey) noexcept
+			: Table(_Table), SlotPtr(_SlotPtr), Object(_Object), RefKey(_RefKey) {}
+		Ref(Ref&& r) noexcept : Table(r.Table), SlotPtr(r.SlotPtr), Object(r.Object), RefKey(r.RefKey) {
+			r.Table = nullptr, r.SlotPtr = nullptr, r.Object = nullptr;
+		}
+		Ref& operator=(Ref&& r) {
+			if(this != &r) {
+				Release();
+				Table = r.Table, SlotPtr = r.SlotPtr, Object = r.Object, RefKey = r.RefKey;
+				r.Table = nullptr, r.SlotPtr = nullptr, r.Object = nullptr;
+			}
+			return *this;
+		}
+		~Ref() noexcept(false) {Release();}
+		// Deleted copy constructor/assignment operator
+		Ref(const Ref&) = delete;
+		Ref& operator=(const Ref&) = delete;
+
+	private:
+		SlotTable* Table = nullptr;
+		Slot* SlotPtr = nullptr;
+		T* Object = nullptr;
+		Key RefKey = 0;
+	};
+
+	//======================================================================================================================
+	// Table management functions
+	// - Insert: Move object into next free slot; returns key for new occupant, zero if object is null or table is full
+	// - Acquire: Look up key and add reference to object; returns empty Ref if slot is not live or generation mismatches
+	// - Retire: Flag object at key for removal (destroyed once all references released); returns false if not found
+	_Check_return_ Key Insert(std::unique_ptr<T>&& obj);
+	_Check_return_ Ref Acquire(Key key);
+	bool Retire(Key key);
+	// ForEach: Execute function against every live object in table, as "f(Key, T&)"
+	template<typename F>
+	void ForEach(F&& f);
+	// Clear: Retire every live object in table
+	void Clear() {ForEach([this](Key key, T&) {Retire(key);});}
+	// HighWater: Retrieve highest index ever occupied (non-interlocked; for iteration bounds and diagnostics)
+	_Check_return_ size_t HighWater() const noexcept {return MaxIndex.load(std::memory_order_acquire);}
+	// Occupied: Retrieve count of slots currently occupied, including retired objects not yet reclaimed (non-interlocked)
+	_Check_return_ size_t Occupied() const noexcept {return OccupiedCount.load(std::memory_order_acquire);}
+
+	//======================================================================================================================
+	// Public default constructor
+	SlotTable() noexcept {for(auto& p : Pages) p.store(nullptr, std::memory_order_relaxed);}
+	~SlotTable() noexcept(false);
+	// Deleted copy/move constructors and assignment operators
+	SlotTable(const SlotTable&) = delete;
+	SlotTable(SlotTable&&) = delete;
+	SlotTable& operator=(const SlotTable&) = delete;
+	SlotTable& operator=(SlotTable&&) = delete;
+
+private:
+
+	//======================================================================================================================
+	// Private definitions - Control word layout: [generation:32][reference count:30][state:2]
+	// - Pending state is held only briefly by an inserting thread, between claiming slot and storing object pointer
+	using Control = unsigned long long;
+	static constexpr Control STATE_FREE = 0, STATE_LIVE = 1, STATE_RETIRED = 2, STATE_PENDING = 3, STATE_MASK = 3;
+	static constexpr Control REF_ONE = 4, REF_MASK = 0xFFFFFFFCULL;
+	_Check_return_ static constexpr Control State(Control c) noexcept {return (c & STATE_MASK);}
+	_Check_return_ static constexpr Control Refs(Control c) noexcept {return ((c & REF_MASK) >> 2);}
+	_Check_return_ static constexpr unsigned int Generation(Control c) noexcept {return gsl::narrow_cast<unsigned int>(c >> 32);}
+	_Check_return_ static constexpr bool Matches(Control c, Key key) noexcept {
+		return ((Generation(c) & GENERATION_MASK) == KeyGeneration(key));
+	}
+
+	// Private definitions - Page layout
+	static constexpr unsigned int PAGE_BITS = 12;
+	static constexpr size_t PAGE_SIZE = (1ULL << PAGE_BITS);
+	static constexpr size_t PAGE_COUNT = (1ULL << (IndexBits - PAGE_BITS));
+
+	// Slot: Container for a single object pointer and its control word
+	// - Object member is written only by inserting thread (while slot is pending) and by reclaiming thread (after last
+	//   reference has been released), and read only by holders of a reference
+	struct Slot {
+		std::atomic<Control> ControlWord{0};
+		T* Object = nullptr;
+	};
+
+	// Private utility functions
+	_Check_return_ Slot* GetSlot(size_t index, bool Create);
+	void ReleaseRef(Slot& slot);
+	void Reclaim(Slot& slot, Control c);
+
+	// Private member variables
+	std::atomic<Slot*> Pages[PAGE_COUNT];			// Array of pointers to slot pages (allocated on first use)
+	std::atomic<size_t> Capacity{0};				// Highest index currently available to allocation cursor
+	std::atomic<size_t> Cursor{0};					// Allocation cursor (position within current capacity)
+	std::atomic<size_t> OccupiedCount{0};			// Count of slots not currently free
+	std::atomic<size_t> MaxIndex{0};				// Highest index ever occupied
+};
+
+//==========================================================================================================================
+// SlotTable::~SlotTable: Destroy any remaining objects (regardless of reference state) and release all pages
+template<typename T, unsigned int IndexBits, unsigned int GenerationBits>
+inline SlotTable<T, IndexBits, GenerationBits>::~SlotTable() noexcept(false) {
+	for(auto& p : Pages) {
+		Slot* page = p.exchange(nullptr);
+		if(page != nullptr) {
+			for(size_t s = 0; s < PAGE_SIZE; ++s) delete page[s].Object;
+			delete[] page;
+		}
+	}
+}
+// SlotTable::Insert: Claim next free slot (round-robin from shared cursor) and move object into it
+template<typename T, unsigned int IndexBits, unsigned int GenerationBits>
+inline _Check_return_ typename SlotTable<T, IndexBits, GenerationBits>::Key SlotTable<T, IndexBits, GenerationBits>::Insert(
+	std::unique_ptr<T>&& obj) {
+	if(obj.get() == nullptr) return 0;
+	for(size_t probes = 0;;) {
+		size_t cap = Capacity.load(std::memory_order_acquire);
+		// If table is more than three-quarters occupied (or a full pass of cursor found no free slot), grow capacity by
+		// one page; if another thread grows it first, just reload and carry on:
+		if((OccupiedCount.load(std::memory_order_relaxed) + 1) * 4 > cap * 3 || probes >= cap) {
+			if(cap < SLOTS_MAX) {
+				Capacity.compare_exchange_strong(cap, (std::min)(cap + PAGE_SIZE, SLOTS_MAX), std::memory_order_acq_rel);
+				probes = 0;
+				continue;
+			}
+			else if(probes >= cap) return 0; // Table is full
+		}
+
+		// Advance cursor and attempt to claim slot, transitioning from free to pending state (generation is retained):
+		const size_t index = (Cursor.fetch_add(1, std::memory_order_relaxed) % cap) + 1;
+		++probes;
+		Slot* const slot = GetSlot(index, true);
+		Control c = slot->ControlWord.load(std::memory_order_acquire);
+		if(State(c) == STATE_FREE
+			&& slot->ControlWord.compare_exchange_strong(c, c | STATE_PENDING, std::memory_order_acq_rel)) {
+			// Slot is now exclusively ours; store object, then transition to live state (release ordering ensures
+			// Object is visible to readers), and update high-water mark if required:
+			OccupiedCount.fetch_add(1, std::memory_order_acq_rel);
+			slot->Object = obj.release();
+			slot->ControlWord.store(c | STATE_LIVE, std::memory_order_release);
+			for(size_t m = MaxIndex.load(std::memory_order_relaxed);
+				m < index && MaxIndex.compare_exchange_weak(m, index, std::memory_order_acq_rel) == false;);
+			return MakeKey(index, Generation(c));
+		}
+	}
+}
+// SlotTable::Acquire: Look up key and add reference to object, if slot is live and generation matches
+template<typename T, unsigned int IndexBits, unsigned int GenerationBits>
+inline _Check_return_ typename SlotTable<T, IndexBits, GenerationBits>::Ref SlotTable<T, IndexBits, GenerationBits>::Acquire(
+	Key key) {
+	const size_t index = KeyIndex(key);
+	Slot* const slot = (index == 0) ? nullptr : GetSlot(index, false);
+	if(slot == nullptr) return Ref();
+	Control c = slot->ControlWord.load(std::memory_order_acquire);
+	while(State(c) == STATE_LIVE && Matches(c, key) && (c & REF_MASK) != REF_MASK) {
+		if(slot->ControlWord.compare_exchange_weak(c, c + REF_ONE, std::memory_order_acq_rel))
+			return Ref(pass_key{}, this, slot, slot->Object, MakeKey(index, Generation(c)));
+	}
+	return Ref();
+}
+// SlotTable::Retire: Flag object for removal; if no references are outstanding, reclaim immediately
+template<typename T, unsigned int IndexBits, unsigned int GenerationBits>
+inline bool SlotTable<T, IndexBits, GenerationBits>::Retire(Key key) {
+	const size_t index = KeyIndex(key);
+	Slot* const slot = (index == 0) ? nullptr : GetSlot(index, false);
+	if(slot == nullptr) return false;
+	Control c = slot->ControlWord.load(std::memory_order_acquire);
+	while(State(c) == STATE_LIVE && Matches(c, key)) {
+		const Control retired = (c & ~STATE_MASK) | STATE_RETIRED;
+		if(slot->ControlWord.compare_exchange_weak(c, retired, std::memory_order_acq_rel)) {
+			// If no references were held at time of retirement, this thread is responsible for reclaiming:
+			if(Refs(retired) == 0) Reclaim(*slot, retired);
+			return true;
+		}
+	}
+	return false;
+}
+// SlotTable::ForEach: Execute function against every live object in table
+template<typename T, unsigned int IndexBits, unsigned int GenerationBits>
+template<typename F>
+inline void SlotTable<T, IndexBits, GenerationBits>::ForEach(F&& f) {
+	const size_t maxindex = HighWater();
+	for(size_t index = 1; index <= maxindex; ++index) {
+		Slot* const slot = GetSlot(index, false);
+		if(slot == nullptr) { // Page not allocated, skip to start of next page
+			index |= (PAGE_SIZE - 1);
+			continue;
+		}
+		const Control c = slot->ControlWord.load(std::memory_order_acquire);
+		if(State(c) == STATE_LIVE) {
+			Ref r = Acquire(MakeKey(index, Generation(c)));
+			if(r) f(r.GetKey(), *r);
+		}
+	}
+}
+// SlotTable::GetSlot: Retrieve pointer to slot at index, allocating page if required and requested
+template<typename T, unsigned int IndexBits, unsigned int GenerationBits>
+inline _Check_return_ typename SlotTable<T, IndexBits, GenerationBits>::Slot* SlotTable<T, IndexBits, GenerationBits>::GetSlot(
+	size_t index, bool Create) {
+	std::atomic<Slot*>& pageptr = Pages[(index & INDEX_MASK) >> PAGE_BITS];
+	Slot* page = pageptr.load(std::memory_order_acquire);
+	if(page == nullptr && Create) {
+		// Allocate new page and attempt to install; if another thread won the race, discard ours and use theirs:
+		std::unique_ptr<Slot[]> newpage = std::make_unique<Slot[]>(PAGE_SIZE);
+		if(pageptr.compare_exchange_strong(page, newpage.get(), std::memory_order_acq_rel)) page = newpage.release();
+	}
+	return (page == nullptr) ? nullptr : &page[index & (PAGE_SIZE - 1)];
+}
+// SlotTable::ReleaseRef: Remove reference from slot; reclaim slot if it has been retired and this was last reference
+template<typename T, unsigned int IndexBits, unsigned int GenerationBits>
+inline void SlotTable<T, IndexBits, GenerationBits>::ReleaseRef(Slot& slot) {
+	const Control c = slot.ControlWord.fetch_sub(REF_ONE, std::memory_order_acq_rel) - REF_ONE;
+	if(State(c) == STATE_RETIRED && Refs(c) == 0) Reclaim(slot, c);
+}
+// SlotTable::Reclaim: Destroy retired object, advance generation and return slot to free state
+template<typename T, unsigned int IndexBits, unsigned int GenerationBits>
+inline void SlotTable<T, IndexBits, GenerationBits>::Reclaim(Slot& slot, Control c) {
+	// Only one thread can observe the transition to retired-with-no-references, so no further synchronization needed:
+	std::unique_ptr<T> obj(slot.Object);
+	slot.Object = nullptr;
+	slot.ControlWord.store((static_cast<Control>(Generation(c) + 1) << 32) | STATE_FREE, std::memory_order_release);
+	OccupiedCount.fetch_sub(1, std::memory_order_acq_rel);
+	obj.reset();
+}
+
+}; // (end namespace FIQCPPBASE)
@@ -4,10 +4,22 @@
 //==========================================================================================================================
 
 #include <ws2tcpip.h>
+#include <mstcpip.h>
+#include <afunix.h>
+#ifdef FIQ_TLS_OPENSSL
+// OpenSSL backend: handles only are held by socket objects (OpenSSL headers are included by backend implementation)
+typedef struct ssl_st SSL;
+typedef struct ssl_ctx_st SSL_CTX;
+typedef struct ssl_session_st SSL_SESSION;
+typedef struct evp_cipher_ctx_st EVP_CIPHER_CTX;
+typedef struct evp_mac_ctx_st EVP_MAC_CTX;
+#else
 #define SECURITY_WIN32
 #include <security.h>
 #include <schnlsp.h>
+#endif
 #include "Tools/Exceptions.h"
+#include "Tools/FramingCodec.h"
 #include "Tools/SteadyClock.h"
 #include "Tools/ValueOps.h"
 
@@ -33,8 +45,21 @@ inline constexpr bool operator&(SocketFlags a, SocketFlags b) noexcept {
 
 //==========================================================================================================================
 // SocketOps: Main class containing all TCP/IP socket functionality, with TLS support
+// - TLS backend is selected at build time: SChannel by default (SocketOpsSChannel.cpp), or OpenSSL if FIQ_TLS_OPENSSL is
+//   defined (SocketOpsOpenSSL.cpp, requiring OpenSSL 3.0 or later); both implement the same ServerSocket/SessionSocket
+//   TLS interface, with raw socket data staged through the session's read buffer in either case
+// - OpenSSL backend loads server credentials from PKCS12 files only (InitCredentialsFromStore is SChannel-only)
+// - TLS session read and cleartext buffers are taken from a shared slab pool only while a session has data in flight
+//   (negotiation, or raw/decrypted data not yet consumed), and returned to the pool whenever the session is idle
 class SocketOps {
 private: struct pass_key {}; // Private function pass-key definition
+	// Private definitions - Pooled TLS session buffer (returned to pool of its size class on release)
+	class TLSBufferPool;
+	struct TLSBufferRelease {
+		size_t BufSize;
+		void operator()(_In_opt_ char* Buffer) const noexcept;
+	};
+	using TLSBuffer = std::unique_ptr<char[], TLSBufferRelease>;
 public:
 
 	//======================================================================================================================
@@ -47,6 +72,42 @@ public:
 	static constexpr size_t TLS_BUFFER_SIZE_MIN		= 0x0080;
 	static constexpr size_t TLS_BUFFER_SIZE_DEFAULT	= 0x2000;
 	static constexpr size_t TLS_BUFFER_SIZE_MAX		= 0x8000;
+	// Public definitions - Listen backlog sizes
+	static constexpr int LISTEN_BACKLOG_DEFAULT		= 10;
+	static constexpr int LISTEN_BACKLOG_HINT_MIN	= 200;
+	// Public definitions - TLS session ticket key rotation intervals (milliseconds, see ServerSocket::SetTicketKeyRotation)
+	static constexpr int TICKET_KEY_ROTATION_DEFAULT	= 3600000;
+	static constexpr int TICKET_KEY_ROTATION_MIN		= 60000;
+	// Public definitions - TLS session resumption counters (see GetTLSResumptionStats)
+	struct TLSResumptionStats {
+		unsigned long long ClientResumed = 0;		// Client handshakes which resumed a cached session (cache hits)
+		unsigned long long ClientFull = 0;			// Client handshakes which performed full key exchange (cache misses)
+		unsigned long long ServerResumed = 0;		// Server handshakes which resumed a client's session (ticket or ID)
+		unsigned long long ServerFull = 0;			// Server handshakes which performed full key exchange
+		unsigned long long TicketKeyRotations = 0;	// Session ticket keys installed by listeners (including initial keys)
+	};
+	// Public definitions - TLS session buffer pool usage (see GetTLSBufferStats)
+	struct TLSBufferStats {
+		size_t Allocated = 0;	// Buffers allocated by pool (in use or free), across all buffer sizes
+		size_t InUse = 0;		// Buffers currently held by sessions
+	};
+	// Public definitions - TCP connection statistics maintained by system for a session (see SessionSocket::GetTcpInfo)
+	struct TcpInfo {
+		unsigned long RttMicros = 0;				// Smoothed round-trip time
+		unsigned long MinRttMicros = 0;				// Minimum round-trip time observed
+		unsigned long Cwnd = 0;						// Congestion window (bytes)
+		unsigned long BytesInFlight = 0;			// Bytes sent and not yet acknowledged
+		unsigned long long BytesRetransmitted = 0;	// Bytes retransmitted since connection
+		unsigned long FastRetransmits = 0;			// Fast retransmissions (duplicate acknowledgements)
+		unsigned long TimeoutEpisodes = 0;			// Retransmission timeouts
+	};
+	// Public definitions - Kernel TLS offload state of a session (see SetKernelTLS, SessionSocket::GetTLSOffload)
+	enum class TLSOffload : unsigned char {
+		None = 0,		// Records encrypted and decrypted in user space
+		Send = 1,		// Outbound records encrypted by kernel
+		Receive = 2,	// Inbound records decrypted by kernel
+		Full = 3		// Both directions handled by kernel
+	};
 
 	//======================================================================================================================
 	// Static library initialization functions: Each should be called exactly once in program lifetime
@@ -54,14 +115,40 @@ public:
 	static void InitializeSockets(bool TLSRequired);
 	static void CleanupSockets();
 
+	//======================================================================================================================
+	// TLS session resumption functions
+	// - Client sessions share one SChannel credential per TLS method, and identify the remote endpoint (IP and port) as
+	//   the target of each handshake; SChannel caches the session ID or ticket issued by each endpoint against that
+	//   credential, so that later connections to the same endpoint resume the session (an abbreviated handshake, with no
+	//   certificate exchange or asymmetric key exchange)
+	// - PurgeTLSSessionCache releases the shared client credentials, so that subsequent handshakes start a new cache
+	//   (sessions already open are unaffected)
+	static void GetTLSResumptionStats(TLSResumptionStats& stats) noexcept;
+	static void PurgeTLSSessionCache();
+
+	//======================================================================================================================
+	// Kernel TLS offload - If enabled, sessions negotiated from then on ask OpenSSL to install the negotiated keys into
+	// the kernel (Linux kTLS) once handshake completes, so that data is sent and read as cleartext through the socket
+	// and encrypted/decrypted by the kernel; each direction falls back to user-space TLS if kernel does not accept it
+	// - Returns false if offload is not supported by this build (SChannel backend, or OpenSSL built without kTLS - which
+	//   includes every Windows build of OpenSSL, as kTLS is a Linux facility; on those builds enabling has no effect)
+	static bool SetKernelTLS(bool Enable) noexcept;
+
+	//======================================================================================================================
+	// TLS buffer pool statistics - Pool memory is retained while program runs (free slabs are released by CleanupSockets)
+	static void GetTLSBufferStats(TLSBufferStats& stats) noexcept;
+
 	//======================================================================================================================
 	// Static socket management functions: Used by callers who manage their own SOCKET handles
 	// - Most provide optional LastErrString parameter, used if caller requires further information on any failures
 	//======================================================================================================================
 	// InitServer: Create and initialize a SOCKET, bind it to the specified port and (optional) interface and listen
+	// - If Interface is a unix domain address (see IsUnixAddress), socket is bound to that path instead (port is ignored);
+	//   any socket file left at path by a previous listener is removed first
+	// - Backlog values above LISTEN_BACKLOG_HINT_MIN are passed as a hint (allowing queue beyond provider default)
 	// - Returns initialized socket or INVALID_SOCKET on error
 	_Check_return_ static SOCKET InitServer(
-		unsigned short ListenPort, _In_opt_z_ const char* Interface = nullptr, int Backlog = 10,
+		unsigned short ListenPort, _In_opt_z_ const char* Interface = nullptr, int Backlog = LISTEN_BACKLOG_DEFAULT,
 		_Inout_opt_ std::string* LastErrString = nullptr);
 	// Accept: Accept incoming connection request (will block until client request avaialble)
 	// - "server" input should be a valid, listening socket (as returned by InitServer)
@@ -69,10 +156,29 @@ public:
 	// - Returns connected SOCKET value or INVALID_SOCKET on error
 	_Check_return_ static SOCKET Accept(SOCKET server, _Inout_opt_ sockaddr_in* saddr = nullptr,
 		_Inout_opt_ std::string* LastErrString = nullptr);
+	// AcceptPending: As Accept, but for a nonblocking listener socket (will not block if no client request available)
+	// - Accepted socket is returned in blocking mode
+	// - Returns OK with connected SOCKET in "client", Timeout if no request was pending, or Failed on error
+	_Check_return_ static Result AcceptPending(SOCKET server, SOCKET& client, _Inout_opt_ sockaddr_in* saddr = nullptr,
+		_Inout_opt_ std::string* LastErrString = nullptr);
 	// DNSLookup: Retrieve IP address for specified name
+	// - First overload retrieves the first IPv4 address only; second retrieves all IPv4 and IPv6 addresses, in the order
+	//   returned by the system (i.e. in order of preference), without duplicates
+	// - Both block until the lookup has completed (see DnsResolver for asynchronous, cached lookups)
 	_Check_return_ static bool DNSLookup(_In_z_ const char* URL, _Out_writes_z_(20) char* TgtIP,
 		_Inout_opt_ std::string* LastErrString = nullptr);
-	// Connect: Attempt outbound connection to the specified IP and port
+	_Check_return_ static bool DNSLookup(_In_z_ const char* Name, std::vector<std::string>& Addresses,
+		_Inout_opt_ std::string* LastErrString = nullptr);
+	// ParseAddress: Convert IPv4 or IPv6 address literal and port (or unix domain address) into socket address
+	// - Returns false if input is not a valid address literal (e.g. is a host name, requiring lookup)
+	_Check_return_ static bool ParseAddress(_In_z_ const char* IP, unsigned short Port,
+		sockaddr_storage& Addr, int& AddrLen) noexcept;
+	// IsUnixAddress: Address refers to a unix domain (AF_UNIX) stream socket, in "unix:PATH" format; such addresses are
+	// accepted wherever an IP address literal is (with port ignored), for peers on the same host (Windows 10 1803+)
+	_Check_return_ static bool IsUnixAddress(_In_opt_z_ const char* Address) noexcept {
+		return (Address ? (strncmp(Address, "unix:", 5) == 0 && Address[5] != 0) : false);
+	}
+	// Connect: Attempt outbound connection to the specified IP (IPv4 or IPv6 literal, or unix domain address) and port
 	// - Optional Timeout value (milliseconds) can override Winsock default timeout period (0 = use default)
 	// - Returns connected SOCKET value or INVALID_SOCKET on error
 	_Check_return_ static SOCKET Connect(_In_z_ const char* RemoteIP, unsigned short RemotePort, int Timeout = 0,
@@ -92,6 +198,15 @@ public:
 	// - Socket will be shutdown (but not closed) on error
 	_Check_return_ static Result Send(SOCKET s, _In_reads_(len) const char* buf, size_t len,
 		_Inout_opt_ std::string* LastErrString = nullptr);
+	// SendGather: Deliver contents of multiple buffers to session socket in a single write
+	// - Socket will be shutdown (but not closed) on error
+	_Check_return_ static Result SendGather(SOCKET s, _In_reads_(Count) const WSABUF* Buffers, size_t Count,
+		_Inout_opt_ std::string* LastErrString = nullptr);
+	// SendAvailable: Write as much of the contents of buffers as a nonblocking session socket will currently accept
+	// - Returns OK with number of bytes written in BytesSent (zero if socket buffer is full), or Failed on error
+	// - Socket will be shutdown (but not closed) on error
+	_Check_return_ static Result SendAvailable(SOCKET s, _In_reads_(Count) const WSABUF* Buffers, size_t Count,
+		size_t& BytesSent, _Inout_opt_ std::string* LastErrString = nullptr);
 	// ReadExact: Read a specific number of bytes from session socket
 	// - Socket will be shutdown (but not closed) on error, also on timeout IF only some bytes were read (prevent fragmentation)
 	_Check_return_ static Result ReadExact(SOCKET s, _Out_writes_(BytesToRead) char* Tgt, size_t BytesToRead, int Timeout,
@@ -101,6 +216,12 @@ public:
 	// - Function will block if no data pending (assumes caller has already checked for available data)
 	_Check_return_ static Result ReadAvailable(SOCKET s, _Out_writes_(MaxBytes) char* Tgt, size_t MaxBytes, size_t& BytesRead,
 		_Inout_opt_ std::string* LastErrString = nullptr);
+	// ReadFrame: Read one frame as defined by framing codec (see Framing), placing its payload (up to MaxBytes) in Tgt
+	// - Socket will be shutdown (but not closed on error), also on timeout IF partial frame is read (prevent fragmentation)
+	// - Frames of Scanned codecs are located by peeking at pending data, and must fit (with their framing) in MaxBytes
+	template<typename Codec>
+	_Check_return_ static Result ReadFrame(SOCKET s, _Out_writes_(MaxBytes) char* Tgt, size_t MaxBytes, size_t& BytesRead,
+		int Timeout, _Inout_opt_ std::string* LastErrString = nullptr);
 	// ReadPacket: Read a two-byte length header followed by the indicated number of bytes (up to MaxBytes)
 	// - Socket will be shutdown (but not closed on error), also on timeout IF partial packet is read (prevent fragmentation)
 	_Check_return_ static Result ReadPacket(SOCKET s, _Out_writes_(MaxBytes) char* Tgt, size_t MaxBytes, size_t& BytesRead,
@@ -111,6 +232,25 @@ public:
 	// CloseSocket: Close socket and invalidate socket handle
 	static void Close(SOCKET& s) {if(s != INVALID_SOCKET) closesocket(s); s = INVALID_SOCKET;}
 
+	// SendBuffer: Output accepted for delivery to a nonblocking session socket but not yet written (see
+	// SessionSocket::Write); holds bytes exactly as they are to be written to the socket (i.e. encrypted, if using TLS)
+	struct SendBuffer {
+		std::vector<char> data;	// Pending bytes, of which those ahead of offset have already been written
+		size_t offset = 0;
+		_Check_return_ size_t Size() const noexcept {return (data.size() - offset);}
+		_Check_return_ bool Empty() const noexcept {return (offset >= data.size());}
+		void Consume(size_t bytes) { // Discard written bytes, compacting once more than half of buffer is consumed
+			if((offset += bytes) >= data.size()) {
+				data.clear();
+				offset = 0;
+			}
+			else if(offset > data.size() / 2) {
+				data.erase(data.begin(), data.begin() + offset);
+				offset = 0;
+			}
+		}
+	};
+
 	// Forward declarations for ServerSocket, SessionSocket class and smart pointers:
 	class ServerSocket;
 	using ServerSocketPtr = std::unique_ptr<ServerSocket>;
@@ -139,9 +279,23 @@ public:
 		}
 		//==================================================================================================================
 		// Socket management functions
-		_Check_return_ bool Open(unsigned short ListenPort, _In_opt_z_ const char* Interface = nullptr, int Backlog = 10);
+		// - Open: NonBlocking flag places listener socket in nonblocking mode, for use with AcceptPending (allowing any
+		//   number of threads to poll the same listener and drain pending connections without blocking); Interface may
+		//   be a unix domain address (see IsUnixAddress), in which case socket file is removed again by Close
+		_Check_return_ bool Open(unsigned short ListenPort, _In_opt_z_ const char* Interface = nullptr,
+			int Backlog = LISTEN_BACKLOG_DEFAULT, bool NonBlocking = false);
 		_Check_return_ Result WaitEvent(int Timeout) const;
-		void Close() {SocketOps::Close(SocketHandle);}
+		// SelectAcceptEvent: Signal specified event whenever a connection is pending, for waiting on listener alongside
+		// other objects (replaces any event previously selected, or cancels selection if Event is null; does not update
+		// server object error text, as per AcceptPending, and sessions accepted by AcceptPending do not inherit it)
+		_Check_return_ bool SelectAcceptEvent(HANDLE Event, _Inout_opt_ std::string* ErrString = nullptr);
+		void Close() {
+			SocketOps::Close(SocketHandle);
+			if(UnixPath.empty() == false) {
+				DeleteFileA(UnixPath.c_str());
+				UnixPath.clear();
+			}
+		}
 		//==================================================================================================================
 		// Accept function: Accepts new incoming session
 		// - Note that this function will block waiting for a new connection, caller is assumed to have used WaitEvent
@@ -153,19 +307,33 @@ public:
 		// - Note that this function will NOT block to perform TLS negotiation
 		_Check_return_ SessionSocketPtr StartAccept(_Inout_opt_ sockaddr_in* saddr = nullptr,
 			size_t TLSBufferSize = SocketOps::TLS_BUFFER_SIZE_DEFAULT);
+		// AcceptPending function: Accepts pending incoming session, if any (listener must be opened in nonblocking mode)
+		// - Returns OK with new session in "sp" (TLS negotiation started but not completed, as per StartAccept), Timeout
+		//   if no connection was pending, or Failed on error
+		// - Does not update server object error text (safe to call from multiple threads against the same listener)
+		_Check_return_ Result AcceptPending(SessionSocketPtr& sp, _Inout_opt_ std::string* ErrString = nullptr,
+			_Inout_opt_ sockaddr_in* saddr = nullptr, size_t TLSBufferSize = SocketOps::TLS_BUFFER_SIZE_DEFAULT);
 		// PollAccept function: Checks whether TLS negotiation is required (if so, attempts to complete without blocking)
 		_Check_return_ Result PollAccept(const SessionSocketPtr& sp);
 		//==================================================================================================================
 		// Credential management functions
-		_Check_return_ bool CredentialsValid() const noexcept {
-			return ((hCreds.dwLower || hCreds.dwUpper) && pCertContext && hMyCertStore && SchannelCred.dwVersion);
-		}
+		_Check_return_ bool CredentialsValid() const noexcept;
 		_Check_return_ bool InitCredentialsFromStore( // Reads certificate from store (Local Machine or Current User)
 			const std::string& CertName, const std::string& TLSMethod = "", bool LocalMachineStore = true);
 		_Check_return_ bool InitCredentialsFromFile( // Reads certificate from PKCS12 store file
 			const std::string& FileName, const std::string& FilePassword, const std::string& CertName,
 			const std::string& TLSMethod = "");
 		void CleanupCredentials();
+		//==================================================================================================================
+		// Session ticket functions - Listener installs its own ticket encryption keys (once credentials are initialized),
+		// replacing them after each rotation interval; the previous key is retained alongside the current one, so that
+		// tickets issued shortly before a rotation can still be resumed
+		// - Rotation is checked at the start of each negotiation; RotateTicketKeys forces immediate rotation
+		// - If keys cannot be installed (SDK or OS without ticket key support), SChannel's own ticket keys are used
+		void SetTicketKeyRotation(int Interval) noexcept {
+			TicketKeyInterval = (Interval < SocketOps::TICKET_KEY_ROTATION_MIN) ? SocketOps::TICKET_KEY_ROTATION_MIN : Interval;
+		}
+		_Check_return_ bool RotateTicketKeys();
 
 		//==================================================================================================================
 		// Public constructor (locked by private pass key), destructor
@@ -186,16 +354,39 @@ public:
 		// Private utility functions
 		_Check_return_ bool CompleteInitCredentials(const std::string& TLSMethod);
 		_Check_return_ Result TLSNegotiate(const SessionSocketPtr& sp, int Timeout);
+		_Check_return_ bool InstallTicketKeys(std::string& ErrString);
+#ifdef FIQ_TLS_OPENSSL
+		static int TicketKeyCallback(SSL* ssl, unsigned char* KeyName, unsigned char* IV,
+			EVP_CIPHER_CTX* CipherCtx, EVP_MAC_CTX* MacCtx, int Encrypt);
+#endif
+
+		// TicketKey: Session ticket encryption key (identifier and keying material, randomly generated)
+		struct TicketKey {
+			unsigned char Id[16];
+			unsigned char Material[64];
+		};
 
 		// Private member variables
 		SOCKET SocketHandle = INVALID_SOCKET;	// Handle to listener socket
 		mutable std::string LastErrString;		// Storage for last error on this socket
+		std::string UnixPath;					// Socket file created by listener, if bound to unix domain address
 		// Private member variables - TLS credentials
 		bool UsingTLS = false;					// By default, TLS not in use (credentials not required)
+#ifdef FIQ_TLS_OPENSSL
+		SSL_CTX* SslContext = nullptr;			// Context holding certificate and key, shared by all accepted sessions
+#else
 		SCHANNEL_CRED SchannelCred = {0};		// Holds configuration parameters
 		HCERTSTORE hMyCertStore = nullptr;		// Handle held from init to cleanup
 		PCCERT_CONTEXT pCertContext = nullptr;	// Handle held from init to cleanup
 		CredHandle hCreds = {0};				// Handle actually used for negotiations
+#endif
+		// Private member variables - TLS session ticket keys (protected by TicketLock, as negotiations may run concurrently)
+		std::mutex TicketLock;
+		TicketKey TicketKeys[2] = {};			// Current key, followed by previous key
+		size_t TicketKeyCount = 0;				// Number of valid keys in TicketKeys
+		bool TicketKeysSupported = false;		// Set once keys have been installed successfully
+		int TicketKeyInterval = SocketOps::TICKET_KEY_ROTATION_DEFAULT;
+		SteadyClock TicketKeyRotateAt;			// Time at which current key is due to be replaced
 	};
 
 	//======================================================================================================================
@@ -221,40 +412,78 @@ public:
 		_Check_return_ bool IsSocket(SOCKET s) const noexcept {return (s == SocketHandle);}
 		_Check_return_ bool TLSReady() const noexcept {
 			return (
-				ValueOps::Is(TLSBufSize).InRange(SocketOps::TLS_BUFFER_SIZE_MIN, SocketOps::TLS_BUFFER_SIZE_MAX)
-				&& ReadBuf.get()
-				&& ClearBuf.get()
+				UsingTLS
+				&& ValueOps::Is(TLSBufSize).InRange(SocketOps::TLS_BUFFER_SIZE_MIN, SocketOps::TLS_BUFFER_SIZE_MAX)
 			);
 		}
-		bool AddToFD(std::vector<WSAPOLLFD>& fd) const noexcept(false) {
-			return (SocketHandle != INVALID_SOCKET) ? (fd.push_back(WSAPOLLFD{SocketHandle,POLLRDNORM,0}), true) : false;
+		bool AddToFD(std::vector<WSAPOLLFD>& fd, short Events = POLLRDNORM) const noexcept(false) {
+			return (SocketHandle != INVALID_SOCKET) ? (fd.push_back(WSAPOLLFD{SocketHandle,Events,0}), true) : false;
 		}
+		_Check_return_ bool DataBuffered() const noexcept; // Decrypted or raw TLS data already read from socket
 		void SetSessionFlags(SocketFlags sf) noexcept {SessionFlags |= sf;}
-		std::string GetTLSCipherSuite() const {return StringOps::ConvertFromWideString(CipherInfo.szCipherSuite);}
-		std::string GetTLSCipher() const {return StringOps::ConvertFromWideString(CipherInfo.szCipher);}
-		std::string GetTLSHash() const {return StringOps::ConvertFromWideString(CipherInfo.szHash);}
-		std::string GetTLSExchange() const {return StringOps::ConvertFromWideString(CipherInfo.szExchange);}
+		std::string GetTLSCipherSuite() const;
+		std::string GetTLSCipher() const;
+		std::string GetTLSHash() const;
+		std::string GetTLSExchange() const;
+		_Check_return_ bool TLSResumed() const noexcept {return TLSSessionResumed;} // Negotiation resumed cached session
+		_Check_return_ TLSOffload GetTLSOffload() const noexcept {return TLSOffloadMode;} // Kernel offload in use
 		//==================================================================================================================
 		// Socket management functions
 		_Check_return_ Result PollConnect(int TLSTimeout = 0, const std::string& TLSMethod = "");
 		_Check_return_ Result WaitEvent(int Timeout) const;
 		_Check_return_ Result Send(_In_reads_(len) const char* buf, size_t len);
+		_Check_return_ Result Send(_In_reads_(Count) const WSABUF* Buffers, size_t Count);
 		_Check_return_ Result ReadExact(_Out_writes_(BytesToRead) char* Tgt, size_t BytesToRead, int Timeout);
 		_Check_return_ Result ReadAvailable(_Out_writes_(MaxBytes) char* Tgt, size_t MaxBytes, size_t& BytesRead);
 		_Check_return_ Result ReadPacket(_Out_writes_(MaxBytes) char* Tgt, size_t MaxBytes, size_t& BytesRead, int Timeout);
+		// ReadPacketView: As ReadPacket, but returns view of packet data in place within session's cleartext buffer
+		// rather than copying it (TLS sessions only; packet must fit within TLS buffer)
+		// - View remains valid only until the next read from (or close of) this session
+		_Check_return_ Result ReadPacketView(gsl::span<const char>& Packet, int Timeout);
+		//==================================================================================================================
+		// Framed I/O functions - As ReadPacket/ReadPacketView and Send, with framing defined at compile time by codec (see
+		// Framing) rather than by session flags; ReadPacket and ReadPacketView use Length2BE or Extended codecs
+		// - SendFrame writes framing and payload together, and (like Send) must not be used on a nonblocking session
+		template<typename Codec>
+		_Check_return_ Result ReadFrame(_Out_writes_(MaxBytes) char* Tgt, size_t MaxBytes, size_t& BytesRead, int Timeout);
+		template<typename Codec>
+		_Check_return_ Result ReadFrameView(gsl::span<const char>& Payload, int Timeout);
+		template<typename Codec>
+		_Check_return_ Result SendFrame(_In_reads_(len) const char* buf, size_t len);
 		void Shutdown() {SocketOps::Shutdown(SocketHandle);}
+		//==================================================================================================================
+		// Nonblocking output functions - Once session is placed in nonblocking mode, Write delivers data as far as the
+		// socket will accept without waiting, and appends the remainder to a caller-held SendBuffer (behind any output
+		// already pending there); WriteBacklog continues delivery of that remainder, once socket is writable again
+		// - Send functions above must not be used on a nonblocking session (as they treat a partial write as failure)
+		// - Read functions may still be used (they wait for data before reading)
+		_Check_return_ bool SetNonBlocking(bool NonBlocking);
+		_Check_return_ Result Write(_In_reads_(Count) const WSABUF* Buffers, size_t Count, SendBuffer& Backlog);
+		_Check_return_ Result WriteBacklog(SendBuffer& Backlog);
+		//==================================================================================================================
+		// Completion port functions - Socket is associated with a port once, after which each PostReadNotify call queues
+		// a zero-byte overlapped receive which completes to the port when data arrives (or the session fails/closes);
+		// data is then read by the normal (blocking) read functions, so no buffer is pinned while waiting
+		// - Overlapped structure must remain valid until its completion has been dequeued, even if socket is closed
+		_Check_return_ bool AssociateCompletionPort(HANDLE Port, ULONG_PTR Key);
+		_Check_return_ Result PostReadNotify(_Inout_ OVERLAPPED* Overlapped);
+		// - SelectWriteEvent: Signal specified event whenever socket becomes writable again after a nonblocking write
+		//   was held (see Write), as zero-byte reads cannot report writability; socket must remain in nonblocking mode
+		_Check_return_ bool SelectWriteEvent(HANDLE Event);
+		//==================================================================================================================
+		// GetTcpInfo: Sample system's TCP statistics for session (SIO_TCP_INFO, Windows 10 1703 or later); returns false
+		// if socket is closed or statistics are not available
+		_Check_return_ bool GetTcpInfo(TcpInfo& Info) const noexcept;
 		void Close() {
 			SocketOps::Close(SocketHandle);
 			// Reset state of TLS member variables (if any)
 			TLSComplete = false;
-			ReadBufBytes = ClearBufBytes = 0;
-			memset(&StreamSizes, 0, sizeof(StreamSizes));
-			memset(&CipherInfo, 0, sizeof(CipherInfo));
-			if(UsingTLS ? (hContext.dwLower || hContext.dwUpper) : false) {
-				SocketOps::GetFunctionTable()->DeleteSecurityContext(&hContext);
-				hContext.dwLower = hContext.dwUpper = 0;
-			}
-			ClientCred.reset(nullptr);
+			ReadBufOffset = ReadBufBytes = ClearBufOffset = ClearBufBytes = 0;
+			ReleaseIdleTLSBuffers();
+			if(UsingTLS) CloseTLS();
+			ClientCred.reset();
+			TLSSessionResumed = false;
+			TLSOffloadMode = TLSOffload::None;
 		}
 
 		//==================================================================================================================
@@ -262,12 +491,9 @@ public:
 		SessionSocket(SocketOps::pass_key, bool _UsingTLS, size_t _TLSBufSize) : UsingTLS(_UsingTLS),
 			TLSBufSize(ValueOps::Bounded(SocketOps::TLS_BUFFER_SIZE_MIN, _TLSBufSize, SocketOps::TLS_BUFFER_SIZE_MAX)),
 			SocketHandle(INVALID_SOCKET), SessionFlags(SocketFlags::None), TLSComplete(false),
-			ReadBuf(nullptr), ReadBufBytes(0), ClearBuf(nullptr), ClearBufBytes(0) {
+			ReadBuf(nullptr, TLSBufferRelease{TLSBufSize + 10}), ReadBufOffset(0), ReadBufBytes(0),
+			ClearBuf(nullptr, TLSBufferRelease{TLSBufSize + 10}), ClearBufOffset(0), ClearBufBytes(0) {
 			static_assert(SocketOps::TLS_BUFFER_SIZE_MAX <= ULONG_MAX, "Invalid maximum TLS buffer size");
-			if(UsingTLS) {
-				ReadBuf = std::make_unique<char[]>(TLSBufSize + 10);
-				ClearBuf = std::make_unique<char[]>(TLSBufSize + 10);
-			}
 		}
 		~SessionSocket() noexcept(false) {Close();}
 		// Deleted copy/move constructors and assignment operators
@@ -280,17 +506,74 @@ public:
 
 		// Private utility functions
 		_Check_return_ Result TLSNegotiate(int Timeout, const std::string& Method);
-		_Check_return_ Result SendTLS(_In_reads_(len) const char* buf, size_t len);
+		_Check_return_ Result SendTLS(_In_reads_(Count) const WSABUF* Buffers, size_t Count);
+		_Check_return_ Result EncryptRecords(_In_reads_(Count) const WSABUF* Buffers, size_t Count,
+			std::vector<char>& Tgt, bool Deliver);
+		_Check_return_ Result EncryptTLS(_In_reads_(Count) const WSABUF* Buffers, size_t Count, std::vector<char>& Tgt);
 		_Check_return_ Result ReadExactTLS(_Out_writes_(BytesToRead) char* Tgt, size_t BytesToRead, int Timeout);
 		_Check_return_ Result ReadAvailableTLS(_Out_writes_(MaxBytes) char* Tgt, size_t MaxBytes, size_t& BytesRead);
-		_Check_return_ Result ReadPacketTLS(_Out_writes_(MaxBytes) char* Tgt, size_t MaxBytes, size_t& BytesRead, int Timeout);
+		template<typename Codec>
+		_Check_return_ Result ReadFrameViewTLS(gsl::span<const char>& Payload, int Timeout);
+		_Check_return_ Result FillClearTLS(size_t BytesRequired, int Timeout);
+		_Check_return_ bool KernelTLSSend() const noexcept {
+			return (TLSOffloadMode == TLSOffload::Send || TLSOffloadMode == TLSOffload::Full);
+		}
+		_Check_return_ bool KernelTLSReceive() const noexcept {
+			return (TLSOffloadMode == TLSOffload::Receive || TLSOffloadMode == TLSOffload::Full);
+		}
 		_Check_return_ Result PrivateReadTLS(int Timeout);
+		// AcquireTLSBuffers: Take read and cleartext buffers from pool (if not already held)
+		// ReleaseIdleTLSBuffers: Return any buffer which holds no unconsumed data to pool
+		void AcquireTLSBuffers();
+		void ReleaseIdleTLSBuffers() noexcept {
+			if(ReadBufBytes == 0) {ReadBuf.reset(); ReadBufOffset = 0;}
+			if(ClearBufBytes == 0) {ClearBuf.reset(); ClearBufOffset = 0;}
+		}
+		_Check_return_ bool TLSBuffersValid() const noexcept {
+			return (ReadBufOffset + ReadBufBytes <= TLSBufSize && ClearBufOffset + ClearBufBytes <= TLSBufSize);
+		}
+		// ConsumeClearTLS: Discard bytes from start of cleartext data (buffer is not compacted until space is required,
+		// so that data just consumed remains readable in place until next read)
+		void ConsumeClearTLS(size_t Bytes) noexcept {
+			ClearBufBytes -= Bytes;
+			ClearBufOffset = (ClearBufBytes > 0) ? ClearBufOffset + Bytes : 0;
+		}
+		// CompactReadTLS, CompactClearTLS: Move unconsumed data (if any) to start of buffer, maximizing space at end
+		void CompactReadTLS() noexcept {
+			if(ReadBufOffset > 0 && ReadBufBytes > 0) memmove(ReadBuf.get(), ReadBuf.get() + ReadBufOffset, ReadBufBytes);
+			ReadBufOffset = 0;
+		}
+		void CompactClearTLS() noexcept {
+			if(ClearBufOffset > 0 && ClearBufBytes > 0) memmove(ClearBuf.get(), ClearBuf.get() + ClearBufOffset, ClearBufBytes);
+			ClearBufOffset = 0;
+		}
+		_Check_return_ size_t TLSMessageMax() const noexcept; // Largest cleartext message which can be sent at once
+		void CloseTLS() noexcept; // Release backend security context and reset negotiated values
+#ifdef FIQ_TLS_OPENSSL
+		// Private utility functions - OpenSSL session is driven through memory buffers: raw data read from socket is
+		// written to session's read buffer, and session output is drained from its write buffer to socket
+		_Check_return_ bool StartTLS(SSL_CTX* Context, bool Server);
+		_Check_return_ Result NegotiateTLS(int Timeout, bool Server);
+		_Check_return_ Result ReceiveTLS(int Timeout);
+		_Check_return_ Result FlushTLS();
+		_Check_return_ Result CompleteKernelTLS();
+#endif
 
 		// ClientCredentials: Container class for TLS context variables
+		// - Acquire returns the credential shared by all client sessions using the specified TLS method (creating it if
+		//   required), as client session cache is held against the credential handle (SChannel) or context (OpenSSL)
 		class ClientCredentials {
 		public:
+			_Check_return_ static std::shared_ptr<ClientCredentials> Acquire(const std::string& TLSMethod,
+				std::string& LastErrString);
+			static void ReleaseShared();
+#ifdef FIQ_TLS_OPENSSL
+			_Check_return_ bool Valid() const noexcept {return (SslContext != nullptr);}
+			_Check_return_ SSL_CTX* GetContext() noexcept {return SslContext;}
+#else
 			_Check_return_ bool Valid() const noexcept {return (hCreds.dwLower || hCreds.dwUpper );}
 			_Check_return_ CredHandle* GetCreds() noexcept {return &hCreds;}
+#endif
 			_Check_return_ bool Init(const std::string& TLSMethod, std::string& LastErrString);
 			void Cleanup();
 			// Public constructor/destructor
@@ -301,9 +584,24 @@ public:
 			ClientCredentials(ClientCredentials&&) = delete;
 			ClientCredentials& operator=(const ClientCredentials&) = delete;
 			ClientCredentials& operator=(ClientCredentials&&) = delete;
+#ifdef FIQ_TLS_OPENSSL
+			// Client session cache: most recent session issued by each endpoint (holds a reference to each session)
+			void StoreSession(const std::wstring& Target, SSL_SESSION* Session);
+			_Check_return_ SSL_SESSION* FindSession(const std::wstring& Target); // Returns new reference (or null)
+#endif
 		private:
+			_Check_return_ static std::mutex& GetSharedLock() noexcept;
+			_Check_return_ static std::map<std::string, std::shared_ptr<ClientCredentials>>& GetShared() noexcept;
+#ifdef FIQ_TLS_OPENSSL
+			static constexpr size_t SESSION_CACHE_MAX = 1024;
+			static int NewSessionCallback(SSL* ssl, SSL_SESSION* Session);
+			SSL_CTX* SslContext = nullptr;
+			std::mutex SessionLock;
+			std::map<std::wstring, SSL_SESSION*> Sessions;
+#else
 			CredHandle hCreds = {0};
 			SCHANNEL_CRED SchannelCred = {0};
+#endif
 		};
 
 		// Private member variables
@@ -314,25 +612,130 @@ public:
 		mutable std::string LastErrString;	// Storage for last error on this socket
 
 		// Private member variables - TLS-only
-		std::unique_ptr<ClientCredentials> ClientCred = nullptr; // Pointer to client credentials (client mode only)
+		std::shared_ptr<ClientCredentials> ClientCred = nullptr; // Pointer to shared client credentials (client mode only)
+		std::wstring TLSTarget;							// Remote endpoint ("IP:port") identifying cached sessions (client mode only)
+		bool TLSSessionResumed = false;					// Flag indicating negotiation resumed a cached session
+		TLSOffload TLSOffloadMode = TLSOffload::None;	// Directions handled by kernel TLS (once negotiation completes)
+		std::vector<char> EncryptBuf;					// Encrypted records awaiting delivery by SendTLS (reused by each send)
+#ifdef FIQ_TLS_OPENSSL
+		SSL* SslSession = nullptr;						// Session object (reading from and writing to memory buffers)
+		bool TLSSocketBio = false;						// Flag indicating handshake runs directly on socket (kernel TLS)
+		std::vector<char> GatherBuf;					// Cleartext of record built from multiple buffers (reused by each send)
+#else
 		CtxtHandle hContext = {0};						// Security context handle
 		SecPkgContext_CipherInfo CipherInfo = {0};		// Negotiated cipher data
 		SecPkgContext_StreamSizes StreamSizes = {0};	// Cached stream buffer sizes (based on negotiated protocol)
+#endif
 		bool TLSComplete;					// Flag indicating TLS negotiation has completed
-		std::unique_ptr<char[]>	ReadBuf;	// Standard TLS socket read buffer (holds raw incoming data)
-		size_t ReadBufBytes;				// Number of bytes currently available in ReadBuf
-		std::unique_ptr<char[]>	ClearBuf;	// Buffered TLS data buffer (holds decrypted cleartext data)
-		size_t ClearBufBytes;				// Number of bytes currently available in ClearBuf
+		TLSBuffer ReadBuf;					// Standard TLS socket read buffer (holds raw incoming data, pooled)
+		size_t ReadBufOffset;				// Offset of first unprocessed byte in ReadBuf
+		size_t ReadBufBytes;				// Number of bytes currently available in ReadBuf (from ReadBufOffset)
+		TLSBuffer ClearBuf;					// Buffered TLS data buffer (holds decrypted cleartext data, pooled)
+		size_t ClearBufOffset;				// Offset of first unconsumed byte in ClearBuf
+		size_t ClearBufBytes;				// Number of bytes currently available in ClearBuf (from ClearBufOffset)
 
 		// Access declarations
 		friend ServerSocket; // Allow ServerSocket to access internal members
+		friend SocketOps; // Allow library functions to release shared client credentials
+	};
+
+	//======================================================================================================================
+	// WakeSocket: Connected pair of loopback datagram sockets, allowing any thread to interrupt another thread waiting in
+	// WSAPoll (receiving socket is included in the waiting thread's poll set, and Wake sends a single byte to it)
+	class WakeSocket {
+	public:
+		_Check_return_ const std::string& GetLastErrString() const noexcept {return LastErrString;}
+		_Check_return_ bool Valid() const noexcept {return (ReceiveHandle != INVALID_SOCKET && SendHandle != INVALID_SOCKET);}
+		bool AddToFD(std::vector<WSAPOLLFD>& fd) const noexcept(false) {
+			return Valid() ? (fd.push_back(WSAPOLLFD{ReceiveHandle,POLLRDNORM,0}), true) : false;
+		}
+		_Check_return_ bool Open();
+		void Wake() const noexcept;	// Safe to call from any thread (while socket is open)
+		void Drain() const noexcept;	// Discard pending wake signals (call from waiting thread only)
+		void Close() {
+			SocketOps::Close(ReceiveHandle);
+			SocketOps::Close(SendHandle);
+		}
+		// Public default constructor, destructor
+		WakeSocket() noexcept = default;
+		~WakeSocket() noexcept(false) {Close();}
+		// Deleted copy/move constructors and assignment operators
+		WakeSocket(const WakeSocket&) = delete;
+		WakeSocket(WakeSocket&&) = delete;
+		WakeSocket& operator=(const WakeSocket&) = delete;
+		WakeSocket& operator=(WakeSocket&&) = delete;
+	private:
+		SOCKET ReceiveHandle = INVALID_SOCKET;	// Bound to loopback, nonblocking
+		SOCKET SendHandle = INVALID_SOCKET;		// Connected to receiving socket's address
+		std::string LastErrString;				// Storage for last error on open
+	};
+
+	//======================================================================================================================
+	// ConnectRace: Outbound connection raced across several addresses of the same remote, in the manner of RFC 8305
+	// ("Happy Eyeballs" version 2)
+	// - Addresses are interleaved by family, starting with the family of the first (most preferred) address; attempts are
+	//   started in that order, each once the attempt delay has passed since the previous one started, or as soon as all
+	//   attempts in progress have failed
+	// - First attempt to complete its handshake (including TLS negotiation, if used) is handed to caller by Poll; all other
+	//   attempts are abandoned, closing their sockets
+	// - Note this class is NOT internally thread-safe; use object within single thread only (or protect with locks)
+	class ConnectRace {
+	public:
+		static constexpr int ATTEMPT_DELAY_DEFAULT	= 250;	// Delay before starting next attempt (milliseconds)
+		static constexpr int ATTEMPT_DELAY_MIN		= 10;
+		static constexpr int ATTEMPT_DELAY_MAX		= 2000;
+		// Start: Order addresses and start first attempt (returns false if no attempt could be started)
+		// Poll: Advance race; returns OK with connected socket in Winner, Timeout if still in progress, or Failed once
+		// every address has failed
+		_Check_return_ bool Start(const std::vector<std::string>& RemoteIPs, unsigned short RemotePort,
+			bool UsingTLS = false, int AttemptDelay = ATTEMPT_DELAY_DEFAULT);
+		_Check_return_ Result Poll(SessionSocketPtr& Winner, const std::string& TLSMethod = "");
+		_Check_return_ const std::string& GetLastErrString() const noexcept {return LastErrString;}
+		_Check_return_ size_t AttemptsStarted() const noexcept {return NextAddress;}
+		_Check_return_ size_t AttemptsActive() const noexcept {return Attempts.size();}
+		// Public default constructor, destructor
+		ConnectRace() noexcept(false) = default;
+		~ConnectRace() noexcept(false) = default;
+		// Deleted copy/move constructors and assignment operators
+		ConnectRace(const ConnectRace&) = delete;
+		ConnectRace(ConnectRace&&) = delete;
+		ConnectRace& operator=(const ConnectRace&) = delete;
+		ConnectRace& operator=(ConnectRace&&) = delete;
+	private:
+		_Check_return_ bool StartNext();
+		std::vector<std::string> Addresses;			// All addresses, in attempt order
+		size_t NextAddress = 0;						// Index of next address to attempt
+		std::vector<SessionSocketPtr> Attempts;		// Attempts in progress
+		unsigned short Port = 0;
+		bool TLS = false;
+		int Delay = ATTEMPT_DELAY_DEFAULT;
+		SteadyClock NextAttemptAt;					// Time at which next attempt is due (if any remain)
+		std::string LastErrString;					// Error from most recent failed attempt
 	};
 
 private:
 
+	// Private TLS backend initialization functions (called by InitializeSockets/CleanupSockets)
+	static void InitializeTLS();
+	static void CleanupTLS();
+#ifndef FIQ_TLS_OPENSSL
 	// Private static object accessor functions
 	_Check_return_ static HMODULE& GetSChannel() noexcept;
 	_Check_return_ static PSecurityFunctionTable& GetFunctionTable() noexcept;
+#endif
+	// Private TLS session resumption counters (defined with accessor), and functions recording outcome of each negotiation
+	// and each ticket key installation
+	struct TLSResumptionCounters;
+	_Check_return_ static TLSResumptionCounters& GetTLSCounters() noexcept;
+	_Check_return_ static bool CountTLSHandshake(bool Server, bool Resumed) noexcept;
+	static void CountTicketKeyRotation() noexcept;
+	// Private framed read implementations, selected by codec's strategy (see ReadFrame)
+	template<typename Codec>
+	_Check_return_ static Result ReadFrame(SOCKET s, _Out_writes_(MaxBytes) char* Tgt, size_t MaxBytes, size_t& BytesRead,
+		int Timeout, _Inout_opt_ std::string* LastErrString, Framing::Prefixed);
+	template<typename Codec>
+	_Check_return_ static Result ReadFrame(SOCKET s, _Out_writes_(MaxBytes) char* Tgt, size_t MaxBytes, size_t& BytesRead,
+		int Timeout, _Inout_opt_ std::string* LastErrString, Framing::Scanned);
 };
 
 //==========================================================================================================================
@@ -341,23 +744,41 @@ private:
 GSL_SUPPRESS(type.1) // reinterpret_cast is preferable to C-style cast (required for call to bind())
 _Check_return_ inline SOCKET SocketOps::InitServer(
 	unsigned short ListenPort, _In_opt_z_ const char* Interface, int Backlog, _Inout_opt_ std::string* LastErrString) {
-	if(ListenPort == 0) {
+	const bool unixdomain = IsUnixAddress(Interface);
+	if(ListenPort == 0 && unixdomain == false) {
 		if(LastErrString) *LastErrString = "Invalid listening port";
 		return INVALID_SOCKET;
 	}
 	else if(LastErrString) LastErrString->clear();
 	try {
-		const SOCKET s = socket(AF_INET, SOCK_STREAM, 0);
+		// Create binding object (unix domain path, or IPv4 port and optional interface):
+		sockaddr_storage saddr = {0};
+		int saddrlen = sizeof(sockaddr_in);
+		if(unixdomain) {
+			if(ParseAddress(Interface, 0, saddr, saddrlen) == false) {
+				if(LastErrString) *LastErrString = "Invalid unix domain socket path";
+				return INVALID_SOCKET;
+			}
+			// Remove socket file left by previous listener, if any (bind would fail otherwise); other files are left
+			// in place, so that bind fails rather than deleting something which is not a socket:
+			const char* const path = reinterpret_cast<const sockaddr_un*>(&saddr)->sun_path;
+			const DWORD attributes = GetFileAttributesA(path);
+			if(attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_REPARSE_POINT)) DeleteFileA(path);
+		}
+		else {
+			sockaddr_in* const v4 = reinterpret_cast<sockaddr_in*>(&saddr);
+			v4->sin_family = AF_INET;
+			v4->sin_port = htons(ListenPort);
+			if((Interface ? Interface[0] : 0) != 0) inet_pton(v4->sin_family, Interface, &v4->sin_addr.s_addr);
+			else v4->sin_addr.s_addr = htonl(INADDR_ANY);
+		}
+		const SOCKET s = socket(saddr.ss_family, SOCK_STREAM, 0);
 		if(s != INVALID_SOCKET) {
-			// Create binding object and attempt socket bind:
-			sockaddr_in saddr = {0};
-			saddr.sin_family = AF_INET;
-			saddr.sin_port = htons(ListenPort);
-			if((Interface ? Interface[0] : 0) != 0) inet_pton(saddr.sin_family, Interface, &saddr.sin_addr.s_addr);
-			else saddr.sin_addr.s_addr = htonl(INADDR_ANY);
-			if(bind(s, reinterpret_cast<const sockaddr*>(&saddr), sizeof(saddr)) != SOCKET_ERROR) {
-				// Binding successful, attempt start listening and return socket if successful:
-				if(listen(s, Backlog) != SOCKET_ERROR) return s;
+			// Attempt socket bind:
+			if(bind(s, reinterpret_cast<const sockaddr*>(&saddr), saddrlen) != SOCKET_ERROR) {
+				// Binding successful, attempt start listening and return socket if successful (backlog values above the
+				// provider's traditional limit are passed as a hint, so that larger queues are honoured):
+				if(listen(s, (Backlog > LISTEN_BACKLOG_HINT_MIN) ? SOMAXCONN_HINT(Backlog) : Backlog) != SOCKET_ERROR) return s;
 				else if(LastErrString) *LastErrString = Exceptions::ConvertCOMError(WSAGetLastError());
 			}
 			else if(LastErrString) *LastErrString = Exceptions::ConvertCOMError(WSAGetLastError());
@@ -380,9 +801,12 @@ _Check_return_ inline SOCKET SocketOps::Accept(
 	}
 	else if(LastErrString) LastErrString->clear();
 	try {
-		// Attempt to accept new socket connection:
-		int saddr_len = sizeof(sockaddr_in);
-		const SOCKET c = accept(server, reinterpret_cast<sockaddr*>(saddr), saddr ? &saddr_len : nullptr);
+		// Attempt to accept new socket connection (into storage large enough for any family, as unix domain addresses
+		// do not fit sockaddr_in), then return client details to caller if IPv4:
+		sockaddr_storage caddr = {0};
+		int caddr_len = sizeof(caddr);
+		const SOCKET c = accept(server, reinterpret_cast<sockaddr*>(&caddr), &caddr_len);
+		if(saddr != nullptr && caddr.ss_family == AF_INET) memcpy(saddr, &caddr, sizeof(sockaddr_in));
 		if(c != INVALID_SOCKET) {
 			// Connection accepted, set socket options before returning (enable keepalive, disable Nagle algorithm):
 			constexpr char keepaliveopt = 1, nodelayopt = 1;
@@ -394,6 +818,42 @@ _Check_return_ inline SOCKET SocketOps::Accept(
 	}
 	catch(const std::exception&) {std::throw_with_nested(FORMAT_RUNTIME_ERROR("Session accept failed"));}
 }
+// SocketOps::AcceptPending: Accept incoming connection request from nonblocking listener, if one is pending
+GSL_SUPPRESS(type.1) // reinterpret_cast is preferable to C-style cast (required for call to accept())
+_Check_return_ inline SocketOps::Result SocketOps::AcceptPending(
+	SOCKET server, SOCKET& client, _Inout_opt_ sockaddr_in* saddr, _Inout_opt_ std::string* LastErrString) {
+	// Validate inputs, default outputs:
+	client = INVALID_SOCKET;
+	if(saddr != nullptr) memset(saddr, 0, sizeof(sockaddr_in));
+	if(server == INVALID_SOCKET) return Result::InvalidSocket;
+	else if(LastErrString) LastErrString->clear();
+	try {
+		sockaddr_storage caddr = {0};
+		int caddr_len = sizeof(caddr);
+		client = accept(server, reinterpret_cast<sockaddr*>(&caddr), &caddr_len);
+		if(saddr != nullptr && caddr.ss_family == AF_INET) memcpy(saddr, &caddr, sizeof(sockaddr_in));
+		if(client == INVALID_SOCKET) {
+			const int wsaerr = WSAGetLastError();
+			if(wsaerr == WSAEWOULDBLOCK) return Result::Timeout; // No connection pending
+			else if(LastErrString) *LastErrString = Exceptions::ConvertCOMError(wsaerr);
+			return Result::Failed;
+		}
+		// Connection accepted; socket inherits nonblocking mode (and any event selection) from listener, so drop
+		// selection and switch back to blocking mode, then set socket options before returning (enable keepalive,
+		// disable Nagle algorithm):
+		WSAEventSelect(client, nullptr, 0);
+		unsigned long nbarg = 0;
+		ioctlsocket(client, FIONBIO, &nbarg);
+		constexpr char keepaliveopt = 1, nodelayopt = 1;
+		setsockopt(client, SOL_SOCKET, SO_KEEPALIVE, &keepaliveopt, sizeof(keepaliveopt));
+		setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &nodelayopt, sizeof(nodelayopt));
+		return Result::OK;
+	}
+	catch(const std::exception&) {
+		SocketOps::Close(client);
+		std::throw_with_nested(FORMAT_RUNTIME_ERROR("Pending session accept failed"));
+	}
+}
 // SocketOps::DNSLookup: Retrieve IP address for specified name
 GSL_SUPPRESS(type.1) // reinterpret_cast is preferable to C-style cast (required for call to inet_ntop())
 _Check_return_ inline bool SocketOps::DNSLookup(
@@ -423,12 +883,79 @@ _Check_return_ inline bool SocketOps::DNSLookup(
 	}
 	catch(const std::exception&) {std::throw_with_nested(FORMAT_RUNTIME_ERROR("DNS name lookup failed"));}
 }
+GSL_SUPPRESS(type.1) // reinterpret_cast is preferable to C-style cast (required for call to inet_ntop())
+_Check_return_ inline bool SocketOps::DNSLookup(
+	_In_z_ const char* Name, std::vector<std::string>& Addresses, _Inout_opt_ std::string* LastErrString) {
+	if(LastErrString) LastErrString->clear();
+	Addresses.clear();
+	try {
+		// Attempt DNS lookup call for both address families, format each distinct address into output vector:
+		struct addrinfo hints = {0}, *ai = nullptr;
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		hints.ai_protocol = IPPROTO_TCP;
+		const int wrc = getaddrinfo(Name, nullptr, &hints, &ai);
+		if(wrc != 0) {
+			if(LastErrString) *LastErrString = Exceptions::ConvertCOMError(wrc);
+			return false;
+		}
+		char ip[INET6_ADDRSTRLEN] = {0};
+		for(const struct addrinfo* seek = ai; seek != nullptr; seek = seek->ai_next) {
+			const char* formatted = nullptr;
+			if(seek->ai_family == AF_INET) {
+				formatted = inet_ntop(AF_INET, &(reinterpret_cast<const sockaddr_in*>(seek->ai_addr)->sin_addr),
+					ip, sizeof(ip));
+			}
+			else if(seek->ai_family == AF_INET6) {
+				formatted = inet_ntop(AF_INET6, &(reinterpret_cast<const sockaddr_in6*>(seek->ai_addr)->sin6_addr),
+					ip, sizeof(ip));
+			}
+			if(formatted != nullptr && std::find(Addresses.cbegin(), Addresses.cend(), formatted) == Addresses.cend())
+				Addresses.emplace_back(formatted);
+		}
+		freeaddrinfo(ai);
+		if(Addresses.empty() && LastErrString) *LastErrString = "No usable addresses returned";
+		return (Addresses.empty() == false);
+	}
+	catch(const std::exception&) {std::throw_with_nested(FORMAT_RUNTIME_ERROR("DNS name lookup failed"));}
+}
+// SocketOps::ParseAddress: Convert IPv4 or IPv6 address literal and port into socket address
+GSL_SUPPRESS(type.1) // reinterpret_cast is preferable to C-style cast (sockaddr_storage holds either address type)
+_Check_return_ inline bool SocketOps::ParseAddress(
+	_In_z_ const char* IP, unsigned short Port, sockaddr_storage& Addr, int& AddrLen) noexcept {
+	memset(&Addr, 0, sizeof(Addr));
+	AddrLen = 0;
+	if((IP ? IP[0] : 0) == 0) return false;
+	sockaddr_in* const v4 = reinterpret_cast<sockaddr_in*>(&Addr);
+	sockaddr_in6* const v6 = reinterpret_cast<sockaddr_in6*>(&Addr);
+	sockaddr_un* const un = reinterpret_cast<sockaddr_un*>(&Addr);
+	if(IsUnixAddress(IP)) {
+		// Path (following "unix:" prefix) must fit, with terminator, in address structure:
+		const size_t pathlen = strlen(IP + 5);
+		if(pathlen < sizeof(un->sun_path)) {
+			un->sun_family = AF_UNIX;
+			memcpy(un->sun_path, IP + 5, pathlen + 1);
+			AddrLen = sizeof(sockaddr_un);
+		}
+	}
+	else if(inet_pton(AF_INET, IP, &(v4->sin_addr)) == 1) {
+		v4->sin_family = AF_INET;
+		v4->sin_port = htons(Port);
+		AddrLen = sizeof(sockaddr_in);
+	}
+	else if(inet_pton(AF_INET6, IP, &(v6->sin6_addr)) == 1) {
+		v6->sin6_family = AF_INET6;
+		v6->sin6_port = htons(Port);
+		AddrLen = sizeof(sockaddr_in6);
+	}
+	return (AddrLen > 0);
+}
 // SocketOps::Connect: Attempt outbound connection to the specified IP and port
 GSL_SUPPRESS(type.1) // reinterpret_cast is preferable to C-style cast (required for calls to bind() and connect())
 _Check_return_ inline SOCKET SocketOps::Connect(
 	_In_z_ const char* RemoteIP, unsigned short RemotePort, int Timeout, _Inout_opt_ std::string* LastErrString) {
 	// Validate inputs, default outputs:
-	if((RemoteIP ? RemoteIP[0] : 0) == 0 || RemotePort == 0) {
+	if((RemoteIP ? RemoteIP[0] : 0) == 0 || (RemotePort == 0 && IsUnixAddress(RemoteIP) == false)) {
 		if(LastErrString) *LastErrString = "Invalid destination IP/port";
 		return INVALID_SOCKET;
 	}
@@ -436,22 +963,23 @@ _Check_return_ inline SOCKET SocketOps::Connect(
 
 	SOCKET s = INVALID_SOCKET;
 	try {
-		// Attempt to create socket handle:
-		s = socket(AF_INET, SOCK_STREAM, 0);
+		// Set up destination object (IPv4, IPv6 or unix domain), then attempt to create socket handle of matching family:
+		sockaddr_storage remaddr = {0};
+		int remaddrlen = 0;
+		if(ParseAddress(RemoteIP, RemotePort, remaddr, remaddrlen) == false) {
+			if(LastErrString) *LastErrString = "Invalid destination IP address";
+			return INVALID_SOCKET;
+		}
+		s = socket(remaddr.ss_family, SOCK_STREAM, 0);
 		if(s == INVALID_SOCKET && LastErrString) *LastErrString = Exceptions::ConvertCOMError(WSAGetLastError());
 		if(s != INVALID_SOCKET) {
-			// Set up destination object:
-			sockaddr_in remaddr = {0};
-			remaddr.sin_family = AF_INET;
-			remaddr.sin_port = htons(RemotePort);
-			inet_pton(remaddr.sin_family, RemoteIP, &remaddr.sin_addr.s_addr);
 			// If timeout value provided, set socket to nonblocking mode:
 			if(Timeout > 0) {
 				unsigned long nbarg = 1;
 				ioctlsocket(s, FIONBIO, &nbarg);
 			}
 			// Attempt connection to remote:
-			if(connect(s, reinterpret_cast<const sockaddr*>(&remaddr), sizeof(remaddr)) == SOCKET_ERROR) {
+			if(connect(s, reinterpret_cast<const sockaddr*>(&remaddr), remaddrlen) == SOCKET_ERROR) {
 				int wsaerr = WSAGetLastError();
 				if(wsaerr == WSAEWOULDBLOCK && Timeout > 0) {
 					// Socket in nonblocking mode with timeout will return WOULDBLOCK; wait up to timeout for writability:
@@ -497,7 +1025,7 @@ GSL_SUPPRESS(type.1) // reinterpret_cast is preferable to C-style cast (required
 _Check_return_ inline SOCKET SocketOps::StartConnect(
 	_In_z_ const char* RemoteIP, unsigned short RemotePort, _Inout_opt_ std::string* LastErrString) {
 	// Validate inputs, default outputs:
-	if((RemoteIP ? RemoteIP[0] : 0) == 0 || RemotePort == 0) {
+	if((RemoteIP ? RemoteIP[0] : 0) == 0 || (RemotePort == 0 && IsUnixAddress(RemoteIP) == false)) {
 		if(LastErrString) *LastErrString = "Invalid destination IP/port";
 		return INVALID_SOCKET;
 	}
@@ -505,20 +1033,21 @@ _Check_return_ inline SOCKET SocketOps::StartConnect(
 
 	SOCKET s = INVALID_SOCKET;
 	try {
-		// Attempt to create socket handle:
-		s = socket(AF_INET, SOCK_STREAM, 0);
+		// Set up destination object (IPv4, IPv6 or unix domain), then attempt to create socket handle of matching family:
+		sockaddr_storage remaddr = {0};
+		int remaddrlen = 0;
+		if(ParseAddress(RemoteIP, RemotePort, remaddr, remaddrlen) == false) {
+			if(LastErrString) *LastErrString = "Invalid destination IP address";
+			return INVALID_SOCKET;
+		}
+		s = socket(remaddr.ss_family, SOCK_STREAM, 0);
 		if(s == INVALID_SOCKET && LastErrString) *LastErrString = Exceptions::ConvertCOMError(WSAGetLastError());
 		if(s != INVALID_SOCKET) {
-			// Set up destination object:
-			sockaddr_in remaddr = {0};
-			remaddr.sin_family = AF_INET;
-			remaddr.sin_port = htons(RemotePort);
-			inet_pton(remaddr.sin_family, RemoteIP, &remaddr.sin_addr.s_addr);
 			// Set socket to nonblocking mode:
 			{unsigned long nbarg = 1;
 			ioctlsocket(s, FIONBIO, &nbarg);}
 			// Attempt connection to remote:
-			if(connect(s, reinterpret_cast<const sockaddr*>(&remaddr), sizeof(remaddr)) == SOCKET_ERROR) {
+			if(connect(s, reinterpret_cast<const sockaddr*>(&remaddr), remaddrlen) == SOCKET_ERROR) {
 				const int wsaerr = WSAGetLastError();
 				if(wsaerr != WSAEWOULDBLOCK) {
 					if(LastErrString) *LastErrString = Exceptions::ConvertCOMError(wsaerr);
@@ -609,6 +1138,64 @@ _Check_return_ inline SocketOps::Result SocketOps::Send(
 	}
 	catch(const std::exception&) {std::throw_with_nested(FORMAT_RUNTIME_ERROR("Data send failed"));}
 }
+// SocketOps::SendGather: Deliver contents of multiple buffers to session socket in a single write
+_Check_return_ inline SocketOps::Result SocketOps::SendGather(
+	SOCKET s, _In_reads_(Count) const WSABUF* Buffers, size_t Count, _Inout_opt_ std::string* LastErrString) {
+	// Validate inputs, default outputs:
+	if(s == INVALID_SOCKET) return Result::InvalidSocket;
+	else if(Buffers == nullptr || ValueOps::Is(Count).InRange(1, 1024) == false) return Result::InvalidArg;
+	else if(LastErrString) LastErrString->clear();
+	size_t total = 0;
+	for(size_t b = 0; b < Count; ++b) total += Buffers[b].len;
+	if(ValueOps::Is(total).InRangeLeft(1, INT_MAX) == false) return Result::InvalidArg;
+
+	try {
+		// Poll to ensure socket is writeable (as per Send), then write all buffers:
+		Result rc = Result::Timeout;
+		WSAPOLLFD fdarray = {s, POLLWRNORM, 0};
+		const int poll = WSAPoll(&fdarray, 1, 250);
+		if((poll == 1 ? fdarray.revents : 0) & POLLWRNORM) {
+			DWORD sent = 0;
+			if(WSASend(s, const_cast<WSABUF*>(Buffers), gsl::narrow_cast<DWORD>(Count), &sent, 0, nullptr, nullptr) == 0
+				&& sent == total) return Result::OK; // Send successful
+			else if(LastErrString) *LastErrString = Exceptions::ConvertCOMError(WSAGetLastError());
+			rc = Result::Failed;
+		}
+		else if(poll >= 0) {
+			if(LastErrString) *LastErrString = "Socket not ready for writing";
+			rc = Result::Timeout;
+		}
+		else if(LastErrString) *LastErrString = Exceptions::ConvertCOMError(WSAGetLastError());
+		// If this point is reached socket cannot be written to; shut down before returning:
+		SocketOps::Shutdown(s);
+		return rc;
+	}
+	catch(const std::exception&) {std::throw_with_nested(FORMAT_RUNTIME_ERROR("Gather send failed"));}
+}
+// SocketOps::SendAvailable: Write as much of the contents of buffers as a nonblocking session socket will accept
+_Check_return_ inline SocketOps::Result SocketOps::SendAvailable(SOCKET s, _In_reads_(Count) const WSABUF* Buffers,
+	size_t Count, size_t& BytesSent, _Inout_opt_ std::string* LastErrString) {
+	BytesSent = 0;
+	// Validate inputs, default outputs:
+	if(s == INVALID_SOCKET) return Result::InvalidSocket;
+	else if(Buffers == nullptr || ValueOps::Is(Count).InRange(1, 1024) == false) return Result::InvalidArg;
+	else if(LastErrString) LastErrString->clear();
+
+	try {
+		// Attempt write without polling (socket will not block); a full socket buffer is not an error:
+		DWORD sent = 0;
+		if(WSASend(s, const_cast<WSABUF*>(Buffers), gsl::narrow_cast<DWORD>(Count), &sent, 0, nullptr, nullptr) == 0) {
+			BytesSent = sent;
+			return Result::OK;
+		}
+		const int err = WSAGetLastError();
+		if(err == WSAEWOULDBLOCK) return Result::OK;
+		else if(LastErrString) *LastErrString = Exceptions::ConvertCOMError(err);
+		SocketOps::Shutdown(s);
+		return Result::Failed;
+	}
+	catch(const std::exception&) {std::throw_with_nested(FORMAT_RUNTIME_ERROR("Nonblocking send failed"));}
+}
 // SocketOps::ReadExact: Read a specific number of bytes from session socket
 _Check_return_ inline SocketOps::Result SocketOps::ReadExact(
 	SOCKET s, _Out_writes_(BytesToRead) char* Tgt, size_t BytesToRead, int Timeout, _Inout_opt_ std::string* LastErrString) {
@@ -628,7 +1215,8 @@ _Check_return_ inline SocketOps::Result SocketOps::ReadExact(
 
 		// Attempt to read specified number of bytes, return on failure OR if requested number of bytes read:
 		iBytesRead = recv(s, Tgt, iBytesToRead, 0);
-		if(iBytesRead <= 0) {
+		if(iBytesRead < 0 && WSAGetLastError() == WSAEWOULDBLOCK) iBytesRead = 0; // Nonblocking socket, wait again
+		else if(iBytesRead <= 0) {
 			if(iBytesRead < 0 && LastErrString) *LastErrString = Exceptions::ConvertCOMError(WSAGetLastError());
 			SocketOps::Shutdown(s);
 			return Result::Failed;
@@ -641,7 +1229,7 @@ _Check_return_ inline SocketOps::Result SocketOps::ReadExact(
 	// If this point is reached, no error occurred but not all bytes received; re-call this function, adjusted for
 	// bytes that were read and time that has elapsed (performed outside try/catch to avoid recursive exceptions)
 	return SocketOps::ReadExact(s, Tgt + iBytesRead,
-		static_cast<size_t>(iBytesToRead) - iBytesRead, // iBytesRead guaranteed to be a positive value less than iBytesToRead
+		static_cast<size_t>(iBytesToRead) - iBytesRead, // iBytesRead guaranteed to be non-negative and less than iBytesToRead
 		SteadyClock().MSecTill(EndTime)
 	);
 }
@@ -656,7 +1244,8 @@ _Check_return_ inline SocketOps::Result SocketOps::ReadAvailable(
 	try {
 		// Attempt to read up to specified number of bytes (conversion to int guaranteed safe by above check):
 		const int br = recv(s, Tgt, gsl::narrow_cast<int>(MaxBytes), 0);
-		if(br <= 0) {
+		if(br < 0 && WSAGetLastError() == WSAEWOULDBLOCK) return Result::Timeout; // Nonblocking socket, no data yet
+		else if(br <= 0) {
 			if(br < 0 && LastErrString) *LastErrString = Exceptions::ConvertCOMError(WSAGetLastError());
 			SocketOps::Shutdown(s);
 			return Result::Failed;
@@ -666,49 +1255,137 @@ _Check_return_ inline SocketOps::Result SocketOps::ReadAvailable(
 	}
 	catch(const std::exception&) {std::throw_with_nested(FORMAT_RUNTIME_ERROR("Available data read failed"));}
 }
-// SocketOps::ReadPacket: Read a two-byte length header followed by the indicated number of bytes (up to MaxBytes)
-_Check_return_ inline SocketOps::Result SocketOps::ReadPacket(
-	SOCKET s, _Out_writes_(MaxBytes) char* Tgt, size_t MaxBytes, size_t& BytesRead, int Timeout, SocketFlags Flags,
+// SocketOps::ReadFrame: Read one frame as defined by framing codec, dispatching on codec's strategy
+template<typename Codec>
+_Check_return_ inline SocketOps::Result SocketOps::ReadFrame(
+	SOCKET s, _Out_writes_(MaxBytes) char* Tgt, size_t MaxBytes, size_t& BytesRead, int Timeout,
 	_Inout_opt_ std::string* LastErrString) {
 	BytesRead = 0;
 	// Validate inputs, default outputs:
 	if(s == INVALID_SOCKET) return Result::InvalidSocket;
-	else if(Tgt == nullptr || ValueOps::Is(MaxBytes).InRangeLeft(4, INT_MAX) == false) return Result::InvalidArg;
+	else if(Tgt == nullptr || ValueOps::Is(MaxBytes).InRangeLeft(1, INT_MAX) == false) return Result::InvalidArg;
 	else if(LastErrString) LastErrString->clear();
+	return ReadFrame<Codec>(s, Tgt, MaxBytes, BytesRead, Timeout, LastErrString, typename Codec::Strategy{});
+}
+// SocketOps::ReadFrame (Prefixed): Read fixed-size header, followed by the number of payload bytes it indicates
+template<typename Codec>
+_Check_return_ inline SocketOps::Result SocketOps::ReadFrame(
+	SOCKET s, _Out_writes_(MaxBytes) char* Tgt, size_t MaxBytes, size_t& BytesRead, int Timeout,
+	_Inout_opt_ std::string* LastErrString, Framing::Prefixed) {
 	try {
-		// Read incoming packet header (2 bytes, or 4 if extended header enabled); return if read fails:
+		// Read incoming frame header; return if read fails:
 		const SteadyClock EndTime(std::chrono::milliseconds{Timeout});
-		Result rc = ReadExact(s, Tgt, (Flags & SocketFlags::ExtendedHeader) ? 4 : 2, Timeout, LastErrString);
+		char Header[Codec::HeaderSize] = {0};
+		Result rc = ReadExact(s, Header, Codec::HeaderSize, Timeout, LastErrString);
 		if(rc != Result::OK) return rc;
 
-		// Calculate total packet length and validate against max read length (zero-length packet return success):
-		const size_t PacketSize = ((Tgt[0] & 0xFF) << 8) | (Tgt[1] & 0xFF);
-		if(PacketSize == 0) return Result::OK;
-		else if(ValueOps::Is(PacketSize).InRange(1, MaxBytes) == false) {
+		// Decode payload length and validate against max read length (zero-length frame return success):
+		size_t PayloadSize = 0;
+		(void)Codec::Measure(Header, Codec::HeaderSize, PayloadSize);
+		if(PayloadSize == 0) return Result::OK;
+		else if(ValueOps::Is(PayloadSize).InRange(1, MaxBytes) == false) {
 			if(LastErrString) *LastErrString = "Length of incoming packet exceeds maximum";
 			SocketOps::Shutdown(s); // Shut down socket to prevent fragmented packet being left on wire
 			return Result::Failed;
 		}
 
 		// Otherwise, read specified number of bytes; if successful, assign output length variable:
-		if((rc = ReadExact(s, Tgt, PacketSize, SteadyClock().MSecTill(EndTime), LastErrString)) == Result::OK) BytesRead = PacketSize;
+		if((rc = ReadExact(s, Tgt, PayloadSize, SteadyClock().MSecTill(EndTime), LastErrString)) == Result::OK)
+			BytesRead = PayloadSize;
 		return rc;
 	}
 	catch(const std::exception&) {std::throw_with_nested(FORMAT_RUNTIME_ERROR("Packet read failed"));}
 }
+// SocketOps::ReadFrame (Scanned): Peek at pending data until codec locates end of frame, reading bytes which are known to
+// belong to frame as they are examined (so that subsequent waits block until more data arrives), then strip framing
+template<typename Codec>
+_Check_return_ inline SocketOps::Result SocketOps::ReadFrame(
+	SOCKET s, _Out_writes_(MaxBytes) char* Tgt, size_t MaxBytes, size_t& BytesRead, int Timeout,
+	_Inout_opt_ std::string* LastErrString, Framing::Scanned) {
+	try {
+		const SteadyClock EndTime(std::chrono::milliseconds{Timeout});
+		size_t Held = 0, FrameSize = 0, PayloadSize = 0;
+		while(FrameSize == 0) {
+			// Wait for data; on timeout, shut down socket if part of frame has already been read (prevent fragmentation):
+			const Result wrc = WaitEvent(s, ValueOps::MinZero(SteadyClock().MSecTill(EndTime)), LastErrString);
+			if(wrc != Result::OK) {
+				if(Held > 0) SocketOps::Shutdown(s);
+				return wrc;
+			}
+			else if(Held >= MaxBytes) {
+				if(LastErrString) *LastErrString = "Length of incoming packet exceeds maximum";
+				SocketOps::Shutdown(s);
+				return Result::Failed;
+			}
+
+			// Peek at pending data (following bytes already held), and check whether frame is now complete:
+			const int Peeked = recv(s, Tgt + Held, gsl::narrow_cast<int>(MaxBytes - Held), MSG_PEEK);
+			if(Peeked < 0 && WSAGetLastError() == WSAEWOULDBLOCK) continue; // Nonblocking socket, wait again
+			else if(Peeked <= 0) {
+				if(Peeked < 0 && LastErrString) *LastErrString = Exceptions::ConvertCOMError(WSAGetLastError());
+				SocketOps::Shutdown(s);
+				return Result::Failed;
+			}
+			FrameSize = Codec::Measure(Tgt, Held + Peeked, PayloadSize);
+
+			// Consume bytes belonging to frame (all peeked bytes, if frame is not yet complete):
+			const size_t Consume = (FrameSize > 0) ? FrameSize - Held : static_cast<size_t>(Peeked);
+			const Result rc = ReadExact(s, Tgt + Held, Consume, ValueOps::MinZero(SteadyClock().MSecTill(EndTime)),
+				LastErrString);
+			if(rc != Result::OK) return rc;
+			Held += Consume;
+		}
+
+		// Move payload to start of target (past any header), and assign output length variable:
+		if(Codec::HeaderSize > 0 && PayloadSize > 0) memmove(Tgt, Tgt + Codec::HeaderSize, PayloadSize);
+		BytesRead = PayloadSize;
+		return Result::OK;
+	}
+	catch(const std::exception&) {std::throw_with_nested(FORMAT_RUNTIME_ERROR("Frame read failed"));}
+}
+// SocketOps::ReadPacket: Read a two-byte length header followed by the indicated number of bytes (up to MaxBytes)
+_Check_return_ inline SocketOps::Result SocketOps::ReadPacket(
+	SOCKET s, _Out_writes_(MaxBytes) char* Tgt, size_t MaxBytes, size_t& BytesRead, int Timeout, SocketFlags Flags,
+	_Inout_opt_ std::string* LastErrString) {
+	return (Flags & SocketFlags::ExtendedHeader)
+		? ReadFrame<Framing::Extended>(s, Tgt, MaxBytes, BytesRead, Timeout, LastErrString)
+		: ReadFrame<Framing::Length2BE>(s, Tgt, MaxBytes, BytesRead, Timeout, LastErrString);
+}
 #pragma endregion SocketOps
 
 //==========================================================================================================================
 #pragma region SocketOps::ServerSocket
-// ServerSocket::Open: Use SocketOps static function to initialize socket member
-_Check_return_ inline bool SocketOps::ServerSocket::Open(unsigned short ListenPort, _In_opt_z_ const char* Interface, int Backlog) {
-	return (SocketHandle != INVALID_SOCKET) ? true
-		: ((SocketHandle = SocketOps::InitServer(ListenPort, Interface, Backlog, &LastErrString)) != INVALID_SOCKET);
+// ServerSocket::Open: Use SocketOps static function to initialize socket member, set nonblocking mode if requested
+_Check_return_ inline bool SocketOps::ServerSocket::Open(
+	unsigned short ListenPort, _In_opt_z_ const char* Interface, int Backlog, bool NonBlocking) {
+	if(SocketHandle != INVALID_SOCKET) return true;
+	else if((SocketHandle = SocketOps::InitServer(ListenPort, Interface, Backlog, &LastErrString)) == INVALID_SOCKET)
+		return false;
+	else if(IsUnixAddress(Interface)) UnixPath.assign(Interface + 5);
+	if(NonBlocking) {
+		unsigned long nbarg = 1;
+		if(ioctlsocket(SocketHandle, FIONBIO, &nbarg) == SOCKET_ERROR) {
+			LastErrString = Exceptions::ConvertCOMError(WSAGetLastError());
+			Close();
+			return false;
+		}
+	}
+	return true;
 }
 // ServerSocket::WaitEvent: Use SocketOps static function to perform wait against socket member
 _Check_return_ inline SocketOps::Result SocketOps::ServerSocket::WaitEvent(int Timeout) const {
 	return SocketOps::WaitEvent(SocketHandle, Timeout, &LastErrString);
 }
+// ServerSocket::SelectAcceptEvent: Associate event with pending connections on socket member
+_Check_return_ inline bool SocketOps::ServerSocket::SelectAcceptEvent(
+	HANDLE Event, _Inout_opt_ std::string* ErrString) {
+	if(SocketHandle == INVALID_SOCKET) return false;
+	else if(WSAEventSelect(SocketHandle, Event, Event ? FD_ACCEPT : 0) == SOCKET_ERROR) {
+		if(ErrString) *ErrString = Exceptions::ConvertCOMError(WSAGetLastError());
+		return false;
+	}
+	return true;
+}
 // ServerSocket::Accept: Use SocketOps static function to accept connection on socket member
 // - If server has TLS credentials, performs TLS session negotiation on new connection before returning
 _Check_return_ inline SocketOps::SessionSocketPtr SocketOps::ServerSocket::Accept(
@@ -736,6 +1413,28 @@ _Check_return_ inline SocketOps::SessionSocketPtr SocketOps::ServerSocket::Start
 	}
 	return sp;
 }
+// ServerSocket::AcceptPending: Use SocketOps static function to accept pending connection (if any) without blocking
+// - If server has TLS credentials, attempts no-timeout TLS session negotiation on new connection before returning
+_Check_return_ inline SocketOps::Result SocketOps::ServerSocket::AcceptPending(
+	SessionSocketPtr& sp, _Inout_opt_ std::string* ErrString, _Inout_opt_ sockaddr_in* saddr, size_t TLSBufferSize) {
+	sp.reset();
+	SOCKET c = INVALID_SOCKET;
+	Result rc = SocketOps::AcceptPending(SocketHandle, c, saddr, ErrString);
+	if(ResultOK(rc)) {
+		// Create new SessionSocket object to take ownership of handle, passing along TLS values (if provided):
+		sp = std::make_unique<SessionSocket>(SocketOps::pass_key{}, UsingTLS, TLSBufferSize);
+		sp->SocketHandle = c;
+		// If TLS negotiation is required, attempt now (with no timeout):
+		if(UsingTLS) {
+			if(ResultFailed(rc = TLSNegotiate(sp, 0))) {
+				if(ErrString) ErrString->assign(std::move(sp->GetLastErrString()));
+				sp.reset();
+			}
+			else rc = Result::OK; // Negotiation started (caller to complete via PollAccept)
+		}
+	}
+	return rc;
+}
 // ServerSocket::PollAccept: Ensure socket is connected, continue TLS negotiation (without blocking) if required
 _Check_return_ inline SocketOps::Result SocketOps::ServerSocket::PollAccept(const SessionSocketPtr& sp) {
 	if((sp.get() ? sp->SocketValid() : false) == false) return Result::InvalidSocket;
@@ -762,6 +1461,7 @@ _Check_return_ inline SocketOps::SessionSocketPtr SocketOps::SessionSocket::Conn
 	// Attempt connection to remote, storing handle in object; perform TLS negotiation if required:
 	sp->SocketHandle = SocketOps::Connect(RemoteIP, RemotePort, Timeout, &(sp->LastErrString));
 	if(sp->SocketValid() && UsingTLS) {
+		sp->TLSTarget = StringOps::ConvertToWideString(std::string(RemoteIP) + ':' + std::to_string(RemotePort));
 		if(ResultOK(sp->TLSNegotiate(ValueOps::MinZero(SteadyClock().MSecTill(EndTime)), TLSMethod)) == false)
 			sp->Close();
 	}
@@ -773,6 +1473,8 @@ _Check_return_ inline SocketOps::SessionSocketPtr SocketOps::SessionSocket::Star
 	SessionSocketPtr sp = std::make_unique<SessionSocket>(SocketOps::pass_key{}, UsingTLS, TLSBufferSize);
 	// Initiate connection request to remote, storing handle in object:
 	sp->SocketHandle = SocketOps::StartConnect(RemoteIP, RemotePort, &(sp->LastErrString));
+	if(sp->SocketValid() && UsingTLS)
+		sp->TLSTarget = StringOps::ConvertToWideString(std::string(RemoteIP) + ':' + std::to_string(RemotePort));
 	return sp;
 }
 // SessionSocket::PollConnect: Check if asynchronous connection has completed, perform TLS negotiation if required
@@ -788,14 +1490,72 @@ _Check_return_ inline SocketOps::Result SocketOps::SessionSocket::PollConnect(in
 // SessionSocket::WaitEvent: Use SocketOps static function to perform wait against socket member
 // - Checks read buffers (if any) prior to waiting on socket - returns OK immediately if buffered data available
 _Check_return_ inline SocketOps::Result SocketOps::SessionSocket::WaitEvent(int Timeout) const {
-	if(ClearBuf.get() ? (ClearBufBytes > 0) : false) return Result::OK;
-	else if(ReadBuf.get() ? (ReadBufBytes > 0) : false) return Result::OK;
+	if(DataBuffered()) return Result::OK;
 	else return SocketOps::WaitEvent(SocketHandle, Timeout, &LastErrString);
 }
 // SessionSocket::Send: Deliver data to open session
+// - If using TLS, data larger than the maximum TLS message is split across multiple messages
 _Check_return_ inline SocketOps::Result SocketOps::SessionSocket::Send(_In_reads_(len) const char* buf, size_t len) {
-	return UsingTLS ? SendTLS(buf, len)
-		: SocketOps::Send(SocketHandle, buf, len, &LastErrString);
+	if(UsingTLS == false || KernelTLSSend()) return SocketOps::Send(SocketHandle, buf, len, &LastErrString);
+	else if(len > ULONG_MAX) return Result::InvalidArg;
+	const WSABUF wsabuf = {gsl::narrow_cast<ULONG>(len), const_cast<char*>(buf)};
+	return SendTLS(&wsabuf, 1);
+}
+// SessionSocket::Send: Deliver contents of multiple buffers to open session in a single write (if using TLS, buffers
+// are packed into as few TLS messages as their total allows)
+_Check_return_ inline SocketOps::Result SocketOps::SessionSocket::Send(_In_reads_(Count) const WSABUF* Buffers, size_t Count) {
+	if(UsingTLS == false || KernelTLSSend()) return SocketOps::SendGather(SocketHandle, Buffers, Count, &LastErrString);
+	else return SendTLS(Buffers, Count);
+}
+// SessionSocket::SetNonBlocking: Switch session socket between blocking and nonblocking mode
+_Check_return_ inline bool SocketOps::SessionSocket::SetNonBlocking(bool NonBlocking) {
+	if(SocketHandle == INVALID_SOCKET) return false;
+	unsigned long nbarg = NonBlocking ? 1 : 0;
+	if(ioctlsocket(SocketHandle, FIONBIO, &nbarg) == SOCKET_ERROR) {
+		LastErrString = Exceptions::ConvertCOMError(WSAGetLastError());
+		return false;
+	}
+	return true;
+}
+// SessionSocket::Write: Deliver contents of buffers to nonblocking session as far as socket will accept, appending the
+// remainder to Backlog (if Backlog already holds pending output, all data is appended and written behind it)
+// - If using TLS, data is encrypted into Backlog first (packed into maximum-size TLS messages, as per Send)
+_Check_return_ inline SocketOps::Result SocketOps::SessionSocket::Write(
+	_In_reads_(Count) const WSABUF* Buffers, size_t Count, SendBuffer& Backlog) {
+	if(Valid() == false) return Result::InvalidSocket;
+	else if(Buffers == nullptr || ValueOps::Is(Count).InRange(1, 1024) == false) return Result::InvalidArg;
+	try {
+		if(UsingTLS && KernelTLSSend() == false) {
+			const Result rc = EncryptRecords(Buffers, Count, Backlog.data, false);
+			return ResultOK(rc) ? WriteBacklog(Backlog) : rc;
+		}
+		else if(Backlog.Empty()) {
+			// Nothing pending: write directly from caller's buffers, copying only the part not accepted by socket:
+			size_t sent = 0;
+			const Result rc = SocketOps::SendAvailable(SocketHandle, Buffers, Count, sent, &LastErrString);
+			if(ResultOK(rc) == false) return rc;
+			for(size_t b = 0; b < Count; ++b) {
+				const size_t skip = (std::min)(sent, static_cast<size_t>(Buffers[b].len));
+				sent -= skip;
+				Backlog.data.insert(Backlog.data.end(), Buffers[b].buf + skip, Buffers[b].buf + Buffers[b].len);
+			}
+			return Result::OK;
+		}
+		for(size_t b = 0; b < Count; ++b)
+			Backlog.data.insert(Backlog.data.end(), Buffers[b].buf, Buffers[b].buf + Buffers[b].len);
+		return WriteBacklog(Backlog);
+	}
+	catch(const std::exception&) {std::throw_with_nested(FORMAT_RUNTIME_ERROR("Nonblocking write failed"));}
+}
+// SessionSocket::WriteBacklog: Deliver pending output from Backlog to nonblocking session, as far as socket will accept
+_Check_return_ inline SocketOps::Result SocketOps::SessionSocket::WriteBacklog(SendBuffer& Backlog) {
+	if(Backlog.Empty()) return Result::OK;
+	const WSABUF wsabuf = {gsl::narrow_cast<ULONG>((std::min)(Backlog.Size(), static_cast<size_t>(INT_MAX))),
+		Backlog.data.data() + Backlog.offset};
+	size_t sent = 0;
+	const Result rc = SocketOps::SendAvailable(SocketHandle, &wsabuf, 1, sent, &LastErrString);
+	if(ResultOK(rc)) Backlog.Consume(sent);
+	return rc;
 }
 // SessionSocket::ReadExact: Read the specified number of bytes from open session
 _Check_return_ inline SocketOps::Result SocketOps::SessionSocket::ReadExact(
@@ -812,9 +1572,255 @@ _Check_return_ inline SocketOps::Result SocketOps::SessionSocket::ReadAvailable(
 // SessionSocket::ReadPacket: Read two-byte length header followed by data from open session
 _Check_return_ inline SocketOps::Result SocketOps::SessionSocket::ReadPacket(
 	_Out_writes_(MaxBytes) char* Tgt, size_t MaxBytes, size_t& BytesRead, int Timeout) {
-	return UsingTLS ? ReadPacketTLS(Tgt, MaxBytes, BytesRead, Timeout)
-		: SocketOps::ReadPacket(SocketHandle, Tgt, MaxBytes, BytesRead, Timeout, SessionFlags, &LastErrString);
+	return (SessionFlags & SocketFlags::ExtendedHeader) ? ReadFrame<Framing::Extended>(Tgt, MaxBytes, BytesRead, Timeout)
+		: ReadFrame<Framing::Length2BE>(Tgt, MaxBytes, BytesRead, Timeout);
+}
+// SessionSocket::ReadPacketView: Wait for complete packet in cleartext buffer, then consume it and return view of its data
+_Check_return_ inline SocketOps::Result SocketOps::SessionSocket::ReadPacketView(gsl::span<const char>& Packet, int Timeout) {
+	return (SessionFlags & SocketFlags::ExtendedHeader) ? ReadFrameView<Framing::Extended>(Packet, Timeout)
+		: ReadFrameView<Framing::Length2BE>(Packet, Timeout);
+}
+// SessionSocket::ReadFrame: Read one frame (as defined by codec) from open session, copying its payload to Tgt
+template<typename Codec>
+_Check_return_ inline SocketOps::Result SocketOps::SessionSocket::ReadFrame(
+	_Out_writes_(MaxBytes) char* Tgt, size_t MaxBytes, size_t& BytesRead, int Timeout) {
+	if(UsingTLS == false) return SocketOps::ReadFrame<Codec>(SocketHandle, Tgt, MaxBytes, BytesRead, Timeout, &LastErrString);
+	BytesRead = 0;
+	if(Tgt == nullptr || ValueOps::Is(MaxBytes).InRangeLeft(1, INT_MAX) == false) return Result::InvalidArg;
+	try {
+		// Locate frame in cleartext buffer, then copy payload to target (after which buffers can be returned to pool):
+		gsl::span<const char> Payload;
+		const Result rc = ReadFrameViewTLS<Codec>(Payload, Timeout);
+		if(ResultOK(rc) && Payload.empty() == false) {
+			if(static_cast<size_t>(Payload.size()) > MaxBytes) {
+				LastErrString = "Length of incoming packet exceeds maximum";
+				Shutdown(); // Shut down socket, as stream position can no longer be trusted by caller
+				return Result::Failed;
+			}
+			memcpy(Tgt, Payload.data(), Payload.size());
+			BytesRead = Payload.size();
+		}
+		ReleaseIdleTLSBuffers(); // Return buffers to pool if all data has been consumed
+		return rc;
+	}
+	catch(const std::exception&) {std::throw_with_nested(FORMAT_RUNTIME_ERROR("TLS frame read failed"));}
+}
+// SessionSocket::ReadFrameView: Wait for complete frame in cleartext buffer, then consume it and return view of payload
+// - Buffers are not returned to pool after the frame is consumed (as view refers to them), but at the start of the next
+//   call instead (at which point previous view is no longer valid)
+template<typename Codec>
+_Check_return_ inline SocketOps::Result SocketOps::SessionSocket::ReadFrameView(gsl::span<const char>& Payload, int Timeout) {
+	Payload = gsl::span<const char>();
+	if(UsingTLS == false) {
+		LastErrString = "Packet views require TLS session";
+		return Result::InvalidArg;
+	}
+	ReleaseIdleTLSBuffers();
+	try {return ReadFrameViewTLS<Codec>(Payload, Timeout);}
+	catch(const std::exception&) {std::throw_with_nested(FORMAT_RUNTIME_ERROR("TLS packet view read failed"));}
+}
+// SessionSocket::SendFrame: Encode framing for buffer, and send framing and buffer together to open session
+template<typename Codec>
+_Check_return_ inline SocketOps::Result SocketOps::SessionSocket::SendFrame(_In_reads_(len) const char* buf, size_t len) {
+	if(buf == nullptr || len > Codec::MaxPayload) return Result::InvalidArg;
+	const Framing::Framed<Codec> Frame(len);
+	const WSABUF Buffers[3] = {
+		{gsl::narrow_cast<ULONG>(Codec::HeaderSize), const_cast<char*>(Frame.Header())},
+		{gsl::narrow_cast<ULONG>(len), const_cast<char*>(buf)},
+		{gsl::narrow_cast<ULONG>(Codec::TrailerSize), const_cast<char*>(Frame.Trailer())}};
+	return Send(Buffers, 3);
+}
+// SessionSocket::ReadFrameViewTLS: Read from session until codec can locate complete frame at start of cleartext buffer,
+// then consume frame and return view of its payload (a timeout leaves partial frame buffered for the next call)
+template<typename Codec>
+_Check_return_ inline SocketOps::Result SocketOps::SessionSocket::ReadFrameViewTLS(
+	gsl::span<const char>& Payload, int Timeout) {
+	const SteadyClock EndTime(std::chrono::milliseconds{Timeout});
+	for(;;) {
+		// Determine frame size from buffered data, if possible (note buffer may be compacted by read, so frame location
+		// is only taken once complete):
+		size_t PayloadSize = 0;
+		const size_t FrameSize = (ClearBufBytes > 0)
+			? Codec::Measure(ClearBuf.get() + ClearBufOffset, ClearBufBytes, PayloadSize) : 0;
+		if(FrameSize > 0 && FrameSize <= ClearBufBytes) {
+			Payload = gsl::span<const char>(ClearBuf.get() + ClearBufOffset + Codec::HeaderSize, PayloadSize);
+			ConsumeClearTLS(FrameSize);
+			return Result::OK;
+		}
+
+		// Otherwise wait for whole frame (if size is known) or for more data, ensuring frame can fit in buffer:
+		const size_t Required = (FrameSize > 0) ? FrameSize : ClearBufBytes + 1;
+		if(Required > TLSBufSize) {
+			LastErrString = "Length of incoming packet exceeds maximum";
+			Shutdown(); // Shut down socket to prevent fragmented packet being left on wire
+			return Result::Failed;
+		}
+		const Result rc = FillClearTLS(Required, ValueOps::MinZero(SteadyClock().MSecTill(EndTime)));
+		if(ResultOK(rc) == false) return rc;
+	}
+}
+// SessionSocket::AssociateCompletionPort: Attach socket to completion port, with key identifying socket's completions
+_Check_return_ inline bool SocketOps::SessionSocket::AssociateCompletionPort(HANDLE Port, ULONG_PTR Key) {
+	if(SocketHandle == INVALID_SOCKET) return false;
+	else if(CreateIoCompletionPort(reinterpret_cast<HANDLE>(SocketHandle), Port, Key, 0) == nullptr) {
+		LastErrString = Exceptions::ConvertCOMError(GetLastError());
+		return false;
+	}
+	return true;
+}
+// SessionSocket::SelectWriteEvent: Associate event with writability of socket (signalled at once if already writable)
+_Check_return_ inline bool SocketOps::SessionSocket::SelectWriteEvent(HANDLE Event) {
+	if(SocketHandle == INVALID_SOCKET) return false;
+	else if(WSAEventSelect(SocketHandle, Event, FD_WRITE) == SOCKET_ERROR) {
+		LastErrString = Exceptions::ConvertCOMError(WSAGetLastError());
+		return false;
+	}
+	return true;
+}
+// SessionSocket::PostReadNotify: Queue zero-byte overlapped receive, to complete when data is available
+// - Returns OK if receive is pending or already complete (completion is queued to port in either case)
+_Check_return_ inline SocketOps::Result SocketOps::SessionSocket::PostReadNotify(_Inout_ OVERLAPPED* Overlapped) {
+	if(SocketHandle == INVALID_SOCKET) return Result::InvalidSocket;
+	else if(Overlapped == nullptr) return Result::InvalidArg;
+	memset(Overlapped, 0, sizeof(OVERLAPPED));
+	WSABUF wsabuf = {0, nullptr};
+	DWORD flags = 0;
+	if(WSARecv(SocketHandle, &wsabuf, 1, nullptr, &flags, Overlapped, nullptr) == SOCKET_ERROR) {
+		const int err = WSAGetLastError();
+		if(err != WSA_IO_PENDING) {
+			LastErrString = Exceptions::ConvertCOMError(err);
+			return Result::Failed;
+		}
+	}
+	return Result::OK;
+}
+// SessionSocket::GetTcpInfo: Sample TCP statistics (version 0 structure, available on all systems supporting query)
+_Check_return_ inline bool SocketOps::SessionSocket::GetTcpInfo(TcpInfo& Info) const noexcept {
+	Info = TcpInfo{};
+	if(SocketHandle == INVALID_SOCKET) return false;
+#ifdef SIO_TCP_INFO
+	DWORD Version = 0, BytesReturned = 0;
+	TCP_INFO_v0 ti = {};
+	if(WSAIoctl(SocketHandle, SIO_TCP_INFO, &Version, sizeof(Version), &ti, sizeof(ti), &BytesReturned, nullptr, nullptr)
+		== SOCKET_ERROR || BytesReturned < sizeof(ti)) return false;
+	Info.RttMicros = ti.RttUs;
+	Info.MinRttMicros = ti.MinRttUs;
+	Info.Cwnd = ti.Cwnd;
+	Info.BytesInFlight = ti.BytesInFlight;
+	Info.BytesRetransmitted = ti.BytesRetrans;
+	Info.FastRetransmits = ti.FastRetrans;
+	Info.TimeoutEpisodes = ti.TimeoutEpisodes;
+	return true;
+#else
+	return false; // Not supported by SDK
+#endif
 }
 #pragma endregion SocketOps::SessionSocket
 
+//==========================================================================================================================
+#pragma region SocketOps::WakeSocket
+// WakeSocket::Open: Bind nonblocking receiving socket to ephemeral loopback port, and connect sending socket to it
+_Check_return_ inline bool SocketOps::WakeSocket::Open() {
+	if(Valid()) return true;
+	try {
+		sockaddr_in saddr = {0};
+		int saddrlen = sizeof(saddr);
+		saddr.sin_family = AF_INET;
+		saddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		unsigned long nbarg = 1;
+		if((ReceiveHandle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) == INVALID_SOCKET
+			|| bind(ReceiveHandle, reinterpret_cast<sockaddr*>(&saddr), sizeof(saddr)) == SOCKET_ERROR
+			|| getsockname(ReceiveHandle, reinterpret_cast<sockaddr*>(&saddr), &saddrlen) == SOCKET_ERROR
+			|| ioctlsocket(ReceiveHandle, FIONBIO, &nbarg) == SOCKET_ERROR
+			|| (SendHandle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) == INVALID_SOCKET
+			|| connect(SendHandle, reinterpret_cast<sockaddr*>(&saddr), sizeof(saddr)) == SOCKET_ERROR
+			|| ioctlsocket(SendHandle, FIONBIO, &nbarg) == SOCKET_ERROR) {
+			LastErrString = Exceptions::ConvertCOMError(WSAGetLastError());
+			Close();
+			return false;
+		}
+		return true;
+	}
+	catch(const std::exception&) {std::throw_with_nested(FORMAT_RUNTIME_ERROR("Wake socket open failed"));}
+}
+// WakeSocket::Wake: Send single byte to receiving socket (failure is ignored, as any pending byte will still wake)
+inline void SocketOps::WakeSocket::Wake() const noexcept {
+	constexpr char signal = 0;
+	if(SendHandle != INVALID_SOCKET) send(SendHandle, &signal, 1, 0);
+}
+// WakeSocket::Drain: Read and discard all datagrams pending on receiving socket
+inline void SocketOps::WakeSocket::Drain() const noexcept {
+	char discard[16];
+	if(ReceiveHandle != INVALID_SOCKET) while(recv(ReceiveHandle, discard, sizeof(discard), 0) > 0) {}
+}
+#pragma endregion SocketOps::WakeSocket
+
+//==========================================================================================================================
+#pragma region SocketOps::ConnectRace
+// ConnectRace::Start: Interleave addresses by family (RFC 8305 section 4), then start first attempt
+_Check_return_ inline bool SocketOps::ConnectRace::Start(const std::vector<std::string>& RemoteIPs,
+	unsigned short RemotePort, bool UsingTLS, int AttemptDelay) {
+	Attempts.clear();
+	Addresses.clear();
+	NextAddress = 0;
+	LastErrString.clear();
+	Port = RemotePort;
+	TLS = UsingTLS;
+	Delay = ValueOps::Bounded(ATTEMPT_DELAY_MIN, AttemptDelay, ATTEMPT_DELAY_MAX);
+	std::vector<std::string> preferred, other;
+	const bool preferv6 = (RemoteIPs.empty() == false && RemoteIPs.front().find(':') != std::string::npos);
+	for(const auto& ip : RemoteIPs) {
+		if((ip.find(':') != std::string::npos) == preferv6) preferred.push_back(ip);
+		else other.push_back(ip);
+	}
+	for(size_t i = 0; i < preferred.size() || i < other.size(); ++i) {
+		if(i < preferred.size()) Addresses.push_back(std::move(preferred[i]));
+		if(i < other.size()) Addresses.push_back(std::move(other[i]));
+	}
+	if(Addresses.empty()) {
+		LastErrString = "No destination addresses";
+		return false;
+	}
+	return StartNext();
+}
+// ConnectRace::Poll: Poll attempts in progress, handing over first to complete (abandoning others), and start next
+// attempt if due
+_Check_return_ inline SocketOps::Result SocketOps::ConnectRace::Poll(
+	SessionSocketPtr& Winner, const std::string& TLSMethod) {
+	for(auto seek = Attempts.begin(); seek != Attempts.end();) {
+		const Result rc = (*seek)->PollConnect(0, TLSMethod);
+		if(ResultOK(rc) && (*seek)->Valid()) {
+			Winner = std::move(*seek);
+			Attempts.clear();
+			NextAddress = Addresses.size();
+			return Result::OK;
+		}
+		else if(ResultFailed(rc) || (*seek)->SocketValid() == false) {
+			LastErrString = (*seek)->GetLastErrString();
+			seek = Attempts.erase(seek);
+		}
+		else ++seek;
+	}
+	if(NextAddress < Addresses.size() && (Attempts.empty() || NextAttemptAt.IsPast())) static_cast<void>(StartNext());
+	if(Attempts.empty()) {
+		if(LastErrString.empty()) LastErrString = "All connection attempts failed";
+		return Result::Failed;
+	}
+	return Result::Timeout;
+}
+// ConnectRace::StartNext: Start attempt to next address which accepts a connection attempt (false if none remain)
+_Check_return_ inline bool SocketOps::ConnectRace::StartNext() {
+	while(NextAddress < Addresses.size()) {
+		SessionSocketPtr ss = SessionSocket::StartConnect(Addresses[NextAddress++].c_str(), Port, TLS);
+		if(ss->SocketValid()) {
+			Attempts.push_back(std::move(ss));
+			NextAttemptAt = SteadyClock(std::chrono::milliseconds{Delay});
+			return true;
+		}
+		LastErrString = ss->GetLastErrString();
+	}
+	return false;
+}
+#pragma endregion SocketOps::ConnectRace
+
 }; // (end namespace FIQCPPBASE)
@@ -0,0 +1,653 @@
+//==========================================================================================================================
+// SocketOpsOpenSSL.cpp : OpenSSL TLS backend for SocketOps (used in place of SChannel if FIQ_TLS_OPENSSL is defined)
+//==========================================================================================================================
+#include "pch.h"
+#include "FileOps.h"
+#include "SocketOps.h"
+#include "StringOps.h"
+#ifdef FIQ_TLS_OPENSSL
+#include <openssl/core_names.h>
+#include <openssl/err.h>
+#include <openssl/pkcs12.h>
+#include <openssl/rand.h>
+#include <openssl/ssl.h>
+using namespace FIQCPPBASE;
+
+// Link libraries required for TLS operations
+#pragma comment(lib, "libssl.lib")
+#pragma comment(lib, "libcrypto.lib")
+
+//==========================================================================================================================
+// Local helper functions
+// OpenSSLInitialized: Declares static initialization flag and returns by reference
+_Check_return_ static bool& OpenSSLInitialized() noexcept {
+	static bool Initialized = false;
+	return Initialized;
+}
+// KernelTLSEnabled: Declares static kernel TLS offload flag and returns by reference
+_Check_return_ static std::atomic_bool& KernelTLSEnabled() noexcept {
+	static std::atomic_bool Enabled{false};
+	return Enabled;
+}
+// OpenSSLError: Retrieve text of earliest error queued by OpenSSL (clearing queue), prefixed by function name
+_Check_return_ static std::string OpenSSLError(const char* Function) {
+	const unsigned long e = ERR_get_error();
+	ERR_clear_error();
+	if(e == 0) return std::string(Function) + ": Unknown error";
+	char ErrBuf[256] = {0};
+	ERR_error_string_n(e, ErrBuf, sizeof(ErrBuf));
+	return std::string(Function) + ": " + ErrBuf;
+}
+// ApplyTLSMethod: Set protocol versions enabled for method on context - TLSv1.2 only by default, with lower minimum
+// allowed by method name (as for SChannel backend)
+_Check_return_ static bool ApplyTLSMethod(SSL_CTX* Context, const std::string& TLSMethod) noexcept {
+	int MinVersion = TLS1_2_VERSION;
+	if(_stricmp(TLSMethod.c_str(), "TLSV1.1") == 0) MinVersion = TLS1_1_VERSION;
+	else if(_stricmp(TLSMethod.c_str(), "TLSV1") == 0) MinVersion = TLS1_VERSION;
+	return (SSL_CTX_set_min_proto_version(Context, MinVersion) == 1
+		&& SSL_CTX_set_max_proto_version(Context, TLS1_2_VERSION) == 1);
+}
+
+//==========================================================================================================================
+#pragma region SocketOps
+// SocketOps::InitializeTLS: Initialize OpenSSL library
+void SocketOps::InitializeTLS() {
+	if(OPENSSL_init_ssl(OPENSSL_INIT_LOAD_SSL_STRINGS | OPENSSL_INIT_LOAD_CRYPTO_STRINGS, nullptr) != 1)
+		throw std::runtime_error(OpenSSLError("OPENSSL_init_ssl"));
+	OpenSSLInitialized() = true;
+}
+// SocketOps::CleanupTLS: Flag library as no longer available (OpenSSL releases its own resources at process exit)
+void SocketOps::CleanupTLS() {
+	OpenSSLInitialized() = false;
+}
+// SocketOps::SetKernelTLS: Enable or disable kernel TLS offload for sessions started from now on
+bool SocketOps::SetKernelTLS(bool Enable) noexcept {
+#ifdef OPENSSL_NO_KTLS
+	return (Enable == false);
+#else
+	KernelTLSEnabled() = Enable;
+	return true;
+#endif
+}
+#pragma endregion SocketOps
+
+//==========================================================================================================================
+#pragma region SocketOps::ServerSocket
+// ServerSocket::CredentialsValid: Check that context has been created with certificate and key
+_Check_return_ bool SocketOps::ServerSocket::CredentialsValid() const noexcept {
+	return (SslContext != nullptr);
+}
+// ServerSocket::InitCredentialsFromStore: Not supported by this backend (system certificate stores are SChannel-only)
+_Check_return_ bool SocketOps::ServerSocket::InitCredentialsFromStore(
+	const std::string&, const std::string&, bool) {
+	UsingTLS = true; // Set flag to ensure credentials are validated on all future checks
+	LastErrString = "Certificate store not supported by OpenSSL backend";
+	return false;
+}
+// ServerSocket::InitCredentialsFromFile: Read certificate, key and chain from PKCS12 file into new server context
+_Check_return_ bool SocketOps::ServerSocket::InitCredentialsFromFile(
+	const std::string& FileName, const std::string& FilePassword, const std::string& CertName, const std::string& TLSMethod) {
+	UsingTLS = true; // Set flag to ensure credentials are validated on all future checks
+	// Ensure this object has not yet been initialized, but that library has:
+	if(SslContext != nullptr) {
+		LastErrString = "Credentials have already been initialized";
+		return false;
+	}
+	else if(OpenSSLInitialized() == false) {
+		LastErrString = "OpenSSL library has not been initialized";
+		return false;
+	}
+	try {
+		// Read and parse PKCS12 file contents:
+		std::unique_ptr<PKCS12, decltype(&PKCS12_free)> p12(nullptr, &PKCS12_free);
+		{FileOps::FilePtr CertFile = FileOps::OpenFile(FileName.c_str(), "rb", _SH_DENYWR);
+		if(CertFile.get() == nullptr) {
+			LastErrString = Exceptions::ConvertCOMError(GetLastError());
+			return false;
+		}
+		p12.reset(d2i_PKCS12_fp(CertFile.get(), nullptr));}
+		if(p12.get() == nullptr) {
+			LastErrString = OpenSSLError("d2i_PKCS12_fp");
+			return false;
+		}
+		EVP_PKEY* pKey = nullptr;
+		X509* pCert = nullptr;
+		STACK_OF(X509)* pChain = nullptr;
+		if(PKCS12_parse(p12.get(), FilePassword.c_str(), &pKey, &pCert, &pChain) != 1) {
+			LastErrString = OpenSSLError("PKCS12_parse");
+			return false;
+		}
+		const std::unique_ptr<EVP_PKEY, decltype(&EVP_PKEY_free)> Key(pKey, &EVP_PKEY_free);
+		const std::unique_ptr<X509, decltype(&X509_free)> Cert(pCert, &X509_free);
+		const std::unique_ptr<STACK_OF(X509), void(*)(STACK_OF(X509)*)> Chain(
+			pChain, [](STACK_OF(X509)* c) {sk_X509_pop_free(c, X509_free);});
+		if(Key.get() == nullptr || Cert.get() == nullptr) {
+			LastErrString = "PKCS12_parse: Certificate or private key not found";
+			return false;
+		}
+
+		// Confirm certificate subject contains requested name (as per SChannel backend subject search):
+		{char Subject[256] = {0};
+		X509_NAME_oneline(X509_get_subject_name(Cert.get()), Subject, sizeof(Subject));
+		if(strstr(Subject, CertName.c_str()) == nullptr) {
+			LastErrString = CertName + ": Certificate not found";
+			return false;
+		}}
+
+		// Create context, load certificate, key and chain (this context is then shared by all accepted sessions):
+		if((SslContext = SSL_CTX_new(TLS_server_method())) == nullptr) {
+			LastErrString = OpenSSLError("SSL_CTX_new");
+			return false;
+		}
+		bool Loaded = (SSL_CTX_use_certificate(SslContext, Cert.get()) == 1
+			&& SSL_CTX_use_PrivateKey(SslContext, Key.get()) == 1
+			&& SSL_CTX_check_private_key(SslContext) == 1);
+		for(int c = 0; Loaded && c < sk_X509_num(Chain.get()); ++c)
+			Loaded = (SSL_CTX_add1_chain_cert(SslContext, sk_X509_value(Chain.get(), c)) == 1);
+		if(Loaded == false) {
+			LastErrString = OpenSSLError("SSL_CTX_use_certificate");
+			CleanupCredentials();
+			return false;
+		}
+		return CompleteInitCredentials(TLSMethod);
+	}
+	catch(const std::exception&) {std::throw_with_nested(FORMAT_RUNTIME_ERROR("Server credential initialization failed"));}
+}
+// ServerSocket::CleanupCredentials: Free context and ticket keys
+void SocketOps::ServerSocket::CleanupCredentials() {
+	if(SslContext) SSL_CTX_free(SslContext);
+	SslContext = nullptr;
+	std::lock_guard<std::mutex> lock(TicketLock);
+	OPENSSL_cleanse(TicketKeys, sizeof(TicketKeys));
+	TicketKeyCount = 0;
+	TicketKeysSupported = false;
+}
+// ServerSocket::CompleteInitCredentials: Apply protocol settings to context, and install session ticket handling
+// - Before this function executes, caller should have created context and loaded certificate and key
+_Check_return_ bool SocketOps::ServerSocket::CompleteInitCredentials(const std::string& TLSMethod) {
+	if(ApplyTLSMethod(SslContext, TLSMethod) == false) {
+		LastErrString = OpenSSLError("SSL_CTX_set_min_proto_version");
+		CleanupCredentials();
+		return false;
+	}
+	// Release per-session buffers while idle, and resume sessions from tickets only (no server-side session cache,
+	// which would be shared by all negotiating threads):
+	SSL_CTX_set_mode(SslContext, SSL_MODE_RELEASE_BUFFERS);
+	SSL_CTX_set_session_cache_mode(SslContext, SSL_SESS_CACHE_OFF);
+	SSL_CTX_set_app_data(SslContext, this);
+	SSL_CTX_set_tlsext_ticket_key_evp_cb(SslContext, &TicketKeyCallback);
+	// Install initial session ticket key:
+	{std::lock_guard<std::mutex> lock(TicketLock);
+	TicketKeysSupported = InstallTicketKeys(LastErrString);}
+	if(TicketKeysSupported == false) {
+		CleanupCredentials();
+		return false;
+	}
+	return CredentialsValid();
+}
+// ServerSocket::InstallTicketKeys: Generate new session ticket key and make it current key (previous current key is
+// retained for decryption only, with any older key discarded)
+// - Caller must hold TicketLock
+_Check_return_ bool SocketOps::ServerSocket::InstallTicketKeys(std::string& ErrString) {
+	TicketKey NewKey = {};
+	if(RAND_bytes(NewKey.Id, sizeof(NewKey.Id)) != 1 || RAND_bytes(NewKey.Material, sizeof(NewKey.Material)) != 1) {
+		ErrString = OpenSSLError("RAND_bytes");
+		return false;
+	}
+	TicketKeys[1] = TicketKeys[0];
+	TicketKeys[0] = NewKey;
+	TicketKeyCount = (TicketKeyCount > 0) ? 2 : 1;
+	TicketKeyRotateAt = SteadyClock(std::chrono::milliseconds{TicketKeyInterval});
+	OPENSSL_cleanse(&NewKey, sizeof(NewKey));
+	SocketOps::CountTicketKeyRotation();
+	return true;
+}
+// ServerSocket::TicketKeyCallback: Initialize ticket encryption (using current key) or decryption (using key named in
+// ticket, if still held) - key material holds AES-256 key followed by HMAC-SHA256 key
+// - Returns 1 if current key was used, 2 if previous key was used (so that ticket is renewed under current key), 0 if
+//   key is not known (so that full handshake is performed), or -1 on error
+int SocketOps::ServerSocket::TicketKeyCallback(SSL* ssl, unsigned char* KeyName, unsigned char* IV,
+	EVP_CIPHER_CTX* CipherCtx, EVP_MAC_CTX* MacCtx, int Encrypt) {
+	ServerSocket* const Server = static_cast<ServerSocket*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+	if(Server == nullptr) return -1;
+	static_assert(sizeof(TicketKey::Id) == 16 && sizeof(TicketKey::Material) == 64, "Invalid ticket key size");
+	TicketKey Key = {};
+	int rc = 0;
+	{std::lock_guard<std::mutex> lock(Server->TicketLock);
+	for(size_t k = 0; k < Server->TicketKeyCount && rc == 0; ++k) {
+		if(Encrypt || memcmp(KeyName, Server->TicketKeys[k].Id, sizeof(Key.Id)) == 0) {
+			Key = Server->TicketKeys[k];
+			rc = (k == 0) ? 1 : 2;
+		}
+	}}
+	if(rc > 0) {
+		OSSL_PARAM Params[3] = {
+			OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, Key.Material + 32, 32),
+			OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, const_cast<char*>("SHA256"), 0),
+			OSSL_PARAM_construct_end()
+		};
+		if(Encrypt) {
+			memcpy(KeyName, Key.Id, sizeof(Key.Id));
+			if(RAND_bytes(IV, EVP_CIPHER_get_iv_length(EVP_aes_256_cbc())) != 1
+				|| EVP_EncryptInit_ex(CipherCtx, EVP_aes_256_cbc(), nullptr, Key.Material, IV) != 1) rc = -1;
+		}
+		else if(EVP_DecryptInit_ex(CipherCtx, EVP_aes_256_cbc(), nullptr, Key.Material, IV) != 1) rc = -1;
+		if(rc > 0 && EVP_MAC_CTX_set_params(MacCtx, Params) != 1) rc = -1;
+	}
+	OPENSSL_cleanse(&Key, sizeof(Key));
+	return rc;
+}
+// ServerSocket::TLSNegotiate: Perform server-side TLS negotiation on new socket connection
+// - Error text is written to session object only (server object is not modified, so that multiple threads may negotiate
+//   sessions accepted from the same listener concurrently)
+_Check_return_ SocketOps::Result SocketOps::ServerSocket::TLSNegotiate(
+	const SocketOps::SessionSocketPtr& sp, int Timeout) {
+	// Validate input socket, validate this object's TLS credentials
+	if((sp.get() ? sp->TLSReady() : false) == false) {
+		sp->LastErrString = "TLS negotiation failed: Invalid socket";
+		return Result::InvalidSocket;
+	}
+	else if(CredentialsValid() == false) {
+		sp->LastErrString = "TLS negotiation failed: Server credentials not initialized";
+		return Result::InvalidArg;
+	}
+	sp->LastErrString.clear();
+	try {
+		if(sp->SslSession == nullptr) {
+			// Negotiation is starting; if current session ticket key is due for replacement, rotate now (if rotation
+			// fails, current keys remain in use until the next interval):
+			{std::lock_guard<std::mutex> lock(TicketLock);
+			if(TicketKeysSupported && TicketKeyRotateAt.IsPast()) {
+				std::string TicketErrString;
+				if(InstallTicketKeys(TicketErrString) == false)
+					TicketKeyRotateAt = SteadyClock(std::chrono::milliseconds{TicketKeyInterval});
+			}}
+			if(sp->StartTLS(SslContext, true) == false) {
+				sp->Shutdown();
+				return Result::Failed;
+			}
+		}
+		return sp->NegotiateTLS(Timeout, true);
+	}
+	catch(const std::exception&) {std::throw_with_nested(FORMAT_RUNTIME_ERROR("TLS negotiation (server) failed"));}
+}
+#pragma endregion SocketOps::ServerSocket
+
+//==========================================================================================================================
+#pragma region SocketOps::SessionSocket
+// SessionSocket::ClientCredentials::Init: Create client context for TLS method
+_Check_return_ bool SocketOps::SessionSocket::ClientCredentials::Init(const std::string& TLSMethod, std::string& LastErrString) {
+	LastErrString.clear();
+	// Ensure this object has not yet been initialized, but that library has:
+	if(SslContext != nullptr) {
+		LastErrString = "Credentials have already been initialized";
+		return false;
+	}
+	else if(OpenSSLInitialized() == false) {
+		LastErrString = "OpenSSL library has not been initialized";
+		return false;
+	}
+	if((SslContext = SSL_CTX_new(TLS_client_method())) == nullptr) {
+		LastErrString = OpenSSLError("SSL_CTX_new");
+		return false;
+	}
+	else if(ApplyTLSMethod(SslContext, TLSMethod) == false) {
+		LastErrString = OpenSSLError("SSL_CTX_set_min_proto_version");
+		Cleanup();
+		return false;
+	}
+	// By default do not validate server credentials (may be added in future):
+	SSL_CTX_set_verify(SslContext, SSL_VERIFY_NONE, nullptr);
+	SSL_CTX_set_mode(SslContext, SSL_MODE_RELEASE_BUFFERS);
+	// Sessions issued by servers are held in this object's cache (keyed by endpoint) rather than OpenSSL's internal
+	// cache, which is keyed by session ID only:
+	SSL_CTX_set_session_cache_mode(SslContext, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+	SSL_CTX_sess_set_new_cb(SslContext, &NewSessionCallback);
+	SSL_CTX_set_app_data(SslContext, this);
+	return Valid();
+}
+// SessionSocket::ClientCredentials::Cleanup: Release cached sessions and client context
+void SocketOps::SessionSocket::ClientCredentials::Cleanup() {
+	{std::lock_guard<std::mutex> lock(SessionLock);
+	for(const auto& s : Sessions) SSL_SESSION_free(s.second);
+	Sessions.clear();}
+	if(SslContext) SSL_CTX_free(SslContext);
+	SslContext = nullptr;
+}
+// SessionSocket::ClientCredentials::StoreSession: Replace cached session for endpoint (taking ownership of reference)
+// - If cache is full, it is emptied first (sessions for active endpoints are replaced as they reconnect)
+void SocketOps::SessionSocket::ClientCredentials::StoreSession(const std::wstring& Target, SSL_SESSION* Session) {
+	std::lock_guard<std::mutex> lock(SessionLock);
+	if(Sessions.size() >= SESSION_CACHE_MAX) {
+		for(const auto& s : Sessions) SSL_SESSION_free(s.second);
+		Sessions.clear();
+	}
+	SSL_SESSION*& Cached = Sessions[Target];
+	if(Cached) SSL_SESSION_free(Cached);
+	Cached = Session;
+}
+// SessionSocket::ClientCredentials::FindSession: Retrieve cached session for endpoint, if still resumable
+_Check_return_ SSL_SESSION* SocketOps::SessionSocket::ClientCredentials::FindSession(const std::wstring& Target) {
+	std::lock_guard<std::mutex> lock(SessionLock);
+	const auto seek = Sessions.find(Target);
+	if(seek == Sessions.end()) return nullptr;
+	else if(SSL_SESSION_is_resumable(seek->second) != 1) {
+		SSL_SESSION_free(seek->second);
+		Sessions.erase(seek);
+		return nullptr;
+	}
+	SSL_SESSION_up_ref(seek->second);
+	return seek->second;
+}
+// SessionSocket::ClientCredentials::NewSessionCallback: Cache session issued by server, against session's endpoint
+// - Returns 1 if reference to session was retained, otherwise 0
+int SocketOps::SessionSocket::ClientCredentials::NewSessionCallback(SSL* ssl, SSL_SESSION* Session) {
+	SessionSocket* const Socket = static_cast<SessionSocket*>(SSL_get_app_data(ssl));
+	ClientCredentials* const Creds = static_cast<ClientCredentials*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+	if(Socket == nullptr || Creds == nullptr || Socket->TLSTarget.empty()) return 0;
+	try {Creds->StoreSession(Socket->TLSTarget, Session);}
+	catch(const std::exception&) {return 0;} // Session not cached (exception cannot be passed through OpenSSL)
+	return 1;
+}
+// SessionSocket::TLSNegotiate: Perform client-side negotiation on socket connection
+_Check_return_ SocketOps::Result SocketOps::SessionSocket::TLSNegotiate(int Timeout, const std::string& Method) {
+	if((SocketValid() ? TLSReady() : false) == false) {
+		LastErrString = "TLS negotiation failed: Invalid socket";
+		return Result::InvalidSocket;
+	}
+	LastErrString.clear();
+	try {
+		if(SslSession == nullptr) {
+			// Start session from shared client context, offering session cached for this endpoint (if any):
+			ClientCred = ClientCredentials::Acquire(Method, LastErrString);
+			if(ClientCred.get() == nullptr || StartTLS(ClientCred->GetContext(), false) == false) {
+				Shutdown();
+				return Result::Failed;
+			}
+			if(TLSTarget.empty() == false) {
+				SSL_SESSION* const Cached = ClientCred->FindSession(TLSTarget);
+				if(Cached != nullptr) {
+					SSL_set_session(SslSession, Cached);
+					SSL_SESSION_free(Cached);
+				}
+			}
+		}
+		return NegotiateTLS(Timeout, false);
+	}
+	catch(const std::exception&) {std::throw_with_nested(FORMAT_RUNTIME_ERROR("TLS negotiation (client) failed"));}
+}
+// SessionSocket::StartTLS: Create session object from context, attaching memory buffers
+// - If kernel TLS is enabled, session is instead attached directly to socket (OpenSSL can only pass keys to the kernel
+//   when it performs socket I/O itself), and socket is placed in nonblocking mode until negotiation completes
+_Check_return_ bool SocketOps::SessionSocket::StartTLS(SSL_CTX* Context, bool Server) {
+	TLSSocketBio = KernelTLSEnabled().load();
+	BIO* const ReadBio = TLSSocketBio ? BIO_new_socket(gsl::narrow_cast<int>(SocketHandle), BIO_NOCLOSE) : BIO_new(BIO_s_mem());
+	BIO* const WriteBio = TLSSocketBio ? ReadBio : BIO_new(BIO_s_mem());
+	if(ReadBio == nullptr || WriteBio == nullptr || (SslSession = SSL_new(Context)) == nullptr) {
+		LastErrString = OpenSSLError("SSL_new");
+		BIO_free(ReadBio);
+		if(WriteBio != ReadBio) BIO_free(WriteBio);
+		return false;
+	}
+	if(TLSSocketBio) {
+		// Take second reference to socket buffer, so that either direction can later be replaced independently:
+		BIO_up_ref(ReadBio);
+		SSL_set_options(SslSession, SSL_OP_ENABLE_KTLS);
+		if(SetNonBlocking(true) == false) {
+			SSL_set0_rbio(SslSession, ReadBio);
+			SSL_set0_wbio(SslSession, WriteBio);
+			return false;
+		}
+	}
+	// Reading from empty read buffer should request more data, rather than indicate end of stream:
+	else BIO_set_mem_eof_return(ReadBio, -1);
+	SSL_set0_rbio(SslSession, ReadBio); // Session takes ownership of both buffers
+	SSL_set0_wbio(SslSession, WriteBio);
+	SSL_set_app_data(SslSession, this);
+	if(Server) SSL_set_accept_state(SslSession);
+	else SSL_set_connect_state(SslSession);
+	return true;
+}
+// SessionSocket::NegotiateTLS: Advance handshake until complete, failed, or no further data arrives within Timeout
+_Check_return_ SocketOps::Result SocketOps::SessionSocket::NegotiateTLS(int Timeout, bool Server) {
+	const SteadyClock EndTime(std::chrono::milliseconds{Timeout});
+	Result rc = Result::Timeout;
+	for(short s = 0; s < 15 && rc == Result::Timeout; ++s) {
+		// Process data received so far, delivering any handshake output (including alert, if negotiation failed):
+		const int hrc = SSL_do_handshake(SslSession);
+		const int err = (hrc == 1) ? SSL_ERROR_NONE : SSL_get_error(SslSession, hrc);
+		const bool Wait = (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE); // (socket write only if kernel TLS)
+		const std::string ErrString = (hrc == 1 || Wait) ? "" : OpenSSLError("SSL_do_handshake");
+		if(ResultOK(rc = FlushTLS()) == false) {
+			if(LastErrString.empty()) LastErrString = "TLS negotiation failed: Socket send failed";
+			else LastErrString = "TLS negotiation failed: " + LastErrString;
+			break;
+		}
+		else if(hrc == 1) {
+			// Negotiation complete; record whether cached session was resumed, and which directions kernel accepted:
+			if(TLSSocketBio && ResultOK(rc = CompleteKernelTLS()) == false) {
+				Shutdown();
+				LastErrString = "TLS negotiation failed: " + LastErrString;
+				break;
+			}
+			TLSSessionResumed = SocketOps::CountTLSHandshake(Server, SSL_session_reused(SslSession) == 1);
+			TLSComplete = true;
+			break;
+		}
+		else if(Wait == false) {
+			Shutdown();
+			rc = Result::Failed;
+			LastErrString = "TLS negotiation failed: " + ErrString;
+			break;
+		}
+		// Handshake requires further data from remote; wait for and read it (without waiting, if no time remains):
+		rc = ReceiveTLS(ValueOps::MinZero(SteadyClock().MSecTill(EndTime)));
+		if(ResultOK(rc)) rc = Result::Timeout;
+		else if(ResultFailed(rc)) LastErrString = "TLS negotiation failed: " + LastErrString;
+	}
+	ReleaseIdleTLSBuffers(); // (raw data is held by session's read buffer, so read buffer is only required while reading)
+	return rc;
+}
+// SessionSocket::CompleteKernelTLS: Once negotiation over socket completes, record directions in which OpenSSL passed
+// keys to kernel, and return remaining directions to memory buffers (for user-space TLS, as for all other sessions);
+// socket is returned to blocking mode
+_Check_return_ SocketOps::Result SocketOps::SessionSocket::CompleteKernelTLS() {
+	const bool KernelSend = (BIO_get_ktls_send(SSL_get_wbio(SslSession)) != 0);
+	const bool KernelReceive = (BIO_get_ktls_recv(SSL_get_rbio(SslSession)) != 0);
+	TLSOffloadMode = KernelSend ? (KernelReceive ? TLSOffload::Full : TLSOffload::Send)
+		: (KernelReceive ? TLSOffload::Receive : TLSOffload::None);
+	if(KernelSend == false) {
+		BIO* const WriteBio = BIO_new(BIO_s_mem());
+		if(WriteBio == nullptr) {
+			LastErrString = OpenSSLError("BIO_new");
+			return Result::Failed;
+		}
+		SSL_set0_wbio(SslSession, WriteBio);
+	}
+	if(KernelReceive == false) {
+		// (OpenSSL does not read ahead of handshake records, so no further data is held by socket buffer)
+		BIO* const ReadBio = BIO_new(BIO_s_mem());
+		if(ReadBio == nullptr) {
+			LastErrString = OpenSSLError("BIO_new");
+			return Result::Failed;
+		}
+		BIO_set_mem_eof_return(ReadBio, -1);
+		SSL_set0_rbio(SslSession, ReadBio);
+	}
+	TLSSocketBio = false;
+	return SetNonBlocking(false) ? Result::OK : Result::Failed;
+}
+// SessionSocket::ReceiveTLS: Wait for data on socket, and pass data read to session's read buffer (if session reads
+// socket directly, i.e. negotiating for kernel TLS, wait only)
+_Check_return_ SocketOps::Result SocketOps::SessionSocket::ReceiveTLS(int Timeout) {
+	Result rc = SocketOps::WaitEvent(SocketHandle, Timeout, &LastErrString);
+	if(ResultOK(rc) && TLSSocketBio == false) {
+		AcquireTLSBuffers();
+		size_t br = 0;
+		if(ResultOK(rc = SocketOps::ReadAvailable(SocketHandle, ReadBuf.get(), TLSBufSize, br, &LastErrString))) {
+			if(ValueOps::Is(br).InRange(1, TLSBufSize) == false) {
+				Shutdown();
+				rc = Result::Failed;
+				if(br != 0) LastErrString = "Invalid number of bytes read";
+			}
+			else if(BIO_write(SSL_get_rbio(SslSession), ReadBuf.get(), gsl::narrow_cast<int>(br)) != static_cast<int>(br)) {
+				Shutdown();
+				rc = Result::Failed;
+				LastErrString = OpenSSLError("BIO_write");
+			}
+		}
+	}
+	return rc;
+}
+// SessionSocket::FlushTLS: Deliver contents of session's write buffer (if any) to socket
+_Check_return_ SocketOps::Result SocketOps::SessionSocket::FlushTLS() {
+	BIO* const WriteBio = SSL_get_wbio(SslSession);
+	if(BIO_method_type(WriteBio) != BIO_TYPE_MEM) return Result::OK; // Session writes to socket directly
+	char* Pending = nullptr;
+	const long PendingBytes = BIO_get_mem_data(WriteBio, &Pending);
+	if(PendingBytes <= 0 || Pending == nullptr) return Result::OK;
+	const Result rc = SocketOps::Send(SocketHandle, Pending, static_cast<size_t>(PendingBytes), &LastErrString);
+	(void)BIO_reset(WriteBio);
+	return rc;
+}
+// SessionSocket::EncryptTLS: Encrypt contents of buffers into a single TLS message, appended to end of Tgt
+_Check_return_ SocketOps::Result SocketOps::SessionSocket::EncryptTLS(
+	_In_reads_(Count) const WSABUF* Buffers, size_t Count, std::vector<char>& Tgt) {
+	if(Valid() == false) return Result::InvalidSocket;
+	else if(Buffers == nullptr || Count == 0) return Result::InvalidArg;
+	size_t len = 0;
+	for(size_t b = 0; b < Count; ++b) len += Buffers[b].len;
+	if(ValueOps::Is(len).InRange(1, TLSMessageMax()) == false) return Result::InvalidArg;
+
+	try {
+		// Gather multiple buffers into one message (each write produces a separate record), reusing gather buffer:
+		const char* Data = Buffers[0].buf;
+		if(Count > 1) {
+			GatherBuf.clear();
+			for(size_t b = 0; b < Count; ++b) GatherBuf.insert(GatherBuf.end(), Buffers[b].buf, Buffers[b].buf + Buffers[b].len);
+			Data = GatherBuf.data();
+		}
+		if(SSL_write(SslSession, Data, gsl::narrow_cast<int>(len)) != static_cast<int>(len)) {
+			Shutdown();
+			LastErrString = OpenSSLError("SSL_write");
+			return Result::Failed;
+		}
+		// Move encrypted record from session's write buffer to target:
+		BIO* const WriteBio = SSL_get_wbio(SslSession);
+		char* Encrypted = nullptr;
+		const long EncryptedBytes = BIO_get_mem_data(WriteBio, &Encrypted);
+		if(EncryptedBytes > 0 && Encrypted != nullptr) Tgt.insert(Tgt.end(), Encrypted, Encrypted + EncryptedBytes);
+		(void)BIO_reset(WriteBio);
+		return Result::OK;
+	}
+	catch(const std::exception&) {std::throw_with_nested(FORMAT_RUNTIME_ERROR("TLS data encryption failed"));}
+}
+// SessionSocket::PrivateReadTLS: Read data from socket and decrypt as much as cleartext buffer will hold
+_Check_return_ SocketOps::Result SocketOps::SessionSocket::PrivateReadTLS(int Timeout) {
+	// Note this function should only be called from one of SessionSocket's ReadTLS functions,
+	// which should have already validated the session socket members and checked that incoming
+	// data is available
+	try {
+		AcquireTLSBuffers();
+		if(KernelTLSReceive()) {
+			// Kernel decrypts inbound records, so read cleartext from socket directly into cleartext buffer:
+			if(ClearBufBytes >= TLSBufSize) return Result::OK;
+			Result rc = SocketOps::WaitEvent(SocketHandle, Timeout, &LastErrString);
+			if(ResultOK(rc)) {
+				if(ClearBufOffset + ClearBufBytes >= TLSBufSize) CompactClearTLS();
+				const size_t MaxBytes = TLSBufSize - ClearBufOffset - ClearBufBytes;
+				size_t br = 0;
+				rc = SocketOps::ReadAvailable(SocketHandle, ClearBuf.get() + ClearBufOffset + ClearBufBytes, MaxBytes, br, &LastErrString);
+				if(ResultOK(rc)) {
+					if(ValueOps::Is(br).InRange(1, MaxBytes)) ClearBufBytes += br;
+					else {
+						Shutdown(); // Zero bytes read indicates remote closed session (or sent non-data record)
+						rc = Result::Failed;
+						if(br != 0) LastErrString = "Invalid number of bytes read";
+					}
+				}
+			}
+			return rc;
+		}
+		const SteadyClock EndTime(std::chrono::milliseconds{Timeout});
+		Result rc = Result::Timeout;
+		for(short s = 0; s < 15 && rc == Result::Timeout; ++s) {
+			// Unless this is first loop iteration (and undecrypted data is already held by session), read from socket:
+			if(s > 0 || (SSL_pending(SslSession) == 0 && BIO_ctrl_pending(SSL_get_rbio(SslSession)) == 0)) {
+				const Result src = ReceiveTLS(ValueOps::MinZero(SteadyClock().MSecTill(EndTime)));
+				if(ResultOK(src) == false) {
+					rc = src;
+					break;
+				}
+			}
+			// Decrypt all complete records held (up to space available in cleartext buffer, compacting buffer only
+			// once space following data already held is exhausted):
+			while(ClearBufBytes < TLSBufSize) {
+				if(ClearBufOffset + ClearBufBytes >= TLSBufSize) CompactClearTLS();
+				char* const ClearPtr = ClearBuf.get() + ClearBufOffset + ClearBufBytes;
+				const int br = SSL_read(SslSession, ClearPtr, gsl::narrow_cast<int>(TLSBufSize - ClearBufOffset - ClearBufBytes));
+				if(br > 0) {
+					ClearBufBytes += static_cast<size_t>(br);
+					rc = Result::OK;
+					continue;
+				}
+				const int err = SSL_get_error(SslSession, br);
+				if(err == SSL_ERROR_ZERO_RETURN) { // Remote has gracefully closed TLS session
+					Shutdown();
+					rc = Result::Failed;
+				}
+				else if(err != SSL_ERROR_WANT_READ) {
+					Shutdown();
+					rc = Result::Failed;
+					LastErrString = OpenSSLError("SSL_read");
+				}
+				break;
+			}
+			// Deliver any protocol output produced while reading (e.g. key update response):
+			if(ResultFailed(rc) == false) {
+				const Result src = FlushTLS();
+				if(ResultOK(src) == false) rc = src;
+			}
+		}
+		return rc;
+	}
+	catch(const std::exception&) {std::throw_with_nested(FORMAT_RUNTIME_ERROR("Failed to read TLS data"));}
+}
+// SessionSocket::DataBuffered: Check for decrypted data, or raw data not yet decrypted, already read from socket
+_Check_return_ bool SocketOps::SessionSocket::DataBuffered() const noexcept {
+	return ((ClearBuf.get() ? (ClearBufBytes > 0) : false)
+		|| (SslSession ? (SSL_pending(SslSession) > 0 || BIO_ctrl_pending(SSL_get_rbio(SslSession)) > 0) : false));
+}
+// SessionSocket::TLSMessageMax: Largest message accepted by EncryptTLS (limited by maximum record size, and by read
+// buffer size less worst-case record overhead, so that a full message fits within read buffer of a peer of equal size)
+_Check_return_ size_t SocketOps::SessionSocket::TLSMessageMax() const noexcept {
+	constexpr size_t Overhead = SSL3_RT_HEADER_LENGTH + EVP_MAX_IV_LENGTH + EVP_MAX_MD_SIZE + EVP_MAX_BLOCK_LENGTH;
+	return (std::min)((TLSBufSize > Overhead) ? TLSBufSize - Overhead : 0,
+		static_cast<size_t>(SSL3_RT_MAX_PLAIN_LENGTH));
+}
+// SessionSocket::GetTLSCipherSuite, GetTLSCipher, GetTLSHash, GetTLSExchange: Retrieve negotiated cipher data
+std::string SocketOps::SessionSocket::GetTLSCipherSuite() const {
+	const SSL_CIPHER* const Cipher = SslSession ? SSL_get_current_cipher(SslSession) : nullptr;
+	return Cipher ? SSL_CIPHER_get_name(Cipher) : "";
+}
+std::string SocketOps::SessionSocket::GetTLSCipher() const {
+	const SSL_CIPHER* const Cipher = SslSession ? SSL_get_current_cipher(SslSession) : nullptr;
+	return Cipher ? OBJ_nid2sn(SSL_CIPHER_get_cipher_nid(Cipher)) : "";
+}
+std::string SocketOps::SessionSocket::GetTLSHash() const {
+	const SSL_CIPHER* const Cipher = SslSession ? SSL_get_current_cipher(SslSession) : nullptr;
+	const EVP_MD* const Hash = Cipher ? SSL_CIPHER_get_handshake_digest(Cipher) : nullptr;
+	return Hash ? EVP_MD_get0_name(Hash) : "";
+}
+std::string SocketOps::SessionSocket::GetTLSExchange() const {
+	const SSL_CIPHER* const Cipher = SslSession ? SSL_get_current_cipher(SslSession) : nullptr;
+	return Cipher ? OBJ_nid2sn(SSL_CIPHER_get_kx_nid(Cipher)) : "";
+}
+// SessionSocket::CloseTLS: Free session object (and with it, its memory buffers)
+void SocketOps::SessionSocket::CloseTLS() noexcept {
+	if(SslSession) SSL_free(SslSession);
+	SslSession = nullptr;
+	TLSSocketBio = false;
+}
+#pragma endregion SocketOps::SessionSocket
+#endif // FIQ_TLS_OPENSSL
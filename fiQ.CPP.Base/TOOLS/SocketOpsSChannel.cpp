@@ -0,0 +1,938 @@
+//==========================================================================================================================
+// SocketOpsSChannel.cpp : SChannel TLS backend for SocketOps (default backend, unless FIQ_TLS_OPENSSL is defined)
+//==========================================================================================================================
+#include "pch.h"
+#include "FileOps.h"
+#include "SocketOps.h"
+#include "StringOps.h"
+#ifndef FIQ_TLS_OPENSSL
+#include <bcrypt.h>
+using namespace FIQCPPBASE;
+
+// Link libraries required for TLS operations
+#pragma comment(lib, "crypt32.lib")
+#pragma comment(lib, "secur32.lib")
+#pragma comment(lib, "bcrypt.lib")
+
+//==========================================================================================================================
+#pragma region SocketOps
+// SocketOps::GetSChannel: Declares static HMODULE and returns by reference
+_Check_return_ HMODULE& SocketOps::GetSChannel() noexcept {
+	static HMODULE hSChannel = NULL;
+	return hSChannel;
+}
+// SocketOps::GetFunctionTable: Declares static pointer to security function table and returns by reference
+_Check_return_ PSecurityFunctionTable& SocketOps::GetFunctionTable() noexcept {
+	static PSecurityFunctionTable pFunctionTable = nullptr;
+	return pFunctionTable;
+}
+// SocketOps::InitializeTLS: Load SChannel library and retrieve security function table
+GSL_SUPPRESS(type.1) // reinterpret_cast is preferable to C-style cast (required to set INIT_SECURITY_INTERFACE)
+void SocketOps::InitializeTLS() {
+	HMODULE hSChannel = NULL;
+	try {
+		// Load DLL handle into local variable:
+		if((hSChannel = LoadLibrary(L"SCHANNEL.DLL")) == NULL)
+			throw std::runtime_error("LoadLibrary: " + Exceptions::ConvertCOMError(GetLastError()));
+		// Get address of InitSecurityInterface function from DLL handle:
+		INIT_SECURITY_INTERFACE pInitSecurityInterface =
+			reinterpret_cast<INIT_SECURITY_INTERFACE>(GetProcAddress(hSChannel, SECURITY_ENTRYPOINT_ANSI));
+		if(pInitSecurityInterface == NULL)
+			throw std::runtime_error("GetProcAddress: " + Exceptions::ConvertCOMError(GetLastError()));
+		// Use InitSecurityInterface to retrieve function table pointer:
+		PSecurityFunctionTable pFunctionTable = pInitSecurityInterface();
+		if(pFunctionTable == nullptr)
+			throw std::runtime_error("InitSecurityInterface: " + Exceptions::ConvertCOMError(GetLastError()));
+
+		// If this point is reached, initialization was successful; assign local handles to static members:
+		SocketOps::GetSChannel() = hSChannel;
+		SocketOps::GetFunctionTable() = pFunctionTable;
+	}
+	catch(const std::exception&) {
+		// If DLL handle was initialized, free now before passing exception to caller:
+		if(hSChannel != NULL) FreeLibrary(hSChannel);
+		throw;
+	}
+}
+// SocketOps::CleanupTLS: Clear security function table, release SChannel library
+void SocketOps::CleanupTLS() {
+	// Clear function table pointer (cleanup not required)
+	SocketOps::GetFunctionTable() = nullptr;
+	// Retrieve DLL handle from static member and clear; if it was initialized, free now:
+	HMODULE hSChannel = SocketOps::GetSChannel();
+	SocketOps::GetSChannel() = NULL;
+	if(hSChannel != NULL) FreeLibrary(hSChannel);
+}
+// SocketOps::SetKernelTLS: Kernel TLS offload is not available with SChannel (setting can only be disabled)
+bool SocketOps::SetKernelTLS(bool Enable) noexcept {
+	return (Enable == false);
+}
+// QueryTLSResumed: Local helper function determining whether completed negotiation resumed a cached session
+_Check_return_ static bool QueryTLSResumed(PSecurityFunctionTable FunctionTable, CtxtHandle& Context) noexcept {
+	SecPkgContext_SessionInfo SessionInfo = {0};
+	return (FunctionTable->QueryContextAttributes(&Context, SECPKG_ATTR_SESSION_INFO, &SessionInfo) == SEC_E_OK
+		&& (SessionInfo.dwFlags & SSL_SESSION_RECONNECT) != 0);
+}
+#pragma endregion SocketOps
+
+//==========================================================================================================================
+#pragma region SocketOps::ServerSocket
+// ServerSocket::CredentialsValid: Check that certificate has been loaded and credential handle acquired
+_Check_return_ bool SocketOps::ServerSocket::CredentialsValid() const noexcept {
+	return ((hCreds.dwLower || hCreds.dwUpper) && pCertContext && hMyCertStore && SchannelCred.dwVersion);
+}
+// ServerSocket::InitCredentialsFromStore: Open system certificate store and locate specified certificate
+_Check_return_ bool SocketOps::ServerSocket::InitCredentialsFromStore(
+	const std::string& CertName, const std::string& TLSMethod, bool LocalMachineStore) {
+	UsingTLS = true; // Set flag to ensure credentials are validated on all future checks
+	// Ensure this object has not yet been initialized, but that static members have:
+	if(hCreds.dwLower || hCreds.dwUpper || pCertContext || hMyCertStore || SchannelCred.dwVersion) {
+		LastErrString = "Credentials have already been initialized";
+		return false;
+	}
+	else if(SocketOps::GetFunctionTable() == nullptr) {
+		LastErrString = "SChannel library has not been initialized";
+		return false;
+	}
+	try {
+		// Open "Personal" key in either local machine store or current user store, based in input parameter:
+		hMyCertStore = LocalMachineStore ?
+			CertOpenStore(CERT_STORE_PROV_SYSTEM, 0, NULL, CERT_SYSTEM_STORE_LOCAL_MACHINE | CERT_STORE_READONLY_FLAG, L"MY")
+			: CertOpenSystemStore(NULL, L"MY");
+		if(hMyCertStore == nullptr) {
+			LastErrString = (LocalMachineStore ? "CertOpenStore: " : "CertOpenSystemStore: ") + Exceptions::ConvertCOMError(GetLastError());
+			return false;
+		}
+		// To locate requested certificate in store, search for certificate name; as some certificate names
+		// may be a substring of longer names, do search in loop with full "CN=" checks on all matches:
+		{const std::wstring wCertName = StringOps::ConvertToWideString(CertName);
+		const std::wstring wCertSearchName(L"CN=" + wCertName);
+		PCCERT_CONTEXT tempCertContext = nullptr;
+		while(1) {
+			// Perform search - note that providing tempCertContext as an input argument here will free any
+			// resources acquired on previous iteration of this loop but discarded due to mismatched CN:
+			if((tempCertContext = CertFindCertificateInStore(
+				hMyCertStore, X509_ASN_ENCODING, 0, CERT_FIND_SUBJECT_STR, wCertName.c_str(), tempCertContext)) == nullptr) {
+				LastErrString = "CertFindCertificateInStore: " + Exceptions::ConvertCOMError(GetLastError());
+				return false;
+			}
+			// Retrieve certificate subject/name string into local buffer, and perform CN check:
+			wchar_t CertNameTemp[260] = {0};
+			const size_t s = CertNameToStr(
+				X509_ASN_ENCODING, &(tempCertContext->pCertInfo->Subject), CERT_X500_NAME_STR, CertNameTemp, 255);
+			if(ValueOps::Is(s).InRange(3, 255)) {
+				if(std::wstring(CertNameTemp, s).find(wCertSearchName) != std::string::npos) {
+					// Confirmed this certificate matches - assign to member pointer and break loop
+					pCertContext = tempCertContext;
+					break;
+				}
+			}
+		}}
+		// Double-check that CertContext was initialized (this should never happen, as
+		// failure of FindCertificateInStore function should have returned above):
+		if(pCertContext == nullptr) {
+			LastErrString = CertName + ": Certificate not found";
+			return false;
+		}
+		// Initialize common members, and return result:
+		return CompleteInitCredentials(TLSMethod);
+	}
+	catch(const std::exception&) {std::throw_with_nested(FORMAT_RUNTIME_ERROR("Server credential initialization failed"));}
+}
+// ServerSocket::InitCredentialsFromFile: Open PKCS12 file and import certificate from store
+_Check_return_ bool SocketOps::ServerSocket::InitCredentialsFromFile(
+	const std::string& FileName, const std::string& FilePassword, const std::string& CertName, const std::string& TLSMethod) {
+	UsingTLS = true; // Set flag to ensure credentials are validated on all future checks
+	// Ensure this object has not yet been initialized, but that static members have:
+	if(hCreds.dwLower || hCreds.dwUpper || pCertContext || hMyCertStore || SchannelCred.dwVersion) {
+		LastErrString = "Credentials have already been initialized";
+		return false;
+	}
+	else if(SocketOps::GetFunctionTable() == nullptr) {
+		LastErrString = "SChannel library has not been initialized";
+		return false;
+	}
+	try {
+		{FileOps::FilePtr CertFile = FileOps::OpenFile(FileName.c_str(), "rb", _SH_DENYWR);
+		if(CertFile.get() == nullptr) {
+			LastErrString = Exceptions::ConvertCOMError(GetLastError());
+			return false;
+		}
+		fseek(CertFile.get(), 0, SEEK_END); // Skip to end of file
+		const long filesize = ftell(CertFile.get()); // Record total file length
+		if(ValueOps::Is(filesize).InRange(0, 0x7FFF)) { // Validate length is within reasonable boundary
+			// Allocate buffer to hold file contents, return file pointer to start of file and read contents:
+			std::unique_ptr<BYTE[]> FileBuf = std::make_unique<BYTE[]>(static_cast<size_t>(filesize) + 5);
+			fseek(CertFile.get(), 0, SEEK_SET);
+			if(fread(FileBuf.get(), sizeof(BYTE), filesize, CertFile.get()) == filesize) {
+				// Construct CRYPT_DATA_BLOB object from buffer and size, open certificate store from it:
+				CRYPT_DATA_BLOB fdata = {gsl::narrow_cast<DWORD>(filesize), FileBuf.get()};
+				hMyCertStore = PFXImportCertStore(&fdata, StringOps::ConvertToWideString(FilePassword).c_str(), 0);
+				if(hMyCertStore == nullptr) {
+					LastErrString = "PFXImportCertStore: " + Exceptions::ConvertCOMError(GetLastError());
+					return false;
+				}
+				// Locate individual certificate by subject name (note this assumes there are no overlapping entries):
+				pCertContext = CertFindCertificateInStore(
+					hMyCertStore, X509_ASN_ENCODING, 0, CERT_FIND_SUBJECT_STR,
+					StringOps::ConvertToWideString(CertName).c_str(), pCertContext);
+				if(pCertContext == nullptr) {
+					LastErrString = "CertFindCertificateInStore: " + Exceptions::ConvertCOMError(GetLastError());
+					return false;
+				}
+			}
+			else { // Read failed
+				LastErrString = Exceptions::ConvertCOMError(GetLastError());
+				return false;
+			}
+		}
+		else { // Length invalid
+			LastErrString = "Certificate file store length invalid";
+			return false;
+		}}
+		// Note that at the end of this block file pointer has been closed, memory buffer and DATA_BLOB objects have all
+		// been destructed, PFXImportCertStore has imported certificate store into memory (with hMyCertStore holding a
+		// reference to it), and pCertContext has been set; initialize common members and return result:
+		return CompleteInitCredentials(TLSMethod);
+	}
+	catch(const std::exception&) {std::throw_with_nested(FORMAT_RUNTIME_ERROR("Server credential initialization failed"));}
+}
+// ServerSocket::CleanupCredentials: Free any handles required
+void SocketOps::ServerSocket::CleanupCredentials() {
+	// Free all allocated objects and reset to default values:
+	if(hCreds.dwLower != 0 || hCreds.dwUpper != 0) FreeCredentialsHandle(&hCreds);
+	hCreds.dwLower = hCreds.dwUpper = 0;
+	if(pCertContext) CertFreeCertificateContext(pCertContext);
+	pCertContext = nullptr;
+	if(hMyCertStore) CertCloseStore(hMyCertStore, 0);
+	hMyCertStore = nullptr;
+	memset(&SchannelCred, 0, sizeof(SchannelCred));
+	std::lock_guard<std::mutex> lock(TicketLock);
+	SecureZeroMemory(TicketKeys, sizeof(TicketKeys));
+	TicketKeyCount = 0;
+	TicketKeysSupported = false;
+}
+// ServerSocket::CompleteInitCredentials: Initialize SChannel object and acquire hCreds handles
+// - Before this function executes, caller should have opened certificate store and loaded cert context
+_Check_return_ bool SocketOps::ServerSocket::CompleteInitCredentials(const std::string& TLSMethod) {
+	// Set up SChannel structure values:
+	SchannelCred.dwVersion = SCHANNEL_CRED_VERSION;
+	SchannelCred.cCreds = 1;
+	SchannelCred.paCred = &pCertContext; // Already initialized by caller
+	// Default protocols to TLSv1.2 only; allow override to downgrade based on Method:
+	SchannelCred.grbitEnabledProtocols = SP_PROT_TLS1_2_SERVER;
+	if(TLSMethod.length() >= 3) {
+		if(_stricmp(TLSMethod.c_str(), "TLSV1.1") == 0) // TLS1.1+ protocols only
+			SchannelCred.grbitEnabledProtocols = SP_PROT_TLS1_1PLUS_SERVER;
+		else if(_stricmp(TLSMethod.c_str(), "TLSV1") == 0) // TLS1.0+ protocols only
+			SchannelCred.grbitEnabledProtocols = SP_PROT_TLS1_SERVER | SP_PROT_TLS1_1PLUS_SERVER;
+	}
+	SchannelCred.dwFlags = (SCH_USE_STRONG_CRYPTO | SCH_CRED_NO_SYSTEM_MAPPER | SCH_SEND_ROOT_CERT);
+	const SECURITY_STATUS s = SocketOps::GetFunctionTable()->AcquireCredentialsHandle(
+		NULL, const_cast<wchar_t*>(UNISP_NAME), SECPKG_CRED_INBOUND, NULL, &SchannelCred, NULL, NULL, &hCreds, NULL);
+	if(s != SEC_E_OK) {
+		LastErrString = "AcquireCredentialsHandle: " + Exceptions::ConvertCOMError(s);
+		return false;
+	}
+	// Install initial session ticket keys; failure is not fatal (tickets are then issued under SChannel's own keys):
+	{std::lock_guard<std::mutex> lock(TicketLock);
+	std::string TicketErrString;
+	TicketKeysSupported = InstallTicketKeys(TicketErrString);}
+	return CredentialsValid();
+}
+// ServerSocket::InstallTicketKeys: Generate new session ticket key and install it ahead of current key (which becomes the
+// previous key, with any older key discarded)
+// - Caller must hold TicketLock
+_Check_return_ bool SocketOps::ServerSocket::InstallTicketKeys(std::string& ErrString) {
+#ifdef SECPKG_ATTR_SESSION_TICKET_KEYS
+	static_assert(sizeof(TicketKey::Id) == sizeof(SecPkgCred_SessionTicketKey::KeyId)
+		&& sizeof(TicketKey::Material) == sizeof(SecPkgCred_SessionTicketKey::KeyingMaterial), "Invalid ticket key size");
+	TicketKey NewKey = {};
+	if(BCRYPT_SUCCESS(BCryptGenRandom(NULL, NewKey.Id, sizeof(NewKey.Id), BCRYPT_USE_SYSTEM_PREFERRED_RNG)) == false
+		|| BCRYPT_SUCCESS(
+			BCryptGenRandom(NULL, NewKey.Material, sizeof(NewKey.Material), BCRYPT_USE_SYSTEM_PREFERRED_RNG)) == false) {
+		ErrString = "BCryptGenRandom: Session ticket key generation failed";
+		return false;
+	}
+	// Build SChannel key list from new key, followed by current key (if any):
+	SecPkgCred_SessionTicketKey Keys[2] = {0};
+	const size_t KeyCount = (TicketKeyCount > 0) ? 2 : 1;
+	for(size_t k = 0; k < KeyCount; ++k) {
+		const TicketKey& Source = (k == 0) ? NewKey : TicketKeys[0];
+		Keys[k].TicketInfoVersion = SESSION_TICKET_INFO_VERSION;
+		memcpy(Keys[k].KeyId, Source.Id, sizeof(Source.Id));
+		memcpy(Keys[k].KeyingMaterial, Source.Material, sizeof(Source.Material));
+		Keys[k].KeyingMaterialSize = sizeof(Source.Material);
+	}
+	SecPkgCred_SessionTicketKeys KeyList = {0};
+	KeyList.cSessionTicketKeys = gsl::narrow_cast<DWORD>(KeyCount);
+	KeyList.pSessionTicketKeys = Keys;
+	const SECURITY_STATUS s = SocketOps::GetFunctionTable()->SetCredentialsAttributes(
+		&hCreds, SECPKG_ATTR_SESSION_TICKET_KEYS, &KeyList, sizeof(KeyList));
+	SecureZeroMemory(Keys, sizeof(Keys));
+	if(s == SEC_E_OK) {
+		// Keys installed; store new key as current, and schedule its replacement:
+		TicketKeys[1] = TicketKeys[0];
+		TicketKeys[0] = NewKey;
+		TicketKeyCount = KeyCount;
+		TicketKeyRotateAt = SteadyClock(std::chrono::milliseconds{TicketKeyInterval});
+		SocketOps::CountTicketKeyRotation();
+	}
+	else ErrString = "SetCredentialsAttributes (SESSION_TICKET_KEYS): " + Exceptions::ConvertCOMError(s);
+	SecureZeroMemory(&NewKey, sizeof(NewKey));
+	return (s == SEC_E_OK);
+#else
+	ErrString = "Session ticket keys not supported by this SDK";
+	return false;
+#endif
+}
+// ServerSocket::TLSNegotiate: Perform server-side TLS negotiation on new socket connection
+// - Error text is written to session object only (server object is not modified, so that multiple threads may negotiate
+//   sessions accepted from the same listener concurrently)
+_Check_return_ SocketOps::Result SocketOps::ServerSocket::TLSNegotiate(
+	const SocketOps::SessionSocketPtr& sp, int Timeout) {
+	// Validate input socket, validate this object's TLS credentials
+	if((sp.get() ? sp->TLSReady() : false) == false) {
+		sp->LastErrString = "TLS negotiation failed: Invalid socket";
+		return Result::InvalidSocket;
+	}
+	else if(CredentialsValid() == false) {
+		sp->LastErrString = "TLS negotiation failed: Server credentials not initialized";
+		return Result::InvalidArg;
+	}
+	sp->LastErrString.clear();
+#ifdef ASC_REQ_SESSION_TICKET
+	static constexpr DWORD ContextFlags = (ASC_REQ_SEQUENCE_DETECT | ASC_REQ_REPLAY_DETECT | ASC_REQ_CONFIDENTIALITY | ASC_RET_EXTENDED_ERROR | ASC_REQ_ALLOCATE_MEMORY | ASC_REQ_STREAM | ASC_REQ_SESSION_TICKET);
+#else
+	static constexpr DWORD ContextFlags = (ASC_REQ_SEQUENCE_DETECT | ASC_REQ_REPLAY_DETECT | ASC_REQ_CONFIDENTIALITY | ASC_RET_EXTENDED_ERROR | ASC_REQ_ALLOCATE_MEMORY | ASC_REQ_STREAM);
+#endif
+	// If negotiation is starting and current session ticket key is due for replacement, rotate now (if rotation fails,
+	// current keys remain in use until the next interval):
+	if(sp->hContext.dwLower == 0 && sp->hContext.dwUpper == 0) {
+		std::lock_guard<std::mutex> lock(TicketLock);
+		if(TicketKeysSupported && TicketKeyRotateAt.IsPast()) {
+			std::string TicketErrString;
+			if(InstallTicketKeys(TicketErrString) == false)
+				TicketKeyRotateAt = SteadyClock(std::chrono::milliseconds{TicketKeyInterval});
+		}
+	}
+	try {
+		std::string NetErrString; // Scratch value for socket-level error text
+		// Set up function constants - end time, end-of-buffer marker:
+		const SteadyClock EndTime(std::chrono::milliseconds{Timeout});
+		sp->AcquireTLSBuffers();
+		const char * const EndPtr = sp->ReadBuf.get() + sp->TLSBufSize;
+
+		// Create security context initialization variables; OutBufferDesc members will remain
+		// constant (only contents of OutBuffers[0] will change), so set up now:
+		SecBufferDesc InBufferDesc = {0}, OutBufferDesc = {0};
+		SecBuffer InBuffers[2] = {0}, OutBuffers[1] = {0};
+		OutBufferDesc.cBuffers = 1;
+		OutBufferDesc.pBuffers = OutBuffers;
+		OutBufferDesc.ulVersion = SECBUFFER_VERSION;
+
+		SECURITY_STATUS scRet = SEC_I_CONTINUE_NEEDED;
+		Result rc = Result::Timeout;
+		//==================================================================================================================
+		// Main negotiation loop start
+		for(short s = 0; s < 15 && rc == Result::Timeout && Timeout >= 0; ++s) {
+			if(sp->ReadBufBytes == 0 || scRet == SEC_E_INCOMPLETE_MESSAGE) {
+				// We are waiting on further data from socket; ensure there is space remaining in read buffer:
+				char * const ReadPtr = sp->ReadBuf.get() + sp->ReadBufBytes;
+				const size_t MaxBytes = StringOps::BytesAvail(ReadPtr, EndPtr);
+				if(ValueOps::Is(MaxBytes).InRange(1, sp->TLSBufSize) == false) {
+					sp->Shutdown();
+					rc = Result::Failed;
+					sp->LastErrString = "TLS negotiation failed: Buffer size exceeded";
+					break;
+				}
+				// Wait for data to arrive on socket, read if available:
+				Result src = sp->WaitEvent(Timeout);
+				if(ResultOK(src)) {
+					size_t br = 0;
+					if(ResultOK(src = SocketOps::ReadAvailable(sp->SocketHandle, ReadPtr, MaxBytes, br, &NetErrString))) {
+						if(ValueOps::Is(br).InRange(1, MaxBytes)) sp->ReadBufBytes += br;
+						else {
+							sp->Shutdown();
+							src = Result::Failed;
+							if(br != 0) sp->LastErrString = "TLS negotiation failed: Invalid number of bytes read";
+						}
+					}
+					else if(NetErrString.empty()) sp->LastErrString = "TLS negotiation failed: Socket read error";
+					else sp->LastErrString = "TLS negotiation failed: " + NetErrString;
+				}
+				// If error occurred (on wait or read) or either operation timed out,
+				// set result and break now; LastErrString should already be set
+				if(ResultOK(src) == false) {
+					rc = src;
+					break;
+				}
+			}
+
+			// Set up TLS objects - assign incoming data as token (with NULL array terminator), attempt accept:
+			InBuffers[0].pvBuffer = sp->ReadBuf.get();
+			InBuffers[0].cbBuffer = gsl::narrow_cast<unsigned long>(sp->ReadBufBytes);
+			InBuffers[0].BufferType = SECBUFFER_TOKEN;
+			InBuffers[1].pvBuffer = nullptr;
+			InBuffers[1].cbBuffer = 0;
+			InBuffers[1].BufferType = SECBUFFER_EMPTY;
+			InBufferDesc.cBuffers = 2;
+			InBufferDesc.pBuffers = InBuffers;
+			InBufferDesc.ulVersion = SECBUFFER_VERSION;
+			OutBuffers[0].pvBuffer = nullptr;
+			OutBuffers[0].cbBuffer = 0;
+			OutBuffers[0].BufferType = SECBUFFER_EMPTY;
+			DWORD dwSSPIOutFlags = 0;
+			scRet = SocketOps::GetFunctionTable()->AcceptSecurityContext(
+				&hCreds,
+				// Only pass in hContext (input) if initialized:
+				sp->hContext.dwLower == 0 && sp->hContext.dwUpper == 0 ? nullptr : &(sp->hContext),
+				&InBufferDesc,
+				ContextFlags,
+				0,
+				// Only pass in hContext (output) if NOT initialized:
+				sp->hContext.dwLower == 0 && sp->hContext.dwUpper == 0 ? &(sp->hContext) : nullptr,
+				&OutBufferDesc,
+				&dwSSPIOutFlags,
+				nullptr);
+
+			// If SECBUFFER_TOKEN was provided (via OutBuffer) by AcceptSecurityContext (meaning accept function succeeded,
+			// continuation required or an error has occurred and client wants extended error data), send now:
+			if(scRet >= 0 || ((dwSSPIOutFlags & ASC_RET_EXTENDED_ERROR) != 0)) {
+				if(OutBuffers[0].cbBuffer != 0 && OutBuffers[0].pvBuffer != nullptr) {
+					const Result src = SocketOps::Send(sp->SocketHandle,
+						static_cast<const char*>(OutBuffers[0].pvBuffer), OutBuffers[0].cbBuffer, &NetErrString);
+					SocketOps::GetFunctionTable()->FreeContextBuffer(OutBuffers[0].pvBuffer);
+					OutBuffers[0].pvBuffer = nullptr;
+					if(ResultOK(src) == false) {
+						rc = src;
+						if(NetErrString.empty()) sp->LastErrString = "TLS negotiation failed: Socket send failed";
+						else sp->LastErrString = "TLS negotiation failed: " + NetErrString;
+						break;
+					}
+				}
+			}
+
+			// If function was successful (or continuation required) but data has been read beyond end of last token,
+			// save in ReadBuf for subsequent read operations (this represents start of data after negotiation):
+			if(scRet >= 0 && InBuffers[1].BufferType == SECBUFFER_EXTRA) {
+				if(ValueOps::Is<size_t>(InBuffers[1].cbBuffer).InRange(1, sp->ReadBufBytes)) {
+					memcpy(sp->ReadBuf.get(), sp->ReadBuf.get() + sp->ReadBufBytes - InBuffers[1].cbBuffer, InBuffers[1].cbBuffer);
+					sp->ReadBufBytes = InBuffers[1].cbBuffer;
+				}
+				else sp->ReadBufBytes = 0; // Data is invalid length - discard
+			}
+			else if(scRet >= 0) sp->ReadBufBytes = 0; // Clear read buffer
+
+			// If continuation needed, continue loop (note this is the only way for this loop to execute more than
+			// once as all other paths below will break):
+			if(scRet == SEC_E_INCOMPLETE_MESSAGE || scRet > 0) {
+				Timeout = SteadyClock().MSecTill(EndTime);
+				continue;
+			}
+			else if(scRet != SEC_E_OK) {
+				// Non-wait error occurred; set error data:
+				sp->Shutdown();
+				rc = Result::Failed;
+				sp->LastErrString = "TLS negotiation failed: " + Exceptions::ConvertCOMError(scRet);
+				break;
+			}
+			// Negotiation complete; retrieve cipher info:
+			if((scRet = SocketOps::GetFunctionTable()->QueryContextAttributes(
+				&(sp->hContext), SECPKG_ATTR_CIPHER_INFO, &(sp->CipherInfo))) != SEC_E_OK) {
+				sp->Shutdown();
+				rc = Result::Failed;
+				sp->LastErrString = "QueryContextAttributes (CIPHER_INFO): " + Exceptions::ConvertCOMError(scRet);
+				break;
+			}
+			// Retrieve stream sizes for negotiated protocol:
+			if((scRet = SocketOps::GetFunctionTable()->QueryContextAttributes(
+				&sp->hContext, SECPKG_ATTR_STREAM_SIZES, &sp->StreamSizes)) != SEC_E_OK) {
+				sp->Shutdown();
+				rc = Result::Failed;
+				sp->LastErrString = "QueryContextAttributes (STREAM_SIZES): " + Exceptions::ConvertCOMError(scRet);
+				break;
+			}
+			// Validate stream sizes (we must be able to process a packet with header and trailer):
+			if((static_cast<size_t>(sp->StreamSizes.cbHeader) + sp->StreamSizes.cbTrailer) >= sp->TLSBufSize) {
+				sp->Shutdown();
+				rc = Result::Failed;
+				sp->LastErrString = "TLS negotiation failed: Protocol message size exceeds maximum";
+				break;
+			}
+
+			// If this point is reached, negotiation successful - record whether client's session was resumed, break loop:
+			sp->TLSSessionResumed = SocketOps::CountTLSHandshake(true, QueryTLSResumed(SocketOps::GetFunctionTable(), sp->hContext));
+			sp->TLSComplete = true;
+			rc = Result::OK;
+			break;
+		}
+		// Main negotiation loop end
+		//==================================================================================================================
+		sp->ReleaseIdleTLSBuffers(); // Keep read buffer only if it holds data received after (or during) negotiation
+		return rc;
+	}
+	catch(const std::exception&) {std::throw_with_nested(FORMAT_RUNTIME_ERROR("TLS negotiation (server) failed"));}
+}
+#pragma endregion SocketOps::ServerSocket
+
+//==========================================================================================================================
+#pragma region SocketOps::SessionSocket
+// SessionSocket::ClientCredentials::Init: Initialize client credential values
+_Check_return_ bool SocketOps::SessionSocket::ClientCredentials::Init(const std::string& TLSMethod, std::string& LastErrString) {
+	LastErrString.clear();
+	// Ensure this object has not yet been initialized, but that static members have:
+	if(SchannelCred.dwVersion != 0) {
+		LastErrString = "Credentials have already been initialized";
+		return false;
+	}
+	else if(SocketOps::GetFunctionTable() == nullptr) {
+		LastErrString = "SChannel library has not been initialized";
+		return false;
+	}
+	SchannelCred.dwVersion = SCHANNEL_CRED_VERSION;
+	// Default protocols to TLSv1.2 only; allow override to downgrade based on Method:
+	SchannelCred.grbitEnabledProtocols = SP_PROT_TLS1_2_CLIENT;
+	if(TLSMethod.length() >= 3) {
+		if(_stricmp(TLSMethod.c_str(), "TLSV1.1") == 0) // TLS 1.1+ protocols only
+			SchannelCred.grbitEnabledProtocols = SP_PROT_TLS1_1PLUS_CLIENT;
+		else if(_stricmp(TLSMethod.c_str(), "TLSV1") == 0) // TLS protocols only
+			SchannelCred.grbitEnabledProtocols = SP_PROT_TLS1_CLIENT | SP_PROT_TLS1_1PLUS_CLIENT;
+	}
+	// By default do not validate server credentials (may be added in future):
+	SchannelCred.dwFlags = (SCH_USE_STRONG_CRYPTO | SCH_CRED_NO_DEFAULT_CREDS
+		| SCH_CRED_MANUAL_CRED_VALIDATION | SCH_CRED_NO_SERVERNAME_CHECK);
+	const SECURITY_STATUS s = SocketOps::GetFunctionTable()->AcquireCredentialsHandle(
+		NULL, const_cast<wchar_t*>(UNISP_NAME), SECPKG_CRED_OUTBOUND, NULL, &SchannelCred, NULL, NULL, &hCreds, NULL);
+	if(s != SEC_E_OK) {
+		LastErrString = "AcquireCredentialsHandle: " + Exceptions::ConvertCOMError(s);
+		return false;
+	}
+	return Valid();
+}
+// SessionSocket::ClientCredentials::Cleanup: Release client credential values
+void SocketOps::SessionSocket::ClientCredentials::Cleanup() {
+	if(hCreds.dwLower || hCreds.dwUpper) FreeCredentialsHandle(&hCreds);
+	hCreds.dwLower = hCreds.dwUpper = 0;
+}
+// SessionSocket::TLSNegotiate: Perform client-side negotiation on socket connection
+_Check_return_ SocketOps::Result SocketOps::SessionSocket::TLSNegotiate(int Timeout, const std::string& Method) {
+	if((SocketValid() ? TLSReady() : false) == false) {
+		LastErrString = "TLS negotiation failed: Invalid socket";
+		return Result::InvalidSocket;
+	}
+	LastErrString.clear();
+	const SteadyClock EndTime(std::chrono::milliseconds{Timeout});
+
+	static constexpr DWORD ContextFlags = (ISC_REQ_SEQUENCE_DETECT | ISC_REQ_REPLAY_DETECT | ISC_REQ_CONFIDENTIALITY | ISC_RET_EXTENDED_ERROR | ISC_REQ_ALLOCATE_MEMORY | ISC_REQ_STREAM);
+
+	if(ClientCred.get() == nullptr) {
+		//==================================================================================================================
+		// Client credential and handshake begin
+		try {
+			ClientCred = ClientCredentials::Acquire(Method, LastErrString);
+			Result rc = Result::Failed;
+			if(ClientCred.get() != nullptr) {
+
+				// Create and deliver TLS token to start negotiation:
+				SecBufferDesc OutBufferDesc = {0};
+				SecBuffer OutBuffers[1] = {0};
+				OutBuffers[0].pvBuffer = nullptr;
+				OutBuffers[0].cbBuffer = 0;
+				OutBuffers[0].BufferType = SECBUFFER_TOKEN;
+				OutBufferDesc.cBuffers = 1;
+				OutBufferDesc.pBuffers = OutBuffers;
+				OutBufferDesc.ulVersion = SECBUFFER_VERSION;
+				DWORD dwSSPIOutFlags = 0;
+				const SECURITY_STATUS scRet = SocketOps::GetFunctionTable()->InitializeSecurityContext(
+					ClientCred->GetCreds(),
+					nullptr,
+					// Remote endpoint identifies cached session to be resumed (and session to be cached):
+					TLSTarget.empty() ? nullptr : const_cast<wchar_t*>(TLSTarget.c_str()),
+					ContextFlags,
+					0,
+					SECURITY_NATIVE_DREP, 
+					nullptr,
+					0,
+					&hContext,
+					&OutBufferDesc,
+					&dwSSPIOutFlags,
+					nullptr);
+
+				// Expected result is CONTINUE_NEEDED (token has been constructed, and now needs to
+				// be sent [in plaintext] to remote peer to start TLS handshake process)
+				if(scRet == SEC_I_CONTINUE_NEEDED && OutBuffers[0].cbBuffer != 0 && OutBuffers[0].pvBuffer != nullptr)
+					rc = SocketOps::Send(SocketHandle, static_cast<const char*>(OutBuffers[0].pvBuffer), OutBuffers[0].cbBuffer, &LastErrString);
+				else if(scRet != SEC_I_CONTINUE_NEEDED) LastErrString = "InitializeSecurityContext: " + Exceptions::ConvertCOMError(scRet);
+				else LastErrString = "InitializeSecurityContext: Error constructing token";
+
+				// Free any memory allocated above
+				if(OutBuffers[0].cbBuffer != 0 && OutBuffers[0].pvBuffer != nullptr)
+					SocketOps::GetFunctionTable()->FreeContextBuffer(OutBuffers[0].pvBuffer);
+			}
+
+			// If above process did not complete successfully, return now:
+			if(ResultOK(rc) == false) {
+				Shutdown();
+				return rc;
+			}
+		}
+		catch(const std::exception&) {std::throw_with_nested(FORMAT_RUNTIME_ERROR("TLS initialization failed"));}
+		// Client credential and handshake end
+		//==================================================================================================================
+	}
+
+	//======================================================================================================================
+	// Primary TLS negotiation loop begin
+	try {
+		Result rc = Result::Timeout;
+		AcquireTLSBuffers();
+		const char * const EndPtr = ReadBuf.get() + TLSBufSize;
+
+		// Create TLS objects; OutBufferDesc members will remain constant (only contents of OutBuffers[0] will change):
+		SecBufferDesc InBufferDesc = {0}, OutBufferDesc = {0};
+		SecBuffer InBuffers[2] = {0}, OutBuffers[1] = {0};
+		OutBufferDesc.cBuffers = 1;
+		OutBufferDesc.pBuffers = OutBuffers;
+		OutBufferDesc.ulVersion = SECBUFFER_VERSION;
+
+		// Update time remaining, but ensure loop executes at least once:
+		Timeout = ValueOps::MinZero(SteadyClock().MSecTill(EndTime));
+
+		SECURITY_STATUS scRet = SEC_I_CONTINUE_NEEDED;
+		for(short s = 0; s < 15 && rc == Result::Timeout && Timeout >= 0; ++s) {
+
+			// If there is no data in buffer or previous message was incomplete, we need to read data:
+			if(ReadBufBytes == 0 || scRet == SEC_E_INCOMPLETE_MESSAGE) {
+
+				// Ensure there is space remaining in buffer and all pointers are valid:
+				char * const ReadPtr = ReadBuf.get() + ReadBufBytes;
+				const size_t MaxBytes = StringOps::BytesAvail(ReadPtr, EndPtr);
+				if(ValueOps::Is(MaxBytes).InRange(1, TLSBufSize) == false) {
+					Shutdown();
+					rc = Result::Failed;
+					LastErrString = "Maximum data length exceeded";
+					break;
+				}
+
+				// Wait up to timeout for data to arrive on socket, read if available:
+				Result src = WaitEvent(Timeout);
+				if(ResultOK(src)) {
+					size_t br = 0;
+					if(ResultOK(src = SocketOps::ReadAvailable(SocketHandle, ReadPtr, MaxBytes, br, &LastErrString))) {
+						if(ValueOps::Is(br).InRange(1, MaxBytes) == false) {
+							Shutdown();
+							src = Result::Failed;
+							if(br != 0) LastErrString = "Invalid number of bytes read";
+						}
+						else ReadBufBytes += br;
+					}
+				}
+				// If error occurred (on wait or read) or either operation timed out,
+				// set result and break now; LastErrString should already be set
+				if(ResultOK(src) == false) {
+					rc = src;
+					break;
+				}
+			}
+
+			// Now take data we have received, assign it as token in TLS objects and attempt initialization:
+			InBuffers[0].pvBuffer = ReadBuf.get();
+			InBuffers[0].cbBuffer = gsl::narrow_cast<unsigned long>(ReadBufBytes);
+			InBuffers[0].BufferType = SECBUFFER_TOKEN;
+			InBuffers[1].pvBuffer = nullptr;
+			InBuffers[1].cbBuffer = 0;
+			InBuffers[1].BufferType = SECBUFFER_EMPTY;
+			InBufferDesc.cBuffers = 2;
+			InBufferDesc.pBuffers = InBuffers;
+			InBufferDesc.ulVersion = SECBUFFER_VERSION;
+			OutBuffers[0].pvBuffer = nullptr;
+			OutBuffers[0].cbBuffer = 0;
+			OutBuffers[0].BufferType = SECBUFFER_TOKEN;
+			DWORD dwSSPIOutFlags = 0;
+			scRet = SocketOps::GetFunctionTable()->InitializeSecurityContext(
+				ClientCred->GetCreds(),
+				&hContext,
+				TLSTarget.empty() ? nullptr : const_cast<wchar_t*>(TLSTarget.c_str()),
+				ContextFlags,
+				0,
+				SECURITY_NATIVE_DREP,
+				&InBufferDesc,
+				0,
+				nullptr,
+				&OutBufferDesc,
+				&dwSSPIOutFlags,
+				nullptr);
+
+			// If security context was successfully initialized OR continuation is required OR
+			// an error has occurred and client wants to receive extended error data, send outbound
+			// SECBUFFER_TOKEN if InitializeSecurityContext provided it via OutBuffer:
+			if(scRet >= 0 || ((dwSSPIOutFlags & ISC_RET_EXTENDED_ERROR) != 0)) {
+				if(OutBuffers[0].cbBuffer != 0 && OutBuffers[0].pvBuffer != nullptr) {
+					const SocketOps::Result src = SocketOps::Send(SocketHandle,
+						static_cast<const char*>(OutBuffers[0].pvBuffer), OutBuffers[0].cbBuffer,
+						&LastErrString);
+					SocketOps::GetFunctionTable()->FreeContextBuffer(OutBuffers[0].pvBuffer);
+					OutBuffers[0].pvBuffer = nullptr;
+					// If delivery failed, break loop now
+					if(ResultOK(src) == false) {
+						rc = src; // LastErrString should already have been set
+						break;
+					}
+				}
+			}
+
+			// If security context was successfully initiated or continuation is required, but
+			// data has been read beyond end of token, we need to save for subsequent reads:
+			if(scRet >= 0 && InBuffers[1].BufferType == SECBUFFER_EXTRA) {
+				if(ValueOps::Is(static_cast<size_t>(InBuffers[1].cbBuffer)).InRange(1, ReadBufBytes)) {
+					memcpy(ReadBuf.get(), ReadBuf.get() + ReadBufBytes - InBuffers[1].cbBuffer, InBuffers[1].cbBuffer);
+					ReadBufBytes = InBuffers[1].cbBuffer;
+				}
+				else ReadBufBytes = 0; // Invalid data length - discard
+			}
+			else if(scRet >= 0) ReadBufBytes = 0; // Operation complete, clear read buffer
+
+			// If response code indicates continue needed, continue loop (note this is the only way
+			// for this loop to ever execute more than once, as all other paths below will break):
+			if(scRet == SEC_E_INCOMPLETE_MESSAGE || scRet > 0) {
+				Timeout = SteadyClock().MSecTill(EndTime);
+				continue;
+			}
+			else if(scRet != SEC_E_OK) {
+				// Non-wait error occurred; set error data:
+				Shutdown();
+				rc = Result::Failed;
+				LastErrString = "TLS negotiation failed: " + Exceptions::ConvertCOMError(scRet);
+				break;
+			}
+			// Negotiation complete; retrieve cipher info:
+			if((scRet = SocketOps::GetFunctionTable()->QueryContextAttributes(
+				&hContext, SECPKG_ATTR_CIPHER_INFO, &CipherInfo)) != SEC_E_OK) {
+				Shutdown();
+				rc = Result::Failed;
+				LastErrString = "QueryContextAttributes (CIPHER_INFO): " + Exceptions::ConvertCOMError(scRet);
+				break;
+			}
+			// Retrieve stream sizes for negotiated protocol:
+			if((scRet = SocketOps::GetFunctionTable()->QueryContextAttributes(
+				&hContext, SECPKG_ATTR_STREAM_SIZES, &StreamSizes)) != SEC_E_OK) {
+				Shutdown();
+				rc = Result::Failed;
+				LastErrString = "QueryContextAttributes (STREAM_SIZES): " + Exceptions::ConvertCOMError(scRet);
+				break;
+			}
+			// Validate stream sizes (we must be able to process a packet with header and trailer):
+			if((static_cast<size_t>(StreamSizes.cbHeader) + StreamSizes.cbTrailer) >= TLSBufSize) {
+				Shutdown();
+				rc = Result::Failed;
+				LastErrString = "TLS negotiation failed: Protocol message size exceeds maximum";
+				break;
+			}
+
+			// If this point is reached, negotiation successful - record whether cached session was resumed, break loop:
+			TLSSessionResumed = SocketOps::CountTLSHandshake(false, QueryTLSResumed(SocketOps::GetFunctionTable(), hContext));
+			TLSComplete = true;
+			rc = Result::OK;
+			break;
+		}
+		ReleaseIdleTLSBuffers(); // Keep read buffer only if it holds data received after (or during) negotiation
+		return rc;
+	}
+	catch(const std::exception&) {std::throw_with_nested(FORMAT_RUNTIME_ERROR("TLS negotiation (client) failed"));}
+	// Primary TLS negotiation loop end
+	//======================================================================================================================
+}
+// SessionSocket::EncryptTLS: Encrypt contents of buffers into a single TLS message, appended to end of Tgt
+_Check_return_ SocketOps::Result SocketOps::SessionSocket::EncryptTLS(
+	_In_reads_(Count) const WSABUF* Buffers, size_t Count, std::vector<char>& Tgt) {
+	if(Valid() == false) return Result::InvalidSocket;
+	else if(Buffers == nullptr || Count == 0) return Result::InvalidArg;
+	size_t len = 0;
+	for(size_t b = 0; b < Count; ++b) len += Buffers[b].len;
+	if(ValueOps::Is(len).InRange(1, TLSBufSize) == false) return Result::InvalidArg;
+	else if (len > StreamSizes.cbMaximumMessage) return Result::InvalidArg;
+
+	const size_t start = Tgt.size();
+	try {
+		// Extend target for full outbound message plus header/trailer, copy outbound data ahead of trailer space:
+		Tgt.resize(start + StreamSizes.cbHeader + len + StreamSizes.cbTrailer);
+		char* const SendBuf = Tgt.data() + start;
+		for(size_t b = 0, offset = StreamSizes.cbHeader; b < Count; offset += Buffers[b++].len) {
+			if(Buffers[b].len > 0) memcpy(SendBuf + offset, Buffers[b].buf, Buffers[b].len);
+		}
+		// Build TLS variables and attempt encryption:
+		SecBuffer SecBuffers[4] = {0};
+		SecBuffers[0].pvBuffer = SendBuf;
+		SecBuffers[0].cbBuffer = StreamSizes.cbHeader;
+		SecBuffers[0].BufferType = SECBUFFER_STREAM_HEADER;
+		SecBuffers[1].pvBuffer = SendBuf + StreamSizes.cbHeader;
+		SecBuffers[1].cbBuffer = gsl::narrow_cast<unsigned long>(len);
+		SecBuffers[1].BufferType = SECBUFFER_DATA;
+		SecBuffers[2].pvBuffer = SendBuf + StreamSizes.cbHeader + len;
+		SecBuffers[2].cbBuffer = StreamSizes.cbTrailer;
+		SecBuffers[2].BufferType = SECBUFFER_STREAM_TRAILER;
+		SecBuffers[3].BufferType = SECBUFFER_EMPTY;
+		SecBufferDesc BufferDesc = {0};
+		BufferDesc.ulVersion = SECBUFFER_VERSION;
+		BufferDesc.cBuffers = 4;
+		BufferDesc.pBuffers = SecBuffers;
+		const SECURITY_STATUS scRet = SocketOps::GetFunctionTable()->EncryptMessage(&hContext, 0, &BufferDesc, 0);
+		if(scRet != SEC_E_OK) {
+			Tgt.resize(start);
+			Shutdown();
+			LastErrString = "EncryptMessage: " + Exceptions::ConvertCOMError(scRet);
+			return Result::Failed;
+		}
+		// Trim target to actual length of header plus data plus footer:
+		Tgt.resize(start + SecBuffers[0].cbBuffer + SecBuffers[1].cbBuffer + SecBuffers[2].cbBuffer);
+		return Result::OK;
+	}
+	catch(const std::exception&) {std::throw_with_nested(FORMAT_RUNTIME_ERROR("TLS data encryption failed"));}
+}
+// SessionSocket::PrivateReadTLS:
+_Check_return_ SocketOps::Result SocketOps::SessionSocket::PrivateReadTLS(int Timeout) {
+	// Note this function should only be called from one of SessionSocket's ReadTLS functions,
+	// which should have already validated the session socket members and checked that incoming
+	// data is available
+	try {
+		const SteadyClock EndTime(std::chrono::milliseconds{Timeout});
+		AcquireTLSBuffers();
+		const char * const EndPtr = ReadBuf.get() + TLSBufSize;
+
+		// Attempt receive/decrypt operation until data decrypted or error/timeout occurs:
+		Result rc = Result::Timeout;
+		for(short s = 0; s < 15 && rc == Result::Timeout && Timeout >= 0; ++s) {
+			// Unless this is first loop iteration (and there is already data in read buffer), wait for socket events:
+			const bool Buffered = (s == 0 && ReadBufBytes > 0);
+			Result src = Buffered ? Result::Timeout : SocketOps::WaitEvent(SocketHandle, Timeout, &LastErrString);
+			if(ResultOK(src)) {
+				// Records already decrypted are skipped by offset rather than shifting remaining data after each one, so
+				// move remaining (partial record) data to start of buffer only now that more data is to be read:
+				CompactReadTLS();
+				char * const ReadPtr = ReadBuf.get() + ReadBufBytes;
+				const size_t MaxBytes = StringOps::BytesAvail(ReadPtr, EndPtr);
+				if(ValueOps::Is(MaxBytes).InRange(1, TLSBufSize) == false) {
+					Shutdown();
+					rc = Result::Failed;
+					LastErrString = "TLS read failed: Buffer size exceeded";
+					break;
+				}
+				size_t br = 0;
+				if(ResultOK(src = SocketOps::ReadAvailable(SocketHandle, ReadPtr, MaxBytes, br, &LastErrString))) {
+					if(ValueOps::Is(br).InRange(1, MaxBytes)) ReadBufBytes += br;
+					else {
+						Shutdown();
+						src = Result::Failed;
+						if(br != 0) LastErrString = "TLS read failed: Invalid number of bytes read";
+					}
+				}
+			}
+			// If error occurred (on wait or read) or either operation timed out (other than where buffered data is
+			// to be decrypted first), set result and break now; LastErrString should already be set
+			if(ResultFailed(src) || (ResultTimeout(src) && Buffered == false)) {
+				rc = src;
+				break;
+			}
+
+			// Set up incoming message TLS objects and attempt to decrypt (in place, from first unprocessed byte):
+			SecBuffer Buffers[4] = {0};
+			Buffers[0].pvBuffer = ReadBuf.get() + ReadBufOffset;
+			Buffers[0].cbBuffer = gsl::narrow_cast<unsigned long>(ReadBufBytes);
+			Buffers[0].BufferType = SECBUFFER_DATA;
+			Buffers[1].BufferType = Buffers[2].BufferType = Buffers[3].BufferType = SECBUFFER_EMPTY;
+			SecBufferDesc BufferDesc = {0};
+			BufferDesc.ulVersion = SECBUFFER_VERSION;
+			BufferDesc.cBuffers = 4;
+			BufferDesc.pBuffers = Buffers;
+			const SECURITY_STATUS scRet = SocketOps::GetFunctionTable()->DecryptMessage(&hContext, &BufferDesc, 0, nullptr);
+
+			// If response code indicates continue needed, continue loop (note this is the only way
+			// for this loop to ever execute more than once, as all other paths below will break):
+			if(scRet == SEC_E_INCOMPLETE_MESSAGE) {
+				Timeout = SteadyClock().MSecTill(EndTime);
+				continue;
+			}
+			else if(scRet == SEC_I_CONTEXT_EXPIRED) {
+				// Remote has gracefully closed TLS session - shut down socket and return:
+				Shutdown();
+				rc = Result::Failed;
+				break;
+			}
+			else if(scRet != SEC_E_OK) {
+				// Non-wait error occurred; set error data:
+				Shutdown();
+				rc = Result::Failed;
+				LastErrString = "DecryptMessage: " + Exceptions::ConvertCOMError(scRet);
+				break;
+			}
+
+			// Data decrypted; step through returned data buffers, locating decrypted and 'extra' data
+			SecBuffer *DataBuf = nullptr, *ExtraBuf = nullptr;
+			for(short i = 0; i < 4; ++i) {
+				if(Buffers[i].BufferType == SECBUFFER_DATA) DataBuf = &Buffers[i];
+				else if(Buffers[i].BufferType == SECBUFFER_EXTRA) ExtraBuf = &Buffers[i];
+			}
+
+			// If decrypted data located, validate length and write to target (compacting cleartext buffer first, if
+			// there is not enough space following data already held):
+			if(DataBuf != nullptr ? (DataBuf->cbBuffer != 0) : false) {
+				if(ValueOps::Is(static_cast<size_t>(DataBuf->cbBuffer)).InRange(1, TLSBufSize - ClearBufBytes) && DataBuf->pvBuffer != nullptr) {
+					if(ClearBufOffset + ClearBufBytes + DataBuf->cbBuffer > TLSBufSize) CompactClearTLS();
+					memcpy(ClearBuf.get() + ClearBufOffset + ClearBufBytes, DataBuf->pvBuffer, DataBuf->cbBuffer);
+					ClearBufBytes += DataBuf->cbBuffer;
+				}
+				else { // Invalid data or buffer overrun, abort:
+					Shutdown();
+					rc = Result::Failed;
+					LastErrString = "Invalid inbound data or TLS buffer overrun";
+					break;
+				}
+			}
+
+			// If "extra" data was located after encrypted packet, advance read offset to it (leaving it in place):
+			if(ExtraBuf ? ValueOps::Is(static_cast<size_t>(ExtraBuf->cbBuffer)).InRange(1, ReadBufBytes) : false) {
+				ReadBufOffset += ReadBufBytes - ExtraBuf->cbBuffer;
+				ReadBufBytes = ExtraBuf->cbBuffer;
+			}
+			// Otherwise all available data has been decrypted, reset read offset and count:
+			else ReadBufOffset = ReadBufBytes = 0;
+
+			// If this point is reached, data decryption successful - break loop now:
+			rc = Result::OK;
+			break;
+
+		} // End for loop
+		return rc;
+	}
+	catch(const std::exception&) {std::throw_with_nested(FORMAT_RUNTIME_ERROR("Failed to read TLS data"));}
+}
+// SessionSocket::DataBuffered: Check for decrypted data, or raw data not yet decrypted, already read from socket
+_Check_return_ bool SocketOps::SessionSocket::DataBuffered() const noexcept {
+	return ((ClearBuf.get() ? (ClearBufBytes > 0) : false) || (ReadBuf.get() ? (ReadBufBytes > 0) : false));
+}
+// SessionSocket::TLSMessageMax: Largest message accepted by EncryptTLS (limited by negotiated protocol, and by read
+// buffer size less record header/trailer, so that a full message fits within read buffer of a peer of equal size)
+_Check_return_ size_t SocketOps::SessionSocket::TLSMessageMax() const noexcept {
+	const size_t Overhead = static_cast<size_t>(StreamSizes.cbHeader) + StreamSizes.cbTrailer;
+	return (std::min)((TLSBufSize > Overhead) ? TLSBufSize - Overhead : 0,
+		static_cast<size_t>(StreamSizes.cbMaximumMessage));
+}
+// SessionSocket::GetTLSCipherSuite, GetTLSCipher, GetTLSHash, GetTLSExchange: Retrieve negotiated cipher data
+std::string SocketOps::SessionSocket::GetTLSCipherSuite() const {
+	return StringOps::ConvertFromWideString(CipherInfo.szCipherSuite);
+}
+std::string SocketOps::SessionSocket::GetTLSCipher() const {return StringOps::ConvertFromWideString(CipherInfo.szCipher);}
+std::string SocketOps::SessionSocket::GetTLSHash() const {return StringOps::ConvertFromWideString(CipherInfo.szHash);}
+std::string SocketOps::SessionSocket::GetTLSExchange() const {return StringOps::ConvertFromWideString(CipherInfo.szExchange);}
+// SessionSocket::CloseTLS: Delete security context (if any), reset negotiated values
+void SocketOps::SessionSocket::CloseTLS() noexcept {
+	memset(&StreamSizes, 0, sizeof(StreamSizes));
+	memset(&CipherInfo, 0, sizeof(CipherInfo));
+	if(hContext.dwLower || hContext.dwUpper) {
+		SocketOps::GetFunctionTable()->DeleteSecurityContext(&hContext);
+		hContext.dwLower = hContext.dwUpper = 0;
+	}
+}
+#pragma endregion SocketOps::SessionSocket
+#endif // FIQ_TLS_OPENSSL
@@ -0,0 +1,138 @@
+#pragma once
+//==========================================================================================================================
+// SpscRing.h : Lock-free single-producer/single-consumer byte ring buffer
+//==========================================================================================================================
+
+#include <atomic>
+
+namespace FIQCPPBASE {
+
+//==========================================================================================================================
+// SpscRing: Fixed-capacity byte ring, written by one thread and read by another without locking
+// - Capacity is rounded up to a power of two (caller is responsible for bounding it); positions are running byte counts
+//   (never wrapped), so that the ring is empty when read and write positions are equal and full when they differ by
+//   capacity
+// - Each side caches the other side's last-seen position, and only reloads it when the cached value does not allow the
+//   operation to complete; positions are updated with sequentially-consistent stores, so that a producer which sees the
+//   read position equal to its write position prior to a write (see Drained) knows that the consumer cannot have
+//   observed the write's data (and may need to be woken)
+// - Only one thread at a time may call producer functions, and only one thread at a time consumer functions (a thread
+//   may take over either role if ordered against the previous holder, e.g. by a mutex)
+// - Positions and data are held in a single region, either allocated by the ring or supplied by the caller (e.g. a
+//   shared-memory section, see SharedRing); a region may be attached by one ring object for each side, in different
+//   processes if mapped by both, provided only one of them initializes it
+class SpscRing {
+public:
+	//======================================================================================================================
+	// Public definitions
+	static constexpr size_t CAPACITY_MIN = 0x1000;
+	// RegionSize: Size of region required for ring of specified capacity (rounded as described above)
+	_Check_return_ static size_t RegionSize(size_t capacity) noexcept {return sizeof(Positions) + RoundCapacity(capacity);}
+
+	//======================================================================================================================
+	// Producer functions
+	// - Write: Copy as much of data as ring has space for; returns number of bytes written
+	// - WritePosition: Running count of bytes written; Drained: Consumer has read everything up to specified position
+	_Check_return_ size_t Write(_In_reads_(len) const char* src, size_t len) noexcept;
+	_Check_return_ size_t WritePosition() const noexcept {return pos.writepos.load(std::memory_order_relaxed);}
+	_Check_return_ bool Drained(size_t position) const noexcept {return (pos.readpos.load() == position);}
+
+	//======================================================================================================================
+	// Consumer functions
+	// - Read: Copy up to MaxBytes from ring, returning number of bytes read
+	// - Peek: Copy specified number of bytes without removing them (returns false if fewer are available)
+	// - Available: Number of bytes available for reading
+	_Check_return_ size_t Read(_Out_writes_(MaxBytes) char* tgt, size_t MaxBytes) noexcept;
+	_Check_return_ bool Peek(_Out_writes_(len) char* tgt, size_t len) noexcept;
+	_Check_return_ size_t Available() noexcept {
+		return ((pos.readcache = pos.writepos.load()) - pos.readpos.load(std::memory_order_relaxed));
+	}
+
+	//======================================================================================================================
+	// External accessors
+	_Check_return_ size_t Capacity() const noexcept {return capacity;}
+	_Check_return_ bool Empty() const noexcept {return (pos.readpos.load() == pos.writepos.load());}
+
+	//======================================================================================================================
+	// Public constructors, destructor
+	// - Region constructor attaches to caller's region (of at least RegionSize bytes, aligned for atomic access, and
+	//   outliving ring), initializing positions only if Initialize is set
+	explicit SpscRing(size_t _capacity) noexcept(false)
+		: capacity(RoundCapacity(_capacity)), mask(capacity - 1), owned(std::make_unique<char[]>(RegionSize(capacity))),
+		pos(*new(owned.get()) Positions()), buf(owned.get() + sizeof(Positions)) {}
+	SpscRing(_Inout_updates_bytes_(RegionSize(_capacity)) void* Region, size_t _capacity, bool Initialize) noexcept
+		: capacity(RoundCapacity(_capacity)), mask(capacity - 1), owned(nullptr),
+		pos(Initialize ? *new(Region) Positions() : *static_cast<Positions*>(Region)),
+		buf(static_cast<char*>(Region) + sizeof(Positions)) {}
+	~SpscRing() noexcept(false) = default;
+	// Deleted copy/move constructors and assignment operators
+	SpscRing(const SpscRing&) = delete;
+	SpscRing(SpscRing&&) = delete;
+	SpscRing& operator=(const SpscRing&) = delete;
+	SpscRing& operator=(SpscRing&&) = delete;
+
+private:
+
+	// Private utility functions
+	_Check_return_ static size_t RoundCapacity(size_t requested) noexcept {
+		size_t c = CAPACITY_MIN;
+		while(c < requested) c <<= 1;
+		return c;
+	}
+	void CopyOut(size_t position, _Out_writes_(len) char* tgt, size_t len) const noexcept {
+		const size_t offset = (position & mask), first = (std::min)(len, capacity - offset);
+		memcpy(tgt, buf + offset, first);
+		if(len > first) memcpy(tgt + first, buf, len - first);
+	}
+
+	// Private members (producer and consumer positions are kept on separate cache lines, at start of region)
+	static constexpr size_t CACHE_LINE = 64;
+	struct Positions {
+		char pad0[CACHE_LINE];
+		std::atomic<size_t> writepos{0};	// Updated by producer
+		size_t writecache = 0;				// Producer's last-seen read position
+		char pad1[CACHE_LINE - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+		std::atomic<size_t> readpos{0};	// Updated by consumer
+		size_t readcache = 0;				// Consumer's last-seen write position
+		char pad2[CACHE_LINE - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+	};
+	const size_t capacity;
+	const size_t mask;
+	const std::unique_ptr<char[]> owned;	// Region allocated by ring (null if supplied by caller)
+	Positions& pos;
+	char* const buf;
+};
+
+//==========================================================================================================================
+// SpscRing::Write: Copy data into ring (up to available space), then publish new write position
+inline _Check_return_ size_t SpscRing::Write(_In_reads_(len) const char* src, size_t len) noexcept {
+	const size_t position = pos.writepos.load(std::memory_order_relaxed);
+	if(capacity - (position - pos.writecache) < len) pos.writecache = pos.readpos.load();
+	const size_t bytes = (std::min)(len, capacity - (position - pos.writecache));
+	if(bytes == 0) return 0;
+	const size_t offset = (position & mask), first = (std::min)(bytes, capacity - offset);
+	memcpy(buf + offset, src, first);
+	if(bytes > first) memcpy(buf, src + first, bytes - first);
+	pos.writepos.store(position + bytes);
+	return bytes;
+}
+// SpscRing::Read: Copy available data out of ring (up to MaxBytes), then publish new read position
+inline _Check_return_ size_t SpscRing::Read(_Out_writes_(MaxBytes) char* tgt, size_t MaxBytes) noexcept {
+	const size_t position = pos.readpos.load(std::memory_order_relaxed);
+	if(pos.readcache - position < MaxBytes) pos.readcache = pos.writepos.load(std::memory_order_acquire);
+	const size_t bytes = (std::min)(MaxBytes, pos.readcache - position);
+	if(bytes == 0) return 0;
+	CopyOut(position, tgt, bytes);
+	pos.readpos.store(position + bytes);
+	return bytes;
+}
+// SpscRing::Peek: Copy data from ring without publishing new read position
+inline _Check_return_ bool SpscRing::Peek(_Out_writes_(len) char* tgt, size_t len) noexcept {
+	const size_t position = pos.readpos.load(std::memory_order_relaxed);
+	if(pos.readcache - position < len) pos.readcache = pos.writepos.load(std::memory_order_acquire);
+	if(pos.readcache - position < len) return false;
+	CopyOut(position, tgt, len);
+	return true;
+}
+
+}; // (end namespace FIQCPPBASE)
@@ -16,4 +16,32 @@ constexpr T narrow_cast(U&& u) noexcept {
 	return static_cast<T>(std::forward<U>(u));
 }
 
+// span: a non-owning view of a contiguous sequence of objects (subset of GSL/C++20 interface: fixed extent not supported)
+template <class T>
+class span {
+public:
+	using element_type = T;
+	using index_type = size_t;
+	using pointer = T*;
+	using reference = T&;
+	using iterator = T*;
+
+	constexpr span() noexcept : ptr(nullptr), len(0) {}
+	constexpr span(pointer _ptr, index_type _len) noexcept : ptr(_ptr), len(_len) {}
+	template <class U, class = typename std::enable_if<std::is_convertible<U(*)[], T(*)[]>::value>::type>
+	constexpr span(const span<U>& other) noexcept : ptr(other.data()), len(other.size()) {}
+
+	constexpr pointer data() const noexcept {return ptr;}
+	constexpr index_type size() const noexcept {return len;}
+	constexpr bool empty() const noexcept {return (len == 0);}
+	constexpr iterator begin() const noexcept {return ptr;}
+	constexpr iterator end() const noexcept {return ptr + len;}
+	constexpr reference operator[](index_type idx) const noexcept {return ptr[idx];}
+	constexpr span subspan(index_type offset, index_type count) const noexcept {return span(ptr + offset, count);}
+
+private:
+	pointer ptr;
+	index_type len;
+};
+
 }; // (end namespace gsl)
\ No newline at end of file
@@ -0,0 +1,399 @@
+//==========================================================================================================================
+// Benchmark.cpp : Comms load generator - opens sessions to a listener, exchanges echoed packets and reports latencies
+//==========================================================================================================================
+// Usage: fiQ.CPP.Benchmark [NAME=VALUE]... (all parameters optional; see BenchConfig for defaults)
+// - TARGET=ADDR:PORT: Connect to external echo listener (otherwise an echo listener is registered locally on PORT)
+// - UNIXPATH=PATH: Register local echo listener on unix domain socket at PATH instead of PORT (for comparison against
+//   loopback TCP with otherwise identical parameters)
+// - MODE=TCP|EXTHEADER|TLS: Packet framing, or TLS sessions (TLS requires TLSCERT=MY(NAME) for local listener, and
+//   uses TLSMETHOD for both sides)
+// - SESSIONS, THREADS (load generator threads), COMMTHREADS, BACKEND=POLL|IOCP
+// - RATE: Packets per second per session (open loop, latency measured from scheduled send time), or 0 for closed loop
+//   (each session sends next packet as soon as previous one is echoed)
+// - SIZE (payload bytes), WARMUP and DURATION (milliseconds), OUTPUT (JSON results file, otherwise written to stdout)
+
+#include "pch.h"
+#include "Comms/Comms.h"
+#include "Logging/ConsoleSink.h"
+#include "Tools/Exceptions.h"
+#include "LatencyHistogram.h"
+#include <thread>
+#include <unordered_map>
+using namespace FIQCPPBASE;
+
+//==========================================================================================================================
+// BenchConfig: Benchmark parameters, read from command line
+struct BenchConfig {
+	std::string target;						// Remote echo listener, blank to use local listener
+	unsigned short port = 8200;				// Local listener port
+	std::string unixpath;					// Local listener unix domain socket path, blank to use port
+	std::string mode = "TCP";
+	std::string tlscert;
+	std::string tlsmethod = "TLS";
+	size_t sessions = 100;
+	size_t threads = 4;
+	size_t commthreads = 4;
+	Comms::Backend backend = Comms::Backend::Poll;
+	unsigned int rate = 0;					// Packets per second per session (zero for closed loop)
+	size_t size = 64;						// Payload size (at least PAYLOAD_MIN)
+	int warmup = 1000;
+	int duration = 10000;
+	std::string output;
+	static constexpr size_t PAYLOAD_MIN = 16;	// Send timestamp, sequence number and load thread index
+
+	// Read: Parse NAME=VALUE arguments (returns false, with error text, if any are invalid)
+	_Check_return_ bool Read(int argc, char* argv[], std::string& error) {
+		for(int a = 1; a < argc; ++a) {
+			const char* const separator = strchr(argv[a], '=');
+			if(separator == nullptr) {
+				error = std::string("Invalid argument ") + argv[a];
+				return false;
+			}
+			const std::string name(argv[a], separator - argv[a]);
+			const char* const value = separator + 1;
+			if(_stricmp(name.c_str(), "TARGET") == 0) target = value;
+			else if(_stricmp(name.c_str(), "PORT") == 0) port = gsl::narrow_cast<unsigned short>(atoi(value));
+			else if(_stricmp(name.c_str(), "UNIXPATH") == 0) unixpath = value;
+			else if(_stricmp(name.c_str(), "MODE") == 0) mode = value;
+			else if(_stricmp(name.c_str(), "TLSCERT") == 0) tlscert = value;
+			else if(_stricmp(name.c_str(), "TLSMETHOD") == 0) tlsmethod = value;
+			else if(_stricmp(name.c_str(), "SESSIONS") == 0) sessions = strtoul(value, nullptr, 10);
+			else if(_stricmp(name.c_str(), "THREADS") == 0) threads = strtoul(value, nullptr, 10);
+			else if(_stricmp(name.c_str(), "COMMTHREADS") == 0) commthreads = strtoul(value, nullptr, 10);
+			else if(_stricmp(name.c_str(), "BACKEND") == 0)
+				backend = (_stricmp(value, "IOCP") == 0) ? Comms::Backend::CompletionPort : Comms::Backend::Poll;
+			else if(_stricmp(name.c_str(), "RATE") == 0) rate = strtoul(value, nullptr, 10);
+			else if(_stricmp(name.c_str(), "SIZE") == 0) size = strtoul(value, nullptr, 10);
+			else if(_stricmp(name.c_str(), "WARMUP") == 0) warmup = atoi(value);
+			else if(_stricmp(name.c_str(), "DURATION") == 0) duration = atoi(value);
+			else if(_stricmp(name.c_str(), "OUTPUT") == 0) output = value;
+			else {
+				error = "Unrecognized parameter " + name;
+				return false;
+			}
+		}
+		if(_stricmp(mode.c_str(), "TCP") && _stricmp(mode.c_str(), "EXTHEADER") && _stricmp(mode.c_str(), "TLS"))
+			error = "MODE must be TCP, EXTHEADER or TLS";
+		else if(target.empty() && port == 0 && unixpath.empty()) error = "Invalid PORT";
+		else if(sessions == 0 || threads == 0 || commthreads == 0)
+			error = "SESSIONS, THREADS and COMMTHREADS must be nonzero";
+		else if(size < PAYLOAD_MIN || size > Comms::PACKET_SIZE_MAX) error = "SIZE out of range";
+		else if(warmup < 0 || duration <= 0) error = "Invalid WARMUP or DURATION";
+		else if(IsTLS() && target.empty() && tlscert.empty()) error = "TLSCERT required for local TLS listener";
+		return error.empty();
+	}
+	_Check_return_ bool IsTLS() const noexcept {return (_stricmp(mode.c_str(), "TLS") == 0);}
+	// LocalAddress: Address of local echo listener, as used by connecting side
+	_Check_return_ std::string LocalAddress() const {
+		return unixpath.empty() ? ("127.0.0.1:" + std::to_string(port)) : ("unix:" + unixpath);
+	}
+	// Apply: Set framing and TLS options on connection (listener or client side)
+	void Apply(Connection& connection, bool listener) const {
+		if(_stricmp(mode.c_str(), "EXTHEADER") == 0) connection.SetFlagOn(CommFlags::ExtendedHeader);
+		else if(IsTLS()) {
+			if(listener) connection.AddConfigParm(std::string("TLSCERT"), std::string(tlscert));
+			connection.AddConfigParm(std::string("TLSMETHOD"), std::string(tlsmethod));
+		}
+	}
+};
+
+//==========================================================================================================================
+// EchoServer: Local listener client, returning each packet to its sender
+class EchoServer : public CommsClient {
+public:
+	void IBConnect(unsigned int) noexcept(false) override {}
+	void IBData(unsigned int session, _In_reads_(len) const char* buf, size_t len) noexcept(false) override {
+		if(Comms::ResultOK(Comms::Send(session, buf, len)) == false) ++failed;
+	}
+	void IBDisconnect(unsigned int) noexcept(false) override {}
+	EchoServer() : CommsClient(name) {}
+	std::atomic<unsigned long long> failed{0};
+private:
+	const std::string name = "ECHOSERVER";
+};
+
+//==========================================================================================================================
+// LoadGenerator: Client owning benchmark sessions; each load thread drives a share of the sessions, and echoed packets
+// are attributed to the thread which sent them (by index carried in payload)
+class LoadGenerator : public CommsClient {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	// ThreadStats: Counters for one load thread (updated from load thread and comms threads)
+	struct ThreadStats {
+		std::vector<Comms::SessionTicket> sessions;
+		std::atomic<unsigned long long> sent{0};
+		std::atomic<unsigned long long> received{0};	// Packets echoed, and sent within measurement window
+		std::atomic<unsigned long long> sendfailed{0};
+		LatencyHistogram rtt;
+	};
+
+	//======================================================================================================================
+	// Comms event handlers
+	void IBConnect(unsigned int session) noexcept(false) override {
+		const Clock::time_point now = Clock::now();
+		std::lock_guard<std::mutex> lock(connectlock);
+		connected.emplace(session, now);
+	}
+	void IBData(unsigned int session, _In_reads_(len) const char* buf, size_t len) noexcept(false) override {
+		const Clock::time_point now = Clock::now();
+		if(len < BenchConfig::PAYLOAD_MIN) return;
+		unsigned long long stamp = 0;
+		unsigned int index = 0;
+		memcpy(&stamp, buf, sizeof(stamp));
+		memcpy(&index, buf + 12, sizeof(index));
+		if(index >= stats.size()) return;
+		ThreadStats& ts = *(stats[index]);
+		if(InWindow(stamp)) {
+			ts.received.fetch_add(1, std::memory_order_relaxed);
+			ts.rtt.Record(static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+				now - origin).count()) - stamp);
+		}
+		// In closed-loop mode, echo of previous packet triggers next:
+		if(config.rate == 0 && stopping == false) SendPacket(ts, session, index, now);
+	}
+	void IBDisconnect(unsigned int) noexcept(false) override {++disconnected;}
+
+	//======================================================================================================================
+	// Benchmark phases
+	// - Connect: Request all sessions (distributed across load threads), and wait for them to connect
+	// - Run: Start load threads, and wait for warmup and measurement to complete
+	void Connect(LatencyHistogram& connecttimes);
+	void Run();
+	void Disconnect();
+
+	//======================================================================================================================
+	// External accessors
+	_Check_return_ const std::vector<std::unique_ptr<ThreadStats>>& GetStats() const noexcept {return stats;}
+	_Check_return_ size_t GetConnected() const noexcept {return connectedcount;}
+	_Check_return_ size_t GetConnectFailed() const noexcept {return connectfailed;}
+	_Check_return_ int GetMeasuredMSec() const noexcept {return config.duration;}
+
+	explicit LoadGenerator(const BenchConfig& _config) : CommsClient(name), config(_config), payload(_config.size, 'x') {
+		for(size_t t = 0; t < config.threads; ++t) stats.emplace_back(std::make_unique<ThreadStats>());
+	}
+
+private:
+
+	// Private utility functions
+	_Check_return_ bool InWindow(unsigned long long stamp) const noexcept {
+		return (stamp >= windowstart && stamp < windowend);
+	}
+	void SendPacket(ThreadStats& ts, Comms::SessionTicket session, unsigned int index, Clock::time_point scheduled);
+	void LoadThread(unsigned int index);
+
+	// Private members
+	const std::string name = "LOADGENERATOR";
+	const BenchConfig& config;
+	const std::vector<char> payload;	// Packet template (stamp and index are written into a copy for each send)
+	const Clock::time_point origin = Clock::now();
+	unsigned long long windowstart = 0;	// Measurement window, as nanoseconds since origin
+	unsigned long long windowend = 0;
+	std::atomic_bool stopping{false};
+	std::atomic<size_t> disconnected{0};
+	std::vector<std::unique_ptr<ThreadStats>> stats;
+	std::mutex connectlock;
+	std::unordered_map<Comms::SessionTicket, Clock::time_point> connected;
+	size_t connectedcount = 0;
+	size_t connectfailed = 0;
+};
+// LoadGenerator::SendPacket: Send packet stamped with scheduled send time (thread-safe; buffer is per call)
+void LoadGenerator::SendPacket(ThreadStats& ts, Comms::SessionTicket session, unsigned int index,
+	Clock::time_point scheduled) {
+	char buf[Comms::PACKET_SIZE_MAX];
+	memcpy(buf, payload.data(), payload.size());
+	const unsigned long long stamp =
+		static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(scheduled - origin).count());
+	const unsigned int sequence = gsl::narrow_cast<unsigned int>(ts.sent.load(std::memory_order_relaxed));
+	memcpy(buf, &stamp, sizeof(stamp));
+	memcpy(buf + 8, &sequence, sizeof(sequence));
+	memcpy(buf + 12, &index, sizeof(index));
+	if(Comms::ResultOK(Comms::Send(session, buf, payload.size()))) ts.sent.fetch_add(1, std::memory_order_relaxed);
+	else ts.sendfailed.fetch_add(1, std::memory_order_relaxed);
+}
+// LoadGenerator::Connect: Request sessions (round-robin across load threads), wait for all to connect, then record
+// time from request to connect callback for each
+void LoadGenerator::Connect(LatencyHistogram& connecttimes) {
+	auto connection = std::make_shared<Connection>();
+	connection->SetRemote(config.target.empty() ? config.LocalAddress() : config.target);
+	config.Apply(*connection, false);
+	std::unordered_map<Comms::SessionTicket, Clock::time_point> requested;
+	std::string lasterr;
+	for(size_t s = 0; s < config.sessions; ++s) {
+		const Clock::time_point start = Clock::now();
+		const Comms::SessionTicket ticket = Comms::RequestConnect(shared_from_this(), connection, &lasterr);
+		if(ticket == 0) {
+			LOG_FROM_TEMPLATE(LogLevel::Warn, "Connect request failed: {:S60}", lasterr.c_str());
+			++connectfailed;
+			continue;
+		}
+		requested.emplace(ticket, start);
+		stats[s % stats.size()]->sessions.push_back(ticket);
+	}
+	const SteadyClock waituntil(std::chrono::milliseconds{30000});
+	for(;;) {
+		{std::lock_guard<std::mutex> lock(connectlock);
+		if(connected.size() + disconnected >= requested.size() || waituntil.IsPast()) break;}
+		Sleep(10);
+	}
+	std::lock_guard<std::mutex> lock(connectlock);
+	for(const auto& r : requested) {
+		const auto seek = connected.find(r.first);
+		if(seek == connected.end()) ++connectfailed;
+		else connecttimes.Record(static_cast<unsigned long long>(
+			std::chrono::duration_cast<std::chrono::nanoseconds>(seek->second - r.second).count()));
+	}
+	connectedcount = connected.size();
+}
+// LoadGenerator::LoadThread: Send packets on this thread's sessions - in closed-loop mode, one packet per session
+// (subsequent packets are sent on echo); otherwise one packet per session per rate interval until stopped
+void LoadGenerator::LoadThread(unsigned int index) {
+	ThreadStats& ts = *(stats[index]);
+	if(config.rate == 0) {
+		for(const auto session : ts.sessions) SendPacket(ts, session, index, Clock::now());
+		return;
+	}
+	const Clock::duration interval = std::chrono::duration_cast<Clock::duration>(
+		std::chrono::nanoseconds{1000000000ULL / config.rate});
+	for(Clock::time_point scheduled = Clock::now(); stopping == false; scheduled += interval) {
+		// Latency is measured from scheduled time, so that sends delayed by a stalled session are not under-reported:
+		std::this_thread::sleep_until(scheduled);
+		for(const auto session : ts.sessions) SendPacket(ts, session, index, scheduled);
+	}
+}
+// LoadGenerator::Run: Start load threads, wait for warmup and measurement window, then stop load
+void LoadGenerator::Run() {
+	const auto sincestart = [this](int msec) {
+		return static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			(Clock::now() + std::chrono::milliseconds{msec}) - origin).count());
+	};
+	windowstart = sincestart(config.warmup);
+	windowend = sincestart(config.warmup + config.duration);
+	std::vector<std::thread> threads;
+	for(unsigned int t = 0; t < gsl::narrow_cast<unsigned int>(stats.size()); ++t)
+		threads.emplace_back([this, t]() {LoadThread(t);});
+	std::this_thread::sleep_for(std::chrono::milliseconds{config.warmup + config.duration});
+	stopping = true;
+	for(auto& t : threads) t.join();
+	std::this_thread::sleep_for(std::chrono::milliseconds{500}); // Allow packets in flight to be echoed
+}
+// LoadGenerator::Disconnect: Drop all sessions
+void LoadGenerator::Disconnect() {
+	for(const auto& ts : stats) for(const auto session : ts->sessions) static_cast<void>(Comms::Disconnect(session));
+}
+
+//==========================================================================================================================
+// WriteLatencies: Write histogram summary as JSON object (values in microseconds)
+static void WriteLatencies(FILE* f, const char* name, const LatencyHistogram& h) {
+	const auto usec = [](unsigned long long ns) {return ns / 1000.0;};
+	fprintf(f, "\"%s\": {\"count\": %llu, \"min\": %.3f, \"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, "
+		"\"p99_9\": %.3f, \"p99_99\": %.3f, \"max\": %.3f}", name, h.Count(), usec(h.Min()), h.Mean() / 1000.0,
+		usec(h.Percentile(50.0)), usec(h.Percentile(90.0)), usec(h.Percentile(99.0)), usec(h.Percentile(99.9)),
+		usec(h.Percentile(99.99)), usec(h.Max()));
+}
+// WriteResults: Write configuration, connection times and per-thread and total throughput and latency as JSON
+static void WriteResults(FILE* f, const BenchConfig& config, const LoadGenerator& generator,
+	const LatencyHistogram& connecttimes, unsigned long long echofailed) {
+	const double seconds = generator.GetMeasuredMSec() / 1000.0;
+	fprintf(f, "{\n  \"config\": {\"target\": \"%s\", \"mode\": \"%s\", \"sessions\": %zu, \"threads\": %zu, "
+		"\"commthreads\": %zu, \"backend\": \"%s\", \"rate\": %u, \"size\": %zu, \"warmup_ms\": %d, "
+		"\"duration_ms\": %d},\n",
+		config.target.empty() ? config.LocalAddress().c_str() : config.target.c_str(), config.mode.c_str(),
+		config.sessions, config.threads, config.commthreads,
+		(config.backend == Comms::Backend::CompletionPort) ? "iocp" : "poll", config.rate, config.size, config.warmup,
+		config.duration);
+	fprintf(f, "  \"connect\": {\"connected\": %zu, \"failed\": %zu, ", generator.GetConnected(),
+		generator.GetConnectFailed());
+	WriteLatencies(f, "latency_us", connecttimes);
+	fprintf(f, "},\n  \"threads\": [\n");
+	LatencyHistogram total;
+	unsigned long long sent = 0, received = 0, sendfailed = 0;
+	const auto& stats = generator.GetStats();
+	for(size_t t = 0; t < stats.size(); ++t) {
+		const LoadGenerator::ThreadStats& ts = *(stats[t]);
+		fprintf(f, "    {\"thread\": %zu, \"sessions\": %zu, \"sent\": %llu, \"received\": %llu, \"send_failed\": %llu, "
+			"\"packets_per_sec\": %.1f, \"mbytes_per_sec\": %.3f, ", t, ts.sessions.size(), ts.sent.load(),
+			ts.received.load(), ts.sendfailed.load(), ts.received / seconds,
+			(ts.received * config.size) / seconds / 1000000.0);
+		WriteLatencies(f, "rtt_us", ts.rtt);
+		fprintf(f, "}%s\n", (t + 1 < stats.size()) ? "," : "");
+		total.Merge(ts.rtt);
+		sent += ts.sent;
+		received += ts.received;
+		sendfailed += ts.sendfailed;
+	}
+	fprintf(f, "  ],\n  \"total\": {\"sent\": %llu, \"received\": %llu, \"send_failed\": %llu, \"echo_failed\": %llu, "
+		"\"packets_per_sec\": %.1f, \"mbytes_per_sec\": %.3f, ", sent, received, sendfailed, echofailed,
+		received / seconds, (received * config.size) / seconds / 1000000.0);
+	WriteLatencies(f, "rtt_us", total);
+	fprintf(f, "}\n}\n");
+}
+
+//==========================================================================================================================
+// RunBenchmark: Register local echo listener (unless targeting external listener), connect sessions, run load and
+// write results
+static int RunBenchmark(const BenchConfig& config) {
+	Comms::Initialize(config.commthreads, config.backend);
+	int rc = 1;
+	{auto server = std::make_shared<EchoServer>();
+	auto generator = std::make_shared<LoadGenerator>(config);
+	Comms::ListenerTicket lticket = 0;
+	std::string lasterr;
+	if(config.target.empty()) {
+		auto connection = std::make_shared<Connection>();
+		if(config.unixpath.empty()) connection->SetLocal(config.port);
+		else connection->SetLocal(config.LocalAddress());
+		connection->SetFlagOn(CommFlags::ShardedListen)
+			.AddConfigParm(std::string("BACKLOG"), std::string("4096"));
+		config.Apply(*connection, true);
+		lticket = Comms::RegisterListener(server, connection, &lasterr);
+		if(lticket == 0) LOG_FROM_TEMPLATE(LogLevel::Error, "Listener registration failed: {:S60}", lasterr.c_str());
+	}
+	if(config.target.empty() == false || lticket != 0) {
+		LatencyHistogram connecttimes;
+		generator->Connect(connecttimes);
+		if(generator->GetConnected() > 0) {
+			generator->Run();
+			FILE* f = config.output.empty() ? stdout : nullptr;
+			if(f == nullptr && fopen_s(&f, config.output.c_str(), "w") != 0) {
+				LOG_FROM_TEMPLATE(LogLevel::Error, "Failed to open output file {:S60}", config.output.c_str());
+				f = stdout;
+			}
+			WriteResults(f, config, *generator, connecttimes, server->failed);
+			if(f != stdout) fclose(f);
+			rc = 0;
+		}
+		else LOG_FROM_TEMPLATE(LogLevel::Error, "No sessions connected");
+		generator->Disconnect();
+	}
+	if(lticket != 0) Comms::DeregisterListener(lticket, 1000);}
+	Comms::Cleanup();
+	return rc;
+}
+
+int main(int argc, char* argv[])
+{
+	_set_invalid_parameter_handler(Exceptions::InvalidParameterHandler);
+	_set_se_translator(Exceptions::StructuredExceptionTranslator);
+	SetUnhandledExceptionFilter(&Exceptions::UnhandledExceptionFilter);
+
+	try {
+		BenchConfig config;
+		std::string error;
+		if(config.Read(argc, argv, error) == false) {
+			fprintf(stderr, "%s\n", error.c_str());
+			return 2;
+		}
+		LogSink::AddSink<ConsoleSink>(LogLevel::Warn, ConsoleSink::Config { });
+		LogSink::InitializeSinks();
+		SocketOps::InitializeSockets(true);
+		const int rc = RunBenchmark(config);
+		SocketOps::CleanupSockets();
+		return rc;
+	}
+	catch(const std::exception& e) {
+		const auto exceptioncontext = Exceptions::UnrollException(e);
+		LOG_FROM_TEMPLATE_CONTEXT(LogLevel::Error, &exceptioncontext, "Caught exception");
+	}
+	return 1;
+}
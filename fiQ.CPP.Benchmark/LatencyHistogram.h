@@ -0,0 +1,108 @@
+#pragma once
+//==========================================================================================================================
+// LatencyHistogram.h : High-dynamic-range histogram of latency values, for benchmark reporting
+//==========================================================================================================================
+
+#include <atomic>
+
+namespace FIQCPPBASE {
+
+//==========================================================================================================================
+// LatencyHistogram: Log-linear histogram of nanosecond values, recordable concurrently from any number of threads
+// - Values below SUB_BUCKETS are counted exactly; above that, each power-of-two range is divided into SUB_BUCKETS/2
+//   linear buckets, so that any recorded value is reported to within 0.1% (three significant digits), as for
+//   HdrHistogram; values above VALUE_MAX are counted as VALUE_MAX
+// - Percentiles report the highest value equivalent to the bucket holding the requested rank
+class LatencyHistogram {
+public:
+	//======================================================================================================================
+	// Public definitions
+	static constexpr unsigned long long SUB_BUCKETS	= 2048;
+	static constexpr unsigned int MAGNITUDES		= 30;					// Power-of-two ranges above SUB_BUCKETS
+	static constexpr unsigned long long VALUE_MAX	= (SUB_BUCKETS << MAGNITUDES) - 1;	// Approximately 2200 seconds
+	static constexpr size_t BUCKET_COUNT			= SUB_BUCKETS + (MAGNITUDES * (SUB_BUCKETS / 2));
+
+	//======================================================================================================================
+	// Recording functions
+	void Record(unsigned long long value) noexcept {
+		if(value > VALUE_MAX) value = VALUE_MAX;
+		counts[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+		total.fetch_add(1, std::memory_order_relaxed);
+		sum.fetch_add(value, std::memory_order_relaxed);
+		for(unsigned long long m = minimum.load(std::memory_order_relaxed);
+			value < m && minimum.compare_exchange_weak(m, value, std::memory_order_relaxed) == false;);
+		for(unsigned long long m = maximum.load(std::memory_order_relaxed);
+			value > m && maximum.compare_exchange_weak(m, value, std::memory_order_relaxed) == false;);
+	}
+	// Merge: Add all values recorded in another histogram (other histogram should not be recorded to concurrently)
+	void Merge(const LatencyHistogram& other) noexcept {
+		for(size_t b = 0; b < BUCKET_COUNT; ++b) {
+			const unsigned long long c = other.counts[b].load(std::memory_order_relaxed);
+			if(c > 0) counts[b].fetch_add(c, std::memory_order_relaxed);
+		}
+		total.fetch_add(other.Count(), std::memory_order_relaxed);
+		sum.fetch_add(other.sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		if(other.Count() > 0) {
+			if(other.Min() < minimum.load(std::memory_order_relaxed)) minimum = other.Min();
+			if(other.Max() > maximum.load(std::memory_order_relaxed)) maximum = other.Max();
+		}
+	}
+
+	//======================================================================================================================
+	// Reporting functions (call once recording has completed)
+	_Check_return_ unsigned long long Count() const noexcept {return total.load(std::memory_order_relaxed);}
+	_Check_return_ unsigned long long Min() const noexcept {return (Count() > 0 ? minimum.load() : 0);}
+	_Check_return_ unsigned long long Max() const noexcept {return maximum.load();}
+	_Check_return_ double Mean() const noexcept {
+		return (Count() > 0 ? static_cast<double>(sum.load()) / static_cast<double>(Count()) : 0.0);
+	}
+	// Percentile: Retrieve value at or below which specified percentage (0-100) of recorded values fall
+	_Check_return_ unsigned long long Percentile(double percentile) const noexcept {
+		const unsigned long long count = Count();
+		if(count == 0) return 0;
+		const double fraction = (std::min)((std::max)(percentile, 0.0), 100.0) / 100.0;
+		const unsigned long long rank = (std::max)(1ULL, static_cast<unsigned long long>(fraction * count + 0.5));
+		unsigned long long seen = 0;
+		for(size_t b = 0; b < BUCKET_COUNT; ++b) {
+			if((seen += counts[b].load(std::memory_order_relaxed)) >= rank)
+				return (std::min)(HighestEquivalent(b), Max());
+		}
+		return Max();
+	}
+
+	//======================================================================================================================
+	// Public constructor, destructor
+	LatencyHistogram() noexcept(false) : counts(std::make_unique<std::atomic<unsigned long long>[]>(BUCKET_COUNT)) {}
+	~LatencyHistogram() noexcept(false) = default;
+	// Deleted copy/move constructors and assignment operators
+	LatencyHistogram(const LatencyHistogram&) = delete;
+	LatencyHistogram(LatencyHistogram&&) = delete;
+	LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+	LatencyHistogram& operator=(LatencyHistogram&&) = delete;
+
+private:
+
+	// Private utility functions: BucketIndex maps value to bucket, HighestEquivalent maps bucket to largest value in it
+	_Check_return_ static size_t BucketIndex(unsigned long long value) noexcept {
+		if(value < SUB_BUCKETS) return gsl::narrow_cast<size_t>(value);
+		unsigned int shift = 1;
+		while((value >> shift) >= SUB_BUCKETS) ++shift;
+		return gsl::narrow_cast<size_t>(
+			SUB_BUCKETS + ((shift - 1) * (SUB_BUCKETS / 2)) + ((value >> shift) - (SUB_BUCKETS / 2)));
+	}
+	_Check_return_ static unsigned long long HighestEquivalent(size_t bucket) noexcept {
+		if(bucket < SUB_BUCKETS) return bucket;
+		const unsigned int shift = gsl::narrow_cast<unsigned int>((bucket - SUB_BUCKETS) / (SUB_BUCKETS / 2)) + 1;
+		const unsigned long long sub = ((bucket - SUB_BUCKETS) % (SUB_BUCKETS / 2)) + (SUB_BUCKETS / 2);
+		return (((sub + 1) << shift) - 1);
+	}
+
+	// Private members
+	const std::unique_ptr<std::atomic<unsigned long long>[]> counts;
+	std::atomic<unsigned long long> total{0};
+	std::atomic<unsigned long long> sum{0};
+	std::atomic<unsigned long long> minimum{ULLONG_MAX};
+	std::atomic<unsigned long long> maximum{0};
+};
+
+}; // (end namespace FIQCPPBASE)
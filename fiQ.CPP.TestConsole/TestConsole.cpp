@@ -17,14 +17,17 @@ void Outermost() {
 }
 
 #include "Comms/Comms.h"
+#include <thread>
 
 std::timed_mutex tmut;
 
 class testrec : public CommsClient, ThreadOperator<int> {
 public:
-	void IBConnect() noexcept(false) override {printf("IBConnect\n");}
-	void IBData() noexcept(false) override {printf("IBData\n");}
-	void IBDisconnect() noexcept(false) override {printf("IBDisconnect\n");}
+	void IBConnect(unsigned int session) noexcept(false) override {printf("IBConnect %08X\n", session);}
+	void IBData(unsigned int session, const char*, size_t len) noexcept(false) override {
+		printf("IBData %08X (%zu bytes)\n", session, len);
+	}
+	void IBDisconnect(unsigned int session) noexcept(false) override {printf("IBDisconnect %08X\n", session);}
 	Comms::ListenerTicket listen(unsigned short port) {
 		//printf("[%s]\n", c.GetConfigParm("test1").c_str());
 		//printf("[%s]\n", c.GetConfigParm("Test2.......................").c_str());
@@ -72,7 +75,83 @@ private:
 	const std::string name = "TESTREC";
 };
 
-int main()
+//==========================================================================================================================
+// Comms backend benchmark: Open a number of loopback sessions to a local listener, stream packets over a subset of them,
+// and report elapsed time and process CPU time until all packets are delivered (run once per backend, as Comms can only
+// be initialized once per process - e.g. "TestConsole bench poll 2000 50 1000" versus "TestConsole bench iocp ...")
+class benchrec : public CommsClient {
+public:
+	void IBConnect(unsigned int) noexcept(false) override {++connected;}
+	void IBData(unsigned int, const char*, size_t) noexcept(false) override {++received;}
+	void IBDisconnect(unsigned int) noexcept(false) override {--connected;}
+	benchrec() : CommsClient(name) {}
+	std::atomic<size_t> connected{0};
+	std::atomic<size_t> received{0};
+private:
+	const std::string name = "BENCHREC";
+};
+static long long ProcessCPUMSec() {
+	FILETIME created, exited, kernel, user;
+	if(GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user) == FALSE) return 0;
+	const auto ticks = [](const FILETIME& f) {return (static_cast<long long>(f.dwHighDateTime) << 32) | f.dwLowDateTime;};
+	return (ticks(kernel) + ticks(user)) / 10000;
+}
+static int RunBackendBenchmark(Comms::Backend backend, size_t sessions, size_t active, size_t packets) {
+	constexpr unsigned short port = 8100;
+	constexpr size_t senders = 4, payload = 64;
+	Comms::Initialize(4, backend);
+	int rc = 1;
+	{auto br = std::make_shared<benchrec>();
+	auto c = std::make_shared<Connection>();
+	c->SetLocal(port).ReadConfig(Tokenizer::CreateCopy<4>("SHARDED|BACKLOG=4096", "|"));
+	std::string lasterr;
+	const auto lticket = Comms::RegisterListener(br, c, &lasterr);
+	if(lticket == 0) printf("Listener registration failed [%s]\n", lasterr.c_str());
+	else {
+		// Connect all sessions, wait for server side to report them open:
+		std::vector<SocketOps::SessionSocketPtr> clients;
+		for(size_t i = 0; i < sessions; ++i) {
+			clients.emplace_back(SocketOps::SessionSocket::Connect("127.0.0.1", port, 5000));
+			if((clients.back().get() ? clients.back()->Valid() : false) == false) {
+				printf("Connect failed for session %zu\n", i);
+				clients.pop_back();
+				break;
+			}
+		}
+		const SteadyClock connectuntil(std::chrono::milliseconds{10000});
+		while(br->connected < clients.size() && connectuntil.IsPast() == false) Sleep(10);
+		active = (std::min)(active, clients.size());
+
+		// Stream packets over active sessions from sender threads, and wait for all to be delivered:
+		char packet[payload + 2] = {0, static_cast<char>(payload)};
+		const long long cpustart = ProcessCPUMSec();
+		const SteadyClock start;
+		std::vector<std::thread> threads;
+		for(size_t t = 0; t < senders; ++t) threads.emplace_back([&, t]() {
+			for(size_t p = 0; p < packets; ++p) {
+				for(size_t s = t; s < active; s += senders) {
+					if(SocketOps::ResultFailed(clients[s]->Send(packet, sizeof(packet)))) return;
+				}
+			}
+		});
+		for(auto& t : threads) t.join();
+		const SteadyClock receiveuntil(std::chrono::milliseconds{30000});
+		while(br->received < active * packets && receiveuntil.IsPast() == false) Sleep(1);
+		const int elapsed = SteadyClock().MSecSince(start);
+		const long long cpu = ProcessCPUMSec() - cpustart;
+		printf("%s: %zu sessions (%zu active), %zu/%zu packets in %dms (%.0f packets/sec), CPU %lldms\n",
+			backend == Comms::Backend::CompletionPort ? "iocp" : "poll", clients.size(), active,
+			br->received.load(), active * packets, elapsed,
+			elapsed > 0 ? (br->received * 1000.0 / elapsed) : 0.0, cpu);
+		rc = (br->received >= active * packets) ? 0 : 1;
+		clients.clear();
+		Comms::DeregisterListener(lticket, 1000);
+	}}
+	Comms::Cleanup();
+	return rc;
+}
+
+int main(int argc, char* argv[])
 {
 #ifdef _DEBUG
 	_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF|_CRTDBG_LEAK_CHECK_DF);
@@ -85,6 +164,16 @@ int main()
 		LogSink::AddSink<ConsoleSink>(LogLevel::Debug, ConsoleSink::Config { });
 		LogSink::InitializeSinks();
 		SocketOps::InitializeSockets(true);
+
+		// Run backend benchmark if requested ("bench [poll|iocp] [sessions] [active] [packets]"):
+		if(argc >= 2 ? (_stricmp(argv[1], "bench") == 0) : false) {
+			const int rc = RunBackendBenchmark(
+				(argc >= 3 ? (_stricmp(argv[2], "iocp") == 0) : false) ? Comms::Backend::CompletionPort : Comms::Backend::Poll,
+				argc >= 4 ? strtoul(argv[3], nullptr, 10) : 1000, argc >= 5 ? strtoul(argv[4], nullptr, 10) : 50,
+				argc >= 6 ? strtoul(argv[5], nullptr, 10) : 1000);
+			SocketOps::CleanupSockets();
+			return rc;
+		}
 		Comms::Initialize();
 
 		std::unique_lock<std::timed_mutex> lock(tmut);